@@ -129,6 +129,9 @@ Arguments ArgParser::Parse(int& argc, char** argv)
 		else if(c_arg.compare("-with_filter") == 0){ // bilateral filter kernel size
 			opt.filter_enabled = true;
 		}
+		else if(c_arg.compare("-with_tracking") == 0){ // frame-to-frame tracking
+			opt.tracking_enabled = true;
+		}
 		else if(c_arg.compare("-cam_offset") == 0){ // cuda camera procuder grid offset
 			if (argc >= pos) opt.camera_sampling_offset = atoi(  string(argv[pos+1]).c_str() );
 			else ParamError(c_arg);
@@ -208,6 +211,11 @@ void ArgParser::Display(void)
 	}else{
 		std::cout << "Filter:\t\t\tDisabled " << std::endl;
 	}
+	if (opt.tracking_enabled) {
+		std::cout << "Tracking:\t\t\tEnabled " << std::endl;
+	}else{
+		std::cout << "Tracking:\t\t\tDisabled " << std::endl;
+	}
 	std::cout << "\nCurrent working path: \t" << opt.current_path << std::endl;
 	
 	
@@ -33,6 +33,8 @@ typedef struct _Arguments
 	int		filter_kernel;
 	bool	filter_enabled;
 
+	bool	tracking_enabled;
+
 	float	sampling_grid_size;
 
 	string	intrincic_params_file;
@@ -83,6 +85,8 @@ typedef struct _Arguments
 		filter_kernel = 9;
 		filter_enabled = false;
 
+		tracking_enabled = false;
+
 	}
 
 
@@ -1,5 +1,6 @@
 #include "TrackingExpertDemo.h"
 #include "CamPose.h"
+#include "Profiler.h"
 
 using namespace texpert;
 
@@ -24,6 +25,10 @@ TrackingExpertDemo::~TrackingExpertDemo()
 	m_producers.clear();
 #endif
 	delete m_reg;
+
+#ifdef TRACKINGX_PROFILING
+	Profiler::WriteCSV("trackingx_profile.csv");
+#endif
 }
 
 void TrackingExpertDemo::init(void)
@@ -483,6 +488,9 @@ void TrackingExpertDemo::render_fcn(glm::mat4 pm, glm::mat4 vm)
 	// update the poses if a new scene model is available.
 	trackObject();
 
+	// per-stage latency of this frame, if TRACKINGX_PROFILING is defined
+	TX_PROFILE_FRAME();
+
 	switch (m_scene_type) {
 		case PC:
 			renderPointCloudScene(pm, vm);
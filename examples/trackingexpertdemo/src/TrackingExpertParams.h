@@ -30,6 +30,14 @@ typedef struct TEParams {
 	float		icp_outlier_reject_distance; // point outlier rejection distance [0.01f, 100]
 	float		icp_termination_dist; // ICP RMS termination criteria [0, inf]
 	float		icp_num_max_iterations; // ICP max. number of allowed iterations [1, 1000]
+	int			icp_num_hypotheses; // number of pose clusters ICP refines in parallel [1, inf]
+
+	// frame-to-frame tracking
+	bool		tracking_enabled; // skip global detection while the last pose is healthy. Off by default, opt in with -with_tracking
+	bool		tracking_constant_velocity; // predict the next pose from the motion between the last two frames
+	float		tracking_max_rms; // max. ICP rms of a healthy pose [0, inf]
+	float		tracking_min_inlier_fraction; // min. fraction of model inliers of a healthy pose [0, 1]
+	float		tracking_min_inlier_ratio; // min. inlier fraction relative to the one at the time the lock was acquired [0, 1]
 
 
 	// bilateral filter
@@ -51,6 +59,12 @@ typedef struct TEParams {
 		icp_outlier_reject_distance = 0.1f;
 		icp_termination_dist = 0.00000001f;
 		icp_num_max_iterations = 200;
+		icp_num_hypotheses = 12;
+		tracking_enabled = false;
+		tracking_constant_velocity = true;
+		tracking_max_rms = 0.01f;
+		tracking_min_inlier_fraction = 0.3f;
+		tracking_min_inlier_ratio = 0.5f;
 		curvature_multiplier = 10;
 
 		filter_sigmaI = 12.0;
@@ -1,4 +1,5 @@
 #include "TrackingExpertRegistration.h"
+#include "Profiler.h"
 
 
 TrackingExpertRegistration::TrackingExpertRegistration()
@@ -19,11 +20,12 @@ void TrackingExpertRegistration::init(void)
 	m_model_id = -1;
 	m_model_pose = Eigen::Matrix4f::Identity();
 	m_working = false;
+	m_scene_pending = false;
 	m_rms = 100000.0;
 
 	// create an ICP and feature descriptor instance. 
 	m_fd = new CPFMatchingExpGPU();
-	m_icp = new ICP();
+	m_icp = new ICPBatch();
 
 	// set the default params.
 	m_fd_params.search_radius = 0.1;
@@ -37,6 +39,7 @@ void TrackingExpertRegistration::init(void)
 	m_icp->setRejectMaxAngle(45.0);
 	m_icp->setRejectMaxDistance(0.1);
 	m_icp->setRejectionMethod(ICPReject::DIST_ANG);
+	m_icp->setMaxHypotheses(12);
 
 }
 
@@ -81,6 +84,13 @@ bool TrackingExpertRegistration::updateScene(PointCloud& points)
 
 	m_ptr_model_pc = &points;
 
+	// the descriptors are only required if process() needs to detect the object. 
+	if (m_params.tracking_enabled && m_tracker.getState() == PoseTracker::TRACKING) {
+		m_scene_pending = true;
+		return true;
+	}
+
+	m_scene_pending = false;
 	return m_fd->setScene(m_scene_pc);
 }
 
@@ -92,47 +102,50 @@ Invoking this function will start descriptor matching for model_id, voting, and
 */
 bool TrackingExpertRegistration::process(void)
 {
+	TX_PROFILE_SCOPE("registration");
+
 	assert(m_fd != NULL);
 	assert(m_icp != NULL);
 
 	if(m_model_id == -1) return false;
 	if(m_working) return false;
 
-	bool ret = true;
 	m_working = true;
 
-	//if(m_rms > m_params.icp_termination_dist)
-	ret = m_fd->match(m_model_id);
-
-	// positive match
-	if (ret) {
+	std::vector<Eigen::Affine3f > pose;
+	bool tracked = false;
 
-		// Do not set the scene data earlier. 
-		// icp and fd share the same knn. 
-		// m_fd->setScene(points) overwrites the data. 
+	// frame-to-frame tracking. Refine the predicted pose and the last pose and skip the detection. 
+	if (m_params.tracking_enabled && m_tracker.predict(pose)) {
 		m_icp->setCameraData(m_scene_pc);
+		tracked = refine(pose);
+	}
 
-		std::vector<Eigen::Affine3f > pose;
-		getPose(pose);
-		
-		if (pose.size() <= 0) {
-			return false;
-		}	
+	// global detection, if the object is not tracked or was lost. 
+	if (!tracked) {
+		if (m_scene_pending) {
+			m_fd->setScene(m_scene_pc);
+			m_scene_pending = false;
+		}
 
-		texpert::Pose Rt;
-		Rt.t = pose[0];
+		//if(m_rms > m_params.icp_termination_dist)
+		bool ret = m_fd->match(m_model_id);
 
-		Eigen::Matrix4f out_Rt;
-		//float rms = 0.0;
+		// positive match
+		if (ret) {
 
-		// ICP works internally with a copy of m_model_pc
-		m_icp->compute(m_model_pc, Rt, out_Rt, m_rms);
+			// Do not set the scene data earlier. 
+			// icp and fd share the same knn. 
+			// m_fd->setScene(points) overwrites the data. 
+			m_icp->setCameraData(m_scene_pc);
 
+			getPose(pose);
 
-		// return the pose
-		m_model_pose = m_icp->Rt();
-	
-	
+			// refine the best pose clusters in parallel and keep the best refined pose. 
+			if (pose.size() > 0) {
+				refine(pose);
+			}
+		}
 	}
 
 	m_working = false;
@@ -141,6 +154,30 @@ bool TrackingExpertRegistration::process(void)
 }
 
 
+/*
+Refine the poses with ICP, keep the best pose, and update the tracking state. 
+*/
+bool TrackingExpertRegistration::refine(std::vector<Eigen::Affine3f >& poses)
+{
+	// ICP works internally with a copy of m_model_pc
+	bool valid = m_icp->compute(m_model_pc, poses, m_icp_results);
+
+	if (m_icp_results.size() <= 0) {
+		m_tracker.reset();
+		return false;
+	}
+
+	// return the pose
+	const ICPHypothesis& best = m_icp_results[0];
+	m_model_pose = best.pose;
+	m_rms = best.rms;
+
+	if (!m_params.tracking_enabled) return false;
+
+	return m_tracker.update(valid, best.model_pose.matrix(), best.rms, best.inlier_fraction);
+}
+
+
 /*!
 Return the poses for a particular model.
 The function returns the 12 best hits by default. Note that this can be reduced to only 1 or so. 
@@ -172,12 +209,22 @@ Eigen::Matrix4f  TrackingExpertRegistration::getICPPose(void)
 
 }
 
+
+/*!
+Return true if the object is tracked, so that the next frame skips global detection. 
+*/
+bool TrackingExpertRegistration::isTracking(void)
+{
+	return m_params.tracking_enabled && m_tracker.getState() == PoseTracker::TRACKING;
+}
+
 /*!
 Reset registration and move the reference model to its original start position.
 */
 bool TrackingExpertRegistration::reset(void)
 {
 	m_model_pose = Eigen::Matrix4f::Identity();
+	m_tracker.reset();
 
 	// copy the original instance of points to m_scene_pc;
 	m_scene_pc = *m_ptr_model_pc;
@@ -195,6 +242,8 @@ bool TrackingExpertRegistration::setVerbose(bool verbose)
 	assert(m_fd != NULL);
 //	assert(m_icp != NULL);
 
+	m_tracker.setVerbose(verbose);
+
 	return m_fd->setVerbose(verbose) & m_icp->setVerbose(verbose);
 }
 
@@ -216,8 +265,14 @@ bool TrackingExpertRegistration::setParams(	TEParams params)
 		m_icp->setRejectMaxAngle(params.icp_outlier_reject_angle);
 		m_icp->setRejectMaxDistance(params.icp_outlier_reject_distance);
 		m_icp->setRejectionMethod(ICPReject::DIST_ANG);
+		m_icp->setMaxHypotheses(params.icp_num_hypotheses);
 	}
 
+	m_tracker.setHealthThresholds(params.tracking_max_rms, params.tracking_min_inlier_fraction, params.tracking_min_inlier_ratio);
+	m_tracker.setConstantVelocity(params.tracking_constant_velocity);
+	m_tracker.setVerbose(params.verbose);
+	if (!params.tracking_enabled) m_tracker.reset();
+
 	if(m_fd){
 		m_fd_params.angle_step = params.angle_step;
 		m_fd_params.search_radius = params.curvature_search_radius;
@@ -8,6 +8,12 @@ Last edits:
 Aug 6, 2020, RR
 - Added two pointers for the point cloud addresses (The current version of the code has too many
   point cloud copies. 
+
+Oct 17, 2026
+- process() refines the best pose clusters in parallel with ICPBatch instead of only the first one. 
+- Added frame-to-frame tracking. While the last pose is healthy, process() refines the predicted pose 
+  and skips the scene descriptors, matching, and voting. It falls back to global detection on loss. 
+  Tracking is off by default, see TEParams::tracking_enabled.
 */
 
 // STL
@@ -33,6 +39,8 @@ Aug 6, 2020, RR
 #include "CPFMatchingExp.h"
 #include "CPFMatchingExpGPU.h"
 #include "ICP.h"
+#include "ICPBatch.h"
+#include "PoseTracker.h"
 #include "TrackingExpertParams.h"
 
 class TrackingExpertRegistration
@@ -55,6 +63,7 @@ public:
 	/*!
 	Set or update the scene point cloud from a camera as PointCloud object. 
 	Note that adding the model will also start the descriptor extraction process. 
+	While the object is tracked, the extraction is deferred until process() needs to detect the object. 
 	@param points - point and normal vectors. 
 	@return true if the scene was accepted. 
 	*/
@@ -65,6 +74,8 @@ public:
 	/*!
 	Start the detection and pose estimation process for a model with the id model_id.
 	Invoking this function will start descriptor matching for model_id, voting, and pose clustering. 
+	If the object is tracked, the function refines the predicted pose instead and only detects the object
+	if the refined pose is not healthy. 
 	@para model_id - the id of the model to be detected (the int returned from addModel().
 	*/
 	bool process(void);
@@ -93,6 +104,12 @@ public:
 	Eigen::Matrix4f  getICPPose(void);
 
 
+	/*!
+	Return true if the object is tracked, so that the next frame skips global detection. 
+	*/
+	bool isTracking(void);
+
+
 
 	/*!
 	Enable extra debug messages. 
@@ -151,6 +168,13 @@ private:
 
 	void init(void);
 
+	/*
+	Refine the poses with ICP, keep the best pose, and update the tracking state. 
+	@param poses - the initial poses. 
+	@return true if the best refined pose is healthy. 
+	*/
+	bool refine(std::vector<Eigen::Affine3f >& poses);
+
 	//------------------------------------------------------------------
 	// Params
 
@@ -159,8 +183,13 @@ private:
 	CPFParams			m_fd_params;
 	bool				m_working;
 
-	// ICP
-	ICP*				m_icp;
+	// ICP, refines multiple pose hypotheses
+	ICPBatch*			m_icp;
+	std::vector<ICPHypothesis>	m_icp_results;
+
+	// frame-to-frame tracking
+	PoseTracker			m_tracker;
+	bool				m_scene_pending; // the scene descriptors were not extracted yet
 
 	// 
 	int					m_model_id;
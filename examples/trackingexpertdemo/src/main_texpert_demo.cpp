@@ -29,6 +29,7 @@ TEParams populateParams(Arguments params)
 	p.filter_sigmaI = params.filter_sigmaI;
 	p.filter_sigmaS = params.filter_sigmaS;
 	p.filter_kernel = params.filter_kernel;
+	p.tracking_enabled = params.tracking_enabled;
 	p.curvature_multiplier = 4.0;
 
 	return p;
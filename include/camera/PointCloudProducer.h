@@ -35,6 +35,9 @@ Aug 9, 2020, RR
 Aug 27, 2020, RR
 - Removed a copy_if operator and added a loop to copy points. Copy_if return incorrect sized vectors. 
 
+Oct 17, 2026
+- Added a function that returns the depth camera intrinsics, e.g., for projective ICP correspondences. 
+
 */
 #include <iostream>
 #include <vector>
@@ -102,6 +105,14 @@ public:
 	bool process(void);
 
 
+	/*!
+	Return the intrinsics of the depth camera and the sampling step. 
+	ICP uses them to find correspondences by projecting points into the depth image (ICP::setCameraIntrinsics()). 
+	@return the depth camera intrinsics. 
+	*/
+	DepthIntrinsics getDepthIntrinsics(void);
+
+
 
 
 private:
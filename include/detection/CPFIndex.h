@@ -0,0 +1,194 @@
+#pragma once
+/*
+@class CPFSceneIndex, CPFModelIndex
+
+@brief Lookup tables to match CPF descriptors without comparing all descriptor pairs.
+
+CPFSceneIndex sorts the scene descriptors by their discrete values data[0..2] and stores
+the range [begin, end) of each descriptor value in a hash table. Finding all scene descriptors
+that match a model descriptor is a single hash lookup. Descriptors with data[0] == 0 are not indexed;
+they never vote.
+
+CPFModelIndex stores the model descriptors grouped by their point index (point_idx) as offset table,
+so that all descriptors of one model point can be visited without scanning all descriptors.
+
+Both tables keep the original descriptor order within a group. Thus, the matching
+visits the descriptor pairs in the same order as the naive loop.
+
+MIT License
+-------------------------------------------------------------------------------------------------------
+Last edits:
+
+Oct 17, 2026
+- Added the classes to hash-index the descriptor matching in CPFMatchingExp.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// local
+#include "CPFTypes.h"
+
+namespace texpert {
+
+
+/*!
+Hash key for the discrete descriptor values data[0..2]
+*/
+typedef struct _CPFKey
+{
+	std::uint32_t data[3];
+
+	_CPFKey()
+	{
+		data[0] = 0;
+		data[1] = 0;
+		data[2] = 0;
+	}
+
+	_CPFKey(const CPFDiscreet& d)
+	{
+		data[0] = d.data[0];
+		data[1] = d.data[1];
+		data[2] = d.data[2];
+	}
+
+	bool operator==(const _CPFKey& k) const {
+		return	(k.data[0] == data[0]) &&
+				(k.data[1] == data[1]) &&
+				(k.data[2] == data[2]);
+	}
+
+	bool operator<(const _CPFKey& k) const {
+		if (data[0] != k.data[0]) return data[0] < k.data[0];
+		if (data[1] != k.data[1]) return data[1] < k.data[1];
+		return data[2] < k.data[2];
+	}
+
+}CPFKey;
+
+
+typedef struct _CPFKeyHash
+{
+	std::size_t operator()(const CPFKey& k) const
+	{
+		std::uint64_t h = (std::uint64_t)k.data[0] * 73856093ull;
+		h ^= (std::uint64_t)k.data[1] * 19349663ull;
+		h ^= (std::uint64_t)k.data[2] * 83492791ull;
+		return static_cast<std::size_t>(h ^ (h >> 29));
+	}
+
+}CPFKeyHash;
+
+
+
+class CPFSceneIndex
+{
+public:
+
+	CPFSceneIndex();
+	~CPFSceneIndex();
+
+	/*!
+	Create the index for a set of scene descriptors.
+	@param descriptors - the scene descriptors.
+	*/
+	void build(const std::vector<CPFDiscreet>& descriptors);
+
+	/*!
+	Find all scene descriptors with the same values data[0..2] as the descriptor d.
+	The matching descriptor indices are at(begin) ... at(end-1).
+	@param d - the search descriptor.
+	@param begin - the first index into the index table.
+	@param end - the last index into the index table, exclusive.
+	@return true if at least one descriptor matches.
+	*/
+	bool find(const CPFDiscreet& d, int& begin, int& end) const;
+
+	/*!
+	Return the descriptor index at location i of the index table.
+	*/
+	inline int at(const int i) const { return _order[i]; }
+
+	/*!
+	Return the number of indexed descriptors.
+	*/
+	int size(void) const;
+
+	/*!
+	Clear the index.
+	*/
+	void clear(void);
+
+private:
+
+	// descriptor indices sorted by the descriptor value
+	std::vector<int>												_order;
+
+	// descriptor value -> [begin, end) in _order
+	std::unordered_map<CPFKey, std::pair<int, int>, CPFKeyHash>		_buckets;
+};
+
+
+
+class CPFModelIndex
+{
+public:
+
+	CPFModelIndex();
+	~CPFModelIndex();
+
+	/*!
+	Create the offset table for a set of model descriptors.
+	@param descriptors - the model descriptors.
+	@param num_points - the number of points of the model.
+	*/
+	void build(const std::vector<CPFDiscreet>& descriptors, int num_points);
+
+	/*!
+	Create the offset table for a set of model descriptors, e.g., mapped from a model database.
+	@param descriptors - pointer to the model descriptors.
+	@param size - the number of descriptors.
+	@param num_points - the number of points of the model.
+	*/
+	void build(const CPFDiscreet* descriptors, int size, int num_points);
+
+	/*!
+	Return the first index of the descriptors of point point_idx into the index table.
+	*/
+	inline int begin(const int point_idx) const { return _offsets[point_idx]; }
+
+	/*!
+	Return the last index of the descriptors of point point_idx into the index table, exclusive.
+	*/
+	inline int end(const int point_idx) const { return _offsets[point_idx + 1]; }
+
+	/*!
+	Return the descriptor index at location i of the index table.
+	*/
+	inline int at(const int i) const { return _order[i]; }
+
+	/*!
+	Return the number of points.
+	*/
+	int numPoints(void) const;
+
+	/*!
+	Clear the index.
+	*/
+	void clear(void);
+
+private:
+
+	// descriptor indices grouped by point index
+	std::vector<int>		_order;
+
+	// point index -> first entry in _order. Size num_points + 1.
+	std::vector<int>		_offsets;
+};
+
+
+}//namespace texpert
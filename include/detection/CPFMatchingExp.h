@@ -22,6 +22,24 @@ Last edits:
 Oct 30, 2020, William Blanchard
 - Fixed case in CalculateDescriptors where points put in their own reference frame
 	would have nonzero position vectors.
+
+Oct 17, 2026
+- Descriptor matching uses a hash index of the scene descriptors and an offset table for the model descriptors.
+  The naive matching remains available as reference mode, see setMatchingMode().
+- Each instance owns its descriptor context (CPFTools::CPFContext). Instances for different objects can run on separate threads.
+- Pose clustering uses the hash grid of PoseClustering instead of comparing all candidates with all clusters.
+- Added saveModel() and loadModel() to store and load the model descriptors in a binary model database.
+- The indexed matching distributes the model points over multiple threads. Each thread owns a reusable
+  vote buffer. The results are merged in model point order and do not depend on the number of threads.
+- The descriptors use variable-length radius search results. All neighbors within the search radius
+  contribute to the curvature and the descriptors, not only the first KNN_MATCHES_LENGTH matches.
+- The kd-tree of a model or scene is reused if the same points were indexed before (KNN::populateCached()).
+- Added setNeighborSearchMode() to select an exact or approximate neighbor search for the descriptors.
+- The indexed matching votes into a VoteAccumulator. Large scenes use sparse counters instead of a dense
+  [scene points x angle bins] array per thread, and the counters are not re-allocated when the scene size changes.
+- The descriptor neighborhoods always use the cpu backend of KNN, also on hosts with a cuda device,
+  since the cuda radius search stops at KNN_MATCHES_LENGTH neighbors.
+- loadModel() keeps the model database mapped and matches against the mapped descriptors and curvatures instead of copying them.
 */
 
 //stl 
@@ -42,8 +60,13 @@ Oct 30, 2020, William Blanchard
 #include "Types.h"
 #include "CPFTypes.h"
 #include "CPFTools.h"
+#include "CPFIndex.h"
+#include "PoseClustering.h"
+#include "CPFModelDatabase.h"
+#include "VoteAccumulator.h"
 #include "KNN.h"
 #include "CPFMatchingWrapper.h"
+#include "ParallelUtils.h"
 
 namespace texpert{
 
@@ -93,6 +116,35 @@ private:
 
 	}CPFMatchingData;
 
+
+	/*!
+	Per-thread voting memory. The buffers are kept between calls to avoid re-allocations. 
+	*/
+	typedef struct CPFVoteBuffer {
+
+		VoteAccumulator							accumulator; // cells scene point * angle bins + bin, empty between model points
+		std::vector<int>						max_votes_idx; // the winner cells
+
+		// results of one thread, merged into CPFMatchingData
+		std::vector<Eigen::Affine3f >			pose_candidates;
+		std::vector<int>						pose_candidates_votes;
+		std::vector<std::pair<float, int>>		vote_pair;
+
+		// render helper data <model point, scene point>
+		std::vector<std::pair<int, int>>		matching_pairs;
+		std::vector<std::pair<int, int>>		vote_ids;
+
+		// function to clear the results
+		void results_clear(void) {
+			pose_candidates.clear();
+			pose_candidates_votes.clear();
+			vote_pair.clear();
+			matching_pairs.clear();
+			vote_ids.clear();
+		}
+
+	}CPFVoteBuffer;
+
 public:
 	
 	CPFMatchingExp();
@@ -109,6 +161,25 @@ public:
 	int addModel(PointCloud& points, std::string label);
 
 
+	/*!
+	Save the model points, curvatures, and descriptors of a model to a binary model database file.
+	@param model_id - the model id.
+	@param path - the file path.
+	@return true if the file was written.
+	*/
+	bool saveModel(int model_id, std::string path);
+
+
+	/*!
+	Load a model from a binary model database file (see CPFModelDatabase). 
+	The descriptor extraction is skipped if the database was created with the current parameters.
+	Otherwise, the descriptors are extracted from the stored points. 
+	@param path - the file path.
+	@return an model id as integer or -1 if the model was rejected.
+	*/
+	int loadModel(std::string path);
+
+
 	/*!
 	Set a scene model or a point cloud from a camera as PointCloud object. 
 	Note that adding the model will also start the descriptor extraction process. 
@@ -156,6 +227,45 @@ public:
 	bool setParams(CPFParams params);
 
 
+	/*!
+	Set the descriptor matching mode.
+	CPF_MATCH_INDEXED uses hash tables to find matching descriptors. CPF_MATCH_REFERENCE compares
+	all descriptor pairs. Both yield the same votes; the reference mode exists for regression comparison.
+	@param mode - the matching mode.
+	*/
+	void setMatchingMode(CPFMatchingMode mode);
+
+
+	/*!
+	Return the descriptor matching mode.
+	*/
+	CPFMatchingMode getMatchingMode(void);
+
+
+	/*!
+	Set the number of threads for descriptor matching and voting. 
+	The results do not depend on the number of threads. 
+	@param num_threads - the number of threads. A value < 1 uses all hardware threads. 
+	*/
+	void setNumThreads(int num_threads);
+
+
+	/*!
+	Return the number of threads for descriptor matching and voting.
+	*/
+	int getNumThreads(void);
+
+
+	/*!
+	Set the search quality of the descriptor neighborhoods. Default is KNN_EXACT.
+	KNN_APPROXIMATE is faster, but may miss neighbors, which changes the descriptors.
+	Models and scenes should be processed with the same mode. 
+	@param mode - KNN_EXACT or KNN_APPROXIMATE.
+	@param max_leaves - the number of kd-tree leaves to visit per point in KNN_APPROXIMATE mode.
+	*/
+	void setNeighborSearchMode(KNNSearchMode mode, int max_leaves = 8);
+
+
 	//-----------------------------------------------------------------------------------------------------------------
 	// Render and debug helpers
 
@@ -198,6 +308,20 @@ public:
 private:
 
 
+	/*
+	Store a model with its descriptors and curvatures and create the model data.
+	@param model - the descriptors and curvatures. The instance takes the data, model is empty afterwards.
+	@return the model id.
+	*/
+	int storeModel(PointCloud& points, std::string label, CPFModelData& model);
+
+
+	/*
+	Return the parameters that affect the descriptor extraction, for the model database. 
+	*/
+	CPFModelDBParams getDBParams(void);
+
+
 	/*
 	Descriptor based on curvature pairs and the direction vector
 	*/
@@ -205,29 +329,73 @@ private:
 	
 
 	/*
-	Match the model and scene descriptors.
+	Match the model and scene descriptors using the descriptor index tables.
 	@param src_model - the descriptors of the reference model
+	@param model_index - the offset table for the model descriptors. 
 	@param src_scene - the scene descriptors
+	@param scene_index - the hash index for the scene descriptors. 
 	@param pc_model - reference to the model point cloud data. 
 	@param pc_scene - reference to the scene point cloud data.
 	@param dst_data - location for all destination data. 
 	*/
-	void matchDescriptors(	std::vector<CPFDiscreet>& src_model, std::vector<CPFDiscreet>& src_scene, PointCloud& pc_model, PointCloud& pc_scene,
-							CPFMatchingData& dst_data);
+	void matchDescriptors(	const CPFModelData& src_model, CPFModelIndex& model_index, std::vector<CPFDiscreet>& src_scene, CPFSceneIndex& scene_index,
+							PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data);
 
 
 	/*
-	Invoke the pose candidate clustering process. 
-	Clusters the poses depending on their difference. Similar poses form a similar cluster. 
-	@param data - the internal model data struct. 
+	Vote for the model points [begin, end) and recover the pose candidates of these points.
+	The function writes into the vote buffer only and can run in parallel. 
 	*/
-	bool clustering(CPFMatchingData& data);
+	void voteRange(	int begin, int end, const CPFModelData& src_model, CPFModelIndex& model_index, std::vector<CPFDiscreet>& src_scene, 
+					CPFSceneIndex& scene_index, PointCloud& pc_model, PointCloud& pc_scene, CPFVoteBuffer& buffer);
+
+
+	/*
+	Match the model and scene descriptors by comparing all descriptor pairs. 
+	Reference implementation. 
+	@param src_model - the descriptors of the reference model
+	@param src_scene - the scene descriptors
+	@param pc_model - reference to the model point cloud data. 
+	@param pc_scene - reference to the scene point cloud data.
+	@param dst_data - location for all destination data. 
+	*/
+	void matchDescriptorsReference(	const CPFModelData& src_model, std::vector<CPFDiscreet>& src_scene, PointCloud& pc_model, PointCloud& pc_scene,
+									CPFMatchingData& dst_data);
 
 
 	/*
-	Calculate the similarity between two poses. 
+	Return the accumulator bin for the angle alpha = alpha_model - alpha_scene.
 	*/
-	bool similarPose(Eigen::Affine3f a, Eigen::Affine3f b);
+	int alphaBin(float alpha);
+
+
+	/*
+	Recover the pose from a model point, a scene point, and the voted angle bin.
+	@param model_id - the model point index.
+	@param scene_id - the scene point index.
+	@param alpha_bin - the voted angle bin.
+	@return - the pose candidate.
+	*/
+	Eigen::Affine3f recoverPose(int model_id, int scene_id, int alpha_bin, PointCloud& pc_model, PointCloud& pc_scene);
+
+
+	/*
+	Recover the pose from a model point, a scene point, and the voted angle bin, and
+	store it as pose candidate. 
+	@param model_id - the model point index.
+	@param scene_id - the scene point index.
+	@param alpha_bin - the voted angle bin.
+	@param votes - the number of votes.
+	*/
+	void addPoseCandidate(int model_id, int scene_id, int alpha_bin, int votes, PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data);
+
+
+	/*
+	Invoke the pose candidate clustering process. 
+	Clusters the poses depending on their difference. Similar poses form a similar cluster. 
+	@param data - the internal model data struct. 
+	*/
+	bool clustering(CPFMatchingData& data);
 
 
 	/*
@@ -247,22 +415,39 @@ private:
 	// descriptor parameterss
 	CPFParams					m_params;
 
+	// descriptor context for CPFTools
+	CPFTools::CPFContext		m_cpf_context;
+
 
 	KNN*						m_knn;
 
+	// radius search results, reused for every descriptor calculation
+	KNNResults					m_neighbors;
+
 	//--------------------------------------------------------------
 	// the model
-	// descriptors and curvatures
-	std::vector< std::vector<CPFDiscreet> >	m_model_descriptors;
-	std::vector< std::vector<uint32_t> >    m_model_curvatures;
+	// descriptors and curvatures, extracted or mapped from a model database
+	std::vector<CPFModelData>				m_models;
+	std::vector<CPFModelIndex>				m_model_index;
 
 	// scene descriptors and curvaturs
 	std::vector<CPFDiscreet>				m_scene_descriptors;
 	std::vector<uint32_t>					m_scene_curvatures;
+	CPFSceneIndex							m_scene_index;
+
+	// the descriptor matching mode
+	CPFMatchingMode							m_matching_mode;
+
+	// per-thread voting memory
+	std::vector<CPFVoteBuffer>				m_vote_buffers;
+	int										m_num_threads;
 
 	// stores the matching, voting, and clustering results per object. 
 	std::vector<CPFMatchingData>			m_matching_results;
 
+	// pose candidate clustering
+	PoseClustering							m_pose_clustering;
+
 	// for debuging and to render descriptor content.
 	CPFRenderHelpers						m_helpers;
 
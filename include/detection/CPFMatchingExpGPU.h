@@ -19,6 +19,11 @@ MIT License
 Last edits:
 28 October 2020
 - Added better allocation/deallocation of memory for CPFToolsGPU
+
+Oct 17, 2026
+- Added saveModel() and loadModel() to store and load the model descriptors in a binary model database.
+- The kd-tree of a model or scene is reused if the same points were indexed before (KNN::populateCached()).
+- loadModel() keeps the model database mapped and matches against the mapped descriptors and curvatures instead of copying them.
 */
 
 //stl 
@@ -41,6 +46,7 @@ Last edits:
 #include "CPFToolsGPU.h"
 #include "KNN.h"
 #include "CPFMatchingWrapper.h"
+#include "CPFModelDatabase.h"
 
 namespace texpert {
 
@@ -106,6 +112,25 @@ namespace texpert {
 		int addModel(PointCloud& points, std::string label);
 
 
+		/*!
+		Save the model points, curvatures, and descriptors of a model to a binary model database file.
+		@param model_id - the model id.
+		@param path - the file path.
+		@return true if the file was written.
+		*/
+		bool saveModel(int model_id, std::string path);
+
+
+		/*!
+		Load a model from a binary model database file (see CPFModelDatabase).
+		The descriptor extraction is skipped if the database was created with the current parameters.
+		Otherwise, the descriptors are extracted from the stored points.
+		@param path - the file path.
+		@return an model id as integer or -1 if the model was rejected.
+		*/
+		int loadModel(std::string path);
+
+
 		/*!
 		Set a scene model or a point cloud from a camera as PointCloud object.
 		Note that adding the model will also start the descriptor extraction process.
@@ -195,6 +220,20 @@ namespace texpert {
 	private:
 
 
+		/*
+		Store a model with its descriptors and curvatures and create the model data.
+		@param model - the descriptors and curvatures. The instance takes the data, model is empty afterwards.
+		@return the model id.
+		*/
+		int storeModel(PointCloud& points, std::string label, CPFModelData& model);
+
+
+		/*
+		Return the parameters that affect the descriptor extraction, for the model database.
+		*/
+		CPFModelDBParams getDBParams(void);
+
+
 		/*
 		Descriptor based on curvature pairs and the direction vector
 		*/
@@ -209,7 +248,7 @@ namespace texpert {
 		@param pc_scene - reference to the scene point cloud data.
 		@param dst_data - location for all destination data.
 		*/
-		void matchDescriptors(std::vector<CPFDiscreet>& src_model, std::vector<CPFDiscreet>& src_scene, PointCloud& pc_model, PointCloud& pc_scene,
+		void matchDescriptors(const CPFModelData& src_model, std::vector<CPFDiscreet>& src_scene, PointCloud& pc_model, PointCloud& pc_scene,
 			CPFMatchingData& dst_data);
 
 
@@ -249,9 +288,8 @@ namespace texpert {
 
 		//--------------------------------------------------------------
 		// the model
-		// descriptors and curvatures
-		std::vector< std::vector<CPFDiscreet> >	m_model_descriptors;
-		std::vector< std::vector<uint32_t> >    m_model_curvatures;
+		// descriptors and curvatures, extracted or mapped from a model database
+		std::vector<CPFModelData>				m_models;
 
 		// scene descriptors and curvaturs
 		std::vector<CPFDiscreet>				m_scene_descriptors;
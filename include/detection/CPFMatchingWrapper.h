@@ -16,6 +16,9 @@ MIT License
 Last edits:
 1 November 2020
 - Added class opening documentation
+
+Oct 17, 2026
+- Added saveModel() and loadModel() to store the model descriptors in a binary model database. 
 */
 #include <vector>
 
@@ -36,6 +39,25 @@ namespace texpert {
 		virtual int addModel(PointCloud& points, std::string label) = 0;
 
 
+		/*!
+		Save the model points, curvatures, and descriptors of a model to a binary model database file.
+		@param model_id - the model id.
+		@param path - the file path.
+		@return true if the file was written.
+		*/
+		virtual bool saveModel(int model_id, std::string path) = 0;
+
+
+		/*!
+		Load a model from a binary model database file. 
+		The descriptor extraction is skipped if the database was created with the current parameters.
+		Otherwise, the descriptors are extracted from the stored points. 
+		@param path - the file path.
+		@return an model id as integer or -1 if the model was rejected.
+		*/
+		virtual int loadModel(std::string path) = 0;
+
+
 		/*!
 		Set a scene model or a point cloud from a camera as PointCloud object.
 		Note that adding the model will also start the descriptor extraction process.
@@ -0,0 +1,286 @@
+#pragma once
+/*
+@class CPFModelDatabase
+
+@brief Binary file format to store the CPF descriptors of a reference model.
+
+Extracting the descriptors of a model requires a kd-tree, the curvatures, and all point pair descriptors,
+which takes time for larger models. The database stores the result of this process together with the
+parameters it was created with. A detector can load the model and skip the extraction if its parameters match.
+
+File layout (little endian):
+	CPFModelDBHeader
+	label		char[label_size]
+	points		float[num_points * 3]
+	normals		float[num_points * 3]
+	curvatures	uint32_t[num_points]
+	descriptors	CPFDiscreet[num_descriptors]
+All sections start at a 16-byte aligned file offset, which is stored in the header. The file is opened as
+memory mapped file; the data accessors return pointers into the mapping and do not copy data.
+CPFModelData keeps the mapping open, so a detector can match against the mapped descriptors and curvatures.
+Only the points and normals are copied into a PointCloud, which the kd-tree and ICP need.
+
+The version number must be incremented if the file layout or the descriptor extraction changes.
+
+MIT License
+-------------------------------------------------------------------------------------------------------
+Last edits:
+
+Oct 17, 2026
+- Added the class to store model descriptors for CPFMatchingExp and CPFMatchingExpGPU.
+- Version 2: the cpu descriptors use all neighbors within the search radius.
+- Replaced knn_matches with max_neighbors, the neighbor limit the descriptors were actually extracted with.
+- Added CPFModelData, the descriptors and curvatures of a model, either extracted or mapped from a database file.
+*/
+
+// stl
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <memory>
+
+// Eigen
+#include <Eigen/Dense>
+
+// local
+#include "Types.h"
+#include "CPFTypes.h"
+#include "MappedFile.h"
+
+
+namespace texpert {
+
+
+// file format version
+#define CPF_MODEL_DB_VERSION 2
+
+
+/*!
+The parameters the descriptors were extracted with.
+Descriptors can only be re-used if all parameters match.
+*/
+typedef struct _CPFModelDBParams
+{
+	float		search_radius;
+	float		angle_step;
+	float		multiplier;
+	int32_t		angle_bins;
+	int32_t		max_neighbors; // max. neighbors per point at extraction time, 0 for all neighbors within the search radius
+
+	_CPFModelDBParams()
+	{
+		search_radius = 0.0f;
+		angle_step = 0.0f;
+		multiplier = 0.0f;
+		angle_bins = 0;
+		max_neighbors = 0;
+	}
+
+	bool operator==(const _CPFModelDBParams& p) const {
+		return	search_radius == p.search_radius &&
+				angle_step == p.angle_step &&
+				multiplier == p.multiplier &&
+				angle_bins == p.angle_bins &&
+				max_neighbors == p.max_neighbors;
+	}
+
+}CPFModelDBParams;
+
+
+/*!
+File header.
+*/
+typedef struct _CPFModelDBHeader
+{
+	char				magic[8]; // "TXCPFDB"
+	uint32_t			version;
+	uint32_t			header_size;
+	uint32_t			endian; // 0x01020304, written in host byte order
+	uint32_t			label_size;
+
+	CPFModelDBParams	params;
+
+	uint32_t			num_points;
+	uint32_t			reserved;
+	uint64_t			num_descriptors;
+
+	// section offsets in bytes from the beginning of the file
+	uint64_t			label_offset;
+	uint64_t			points_offset;
+	uint64_t			normals_offset;
+	uint64_t			curvatures_offset;
+	uint64_t			descriptors_offset;
+	uint64_t			file_size;
+
+}CPFModelDBHeader;
+
+
+
+/*!
+Result of a load operation.
+*/
+typedef enum _CPFModelDBStatus
+{
+	CPF_DB_OK = 0,
+	CPF_DB_PARAMS_MISMATCH = 1, // the points are valid, but the descriptors were extracted with other parameters.
+	CPF_DB_ERROR = 2
+
+}CPFModelDBStatus;
+
+
+
+class CPFModelDatabase
+{
+public:
+
+	CPFModelDatabase();
+	~CPFModelDatabase();
+
+	/*!
+	Write a model to a file.
+	@param path - the file path.
+	@param label - the model label.
+	@param pc - the model point cloud with points and normals.
+	@param curvatures - the discretized curvatures, one per point.
+	@param descriptors - the model descriptors.
+	@param params - the parameters the descriptors were extracted with.
+	@return true, if the file was written.
+	*/
+	static bool Write(const std::string& path, const std::string& label, PointCloud& pc, const std::vector<uint32_t>& curvatures,
+					  const std::vector<CPFDiscreet>& descriptors, const CPFModelDBParams& params);
+
+	/*!
+	Write a model to a file.
+	@param path - the file path.
+	@param label - the model label.
+	@param pc - the model point cloud with points and normals.
+	@param curvatures - the discretized curvatures, one per point.
+	@param descriptors - the model descriptors.
+	@param num_descriptors - the number of descriptors.
+	@param params - the parameters the descriptors were extracted with.
+	@return true, if the file was written.
+	*/
+	static bool Write(const std::string& path, const std::string& label, PointCloud& pc, const uint32_t* curvatures,
+					  const CPFDiscreet* descriptors, size_t num_descriptors, const CPFModelDBParams& params);
+
+	/*!
+	Read a model from a file into the given containers.
+	The descriptors and curvatures are only read if the parameters match.
+	@param path - the file path.
+	@param params - the parameters of the detector.
+	@param label - location for the model label.
+	@param pc - location for the point cloud.
+	@param curvatures - location for the curvatures.
+	@param descriptors - location for the descriptors.
+	@return CPF_DB_OK if the model was read, CPF_DB_PARAMS_MISMATCH if only the point cloud was read.
+	*/
+	static CPFModelDBStatus Read(const std::string& path, const CPFModelDBParams& params, std::string& label, PointCloud& pc,
+								 std::vector<uint32_t>& curvatures, std::vector<CPFDiscreet>& descriptors);
+
+	/*!
+	Map a database file into memory and validate it.
+	@param path - the file path.
+	@return true, if the file is a valid database.
+	*/
+	bool open(const std::string& path);
+
+	/*!
+	Unmap the file. All pointers returned by this class become invalid.
+	*/
+	void close(void);
+
+	/*!
+	Return true if the parameters of the file match params.
+	*/
+	bool paramsMatch(const CPFModelDBParams& params) const;
+
+	/*!
+	Copy the points and normals of the mapped file into a point cloud.
+	@param pc - location for the point cloud.
+	*/
+	void getPointCloud(PointCloud& pc) const;
+
+	//-----------------------------------------------------------------
+	// Zero-copy access to the mapped file. Valid until close() is called.
+
+	const CPFModelDBHeader& header(void) const;
+	std::string label(void) const;
+	int numPoints(void) const;
+	size_t numDescriptors(void) const;
+	const float* points(void) const; // x, y, z
+	const float* normals(void) const; // nx, ny, nz
+	const uint32_t* curvatures(void) const;
+	const CPFDiscreet* descriptors(void) const;
+
+private:
+
+	// no copies
+	CPFModelDatabase(const CPFModelDatabase&);
+	CPFModelDatabase& operator=(const CPFModelDatabase&);
+
+	MappedFile			_file;
+	CPFModelDBHeader	_header;
+	bool				_valid;
+};
+
+
+
+/*!
+The descriptors and curvatures of one model.
+The data is either owned, after the descriptor extraction, or a view into a mapped database file,
+which the instance keeps open. Copies of an instance share the database file.
+*/
+class CPFModelData
+{
+public:
+
+	// no user-declared constructor and destructor, so the instances move without copying the descriptors.
+
+	/*!
+	Take the extracted descriptors and curvatures. The vectors are swapped and empty afterwards.
+	*/
+	void assign(std::vector<CPFDiscreet>& descriptors, std::vector<uint32_t>& curvatures);
+
+	/*!
+	Use the descriptors and curvatures of an open database file without copying them.
+	*/
+	void assign(std::shared_ptr<CPFModelDatabase> db);
+
+	/*!
+	Return the descriptors.
+	*/
+	inline const CPFDiscreet* descriptors(void) const { return _db ? _db->descriptors() : _descriptors.data(); }
+
+	/*!
+	Return the number of descriptors.
+	*/
+	inline size_t size(void) const { return _db ? _db->numDescriptors() : _descriptors.size(); }
+
+	/*!
+	Return descriptor i.
+	*/
+	inline const CPFDiscreet& operator[](const size_t i) const { return descriptors()[i]; }
+
+	/*!
+	Return the curvatures, one per model point.
+	*/
+	inline const uint32_t* curvatures(void) const { return _db ? _db->curvatures() : _curvatures.data(); }
+
+	/*!
+	Return the number of curvatures, which is the number of model points.
+	*/
+	inline size_t numCurvatures(void) const { return _db ? (size_t)_db->numPoints() : _curvatures.size(); }
+
+private:
+
+	// extracted data
+	std::vector<CPFDiscreet>			_descriptors;
+	std::vector<uint32_t>				_curvatures;
+
+	// or the mapped database file
+	std::shared_ptr<CPFModelDatabase>	_db;
+};
+
+
+}//namespace texpert
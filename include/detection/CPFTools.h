@@ -16,7 +16,12 @@ MIT License
 -------------------------------------------------------------------------------------------------------
 Last edits:
 
-
+Oct 17, 2026
+- Removed the file-scope state. The descriptor parameters and statistics are kept in a CPFContext, 
+  which each detector owns, so multiple detectors can run on separate threads. 
+  The functions without context use a thread-local default context for backward compatibility. 
+- Added a DiscretizeCurvature function for variable-length KNNResults. It uses all neighbors
+  instead of the first 21 matches.
 */
 
 #include <iostream>
@@ -45,6 +50,28 @@ public:
 		}
 
 	}CPFParam;
+
+
+	/*!
+	Descriptor context. Keeps the parameters and statistics for one descriptor extraction process. 
+	Each detector should own one context. 
+	*/
+	typedef struct CPFContext
+	{
+		// number of angle bins to discretize the point pair angle
+		int		angle_bins;
+
+		// min. and max. point pair angle value (cosine) seen since the last reset.
+		float	max_ang_value;
+		float	min_ang_value;
+
+		CPFContext() {
+			angle_bins = 12;
+			max_ang_value = 0.0f;
+			min_ang_value = 10000000.0f;
+		}
+
+	}CPFContext;
 	
 	/*!
 	*/
@@ -59,19 +86,53 @@ public:
 	static uint32_t DiscretizeCurvature(const Eigen::Vector3f& p1, const Eigen::Vector3f& n1, const PointCloud& pc, const MyMatches& matches, const float range = 10.0);
 
 	/*!
+	Discretize the curvature of a point as the mean angle between its normal vector and the normal vectors of its neighbors.
+	Neighbors with distance 0, e.g., the point itself, are skipped.
+	@param p1, n1 - the point and its normal vector.
+	@param pc - the point cloud the neighbor ids refer to.
+	@param results - the radius search results.
+	@param index - the index of the point in results.
+	@param range - the angle multiplier.
+	@return the discretized curvature, 0 if the point has no neighbors.
+	*/
+	static uint32_t DiscretizeCurvature(const Eigen::Vector3f& p1, const Eigen::Vector3f& n1, const PointCloud& pc, const KNNResults& results, const int index, const float range = 10.0);
+
+	/*!
+	Discretize the point pair feature.
+	@param ctx - the descriptor context. Its min/max angle statistics are updated. 
+	@param c0, c1 - the discretized curvatures of both points.
+	@param p0 - the first point.
+	@param p1 - the second point in the reference frame of p0.
+	*/
+	static CPFDiscreet DiscretizeCPF(CPFContext& ctx, const std::uint32_t& c0, const std::uint32_t& c1, const Eigen::Vector3f& p0, const Eigen::Vector3f& p1);
+
+	/*!
+	Return the min/max point pair angle of a context.
+	*/
+	static void GetMaxMinAng(const CPFContext& ctx, float& max, float& min);
+
+	/*!
+	Reset the min/max statistics of a context.
+	*/
+	static void Reset(CPFContext& ctx);
+
+	/*!
+	Same as above, uses the thread-local default context. 
 	*/
 	static CPFDiscreet DiscretizeCPF(const std::uint32_t& c0, const std::uint32_t& c1, const Eigen::Vector3f& p0, const Eigen::Vector3f& p1);
 	
 	/*!
+	Set the parameters of the thread-local default context. 
 	*/
 	static void SetParam(CPFParam& param);
 
 	/*!
+	Return the min/max point pair angle of the thread-local default context. 
 	*/
 	static void GetMaxMinAng(float& max, float& min);
 
 	/*!
-	
+	Reset the thread-local default context. 
 	*/
 	static void Reset(void);
 };
\ No newline at end of file
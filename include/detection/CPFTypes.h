@@ -86,4 +86,17 @@ typedef struct CPFParams
 
 
 // to be backward compatible with the old name
-typedef CPFParams CPFToolsParams;
\ No newline at end of file
+typedef CPFParams CPFToolsParams;
+
+
+/*
+Descriptor matching modes.
+CPF_MATCH_INDEXED - looks up the matching scene descriptors in a hash table (default).
+CPF_MATCH_REFERENCE - compares all model and scene descriptors. Slow, for regression comparison only.
+*/
+typedef enum _CPFMatchingMode
+{
+	CPF_MATCH_INDEXED = 0,
+	CPF_MATCH_REFERENCE = 1
+
+}CPFMatchingMode;
\ No newline at end of file
@@ -23,6 +23,9 @@ March 20, 2019, RR
 - Changed the variable g_dlg_ppf_nn = 9, to 9 since the kd-tree radius search is limited to 10 hits. 
 - Inverted the final transformation pose.t.data()[12] , elements 12-14
 - Added a verbose variable to enable or surpress console outputs
+
+Oct 17, 2026
+- The poses are grouped with the hash grid of PoseClustering instead of comparing each pose with all clusters.
 */
 
 // stl
@@ -37,6 +40,7 @@ March 20, 2019, RR
 
 // local
 #include "FDTypes.h"
+#include "PoseClustering.h"
 
 using namespace std;
 
@@ -82,13 +86,6 @@ namespace texpert {
 
 	private:
 
-		/*
-		Calculates the similarity between a and b. 
-		a and b are 4x4 matrices with affine transformations. 
-		*/
-		bool similar(Eigen::Affine3f a, Eigen::Affine3f b);
-
-
 		//------------------------------------------------------------
 		// Members 
 
@@ -102,6 +99,11 @@ namespace texpert {
 		std::vector<std::pair<int, int> >		_temp_cluster_votes;
 		std::vector<std::vector<Pose>>			_temp_clustered_poses;
 
+		// the pose clustering engine and its input
+		PoseClustering							_clustering;
+		std::vector<Eigen::Affine3f>			_temp_transformations;
+		std::vector<int>						_temp_votes;
+
 		// to invert the pose if the test object should be moved to the
 		// reference object
 		bool									_invert;
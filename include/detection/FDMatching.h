@@ -23,6 +23,15 @@ March 20, 2019, RR
 - Changed the variable g_dlg_ppf_nn = 9, to 9 since the kd-tree radius search is limited to 10 hits. 
 - Inverted the final transformation pose.t.data()[12] , elements 12-14
 - Added a verbose variable to enable or surpress console outputs
+
+Oct 17, 2026
+- Uses KNN with a cached kd-tree instead of re-initializing its own cuda kd-tree for every call. 
+- The model features are stored in a flat, radix-sorted table (PPFTable) instead of a std::unordered_multimap. 
+  extract_feature_map() and detect() run in parallel (setNumThreads()). detect() looks up all features of a 
+  scene point at once and only resets the touched accumulator cells. 
+- Added a distance-bounded extraction (setMaxPairDistance()). Each model point is only paired with the model points 
+  within the max. distance, found with a uniform grid (Cpu_RadiusGrid), so large models do not need N^2 pairs. 
+- The voting uses a VoteAccumulator. Large models use sparse counters instead of a dense [model points x angle bins] array per thread.
 */
 
 // stl
@@ -38,14 +47,31 @@ March 20, 2019, RR
 // local
 #include "FDTypes.h"
 #include "FDTools.h"
-#include "Cuda_KdTree.h"
+#include "KNN.h"
 #include "FDClustering.h"
+#include "PPFTable.h"
+#include "VoteAccumulator.h"
+#include "Cpu_RadiusGrid.h"
+#include "ParallelUtils.h"
 
 using namespace std;
 
 
 namespace texpert {
 
+	/*
+	The voting buffers of one thread. 
+	*/
+	typedef struct _FDAccumulator
+	{
+		VoteAccumulator				votes; // cells model point * angle bins + bin
+		std::vector<std::uint64_t>	keys; // the features of one scene point
+		std::vector<float>			alpha_s;
+		std::vector<int>			begin; // the matching runs in the table
+		std::vector<int>			end;
+	}FDAccumulator;
+
+
 	class FDMatching
 	{
 	public:
@@ -67,6 +93,18 @@ namespace texpert {
 		bool setAngleStep(float angele_step);
 
 
+		/*
+		Set the max. distance between two paired model points for extract_feature_map(). 
+		The default, 0, pairs all model points, which needs N^2 features. 
+		A max. distance pairs each point only with its neighbors within this distance. Points further 
+		apart cannot vote for each other, so the value should cover the part of the object the camera sees,
+		e.g., the object diameter for a full match or the radius for a more local voting.
+		@param max_distance - the max. distance in model units, >= 0. 0 pairs all points.
+		@return true if the value was accepted.
+		*/
+		bool setMaxPairDistance(float max_distance);
+
+
 		/*
 		Extract a ppf feature map for an object of interest
 		@param points - point as {x, y, z}
@@ -106,6 +144,13 @@ namespace texpert {
 		void setClusteringThreshold(float distance_th, float angle_th);
 
 
+		/*
+		Set the number of threads for the feature extraction and the voting.
+		@param num_threads - number of threads. A value < 1 uses all hardware threads.
+		*/
+		void setNumThreads(int num_threads);
+
+
 		/*
 		Enable console outputs.
 		*/
@@ -113,6 +158,25 @@ namespace texpert {
 
 	private:
 
+		/*
+		Pair each model point with the model points within the max. pair distance.
+		The pairs keep the order of the loop over all points.
+		@param points, normals - the model points and normal vectors.
+		@param keys, pairs - the table keys and vote pairs of all pairs.
+		@return false if the number of pairs exceeds the table size.
+		*/
+		bool extractBounded(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>* normals,
+			std::vector<std::uint64_t>& keys, std::vector<VotePair>& pairs);
+
+
+		/*
+		Compute the table key and the vote pair of the model point pair (p0, p1).
+		@param T - the reference frame of p0, see FDTools::getRefFrame().
+		*/
+		inline void PairFeature(const Eigen::Vector3f& p0, const Eigen::Vector3f& n0, const Eigen::Affine3f& T,
+			const Eigen::Vector3f& p1, const Eigen::Vector3f& n1, int point_index, std::uint64_t& key, VotePair& vote_pair) const;
+
+
 		// test object
 		vector<Eigen::Vector3f>*                 _points_test;
 		vector<Eigen::Vector3f>*				 _normals_test;
@@ -132,14 +196,22 @@ namespace texpert {
 		float									_angle_step;
 		int										_angle_bins;
 
-		// The ppf map for the test object
-		PPFMap									_map_test_points;
+		// max. distance between two paired model points, 0 pairs all points
+		float									_max_pair_distance;
+
+		// The ppf table for the test object
+		PPFTable								_map_test_points;
+
+		// one accumulator per thread, reused for all calls
+		std::vector<FDAccumulator>				_accumulators;
+		int										_num_threads;
 
 		// clustering 
 		FDClustering							_cluster;
 
-		// kdtree tofind the nearest matches
-		Cuda_KdTree*							_kdtree;
+		// knn to find the nearest matches. The kd-tree is reused if the points do not change. 
+		KNN*									_knn;
+		KNNResults								_matches;
 		int										_k;
 
 		bool									_verbose;
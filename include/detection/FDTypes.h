@@ -16,6 +16,8 @@ MIT License
 ---------------------------------------------------------------
 Last Changes:
 
+Oct 17, 2026
+- Added a default constructor to VotePair, so that vote pairs can be stored in flat arrays (PPFTable). 
 
 */
 
@@ -64,6 +66,9 @@ namespace texpert {
 		int				model_i;  // model point id
 		float			alpha_m;
 
+		_VotePair()
+			: model_i(-1), alpha_m(0.0f) {}
+
 		_VotePair(const int m_i, const float a_m)
 			: model_i(m_i), alpha_m(a_m) {}
 
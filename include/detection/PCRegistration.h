@@ -15,6 +15,7 @@
 #include "Utils.h"		
 #include "LogReaderWriter.h"
 #include "ICP.h"		// ICP
+#include "PoseTracker.h"	// frame-to-frame tracking
 
 
 namespace texpert{
@@ -42,12 +43,23 @@ typedef struct PCRegParams{
 	// icp
 	float	icp_min_error;
 
+	// tracking
+	float	tracking_max_rms; // max. ICP rms of a tracked object
+	float	tracking_min_inlier_fraction; // min. fraction of model inliers of a tracked object
+	float	tracking_min_inlier_ratio; // min. inlier fraction relative to the inlier fraction when the lock was acquired
+	bool	tracking_constant_velocity; // predict the next pose from the motion between the last two frames
+
 	PCRegParams()
 	{
 		ppf_angle_step = 3.0f;
 		ppf_distance_step = 0.3f;
 		ppf_cluster_distance_th = 0.8f;
 		ppf_cluster_angle_th = 12.0f;
+
+		tracking_max_rms = 3.0f;
+		tracking_min_inlier_fraction = 0.3f;
+		tracking_min_inlier_ratio = 0.5f;
+		tracking_constant_velocity = true;
 	}
 
 
@@ -79,6 +91,8 @@ public:
 	Process the current camera frame and match all reference objects with
 	possible counterparts in the camera point cloud. 
 	The function will immediately start the process. 
+	If all objects are tracked, the function refines the predicted poses and skips the feature matching.
+	It falls back to feature matching if one object is lost. 
 	@param camera_point_cloud - the location of the current point cloud to process. 
 	@return true, if all steps were exectued successfully. 
 	*/
@@ -119,6 +133,14 @@ public:
 
 private:
 
+	/*
+	Refine the poses with ICP and update the tracking states.
+	process() sets the camera point cloud of ICP.
+	@return true if all refined poses are healthy.
+	*/
+	bool refinePoses(void);
+
+
 	// vector to maintain the reference point clouds
 	std::vector<PointCloud>			_reference_point_clouds;
 
@@ -141,6 +163,9 @@ private:
 	std::vector<Pose>				_poses;
 	std::vector<glm::mat4>			_gl_poses;
 	std::vector<float>				_rms_error;
+
+	// one tracking state per object, index aligned
+	std::vector<PoseTracker>		_trackers;
 };
 
 
@@ -0,0 +1,189 @@
+#pragma once
+/*
+@class PPFTable
+
+@brief A flat lookup table from discrete point pair features to the model point pairs with this feature.
+
+The table replaces the node-based PPFMap (std::unordered_multimap) in FDMatching.
+The four discrete feature values are packed into a 64-bit key (distance 28 bits, angles 12 bits each).
+All (key, vote pair) entries are radix-sorted by key into one array, so the vote pairs of a key are
+one contiguous run (CSR layout). An open addressing hash table maps each key to its run.
+A lookup is one hash probe followed by a linear scan over the run.
+
+The radix sort is stable and the entries are created in the order of the model points.
+Thus, the vote pairs of a run keep the order of the naive loop, independent of the number of threads.
+
+Features with a value that does not fit into the key layout are not stored and never match.
+
+Usage:
+	PPFTable table;
+	table.build(keys, pairs);
+
+	int begin, end;
+	if (table.find(PPFTable::Key(ppf), begin, end)) {
+		for (int i = begin; i < end; i++) { const VotePair& vp = table.at(i); ... }
+	}
+
+MIT License
+-------------------------------------------------------------------------------------------------------
+Last edits:
+
+Oct 17, 2026
+- Added the class to replace the PPFMap in FDMatching.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+// local
+#include "FDTypes.h"
+#include "ParallelUtils.h"
+
+namespace texpert {
+
+
+class PPFTable
+{
+public:
+
+	// the key of features that do not fit into the key layout
+	static const std::uint64_t invalid_key = ~0ULL;
+
+
+	PPFTable();
+	~PPFTable();
+
+
+	/*!
+	Pack the discrete feature values into a table key.
+	@param ppf - the discrete feature.
+	@return the key, or invalid_key if a value does not fit into the key layout.
+	*/
+	static inline std::uint64_t Key(const PPFDiscreet& ppf)
+	{
+		if (ppf[0] >= (1u << 28) - 1 || ppf[1] >= (1u << 12) || ppf[2] >= (1u << 12) || ppf[3] >= (1u << 12)) {
+			return invalid_key;
+		}
+		return ((std::uint64_t)ppf[0] << 36) | ((std::uint64_t)ppf[1] << 24) | ((std::uint64_t)ppf[2] << 12) | (std::uint64_t)ppf[3];
+	}
+
+
+	/*!
+	Create the table. Entries with an invalid key are skipped.
+	The function uses both vectors as sort buffers, so that the build needs no copy of the entries.
+	@param keys - the key of each entry, see Key(). The vector is cleared.
+	@param pairs - the vote pair of each entry, index aligned with keys. The vector is cleared.
+	*/
+	void build(std::vector<std::uint64_t>& keys, std::vector<VotePair>& pairs);
+
+
+	/*!
+	Find the run of vote pairs with a key.
+	The matching vote pairs are at(begin) ... at(end-1).
+	@param key - the search key.
+	@param begin - the first index of the run.
+	@param end - the last index of the run, exclusive.
+	@return true if at least one vote pair matches.
+	*/
+	inline bool find(const std::uint64_t key, int& begin, int& end) const
+	{
+		begin = end = 0;
+		if (_slots.empty() || key == invalid_key) return false;
+
+		std::uint64_t s = Mix(key) & _mask;
+		while (_slots[s].run >= 0) {
+			if (_slots[s].key == key) {
+				begin = _start[_slots[s].run];
+				end = _start[_slots[s].run + 1];
+				return true;
+			}
+			s = (s + 1) & _mask;
+		}
+		return false;
+	}
+
+
+	/*!
+	Find the runs of multiple keys. The probes of the keys do not depend on each other,
+	so the processor can overlap their memory accesses.
+	@param keys - pointer to the search keys.
+	@param n - the number of keys.
+	@param begin - the first index of each run, n values. Empty runs have begin == end.
+	@param end - the last index of each run, exclusive, n values.
+	*/
+	void find(const std::uint64_t* keys, const int n, int* begin, int* end) const;
+
+
+	/*!
+	Return the vote pair at location i of the table.
+	*/
+	inline const VotePair& at(const int i) const { return _pairs[i]; }
+
+
+	/*!
+	Return the number of stored vote pairs.
+	*/
+	int size(void) const;
+
+
+	/*!
+	Return the number of distinct keys.
+	*/
+	int numKeys(void) const;
+
+
+	/*!
+	Return the number of entries that were skipped because of an invalid key.
+	*/
+	int numSkipped(void) const;
+
+
+	/*!
+	Clear the table.
+	*/
+	void clear(void);
+
+
+	/*!
+	Set the number of threads for building the table.
+	@param num_threads - number of threads. A value < 1 uses all hardware threads.
+	*/
+	void setNumThreads(int num_threads);
+
+
+private:
+
+	static inline std::uint64_t Mix(std::uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+
+	// hash table slot, key -> run index. run == -1 marks an empty slot.
+	typedef struct _Slot {
+		std::uint64_t	key;
+		int				run;
+	}Slot;
+
+
+	// the vote pairs, sorted by key
+	std::vector<VotePair>		_pairs;
+
+	// run r covers _pairs[_start[r]] ... _pairs[_start[r + 1] - 1]. Size num keys + 1.
+	std::vector<int>			_start;
+
+	// open addressing table, at most half full
+	std::vector<Slot>			_slots;
+	std::uint64_t				_mask;
+
+	int							_skipped;
+	int							_num_threads;
+};
+
+
+}//namespace texpert
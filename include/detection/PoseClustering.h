@@ -0,0 +1,93 @@
+#pragma once
+/*
+class PoseClustering
+
+The class groups pose candidates into clusters of similar poses.
+Two poses are similar if their translation delta is smaller than the translation threshold
+and, if enabled, their rotation delta is smaller than the rotation threshold.
+
+The clustering follows the schema of the CPF and FD matching:
+each candidate is tested against the first pose (the seed) of all existing clusters and joins
+every cluster with a similar seed. A candidate without similar seed creates a new cluster.
+
+The seeds are stored in a hash grid with a cell size equal to the translation threshold. A similar seed
+can only be located in one of the 27 neighboring cells of a candidate, thus, each candidate is only
+compared with a few seeds. The result is identical to comparing each candidate with all seeds.
+
+Used by CPFMatchingExp and FDClustering.
+
+MIT License
+---------------------------------------------------------------
+Last Changes:
+
+Oct 17, 2026
+- Added the class to replace the quadratic clustering in CPFMatchingExp and FDClustering.
+- The grid is cleared for each run, so its size only depends on the current candidates.
+*/
+
+// stl
+#include <vector>
+#include <iostream>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+
+// Eigen
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+
+namespace texpert {
+
+	class PoseClustering
+	{
+	public:
+
+		PoseClustering();
+		~PoseClustering();
+
+		/*
+		Cluster the poses.
+		@param poses - the pose candidates.
+		@param votes - the votes of each pose candidate. Index aligned with poses.
+		@param cluster_members - location for the pose candidate indices of each cluster, in candidate order.
+		@param cluster_votes - location for the sum of votes of each cluster. Index aligned with cluster_members.
+		@return the number of clusters.
+		*/
+		int cluster(const std::vector<Eigen::Affine3f>& poses, const std::vector<int>& votes,
+					std::vector< std::vector<int> >& cluster_members, std::vector<int>& cluster_votes);
+
+		/*
+		Set the translation threshold for two poses to be considered as similar.
+		@param value - the threshold, > 0.
+		*/
+		void setTranslationThreshold(float value);
+
+		/*
+		Set the rotation threshold for two poses to be considered as similar.
+		@param value - the threshold in rad. A value <= 0 disables the rotation test.
+		*/
+		void setRotationThreshold(float value);
+
+		/*
+		Test whether two poses are similar.
+		*/
+		bool similar(const Eigen::Affine3f& a, const Eigen::Affine3f& b);
+
+	private:
+
+		/*
+		Return the grid cell key for a translation and a cell offset.
+		*/
+		std::uint64_t cellKey(const Eigen::Vector3f& t, int dx, int dy, int dz);
+
+
+		// translation and rotation threshold
+		float	_translation_threshold;
+		float	_rotation_threshold;
+
+		// grid cell -> cluster indices of the seeds in this cell. Only contains the cells of the last run.
+		std::unordered_map<std::uint64_t, std::vector<int> >	_grid;
+	};
+
+}
@@ -0,0 +1,158 @@
+#pragma once
+/*
+class PoseTracker
+files: PoseTracker.h/.cpp
+
+@brief: A frame-to-frame tracking state machine for one object.
+
+Global detection (descriptor extraction, matching, voting, and pose clustering) is the most expensive
+step of the registration. Once the object was found, the pose of the previous frame is usually a good
+initial pose for ICP in the next frame. PoseTracker decides per frame whether detection can be skipped.
+
+States:
+- DETECTING: no reliable pose. The caller must run global detection and refine the detected poses.
+- TRACKING: the last refined pose was healthy. The caller skips detection and refines the seed poses
+  from predict() with ICP.
+
+A refined pose is healthy if ICP converged, its rms is <= max_rms, its inlier fraction is >= min_inlier_fraction,
+and its inlier fraction is >= min_inlier_ratio times the inlier fraction at the time the lock was acquired.
+The last test detects a slow loss, e.g., when the object moves out of view while ICP still fits a part of it.
+Any unhealthy pose returns to DETECTING.
+
+The seeds are the previous pose and, with the constant-velocity model, the previous pose moved by the
+motion between the last two frames, D = T_k * T_k-1^-1, T_k+1 = D * T_k. The prediction is the first seed.
+The velocity is only available after two consecutive tracked frames.
+
+Usage:
+	PoseTracker tracker;
+
+	std::vector<Eigen::Affine3f> seeds;
+	if (!tracker.predict(seeds)) {
+		// run detection and get the poses into seeds
+	}
+	// refine the seeds with ICP
+	tracker.update(converged, pose, rms, inlier_fraction);
+
+MIT License
+-----------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the class to skip global detection while the object is tracked.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// Eigen 3
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+
+namespace texpert{
+
+
+class PoseTracker
+{
+public:
+
+	typedef enum {
+		DETECTING, // no reliable pose, run global detection
+		TRACKING // skip detection and refine the predicted pose
+	}State;
+
+
+	PoseTracker();
+	~PoseTracker();
+
+
+	/*
+	Return the seed poses for ICP if the object is tracked.
+	@param seeds - the seed poses. The prediction comes first, the previous pose follows.
+		The vector is cleared if the object is not tracked.
+	@return true if the object is tracked and detection can be skipped.
+	*/
+	bool predict(std::vector<Eigen::Affine3f>& seeds);
+
+
+	/*
+	Report the refined pose of the current frame.
+	@param converged - true if ICP found a pose.
+	@param pose - the refined pose of the object.
+	@param rms - the ICP rms.
+	@param inlier_fraction - the fraction of the model points accepted as inliers, see ICP::getInlierFraction().
+	@return true if the pose is healthy. The tracker is in state TRACKING afterwards.
+	*/
+	bool update(bool converged, const Eigen::Matrix4f& pose, float rms, float inlier_fraction);
+
+
+	/*
+	Drop the lock. The next frame runs global detection.
+	*/
+	void reset(void);
+
+
+	/*
+	Return the current state.
+	*/
+	State getState(void);
+
+
+	/*
+	Return the number of frames tracked since the lock was acquired.
+	*/
+	int getTrackedFrames(void);
+
+
+	/*
+	Set the health thresholds of a refined pose.
+	@param max_rms - the max. ICP rms, in the units of the point clouds. Default is 0.01.
+	@param min_inlier_fraction - the min. fraction of inliers, in [0, 1]. Default is 0.3.
+	@param min_inlier_ratio - the min. inlier fraction relative to the inlier fraction at the time the lock was acquired,
+		in [0, 1]. Default is 0.5.
+	*/
+	void setHealthThresholds(float max_rms, float min_inlier_fraction, float min_inlier_ratio);
+
+
+	/*
+	Enable the constant-velocity model to predict the pose of the next frame.
+	@param enable - true predicts the pose from the motion between the last two frames. Default is true.
+	*/
+	void setConstantVelocity(bool enable);
+
+
+	/*
+	Enable extra debug messages.
+	@param verbose - output state changes if true.
+	*/
+	void setVerbose(bool verbose);
+
+
+private:
+
+	///////////////////////////////////////////////////////
+	// Members
+
+	State				_state;
+
+	// the last two tracked poses
+	Eigen::Matrix4f		_pose;
+	Eigen::Matrix4f		_prev_pose;
+	bool				_has_velocity;
+
+	// the inlier fraction at the time the lock was acquired
+	float				_reference_inliers;
+	int					_tracked_frames;
+
+	// params
+	float				_max_rms;
+	float				_min_inlier_fraction;
+	float				_min_inlier_ratio;
+	bool				_constant_velocity;
+	bool				_verbose;
+};
+
+
+}//namespace texpert{
@@ -0,0 +1,154 @@
+#pragma once
+/*
+@class VoteAccumulator
+
+@brief A Hough vote accumulator for one reference point, with a reset that only visits the voted cells.
+
+The voting of CPFMatchingExp and FDMatching counts votes per cell (model/scene point x angle bin).
+A dense accumulator has one counter per cell, but one reference point votes for a fraction of the cells only.
+The class keeps a list of the cells with votes, so reset() and a scan over all voted cells cost O(voted cells),
+not O(points x angle bins). The counters are never re-allocated between reference points or frames.
+
+The counters are stored in one of two ways, see setNumCells():
+- dense, one counter per cell. The default and the fastest mode.
+- sparse, the counters of the voted cells in an open addressing table. The table grows with the number
+  of distinct cells, not with the number of cells. Used for cell ranges too large for dense counters.
+
+The voted cells are visited in the order of their first vote in both modes.
+
+Usage:
+	VoteAccumulator acc;
+	acc.setNumCells(num_points * angle_bins);
+	acc.reset();
+	int votes = acc.add(cell);
+	...
+	for (int k = 0; k < acc.size(); k++) { acc.cell(k); acc.votes(k); }
+
+MIT License
+-------------------------------------------------------------------------------------------------------
+Last edits:
+
+Oct 17, 2026
+- Added the class to replace the dense accumulators in CPFMatchingExp and FDMatching.
+- Added dense(), which returns the selected counters.
+*/
+
+// stl
+#include <vector>
+#include <cstdint>
+
+
+namespace texpert {
+
+
+class VoteAccumulator
+{
+public:
+
+	VoteAccumulator();
+	~VoteAccumulator();
+
+
+	/*!
+	Set the number of cells and select the dense or sparse counters. Removes all votes.
+	@param num_cells - the number of cells. Valid cell indices are 0 ... num_cells - 1.
+	*/
+	void setNumCells(int num_cells);
+
+
+	/*!
+	Add one vote to a cell.
+	@param cell - the cell index, 0 <= cell < num_cells.
+	@return the number of votes of this cell, including this vote.
+	*/
+	inline int add(const int cell)
+	{
+		if (_dense) {
+			int v = ++_counts[cell];
+			if (v == 1) _touched.push_back(cell);
+			return v;
+		}
+
+		if (2 * ((int)_touched.size() + 1) > (int)_slots.size()) grow();
+
+		std::uint32_t s = Mix((std::uint32_t)cell) & _mask;
+		while (_slots[s].cell >= 0) {
+			if (_slots[s].cell == cell) return ++_slots[s].votes;
+			s = (s + 1) & _mask;
+		}
+		_slots[s].cell = cell;
+		_slots[s].votes = 1;
+		_touched.push_back((int)s);
+		return 1;
+	}
+
+
+	/*!
+	Return the number of cells with votes.
+	*/
+	inline int size(void) const { return (int)_touched.size(); }
+
+
+	/*!
+	Return the index of the k-th voted cell, k < size().
+	*/
+	inline int cell(const int k) const { return _dense ? _touched[k] : _slots[_touched[k]].cell; }
+
+
+	/*!
+	Return the votes of the k-th voted cell, k < size().
+	*/
+	inline int votes(const int k) const { return _dense ? _counts[_touched[k]] : _slots[_touched[k]].votes; }
+
+
+	/*!
+	Return true if the counters are dense, false if they are sparse. See setNumCells().
+	*/
+	inline bool dense(void) const { return _dense; }
+
+
+	/*!
+	Remove all votes. Only the voted cells are cleared.
+	*/
+	void reset(void);
+
+
+private:
+
+	/*
+	Double the table size and re-insert the voted cells in their order.
+	*/
+	void grow(void);
+
+
+	static inline std::uint32_t Mix(std::uint32_t h)
+	{
+		h ^= h >> 16;
+		h *= 0x85ebca6bU;
+		h ^= h >> 13;
+		return h;
+	}
+
+
+	// table slot. cell == -1 marks an empty slot.
+	typedef struct _Slot {
+		int		cell;
+		int		votes;
+	}Slot;
+
+
+	bool					_dense;
+
+	// dense counters, one per cell, zero for cells without votes
+	std::vector<int>		_counts;
+
+	// sparse counters, open addressing table, at most half full
+	std::vector<Slot>		_slots;
+	std::uint32_t			_mask;
+
+	// the cells (dense) or slots (sparse) with votes, in the order of the first vote
+	std::vector<int>		_touched;
+};
+
+
+}//namespace texpert
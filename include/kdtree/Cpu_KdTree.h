@@ -0,0 +1,250 @@
+#pragma once
+/*
+class Cpu_KdTree
+
+A multithreaded kd-tree that runs on the host. It is the fallback for machines without
+cuda device and implements the same interface as the cuda kd-tree (IKdTree).
+
+The tree is an implicit, balanced tree. All nodes are stored in a flat array; the children
+of node i are 2i+1 and 2i+2. Each node splits its point range at the median of the widest
+dimension. Leaves keep up to CPU_KD_LEAF_SIZE points. The points are stored in leaf order as
+separate x, y, z arrays so that the leaf scans read contiguous memory.
+
+Features:
+- Exact k-nearest neighbor search, k <= KNN_MATCHES_LENGTH for MyMatches, any k for KNNResults.
+- Exact radius search, returns the KNN_MATCHES_LENGTH closest points within the radius for MyMatches,
+  and all points or the max_neighbors closest points for KNNResults.
+- Parallel tree construction and parallel queries.
+- Zero-copy construction and queries from PointViews. Repeated KNNResults queries reuse
+  the output and the internal buffers and do not allocate memory once the buffers are large enough.
+- Approximate search with a leaf budget. The search stops backtracking after max_leaves leaves;
+  the first leaf is the leaf that contains the search point.
+- Queries do not modify the tree. A built tree can be queried from multiple threads at the same time;
+  the query buffers belong to the calling thread.
+
+The results are sorted by distance. MyMatch::distance stores the squared distance, as does the cuda kd-tree.
+Unused match slots are set to second = -1 and distance = 0.0.
+
+MIT License
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the class as cpu backend for KNN.
+- Added variable-length knn and radius search (KNNResults).
+- Added PointView functions and reusable query buffers.
+- The query buffers are thread-local so that shared trees (KdTreeCache) can be queried concurrently.
+- Added the leaf budget for approximate queries.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+// local
+#include "IKdTree.h"
+#include "Cuda_Types.h"
+#include "PointView.h"
+#include "ParallelUtils.h"
+
+
+// max. number of points per leaf
+#define CPU_KD_LEAF_SIZE 16
+
+
+class Cpu_KdTree : public IKdTree
+{
+public:
+
+	Cpu_KdTree();
+	~Cpu_KdTree();
+
+	/**
+	Create the kd-tree
+	@param points, a vector with all points
+	*/
+	void initialize(std::vector<MyPoint>& points);
+
+	/**
+	Create the kd-tree from a point view. The point ids are the indices in the view.
+	@param points, the view of all points
+	*/
+	void initialize(const PointView& points);
+
+	/**
+	Clears the tree memory.
+	This is necessary, if the tree should be re-used with new data.
+	*/
+	bool resetDevTree(void);
+
+	/**
+	Returns the number of points in this tree.
+	*/
+	int size(void);
+
+	/*
+	Searches for k nearest neighbors.
+	@param search_points, vector with the search points
+	@param matches, vector with the matches.
+	@param k - the number of neaarest neighbors to be fouund. Max. KNN_MATCHES_LENGTH
+	*/
+	void knn(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int k);
+
+	/*
+	Searches for the points within a given radius.
+	The function can only return the KNN_MATCHES_LENGTH closests matches to the search point.
+	@param search_points, vector with the search points
+	@param matches, vector with the matches.
+	@param radius, the maximum search radius.
+	*/
+	void radius_search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, double radius);
+
+	/*
+	Searches for k nearest neighbors and returns variable-length results.
+	@param search_points, vector with the search points
+	@param output, the neighbors of all search points.
+	@param k - the number of nearest neighbors to be found.
+	*/
+	void knn(std::vector<MyPoint>& search_points, KNNResults& output, int k);
+
+	/*
+	Searches for the points within a given radius and returns variable-length results.
+	@param search_points, vector with the search points
+	@param output, the neighbors of all search points.
+	@param radius, the maximum search radius.
+	@param max_neighbors, the max. number of neighbors per search point. The closest points are kept. A value <= 0 returns all points.
+	*/
+	void radius_search(std::vector<MyPoint>& search_points, KNNResults& output, double radius, int max_neighbors);
+
+	/*
+	Searches for k nearest neighbors of the points in a view.
+	@param search_points, the view of the search points.
+	@param output, the neighbors of all search points. The memory is reused.
+	@param k - the number of nearest neighbors to be found.
+	@param max_leaves - the max. number of leaves to visit per search point, <= 0 for an exact search.
+	*/
+	void knn(const PointView& search_points, KNNResults& output, int k, int max_leaves);
+
+	/*
+	Searches for the points within a given radius of the points in a view.
+	@param search_points, the view of the search points.
+	@param output, the neighbors of all search points. The memory is reused.
+	@param radius, the maximum search radius.
+	@param max_neighbors, the max. number of neighbors per search point. A value <= 0 returns all points.
+	@param max_leaves - the max. number of leaves to visit per search point, <= 0 for an exact search.
+	*/
+	void radius_search(const PointView& search_points, KNNResults& output, double radius, int max_neighbors, int max_leaves);
+
+	/*
+	Return the backend type of this tree.
+	*/
+	KdTreeBackend backend(void);
+
+	/*
+	Set the number of threads for tree construction and queries.
+	@param num_threads - number of threads. A value < 1 uses all hardware threads.
+	*/
+	void setNumThreads(int num_threads);
+
+	/*
+	Return the number of threads in use.
+	*/
+	int getNumThreads(void);
+
+private:
+
+	typedef struct _CpuKdNode
+	{
+		float	split; // split value
+		int		dim; // split dimension
+		int		begin; // first point index, inclusive
+		int		end; // last point index, exclusive
+
+	}CpuKdNode;
+
+	// the results of one chunk of search points and the search buffers of its thread
+	typedef struct _CpuKdChunk
+	{
+		int									begin; // first search point of the chunk
+		int									truncated;
+		std::vector<int>					indices;
+		std::vector<float>					distances;
+		std::vector<std::pair<float, int>>	row; // radius search candidates
+		std::vector<float>					best_dist; // knn candidates
+		std::vector<int>					best_idx;
+
+	}CpuKdChunk;
+
+	/*
+	Build the tree nodes and copy the points into leaf order.
+	The caller sets _ids from _perm and clears _perm.
+	*/
+	void build(const PointView& points);
+
+	/*
+	Recursively build the subtree for a node.
+	The function stops at stop_level and stores the open nodes in tasks, if tasks is not NULL.
+	*/
+	void buildNode(int node, int begin, int end, int level, int stop_level, std::vector<int>* tasks);
+
+	/*
+	Search a single point.
+	@param q - the search point
+	@param k - the number of points to find.
+	@param max_dist2 - the squared max. search distance.
+	@param index - the search point index.
+	@param result - the location for the result.
+	*/
+	void searchPoint(const float* q, int k, float max_dist2, int index, MyMatches& result);
+
+	/*
+	Run a query for all search points in parallel.
+	*/
+	void search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int k, float max_dist2);
+
+	/*
+	Run a query for all search points in parallel and pack the results.
+	@param k - the max. number of points per search point, <= 0 for all points within max_dist2.
+	@param max_leaves - the max. number of leaves to visit, <= 0 for an exact search.
+	*/
+	void search(const PointView& search_points, KNNResults& output, int k, float max_dist2, int max_leaves);
+
+	/*
+	Traverse the tree for a single point q (x, y, z). The collector provides the current search bound with bound()
+	and receives all leaf points closer than the bound with insert(squared distance, leaf order index).
+	The traversal stops after max_leaves leaves if max_leaves > 0.
+	*/
+	template<typename T>
+	void traverse(const float* q, T& collector, int max_leaves);
+
+	//----------------------------
+	// Data
+
+	// the tree nodes
+	std::vector<CpuKdNode>	_nodes;
+
+	// the points in leaf order
+	std::vector<float>		_x;
+	std::vector<float>		_y;
+	std::vector<float>		_z;
+	std::vector<int>		_ids;
+
+	// temporary permutation array used for construction
+	std::vector<int>		_perm;
+
+	// the points during construction
+	PointView				_build_points;
+
+
+	// tree depth. Nodes with this level are leaves.
+	int						_depth;
+
+	// number of points in the tree
+	int						_N;
+
+	// number of threads
+	int						_num_threads;
+};
@@ -0,0 +1,169 @@
+#pragma once
+/*
+class Cpu_RadiusGrid
+
+A uniform grid for fixed-radius neighbor searches on the host.
+Descriptor extraction only searches neighbors within one fixed radius. For this query, a grid with
+a cell size equal to the radius is faster than a kd-tree: the grid is built with one counting sort,
+and a query only scans the 3 x 3 x 3 cells around the search point.
+
+The cells are organized in rows along the x-axis. A row contains all cells with the same y and z cell
+coordinate. The points of a row are stored in contiguous memory and sorted by their x-coordinate,
+so a query scans the 9 neighboring rows as 9 contiguous ranges. The range of a row is clipped to the part
+of the search sphere that intersects the row. The rows are found with a hash table, so the memory does not
+depend on the extent of the point cloud, e.g., for outliers far away from the scene.
+
+Features:
+- Exact radius search that returns all points or the max_neighbors closest points (KNNResults),
+  the same results as Cpu_KdTree::radius_search() up to the order of points with equal distance.
+- Radii larger than the cell size are supported, but scan more rows.
+- Parallel construction and parallel queries.
+- Queries do not modify the grid. The query buffers belong to the calling thread.
+
+KNN uses the grid for radius searches with the cpu backend (see KNN::setIndex()).
+
+MIT License
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the class for fixed-radius neighbor searches.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// local
+#include "KNNResults.h"
+#include "PointView.h"
+#include "ParallelUtils.h"
+
+
+class Cpu_RadiusGrid
+{
+public:
+
+	Cpu_RadiusGrid();
+	~Cpu_RadiusGrid();
+
+	/*
+	Create the grid from a point view. The point ids are the indices in the view.
+	@param points, the view of all points.
+	@param cell_size, the edge length of a cell. Use the search radius.
+	*/
+	void initialize(const PointView& points, float cell_size);
+
+	/*
+	Clears the grid memory.
+	*/
+	void reset(void);
+
+	/*
+	Returns the number of points in this grid.
+	*/
+	int size(void);
+
+	/*
+	Returns the edge length of a cell.
+	*/
+	float cellSize(void);
+
+	/*
+	Searches for the points within a given radius of the points in a view.
+	@param search_points, the view of the search points.
+	@param output, the neighbors of all search points. The memory is reused.
+	@param radius, the maximum search radius.
+	@param max_neighbors, the max. number of neighbors per search point. The closest points are kept. A value <= 0 returns all points.
+	*/
+	void radius_search(const PointView& search_points, KNNResults& output, double radius, int max_neighbors);
+
+	/*
+	Set the number of threads for construction and queries.
+	@param num_threads - number of threads. A value < 1 uses all hardware threads.
+	*/
+	void setNumThreads(int num_threads);
+
+	/*
+	Return the number of threads in use.
+	*/
+	int getNumThreads(void);
+
+private:
+
+	// the results of one chunk of search points and the search buffers of its thread
+	typedef struct _GridChunk
+	{
+		int									begin; // first search point of the chunk
+		int									truncated;
+		std::vector<int>					indices;
+		std::vector<float>					distances;
+		std::vector<std::pair<float, int>>	row; // candidates
+
+	}GridChunk;
+
+	// a slot of the row hash table. Empty slots have row = -1.
+	typedef struct _RowSlot
+	{
+		std::uint64_t	key;
+		int				row;
+
+	}RowSlot;
+
+	/*
+	Return the cell coordinate of a value along one axis.
+	*/
+	inline std::int64_t cell(float v, int dim) const
+	{
+		return (std::int64_t)std::floor((v - _min[dim]) * _inv_cell);
+	}
+
+	/*
+	Return the key of the row with the cell coordinates y and z.
+	*/
+	inline std::uint64_t rowKey(std::int64_t y, std::int64_t z) const
+	{
+		return ((std::uint64_t)(std::uint32_t)y << 32) | (std::uint32_t)z;
+	}
+
+	/*
+	Return the row index of a row key, or -1 if the row does not exist.
+	*/
+	int findRow(std::uint64_t key) const;
+
+	/*
+	Insert a row key into the hash table if it does not exist.
+	@return the row index of the key.
+	*/
+	int insertRow(std::uint64_t key, int& num_rows);
+
+	//----------------------------
+	// Data
+
+	// hash table, row key -> row index
+	std::vector<RowSlot>	_table;
+	std::uint64_t			_table_mask;
+
+	// the first point of each row, number of rows + 1 entries
+	std::vector<int>		_start;
+
+	// the points in row order, sorted by x within a row
+	std::vector<float>		_x;
+	std::vector<float>		_y;
+	std::vector<float>		_z;
+	std::vector<int>		_ids;
+
+	// the grid origin and cell size
+	float					_min[3];
+	float					_cell;
+	float					_inv_cell;
+
+	// number of points in the grid
+	int						_N;
+
+	// number of threads
+	int						_num_threads;
+};
@@ -7,6 +7,14 @@ Iowa State University
 rafael@iastate.edu
 MIT License
 ---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- The class implements the IKdTree interface so that KNN can switch between the cuda and the cpu kd-tree.
+- Uses the IKdTree conversion for KNNResults and PointViews.
+- The search functions process any number of search points. The points are streamed in chunks of
+  CUDA_KD_QUERY_CHUNK points through the fixed device buffers, using two cuda streams so that copies and searches overlap.
+- initialize() rejects more than MAX_NUM_POINTS points instead of overwriting device memory. KNN switches to the cpu kd-tree for larger point sets.
 */
 
 
@@ -34,12 +42,15 @@ MIT License
 #include "Cuda_Helpers.h"
 #include "Cuda_Common.h"
 #include "Cuda_Types.h"
+#include "IKdTree.h"
 
 #define _WITH_PERFORMANCE
 
 #define MAX_NUM_POINTS 800000
 #define MAX_SEARCH_POINTS 100000
 #define MAX_OUTPUT_POINTS 450000
+// number of search points per chunk. Two chunks must fit into the query buffers.
+#define CUDA_KD_QUERY_CHUNK (MAX_SEARCH_POINTS / 2)
 #define RELOC_TPB 64
 using namespace std;
 using namespace std::chrono;
@@ -97,7 +108,7 @@ private:
 //--------------------------------------------------------------------------------------
 // KD-tree 
 
-class Cuda_KdTree // : public mycv::KdTree<mycv::dPoint>
+class Cuda_KdTree : public IKdTree
 {
 public:
 
@@ -161,12 +172,34 @@ public:
 	*/
 	void radius_search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, double radius);
 
+	// The KNNResults and PointView functions convert the data (see IKdTree).
+	using IKdTree::initialize;
+	using IKdTree::knn;
+	using IKdTree::radius_search;
+
+
+	/*
+	Return the backend type of this tree.
+	*/
+	KdTreeBackend backend(void) { return KD_CUDA; }
+
+	/*
+	Return the max. number of reference points.
+	*/
+	int maxPoints(void) { return MAX_NUM_POINTS; }
+
 private:
 	/**
 	Allocate memory
 	*/
 	void allocateMemory(void);
 
+	/*
+	Run a search in chunks of CUDA_KD_QUERY_CHUNK points.
+	@param mode - 0: nearest neighbor, 1: k nearest neighbors, 2: radius search.
+	*/
+	void search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int mode, int k, double radius);
+
 	ChunkedSorter* sorter;
 
 	// Streams for running multiple kernels in parallel. Online created once, then reused
@@ -0,0 +1,324 @@
+#pragma once
+/*
+class IKdTree
+
+Abstract interface for all kd-tree backends. KNN works with this interface only,
+so the backend can be exchanged at runtime.
+
+Implementations:
+- Cuda_KdTree, the cuda kd-tree. Requires a cuda device.
+- Cpu_KdTree, a multithreaded kd-tree for hosts without cuda device.
+
+All backends report the squared distance in MyMatch::distance and the point id (MyPoint::_id)
+of the reference point in MyMatch::second. MyMatch::first stores the index of the search point.
+
+The KNNResults functions return variable-length results without the KNN_MATCHES_LENGTH limit.
+Backends without a native implementation convert the MyMatches results, so their
+radius search still stops at KNN_MATCHES_LENGTH neighbors. Search points that reach this limit although
+more neighbors were requested are counted in KNNResults::truncated and reported with a warning, see setWarnTruncated().
+
+The PointView functions read the points from existing buffers. The point id of a reference point
+is its index in the view. Backends without a native implementation copy the view into MyPoints.
+They also take a leaf budget for an approximate search. The budget is a query parameter, not a tree
+setting, because trees can be shared (KdTreeCache). Backends that cannot bound the search ignore it.
+
+The conversions reuse buffers of the tree, so repeated queries, e.g., in ICP, do not allocate memory.
+Thus, the converted queries of one tree must not run concurrently. KNN locks the shared cuda kd-tree.
+
+MIT License
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added knn and radius search functions that return KNNResults.
+- Added initialize, knn, and radius search functions that read PointViews.
+- Added a max. leaf budget to the PointView queries for approximate searches.
+- The PointView conversion processes the search points in chunks of IKD_QUERY_CHUNK points, so the temporary
+  MyPoints and MyMatches stay small for large search sets.
+- Added maxPoints() to report the max. number of reference points of a backend.
+- The MyMatches conversion counts a search point as truncated only if more than KNN_MATCHES_LENGTH neighbors
+  were requested and the limit was reached.
+- The truncation warning is on by default.
+- The PointView and KNNResults conversions reuse member buffers for the MyPoints, MyMatches, and KNNResults
+  instead of allocating them for each query. A single chunk is written into the output directly.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+
+// local
+#include "Cuda_Types.h"
+#include "KNNResults.h"
+#include "PointView.h"
+
+
+// number of search points the PointView conversion processes at once
+#define IKD_QUERY_CHUNK 65536
+
+
+/*
+The available kd-tree backends.
+KD_AUTO selects the cuda kd-tree if a cuda device is present and the cpu kd-tree otherwise.
+*/
+typedef enum _KdTreeBackend
+{
+	KD_AUTO = 0,
+	KD_CUDA = 1,
+	KD_CPU = 2
+
+}KdTreeBackend;
+
+
+class IKdTree
+{
+public:
+
+	IKdTree() : _warn_truncated(true) {}
+
+	virtual ~IKdTree() {}
+
+	/**
+	Create the kd-tree
+	@param points, a vector with all points
+	*/
+	virtual void initialize(std::vector<MyPoint>& points) = 0;
+
+	/**
+	Create the kd-tree from a point view. The point ids are the indices in the view.
+	The tree does not keep a reference to the view.
+	@param points, the view of all points
+	*/
+	virtual void initialize(const PointView& points)
+	{
+		std::vector<MyPoint> p;
+		toPoints(points, p);
+		initialize(p);
+	}
+
+	/**
+	Clears the tree memory.
+	This is necessary, if the tree should be re-used with new data.
+	*/
+	virtual bool resetDevTree(void) = 0;
+
+	/**
+	Returns the number of points in this tree.
+	*/
+	virtual int size(void) = 0;
+
+	/*
+	Searches for k nearest neighbors.
+	@param search_points, vector with the search points
+	@param matches, vector with the matches.
+	@param k - the number of neaarest neighbors to be fouund.
+	*/
+	virtual void knn(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int k) = 0;
+
+	/*
+	Searches for the points within a given radius.
+	The function can only return the KNN_MATCHES_LENGTH closests matches to the search point.
+	@param search_points, vector with the search points
+	@param matches, vector with the matches.
+	@param radius, the maximum search radius.
+	*/
+	virtual void radius_search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, double radius) = 0;
+
+	/*
+	Searches for k nearest neighbors and returns variable-length results.
+	@param search_points, vector with the search points
+	@param output, the neighbors of all search points.
+	@param k - the number of nearest neighbors to be found.
+	*/
+	virtual void knn(std::vector<MyPoint>& search_points, KNNResults& output, int k)
+	{
+		convertKnn(search_points, output, k);
+	}
+
+	/*
+	Searches for the points within a given radius and returns variable-length results.
+	@param search_points, vector with the search points
+	@param output, the neighbors of all search points.
+	@param radius, the maximum search radius.
+	@param max_neighbors, the max. number of neighbors per search point. The closest points are kept. A value <= 0 returns all points.
+	*/
+	virtual void radius_search(std::vector<MyPoint>& search_points, KNNResults& output, double radius, int max_neighbors)
+	{
+		convertRadius(search_points, output, radius, max_neighbors);
+		warnTruncated(output, max_neighbors);
+	}
+
+	/*
+	Searches for k nearest neighbors of the points in a view.
+	@param search_points, the view of the search points. It is not copied by backends with native support.
+	@param output, the neighbors of all search points. The memory is reused.
+	@param k - the number of nearest neighbors to be found.
+	@param max_leaves - the max. number of leaves to visit per search point, <= 0 for an exact search.
+	*/
+	virtual void knn(const PointView& search_points, KNNResults& output, int k, int max_leaves)
+	{
+		if (search_points.size() <= IKD_QUERY_CHUNK) {
+			toPoints(search_points, _query_points);
+			convertKnn(_query_points, output, k);
+			return;
+		}
+
+		output.clear();
+		output.offsets.assign(1, 0);
+
+		for (int begin = 0; begin < search_points.size(); begin += IKD_QUERY_CHUNK) {
+			toPoints(search_points, _query_points, begin, std::min(search_points.size(), begin + IKD_QUERY_CHUNK));
+			convertKnn(_query_points, _query_chunk, k);
+			output.append(_query_chunk);
+		}
+	}
+
+	/*
+	Searches for the points within a given radius of the points in a view.
+	@param search_points, the view of the search points. It is not copied by backends with native support.
+	@param output, the neighbors of all search points. The memory is reused.
+	@param radius, the maximum search radius.
+	@param max_neighbors, the max. number of neighbors per search point. A value <= 0 returns all points.
+	@param max_leaves - the max. number of leaves to visit per search point, <= 0 for an exact search.
+	*/
+	virtual void radius_search(const PointView& search_points, KNNResults& output, double radius, int max_neighbors, int max_leaves)
+	{
+		if (search_points.size() <= IKD_QUERY_CHUNK) {
+			toPoints(search_points, _query_points);
+			convertRadius(_query_points, output, radius, max_neighbors);
+			warnTruncated(output, max_neighbors);
+			return;
+		}
+
+		output.clear();
+		output.offsets.assign(1, 0);
+
+		for (int begin = 0; begin < search_points.size(); begin += IKD_QUERY_CHUNK) {
+			toPoints(search_points, _query_points, begin, std::min(search_points.size(), begin + IKD_QUERY_CHUNK));
+			convertRadius(_query_points, _query_chunk, radius, max_neighbors);
+			output.append(_query_chunk);
+		}
+		warnTruncated(output, max_neighbors);
+	}
+
+	/*
+	Return the backend type of this tree.
+	*/
+	virtual KdTreeBackend backend(void) = 0;
+
+	/*
+	Return the max. number of reference points the tree can store, or -1 if the number is not limited.
+	*/
+	virtual int maxPoints(void) { return -1; }
+
+	/*
+	Print a warning if the MyMatches conversion cuts the neighbors of search points at KNN_MATCHES_LENGTH.
+	@param warn - true enables the warning. The default is true.
+	*/
+	void setWarnTruncated(bool warn) { _warn_truncated = warn; }
+
+protected:
+
+	/*
+	Run the MyMatches knn search and convert the matches into KNNResults.
+	*/
+	void convertKnn(std::vector<MyPoint>& search_points, KNNResults& output, int k)
+	{
+		knn(search_points, _query_matches, std::min(k, KNN_MATCHES_LENGTH));
+		toResults(_query_matches, output, std::min(k, KNN_MATCHES_LENGTH), FLT_MAX, k);
+	}
+
+	/*
+	Run the MyMatches radius search and convert the matches into KNNResults.
+	*/
+	void convertRadius(std::vector<MyPoint>& search_points, KNNResults& output, double radius, int max_neighbors)
+	{
+		int k = (max_neighbors <= 0) ? KNN_MATCHES_LENGTH : std::min(max_neighbors, KNN_MATCHES_LENGTH);
+		radius_search(search_points, _query_matches, radius);
+		toResults(_query_matches, output, k, (float)(radius * radius), max_neighbors);
+	}
+
+	/*
+	Warn if the radius search was cut at KNN_MATCHES_LENGTH neighbors although more were requested.
+	Only if enabled, see setWarnTruncated().
+	*/
+	void warnTruncated(const KNNResults& output, int max_neighbors)
+	{
+		if (_warn_truncated && output.truncated > 0 && (max_neighbors <= 0 || max_neighbors > KNN_MATCHES_LENGTH)) {
+			std::cout << "[WARNING] - IKdTree: the radius search of this backend returns max. " << KNN_MATCHES_LENGTH << " neighbors; " << output.truncated << " search points were cut." << std::endl;
+		}
+	}
+
+	/*
+	Copy a point view into MyPoints. The point id is the index in the view.
+	*/
+	static void toPoints(const PointView& view, std::vector<MyPoint>& points)
+	{
+		toPoints(view, points, 0, view.size());
+	}
+
+	/*
+	Copy the points [begin, end) of a point view into MyPoints. The point id is the index in the view.
+	*/
+	static void toPoints(const PointView& view, std::vector<MyPoint>& points, int begin, int end)
+	{
+		points.resize(end - begin);
+		for (int i = begin; i < end; i++) {
+			const float* v = view[i];
+			MyPoint& p = points[i - begin];
+			p._data[0] = v[0];
+			p._data[1] = v[1];
+			p._data[2] = v[2];
+			p._id = i;
+		}
+	}
+
+	/*
+	Pack MyMatches into KNNResults. Keeps the k closest valid matches within max_dist2 of each search point
+	and sorts them by distance. A search point is counted as truncated if all KNN_MATCHES_LENGTH matches are valid
+	and the caller requested more, i.e., requested <= 0 (all points) or requested > KNN_MATCHES_LENGTH.
+	*/
+	void toResults(const std::vector<MyMatches>& matches, KNNResults& output, int k, float max_dist2, int requested)
+	{
+		bool above_limit = requested <= 0 || requested > KNN_MATCHES_LENGTH;
+
+		int n = (int)matches.size();
+		output.clear();
+		output.offsets.resize(n + 1);
+		output.indices.reserve(size_t(n) * 8);
+		output.distances.reserve(size_t(n) * 8);
+		output.offsets[0] = 0;
+
+		std::vector<std::pair<float, int>>& row = _query_row;
+		row.reserve(KNN_MATCHES_LENGTH);
+
+		for (int i = 0; i < n; i++) {
+			row.clear();
+			for (int j = 0; j < KNN_MATCHES_LENGTH; j++) {
+				const MyMatch& m = matches[i].matches[j];
+				if (m.second < 0 || m.distance > max_dist2) continue;
+				row.push_back(std::make_pair((float)m.distance, m.second));
+			}
+			std::sort(row.begin(), row.end());
+
+			int count = std::min((int)row.size(), k);
+			for (int j = 0; j < count; j++) {
+				output.indices.push_back(row[j].second);
+				output.distances.push_back(row[j].first);
+			}
+			if (above_limit && (int)row.size() == KNN_MATCHES_LENGTH) output.truncated++;
+			output.offsets[i + 1] = (int)output.indices.size();
+		}
+	}
+
+	// print a warning for truncated radius searches
+	bool	_warn_truncated;
+
+	// reusable buffers of the conversions
+	std::vector<MyPoint>				_query_points;
+	std::vector<MyMatches>				_query_matches;
+	KNNResults							_query_chunk;
+	std::vector<std::pair<float, int>>	_query_row;
+};
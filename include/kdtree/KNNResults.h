@@ -0,0 +1,102 @@
+#pragma once
+/*
+struct KNNResults
+
+Variable-length nearest neighbor results in compressed sparse row (CSR) layout.
+The neighbors of all search points are packed into two arrays. The neighbors of search point i are
+stored in the range [offsets[i], offsets[i+1]) of indices and distances. Thus, a search point
+with three neighbors costs three entries instead of a fixed MyMatches array with KNN_MATCHES_LENGTH entries.
+
+indices stores the point id (MyPoint::_id) of the reference point, distances stores the squared distance.
+The neighbors of each search point are sorted by distance.
+
+Usage:
+	KNNResults results;
+	knn.radius(pc, 0.01f, results);
+
+	for (int i = 0; i < results.size(); i++) {
+		for (int j = results.begin(i); j < results.end(i); j++) {
+			int id = results.indices[j];
+			float d2 = results.distances[j];
+		}
+	}
+
+MIT License
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the struct to replace the fixed MyMatches arrays.
+- Added append() to collect the results of search points that are processed in chunks.
+*/
+
+// stl
+#include <vector>
+
+
+typedef struct _KNNResults
+{
+	std::vector<int>	offsets; // size() + 1 entries, offsets[0] = 0
+	std::vector<int>	indices; // the point ids of the neighbors
+	std::vector<float>	distances; // the squared distances of the neighbors
+
+	// number of search points whose neighbors were cut at the neighbor limit
+	int					truncated;
+
+	_KNNResults()
+	{
+		truncated = 0;
+	}
+
+	// number of search points
+	inline int size(void) const
+	{
+		return offsets.empty() ? 0 : (int)offsets.size() - 1;
+	}
+
+	// first and one-past-last entry of search point i
+	inline int begin(int i) const
+	{
+		return offsets[i];
+	}
+
+	inline int end(int i) const
+	{
+		return offsets[i + 1];
+	}
+
+	// number of neighbors of search point i
+	inline int count(int i) const
+	{
+		return offsets[i + 1] - offsets[i];
+	}
+
+	// total number of neighbors
+	inline int total(void) const
+	{
+		return (int)indices.size();
+	}
+
+	// append the results of more search points. Their rows follow the rows of this object.
+	inline void append(const _KNNResults& other)
+	{
+		if (offsets.empty()) offsets.push_back(0);
+		int base = (int)indices.size();
+		for (int i = 1; i < (int)other.offsets.size(); i++) {
+			offsets.push_back(base + other.offsets[i]);
+		}
+		indices.insert(indices.end(), other.indices.begin(), other.indices.end());
+		distances.insert(distances.end(), other.distances.begin(), other.distances.end());
+		truncated += other.truncated;
+	}
+
+	// remove all results, but keep the memory.
+	inline void clear(void)
+	{
+		offsets.clear();
+		indices.clear();
+		distances.clear();
+		truncated = 0;
+	}
+
+}KNNResults;
@@ -0,0 +1,120 @@
+#pragma once
+/*
+class KdTreeCache
+
+A cache of built cpu kd-trees, keyed by the content of the reference points.
+Detectors and ICP build a kd-tree for the same models and for a static scene over and over.
+The cache keeps the most recently used trees, so re-indexing unchanged points skips the tree construction.
+
+The key is a 64-bit hash of the point coordinates (Hash()) or a version token supplied by the caller.
+A caller token must change whenever the points change. The key 0 is reserved and means "not built".
+The hash is computed in fixed-size blocks, so it does not depend on the number of threads.
+
+The cached trees are immutable and shared. They can be queried from multiple threads at the same time.
+A tree stays valid as long as a caller holds its shared_ptr, even if the cache evicts it.
+
+The cuda kd-tree exists only once and is not stored in the cache. Instead, the cache remembers the key
+of the points the cuda tree was built with (MarkBuilt(), IsBuilt()), so an unchanged point set is not uploaded again.
+
+Usage:
+	std::shared_ptr<IKdTree> tree = KdTreeCache::Get(PointView(pc.points));
+	tree->radius_search(PointView(pc.points), results, 0.01, -1);
+
+KNN::populateCached() uses the cache.
+
+MIT License
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the class to avoid rebuilding kd-trees for unchanged reference points.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+// local
+#include "IKdTree.h"
+#include "PointView.h"
+
+
+/*
+Usage statistics of the cache.
+*/
+typedef struct _KdTreeCacheStats
+{
+	std::int64_t	hits; // trees returned from the cache
+	std::int64_t	misses; // trees that had to be built
+	int				trees; // trees in the cache
+	std::int64_t	points; // points in all cached trees
+
+	_KdTreeCacheStats()
+	{
+		hits = 0;
+		misses = 0;
+		trees = 0;
+		points = 0;
+	}
+
+}KdTreeCacheStats;
+
+
+class KdTreeCache
+{
+public:
+
+	/*
+	Return the content hash of the points. The hash only depends on the coordinates,
+	not on the stride of the view. It is never 0.
+	@param points - view of the points
+	@return the 64-bit hash
+	*/
+	static std::uint64_t Hash(const PointView& points);
+
+	/*
+	Return a cpu kd-tree for the points. The tree is built and stored if the cache does not
+	contain a tree with this key. The point ids are the indices in the view.
+	@param points - view of the reference points
+	@param key - the key of the points, 0 to use Hash(points).
+	@return the tree, or an empty pointer if the view is empty.
+	*/
+	static std::shared_ptr<IKdTree> Get(const PointView& points, std::uint64_t key = 0);
+
+	/*
+	Remember the key of the points a shared tree, e.g., the cuda kd-tree, was built with.
+	@param tree - the tree.
+	@param key - the key of the points, 0 if the tree content is unknown or changed.
+	*/
+	static void MarkBuilt(IKdTree* tree, std::uint64_t key);
+
+	/*
+	Check if a shared tree was built with the points of this key.
+	@return true, if the key is not 0 and matches the last key passed to MarkBuilt().
+	*/
+	static bool IsBuilt(IKdTree* tree, std::uint64_t key);
+
+	/*
+	Set the max. number of cached trees. The least recently used trees are removed first.
+	@param num_trees - the number of trees, >= 1. Default is 8.
+	*/
+	static void SetCapacity(int num_trees);
+
+	/*
+	Return the max. number of cached trees.
+	*/
+	static int GetCapacity(void);
+
+	/*
+	Remove all trees and reset the statistics.
+	*/
+	static void Clear(void);
+
+	/*
+	Return the usage statistics.
+	*/
+	static KdTreeCacheStats GetStats(void);
+};
@@ -0,0 +1,70 @@
+#pragma once
+/*
+struct PointView
+
+A non-owning, strided view over point coordinates. The view points to the x-coordinate of the first
+point; y and z follow as consecutive floats. stride is the distance between two points in bytes.
+The view does not copy the data, so the storage must outlive the view and must not be reallocated while the view is used.
+
+The view works with all types that start with three floats, e.g., Eigen::Vector3f, float3, or MyPoint:
+	std::vector<Eigen::Vector3f> points;
+	PointView view(points);
+
+	float xyzn[6 * N]; // x, y, z, nx, ny, nz
+	PointView view(xyzn, N, 6 * sizeof(float));
+
+MIT License
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the struct for the zero-copy KNN query functions.
+*/
+
+// stl
+#include <vector>
+#include <cstddef>
+
+
+typedef struct _PointView
+{
+	const float*	data; // the x-coordinate of the first point
+	int				count; // number of points
+	int				stride; // bytes between two points
+
+	_PointView()
+	{
+		data = NULL;
+		count = 0;
+		stride = 3 * sizeof(float);
+	}
+
+	_PointView(const float* data_, int count_, int stride_ = 3 * sizeof(float))
+	{
+		data = data_;
+		count = count_;
+		stride = stride_;
+	}
+
+	// view a vector of points whose type starts with three floats
+	template<typename T>
+	_PointView(const std::vector<T>& points)
+	{
+		static_assert(sizeof(T) >= 3 * sizeof(float), "PointView: the point type must start with three floats.");
+		data = points.empty() ? NULL : reinterpret_cast<const float*>(points.data());
+		count = (int)points.size();
+		stride = sizeof(T);
+	}
+
+	// the coordinates of point i
+	inline const float* operator[](int i) const
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const char*>(data) + size_t(i) * stride);
+	}
+
+	inline int size(void) const
+	{
+		return count;
+	}
+
+}PointView;
@@ -1,9 +1,29 @@
 #pragma once
+/*
+class ResourceManager
+
+The resource manager creates and shares the kd-tree instances.
+The cuda kd-tree requires plenty of gpu memory, thus, only one instance of the cuda kd-tree exists.
+The cpu kd-tree is cheap to create; every caller gets its own instance.
+
+---------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added a backend parameter to select the cuda or the cpu kd-tree.
+  KD_AUTO selects the cpu kd-tree if no cuda device is available.
+- Added a mutex to guard the shared cuda kd-tree when multiple threads use it.
+- KNN locks the kd-tree mutex in every call that uses the cuda kd-tree. The mutex is recursive.
+- The reference count of the cuda kd-tree is guarded by a mutex.
+*/
 #include <iostream>
 #include <string>
 #include <vector>
+#include <mutex>
 
+#include "IKdTree.h"
 #include "Cuda_KdTree.h"
+#include "Cpu_KdTree.h"
 
 
 
@@ -11,13 +31,50 @@ class ResourceManager
 {
 public:
 
+	/*
+	Return a kd-tree instance.
+	@param backend - the kd-tree backend. KD_AUTO uses the default backend.
+	@return - pointer to the kd-tree. Release it with UnrefKDTree.
+	*/
+	static IKdTree* GetKDTree(KdTreeBackend backend = KD_AUTO);
+
+
+	/*
+	Release a kd-tree instance.
+	@param tree - pointer to the kd-tree.
+	@return - true, if the tree was released.
+	*/
+	static bool UnrefKDTree(IKdTree* tree);
 
-	static Cuda_KdTree* GetKDTree(void);
 
+	/*
+	Set the backend that KD_AUTO resolves to.
+	@param backend - KD_CUDA, KD_CPU, or KD_AUTO to select cuda if a device is available.
+	*/
+	static void SetDefaultBackend(KdTreeBackend backend);
 
-	static bool UnrefKDTree(Cuda_KdTree* tree);
+
+	/*
+	Return the backend that KD_AUTO resolves to.
+	*/
+	static KdTreeBackend GetDefaultBackend(void);
+
+
+	/*
+	Check if a cuda device is available.
+	@return - true, if at least one cuda device was found.
+	*/
+	static bool HasCudaDevice(void);
+
+
+	/*
+	Return the mutex for the shared cuda kd-tree. 
+	All KNN instances with a cuda backend use the same tree. KNN locks the mutex in each call 
+	that uses the cuda kd-tree, so KNN users do not need to lock it. 
+	The mutex is recursive. A caller can hold it for a sequence of KNN calls. 
+	*/
+	static std::recursive_mutex& GetKDTreeMutex(void);
 
 private:
 
 };
-
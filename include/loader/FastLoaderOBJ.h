@@ -0,0 +1,61 @@
+#pragma once
+/*
+class FastLoaderOBJ
+
+Loads the vertices and vertex normals of a Wavefront OBJ file.
+The file is memory mapped and split into line-aligned chunks, which are parsed in parallel.
+The chunks are merged in file order, so the result is identical to a sequential read.
+Numbers are parsed with std::from_chars, which does not depend on the current locale.
+
+The supported lines are
+	v x y z [...]
+	vn nx ny nz
+All other lines (faces, texture coordinates, comments, ...) are skipped.
+Invalid vertices and normal vectors are stored as (0, 0, 0), as in ReaderWriterOBJ.
+
+Usage:
+	std::vector<Eigen::Vector3f> points, normals;
+	FastLoaderOBJ::Read("model.obj", points, normals);
+
+MIT License
+------------------------------------------------------
+Last Changes:
+
+Oct 17, 2026
+- Added the class as faster alternative to ReaderWriterOBJ and LoaderObj for large models.
+*/
+
+// stl
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Eigen
+#include <Eigen/Dense>
+
+// local
+#include "MappedFile.h"
+#include "ParallelUtils.h"
+
+namespace texpert {
+
+	class FastLoaderOBJ
+	{
+	public:
+
+		/*!
+		Load the vertices and normal vectors of an obj file.
+		@param file - the file.
+		@param dst_points - the location for the points.
+		@param dst_normals - the location for the normal vectors.
+		@param invert_z - inverts the z-axis of points and normal vectors.
+		@param num_threads - number of threads. A value <= 0 uses all hardware threads.
+		@param verbose - prints the number of loaded points and normal vectors.
+		@return true - if the file was loaded.
+		*/
+		static bool Read(const std::string file, std::vector<Eigen::Vector3f>& dst_points, std::vector<Eigen::Vector3f>& dst_normals,
+						 const bool invert_z = false, int num_threads = 0, const bool verbose = false);
+
+	};
+
+} //texpert
@@ -5,6 +5,10 @@ This class reads and writes model in the PLY file format.
 The supported format is 
 	x y z nx ny nz  (points, normals)
 Also, the class only reads the vertices as points. 
+The vertex properties can appear in any order and with any PLY scalar type; other properties
+and elements are skipped. Files without normals are loaded with zero normal vectors.
+Read supports ascii, binary_little_endian, and binary_big_endian files. The file is memory mapped,
+and binary vertex data is copied directly into the point and normal vectors.
 
 NOTE THAT THIS CLASS IS NOT A COMPLETE PLY LOADER / WRITER. IT JUST SERVES A LIMITED PURPOSE.
 
@@ -23,6 +27,10 @@ Feb 7, 2020, RR
 - Added conio.h
 - Added FileUtils.h
 
+Oct 17, 2026
+- Added binary_little_endian and binary_big_endian support for Read and binary_little_endian for Write.
+- Read maps the file into memory and supports an arbitrary vertex property order.
+- Write counts only the points it writes for the vertex element size.
 */
 // stl
 #include <iostream>
@@ -37,6 +45,19 @@ Feb 7, 2020, RR
 // local
 #include "ReaderWriter.h"
 #include "FileUtilsX.h"
+#include "MappedFile.h"
+
+
+/*!
+Output format for ReaderWriterPLY::Write
+*/
+typedef enum _PLYFormat
+{
+	PLY_ASCII = 0,
+	PLY_BINARY_LE = 1 // binary_little_endian 1.0
+
+}PLYFormat;
+
 
 class ReaderWriterPLY : public ReaderWriter
 {
@@ -58,9 +79,10 @@ public:
 	@param dst_points - vector of vector3f points containing x, y, z coordinates
 	@param dst_normals - vector of vector3f normal vectors index-aligned to the points.
 	@param scale_points - float value > 0.0 that scales all points and normal vectors. 
+	@param format - PLY_ASCII or PLY_BINARY_LE. 
 	*/
 	//virtual 
-	static bool Write(std::string file, std::vector<Eigen::Vector3f>& src_points, std::vector<Eigen::Vector3f>& src_normals, const float scale_points = 1.0f);
+	static bool Write(std::string file, std::vector<Eigen::Vector3f>& src_points, std::vector<Eigen::Vector3f>& src_normals, const float scale_points = 1.0f, const PLYFormat format = PLY_ASCII);
 
 
 private:
@@ -29,6 +29,9 @@ March 20, 2019, RR
 
 Aug 8, 2020, RR
 - Added a verbose level to surpress unnesssary information.
+
+Oct 17, 2026
+- Uniform uses VoxelGrid with 64-bit voxel keys. The previous hash table never marked a voxel as filled. 
 */
 
 
@@ -45,6 +48,7 @@ Aug 8, 2020, RR
 // local
 #include "Types.h"
 #include "SamplingTypes.h"
+#include "VoxelGrid.h"
 
 using namespace std;
 
@@ -84,7 +88,8 @@ public:
 private:
     /*
     Sample the point cloud with a uniform sampling filter. 
-    This filter is voxel based and will put one point into a vocel 
+    This filter is voxel based and will put one point into a vocel. 
+    The point is selected with param.voxel_representative. 
     @param src - location of the the source point cloud.
     @param dst - location of the the destination  point cloud.
     @param param - the sampling parameters
@@ -10,6 +10,9 @@ MIT License
 Last edits:
 Aug 9, 2020, RR:
 - Added a method to validate the correctness of the value and to correct them if required. 
+
+Oct 17, 2026
+- Added VoxelRepresentative and the number of threads for uniform sampling.
 */
 
 
@@ -33,6 +36,21 @@ typedef enum _SamplingMethod
 }SamplingMethod;
 
 
+/*
+The point that represents a voxel for uniform sampling.
+VOXEL_FIRST: the first point in the voxel, in the order of the input point cloud, with its normal vector.
+VOXEL_CENTROID: the centroid of all points in the voxel, with the normal vector of the first point.
+VOXEL_NORMAL_AVERAGE: the centroid of all points in the voxel, with the normalized average of their normal vectors.
+*/
+typedef enum _VoxelRepresentative
+{
+	VOXEL_FIRST = 0,
+	VOXEL_CENTROID = 1,
+	VOXEL_NORMAL_AVERAGE = 2
+
+}VoxelRepresentative;
+
+
 
 typedef struct _SamplingParam
 {
@@ -45,6 +63,12 @@ typedef struct _SamplingParam
 	// step size for uniform sampling
 	int		uniform_step; 
 
+	// the point that represents a voxel for uniform sampling
+	VoxelRepresentative	voxel_representative;
+
+	// number of threads for uniform sampling. A value <= 0 uses all hardware threads. 
+	int		num_threads;
+
 	int		random_max_points;
 	float	ramdom_percentage;
 
@@ -56,6 +80,8 @@ typedef struct _SamplingParam
         grid_z = 0.01f;
 
 		uniform_step = 1;
+		voxel_representative = VOXEL_FIRST;
+		num_threads = 0;
 		random_max_points = 5000;
 		ramdom_percentage = 25; // currently not in use. Use the max random points number. 
     }
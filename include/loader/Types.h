@@ -11,6 +11,9 @@ Last edits:
 
 June 3, 2020, RR
 - Added a vector to store the centroid of the point cloud. 
+
+Oct 17, 2026
+- Added the DepthIntrinsics struct to project points into the depth image. 
 */
 
 #ifndef __TYPES__
@@ -65,5 +68,48 @@ typedef struct PointCloud
 }PointCloud;
 
 
+/*
+The intrinsic parameters of a depth camera. 
+The values follow the conventions of the point cloud production (cuPCU3f): a pixel (i, j) with depth d
+is projected to 
+	x = -(i - width/2) * d / fx + cx
+	y = -(j - height/2) * d / fy + cy
+	z = d
+so cx and cy are offsets in 3D space and not in pixels. 
+*/
+typedef struct _DepthIntrinsics
+{
+	int		width; // image width in pixels
+	int		height; // image height in pixels
+
+	float	fx; // focal length in pixels
+	float	fy;
+	float	cx; // principal point offset
+	float	cy;
+
+	int		step; // pixel distance between two sampled points, e.g., the uniform sampling step. 
+
+	_DepthIntrinsics()
+	{
+		width = 0;
+		height = 0;
+		fx = 0.0f;
+		fy = 0.0f;
+		cx = 0.0f;
+		cy = 0.0f;
+		step = 1;
+	}
+
+	/*
+	Return true if the parameters describe an image. 
+	*/
+	bool valid(void) const
+	{
+		return width > 0 && height > 0 && fx > 0.0f && fy > 0.0f && step > 0;
+	}
+
+}DepthIntrinsics;
+
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+class VoxelGrid
+
+Voxel grid filter for point clouds. The filter keeps one representative point per occupied voxel.
+
+Each point gets a 64-bit voxel key, which packs the voxel coordinates relative to the bounding box minimum.
+The number of bits per axis adapts to the extent of the point cloud. If the extent does not fit into 64 bits,
+the voxel size is increased until it fits. The keys are sorted with a parallel, stable radix sort.
+Points with the same key form one voxel, and their input order is preserved within the voxel.
+The output points are ordered by the first point of each voxel, so the result does not depend on the number of threads.
+
+Points with non-finite coordinates are skipped. Normal vectors are only processed
+if the point cloud has one normal vector per point.
+
+Usage:
+	VoxelGrid grid;
+	grid.setGridSize(0.01f, 0.01f, 0.01f);
+	grid.setRepresentative(VOXEL_CENTROID);
+	grid.filter(src, dst);
+
+The instance keeps its buffers between calls to avoid allocations for every frame.
+
+MIT License
+---------------------------------------------------------------
+Last edits:
+
+Oct 17, 2026
+- Added the class to replace the hash table in Sampling::Uniform.
+*/
+
+#ifndef __VOXEL_GRID__
+#define __VOXEL_GRID__
+
+//stl
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+// Eigen
+#include <Eigen/Dense>
+
+// local
+#include "Types.h"
+#include "SamplingTypes.h"
+
+namespace texpert {
+
+class VoxelGrid
+{
+public:
+
+	VoxelGrid();
+	~VoxelGrid();
+
+	/*
+	Set the voxel size in model units.
+	@param grid_x, grid_y, grid_z - the voxel size for each axis, > 0.
+	*/
+	void setGridSize(float grid_x, float grid_y, float grid_z);
+
+	/*
+	Set the point that represents a voxel.
+	@param representative - VOXEL_FIRST, VOXEL_CENTROID, or VOXEL_NORMAL_AVERAGE
+	*/
+	void setRepresentative(VoxelRepresentative representative);
+
+	/*
+	Set the number of threads.
+	@param num_threads - number of threads. A value <= 0 uses all hardware threads.
+	*/
+	void setNumThreads(int num_threads);
+
+	/*
+	Downsample the point cloud. src and dst can be the same point cloud.
+	@param src - location of the the source point cloud.
+	@param dst - location of the the destination point cloud.
+	@return the number of points in dst.
+	*/
+	int filter(PointCloud& src, PointCloud& dst);
+
+	/*
+	Return the voxel size used by the last call to filter.
+	It is larger than the set size if the extent of the point cloud did not fit into 64-bit keys.
+	*/
+	Eigen::Vector3f getUsedGridSize(void);
+
+private:
+
+	// sort _keys and _index by the lowest bits of the key. The sort is stable.
+	void sortKeys(int size, int bits);
+
+	Eigen::Vector3f			_grid;
+	Eigen::Vector3f			_used_grid;
+	VoxelRepresentative		_representative;
+	int						_num_threads;
+
+	// buffers
+	std::vector<std::uint64_t>	_keys;
+	std::vector<int>			_index;
+	std::vector<std::uint64_t>	_keys_tmp;
+	std::vector<int>			_index_tmp;
+	std::vector<int>			_voxel_start; // start of each voxel in the sorted keys
+	std::vector<int>			_voxel_of_point; // voxel id for the first point of each voxel, -1 otherwise.
+	std::vector<int>			_counts; // radix histogram per thread
+	std::vector<int>			_order; // voxel ids ordered by their first point
+	std::vector<Eigen::Vector3f> _out_points;
+	std::vector<Eigen::Vector3f> _out_normals;
+};
+
+} //texpert
+#endif
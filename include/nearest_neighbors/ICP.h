@@ -79,6 +79,33 @@ Mar 08, 2021, WB
 - Fixed ICP Rt to return a non-transposed matrix
 - Transferred most Rt calculations to the PointCloudTrans class
 
+Oct 17, 2026
+- The nearest neighbor search reads the test points through a PointView and reuses
+  its result buffer, so the iterations do not copy the points or allocate matches. 
+- setCameraData() reuses the kd-tree of unchanged camera points (KNN::populateCached()). 
+- Added projective data association (setCorrespondenceMode()). The model points are projected into
+  the depth image and matched with the closest camera point in a small pixel window. 
+  This needs no kd-tree and is O(1) per point. 
+- Added the point-to-plane and the symmetric error metric (setErrorMetric()). Both use the normal vectors
+  and converge in fewer iterations than the point-to-point metric. 
+- Added a coarse-to-fine mode (setPyramid()). The first iterations run on voxel-downsampled test and 
+  camera points with wide outlier thresholds, the last iterations on the full resolution. 
+- Each iteration rejects the outliers and accumulates the centroids and the cross-covariance, or the 
+  point-to-plane equations, in one parallel pass over the matches (accumulateMatches()). 
+  All buffers are members and keep their memory, so the iterations do not allocate memory after the first frame. 
+- The point-to-point rms is the rms distance of the accepted pairs after the update, computed from the sums. 
+  The former centroid comparison (ICPTransform::CheckRMS()) is close to 0 for every small rotation. 
+  All metrics terminate if the rms does not change anymore. 
+- Added setCameraDataRef() to share one camera point cloud and its kd-tree between ICP instances, 
+  an iteration callback to stop ICP early (setIterationCallback()), getInlierFraction(), and setNumThreads(). 
+  ICPBatch uses them to refine multiple pose hypotheses in parallel. 
+- Added getPose(), the refined pose as a model-to-camera transformation. It can seed ICP in the next frame. 
+- Added getIterations() and setCameraLevelRef(), which shares the downsampled camera points of a pyramid level 
+  between ICP instances. ICPBatch downsamples the camera points once per frame. 
+- Added hasConverged(). compute() returns true whenever it found a pose, also at the iteration limit. 
+- Added setModelLevelRef(), which shares the downsampled model points of a pyramid level for the next compute() call. 
+  ICPBatch downsamples the model points once for all hypotheses. 
+
 */
 
 
@@ -88,6 +115,7 @@ Mar 08, 2021, WB
 #include <numeric>
 #include <algorithm>
 #include <functional>
+#include <cstdint>
 
 // Eigen 3
 #include <Eigen/Dense>
@@ -102,15 +130,60 @@ Mar 08, 2021, WB
 #include "PointCloudUtils.h"
 #include "MatrixConv.h"
 #include "PointCloudTrans.h"
+#include "VoxelGrid.h"
 
 namespace texpert{
 
 
+/*
+One level of the coarse-to-fine ICP pyramid (ICP::setPyramid()). 
+*/
+typedef struct _ICPLevel
+{
+	// the voxel size to downsample the test and camera points, in model units. 0 uses all points. 
+	float	voxel_size;
+
+	// the max. number of iterations on this level
+	int		max_iterations;
+
+	// the outlier rejection distance and angle (degrees) on this level. 
+	// 0 uses the values of setRejectMaxDistance() and setRejectMaxAngle(). 
+	float	reject_distance;
+	float	reject_angle;
+
+	_ICPLevel(float voxel_size_ = 0.0f, int max_iterations_ = 20, float reject_distance_ = 0.0f, float reject_angle_ = 0.0f)
+	{
+		voxel_size = voxel_size_;
+		max_iterations = max_iterations_;
+		reject_distance = reject_distance_;
+		reject_angle = reject_angle_;
+	}
+
+}ICPLevel;
+
+
+
 class ICP
 {
 public:
 
-	ICP();
+	typedef enum {
+		POINT_TO_POINT, // Besl and McKay, the closed-form solution of Arun et al. 
+		POINT_TO_PLANE, // Chen and Medioni, the distance along the normal vector of the camera point
+		SYMMETRIC		// Rusinkiewicz, the distance along the normal vectors of both points
+	}Metric;
+
+	typedef enum {
+		KNN_SEARCH, // the nearest camera point from a kd-tree search
+		PROJECTIVE	// the closest camera point in a pixel window around the projected model point
+	}Correspondence;
+
+
+	/*
+	@param backend - the kd-tree backend for KNN_SEARCH, see KNN. 
+		ICP instances that run in parallel must use KD_CPU. 
+	*/
+	ICP(KdTreeBackend backend = KD_AUTO);
 	~ICP();
 
 		/*
@@ -120,6 +193,39 @@ public:
 	*/
 	bool setCameraData(PointCloud& pc);
 
+
+	/*
+	Set the reference point cloud without copying it. 
+	The points must not change or go out of scope until the next call of setCameraData() or setCameraDataRef(). 
+	ICP instances that share the camera points also share their kd-tree through the KdTreeCache. 
+	@param pc - reference to the camera points
+	@param key - the key of the points for the kd-tree cache (KdTreeCache::Hash()), 0 computes the key. 
+	*/
+	bool setCameraDataRef(PointCloud& pc, std::uint64_t key = 0);
+
+
+	/*
+	Set the downsampled camera points of a pyramid level without copying them. 
+	ICP uses them instead of downsampling the camera points for this voxel size. 
+	Call it after setCameraData(), setCameraDataRef(), and setPyramid(), which drop the points. 
+	The points must not change or go out of scope until then. 
+	@param voxel_size - the voxel size of the pyramid level, > 0. 
+	@param pc - reference to the downsampled camera points
+	@param key - the key of the points for the kd-tree cache (KdTreeCache::Hash()), 0 computes the key. 
+	*/
+	bool setCameraLevelRef(float voxel_size, PointCloud& pc, std::uint64_t key = 0);
+
+
+	/*
+	Set the downsampled model points of a pyramid level for the next compute() call without copying them. 
+	ICP uses them instead of downsampling the model points for this voxel size. 
+	compute() drops them, so they apply to one call only. 
+	The points must be the model points of this call, in the model frame, downsampled with the voxel size of the level. 
+	@param voxel_size - the voxel size of the pyramid level, > 0. 
+	@param pc - reference to the downsampled model points
+	*/
+	bool setModelLevelRef(float voxel_size, PointCloud& pc);
+
 	/*
 	Set the test model, this is tested agains the 
 	reference model in the kd-tree
@@ -179,6 +285,118 @@ public:
 	void setRejectionMethod(ICPReject::Testcase method);
 
 
+	/*
+	Set the levels for coarse-to-fine registration. The levels run in the given order, usually from 
+	the largest to the smallest voxel size, and each level starts with the pose of the previous level. 
+	The test points are downsampled for every call of compute(), the camera points once per setCameraData(). 
+	The termination criteria apply per level. With projective correspondences, the camera points are not 
+	downsampled since the search does not depend on their number. 
+	Example: 
+		levels.push_back(ICPLevel(0.02f, 10, 0.1f, 60.0f));
+		levels.push_back(ICPLevel(0.005f, 10, 0.03f, 45.0f));
+		levels.push_back(ICPLevel(0.0f, 5));
+	@param levels - the pyramid levels. An empty vector runs one level with all points and
+		setMaxIterations() iterations, which is the default. 
+	*/
+	void setPyramid(const std::vector<ICPLevel>& levels);
+
+
+	/*
+	Return the pyramid levels. 
+	*/
+	std::vector<ICPLevel> getPyramid(void);
+
+
+	/*
+	Set the error metric that ICP minimizes. 
+	POINT_TO_PLANE and SYMMETRIC use the normal vectors of the points and solve a linearized 
+	least-squares problem per iteration. They usually converge in a few iterations. 
+	ICP falls back to POINT_TO_POINT for an iteration if the linear system is degenerate. 
+	With these metrics, the rms is the point-to-plane distance. With POINT_TO_POINT, it is the point distance. 
+	ICP also terminates if the rms changes less than the min. error (setMinError()) between two iterations. 
+	@param metric - POINT_TO_POINT, POINT_TO_PLANE, or SYMMETRIC. Default is POINT_TO_POINT. 
+	*/
+	void setErrorMetric(Metric metric);
+
+
+	/*
+	Return the error metric. 
+	*/
+	Metric getErrorMetric(void);
+
+
+	/*
+	Set how ICP finds the camera point that corresponds to a model point. 
+	KNN_SEARCH searches the nearest neighbor in a kd-tree of the camera points. 
+	PROJECTIVE projects the model point into the depth image and searches the closest camera point
+	in a window around the projected pixel. It requires camera points from a single depth camera
+	and its intrinsics (setCameraIntrinsics()). It is faster but only finds correspondences that
+	are visible from the camera. 
+	@param mode - KNN_SEARCH or PROJECTIVE. Default is KNN_SEARCH. 
+	*/
+	void setCorrespondenceMode(Correspondence mode);
+
+
+	/*
+	Return the correspondence mode. 
+	*/
+	Correspondence getCorrespondenceMode(void);
+
+
+	/*
+	Set the intrinsics of the depth camera that produced the camera points. 
+	The projective correspondence mode uses them. Use PointCloudProducer::getDepthIntrinsics() to get them. 
+	@param intrinsics - the camera intrinsics and the pixel step of the sampling pattern. 
+	*/
+	void setCameraIntrinsics(const DepthIntrinsics& intrinsics);
+
+
+	/*
+	Set the size of the search window for projective correspondences. 
+	The window is measured in sampling steps (DepthIntrinsics::step), i.e., in sampled pixels. 
+	@param half_size - the window covers (2 * half_size + 1)^2 pixels. 
+		The value must be in the range [0, 16]. Default is 2.
+	*/
+	void setProjectiveWindow(int half_size);
+
+
+	/*
+	Set a function that is called after each iteration with the number of iterations so far and the rms. 
+	ICP stops and returns the current pose if the function returns false. 
+	@param callback - the function, or an empty function to remove it. 
+	*/
+	void setIterationCallback(std::function<bool(int, float)> callback);
+
+
+	/*
+	Return the fraction of the test points that were accepted as inliers in the last iteration. 
+	@return a value in [0, 1]. 
+	*/
+	float getInlierFraction(void);
+
+
+	/*
+	Return the number of iterations of the last compute() call over all pyramid levels. 
+	*/
+	int getIterations(void);
+
+
+	/*
+	Return true if the last compute() call converged, i.e., the rms of the last pyramid level fell below the min. error 
+	or changed by less than the min. error before the iteration limit. 
+	The iteration limit, too few inliers, and a stop by the iteration callback do not converge. 
+	*/
+	bool hasConverged(void);
+
+
+	/*
+	Set the number of threads for the iterations. 
+	The kd-tree search uses the threads of the kd-tree. 
+	@param num_threads - number of threads. A value < 1 uses all hardware threads. 
+	*/
+	void setNumThreads(int num_threads);
+
+
 	/*!
 	Return the overall rotation after ICP terminates. 
 	@return a 3x3 matrix with the last rotation. 
@@ -207,6 +425,14 @@ public:
 	Matrix4f Rt2(void);
 
 
+	/*!
+	Return the refined pose of the test points, the initial pose followed by the ICP transformation, 
+	so that a registered point is x = pose * p. Unlike Rt(), the pose can be used as initial pose for the next frame. 
+	@return - the pose as an affine transformation. 
+	*/
+	Affine3f getPose(void);
+
+
 	//-------------------------------------------------------------------------------
 
 	/* DEBUG FUNCTION
@@ -238,14 +464,106 @@ private:
 	*/
 	bool ready(void);
 
+
+	/*
+	Find the corresponding camera point of each test point and write them into _local_matches.
+	Uses the kd-tree or the projection, depending on the correspondence mode. 
+	*/
+	void findCorrespondences(void);
+
+
+	/*
+	Find correspondences by projecting the test points into the depth image. 
+	*/
+	void findProjective(void);
+
+
+	/*
+	Project all camera points into the depth image and store their indices per pixel. 
+	*/
+	void createPixelIndex(void);
+
+
+	// the sums over the accepted point pairs of one iteration. 
+	// p and q are the test points and the matching camera points relative to the rotation center. 
+	// Only the sums of the current metric are valid. 
+	typedef struct _ICPSums
+	{
+		int						count; // number of accepted pairs
+		Vector3d				p; // sum p
+		Vector3d				q; // sum q
+		double					pp; // sum |p|^2
+		double					qq; // sum |q|^2
+		Matrix3d				cov; // sum p q^T
+		Matrix<double, 6, 6>	A; // point-to-plane normal equations, see ICPTransform::AccumulatePointToPlane()
+		Matrix<double, 6, 1>	g;
+		double					c;
+
+		void setZero(void)
+		{
+			count = 0;
+			p.setZero();
+			q.setZero();
+			pp = 0.0;
+			qq = 0.0;
+			cov.setZero();
+			A.setZero();
+			g.setZero();
+			c = 0.0;
+		}
+
+	}ICPSums;
+
+
+	/*
+	Reject the outliers among the matches in _local_matches and accumulate the sums of all accepted pairs. 
+	This is one parallel pass over the test points. 
+	@param metric - POINT_TO_POINT accumulates the point sums and the cross-covariance, 
+					the other metrics their normal equations. 
+	@return the sums of all accepted pairs. 
+	*/
+	const ICPSums& accumulateMatches(Metric metric);
+
+
+	/*
+	Move the test points and normal vectors of the current level by one iteration: 
+	p' = R (p - c) + t + c, with c the rotation center. 
+	*/
+	void transformTestPoints(const Matrix3f& R, const Vector3f& t);
+
+
+	/*
+	Downsample the test points for a pyramid level and move them to the current pose. 
+	Select the camera points of the level. 
+	@param level - the pyramid level
+	@param initial_pose - the initial pose of the test points
+	@param centroid0 - the centroid of the test points at the initial pose
+	*/
+	void prepareLevel(const ICPLevel& level, Pose& initial_pose, const Vector3f& centroid0);
+
+
+	/*
+	Delete the downsampled camera points of all levels. 
+	*/
+	void clearCameraLevels(void);
+
+
+	/*
+	Return the index of the camera level with this voxel size in _camera_levels. The level is created if it does not exist. 
+	*/
+	int findCameraLevel(float voxel_size);
+
 	///////////////////////////////////////////////////////
 	// Members
 
 	// reference to the test point cloud and the 
 	// reference point cloud (environment)
 	PointCloud				_cameraPoints;
+	PointCloud*				_camera; // the camera points in use, _cameraPoints or shared points
+	std::uint64_t			_camera_key; // the kd-tree cache key of shared camera points, 0 if unknown
 	PointCloud				_testPoints;
 	PointCloud				_testPointsProcessing;
+	PointCloud				_testPointsInitial; // the test points at the initial pose
 	Vector3f				_testPoint_centroid;
 
 	// translation and rotation for all iterations. 
@@ -253,14 +571,73 @@ private:
 	Vector3f				_t_all; 
 	Matrix4f				_Rt_initial;//inintial pose
 	Affine3f				_Rt_affine; // initial pose
+	Vector3f				_rotation_center; // the centroid of the test points at the initial pose
 
 	Matrix4f				_Rt_final;
 
-	std::vector<Matches>	_local_matches;
+	// nearest neighbors of the last iteration, reused for all iterations
+	KNNResults				_local_matches;
 
 	// k-nearest neighbors implementation
 	KNN*					_knn;		
+	KdTreeBackend			_backend;
+
+	// true if the camera points are in the kd-tree
+	bool					_knn_ready;
 
+	// error metric
+	Metric					_metric;
+
+	// correspondence mode
+	Correspondence			_correspondence;
+
+	// projective correspondences. 
+	// The pixel index stores the index of the camera point per sampled pixel or -1. 
+	DepthIntrinsics			_intrinsics;
+	int						_window;
+	std::vector<int>		_pixel_index;
+	int						_pixel_cols;
+	int						_pixel_rows;
+	bool					_pixel_ready;
+
+	// camera point index and squared distance per test point. -1 if no point was found. 
+	std::vector<std::pair<int, float>>	_projective_matches;
+
+	// the downsampled camera points and their kd-tree, per voxel size
+	typedef struct _CameraLevel
+	{
+		float		voxel_size;
+		PointCloud	points;
+		PointCloud*	shared; // shared points (setCameraLevelRef()) instead of points, or NULL
+		std::uint64_t	key; // the kd-tree cache key of the shared points, 0 if unknown
+		KNN*		knn;
+		bool		filtered; // true if the points belong to the current camera points
+		bool		ready; // true if the points are in the kd-tree
+
+	}CameraLevel;
+
+	// pyramid levels, empty for one level with all points
+	std::vector<ICPLevel>		_levels;
+	std::vector<CameraLevel>	_camera_levels;
+	VoxelGrid					_voxel_grid;
+
+	// the downsampled test points of a level
+	PointCloud					_model_level;
+
+	// the shared downsampled test points per voxel size, for the next compute() call and for the running call
+	std::vector<std::pair<float, PointCloud*>>	_model_level_refs;
+	std::vector<std::pair<float, PointCloud*>>	_model_levels;
+
+	// the camera points of the current level and their index in _camera_levels, -1 for all camera points
+	PointCloud*					_active_camera;
+	int							_active_level;
+
+	// the outlier rejection of the current level
+	ICPReject					_level_reject;
+
+	// the sums of the accepted pairs, per chunk of test points and in total
+	std::vector<ICPSums>		_chunk_sums;
+	ICPSums						_sums;
 
 
 
@@ -275,6 +652,20 @@ private:
 	bool					_verbose;
 	int						_verbose_level;
 
+	// stops the iterations if it returns false
+	std::function<bool(int, float)>	_iteration_callback;
+
+	// inliers of the last iteration
+	float					_inlier_fraction;
+
+	// iterations of the last compute() call
+	int						_iterations;
+
+	// true if the last compute() call converged
+	bool					_converged;
+
+	int						_num_threads;
+
 	// helper to debug knn hits
 	std::vector<std::pair<int, int>> _verbose_matches;
 
@@ -0,0 +1,256 @@
+#pragma once
+/*
+class ICPBatch
+files: ICPBatch.h/.cpp
+
+@brief: The class refines multiple pose hypotheses of one model with ICP in parallel.
+
+Object detection (CPFMatchingExp, FDMatching) returns a list of pose clusters, sorted by their votes.
+Refining only the best-voted pose loses the frame whenever this cluster is wrong.
+ICPBatch refines the first K poses concurrently and returns the refined poses ranked by their fit.
+
+Each worker thread owns an ICP instance with the cpu kd-tree and takes the next hypothesis from a queue,
+so the best-voted hypotheses start first. All workers share the camera points and their kd-tree
+(ICP::setCameraDataRef(), KdTreeCache), so the camera points are indexed once per frame.
+With a pyramid, the downsampled camera points of each level are also built once before the workers start
+and shared read-only (ICP::setCameraLevelRef()). The downsampled model points of each level are built once per 
+compute() call and shared by all hypotheses (ICP::setModelLevelRef()).
+
+A hypothesis stops early
+- if its rms does not improve by more than 1% for a number of iterations (patience), or
+- if its rms exceeds abort_ratio times the rms of the best finished hypothesis (aborted).
+Both tests start after the iterations of the coarse pyramid levels and min_iterations.
+Since the best rms changes while the workers run, the aborted hypotheses can depend on the timing.
+
+A hypothesis converged if ICP converged before the iteration limit (ICP::hasConverged()) or if the patience test stopped it.
+The results are ranked: hypotheses that converged, were not aborted, and have an inlier fraction >= min_inlier_fraction
+come first, sorted by their rms. All other hypotheses follow, also sorted by their rms.
+
+Usage:
+	ICPBatch icp;
+	icp.setCameraData(camera_points);
+
+	std::vector<Eigen::Affine3f> poses;
+	std::vector<int> votes;
+	matching.getPose(model_id, poses, votes);
+
+	std::vector<ICPHypothesis> results;
+	if (icp.compute(model_points, poses, results))
+		pose = results[0].pose;
+
+Dependencies:
+- ICP.h/.cpp
+- KdTreeCache.h/.cpp
+- ParallelUtils.h
+
+MIT License
+-----------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the class to refine the top pose clusters in parallel.
+- The camera points of the pyramid levels are downsampled once and shared by all workers.
+- ICPHypothesis::iterations is the iteration count of the ICP instance (ICP::getIterations()).
+- ICPHypothesis::converged is false for hypotheses that reached the iteration limit. 
+- The model points of the pyramid levels are downsampled once per compute() call and shared by all hypotheses.
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+// Eigen 3
+#include <Eigen/Dense>
+
+// local
+#include "ICP.h"
+#include "KdTreeCache.h"
+#include "ParallelUtils.h"
+
+
+namespace texpert{
+
+/*
+The refined pose of one hypothesis.
+*/
+typedef struct _ICPHypothesis
+{
+	int					id; // index of the initial pose
+	Eigen::Matrix4f		pose; // the refined pose, see ICP::Rt()
+	Eigen::Affine3f		model_pose; // the refined pose as model-to-camera transformation, see ICP::getPose()
+	Eigen::Matrix3f		R; // the rotation and translation ICP applied, see ICP::R() and ICP::t()
+	Eigen::Vector3f		t;
+	float				rms;
+	float				inlier_fraction; // fraction of the model points accepted as inliers in the last iteration
+	int					iterations;
+	bool				converged; // the rms converged before the iteration limit or stopped improving (patience)
+	bool				aborted; // the rms exceeded the abort limit
+
+	_ICPHypothesis()
+	{
+		id = -1;
+		pose = Eigen::Matrix4f::Identity();
+		model_pose = Eigen::Affine3f::Identity();
+		R = Eigen::Matrix3f::Identity();
+		t = Eigen::Vector3f::Zero();
+		rms = 100000000.0f;
+		inlier_fraction = 0.0f;
+		iterations = 0;
+		converged = false;
+		aborted = false;
+	}
+
+}ICPHypothesis;
+
+
+
+class ICPBatch
+{
+public:
+
+	ICPBatch();
+	~ICPBatch();
+
+
+	/*
+	Set the camera points. The class keeps a copy, which all workers share.
+	@param pc - reference to the camera points
+	@return true if the points were accepted.
+	*/
+	bool setCameraData(PointCloud& pc);
+
+
+	/*
+	Refine the pose hypotheses of a model and rank them.
+	@param pc - the model points
+	@param poses - the initial poses, sorted by their votes. Only the first K poses are used (setMaxHypotheses()).
+	@param results - the refined hypotheses, ranked. results[0] is the best pose.
+	@return true if at least one hypothesis converged, was not aborted, and has sufficient inliers.
+	*/
+	bool compute(PointCloud& pc, const std::vector<Eigen::Affine3f>& poses, std::vector<ICPHypothesis>& results);
+
+
+	/*
+	Set the max. number of hypotheses to refine.
+	@param k - number of hypotheses, >= 1. Default is 12.
+	*/
+	void setMaxHypotheses(int k);
+
+
+	/*
+	Set the early abort criteria.
+	@param patience - stop a hypothesis if its rms did not improve by more than 1% for this number of iterations.
+		Must be >= 1. Default is 3.
+	@param abort_ratio - abort a hypothesis if its rms is larger than abort_ratio * the best rms.
+		Must be >= 1. Default is 3.
+	@param min_iterations - the number of iterations before the abort tests start. Default is 3.
+	*/
+	void setAbortCriteria(int patience, float abort_ratio, int min_iterations);
+
+
+	/*
+	Set the min. inlier fraction of a valid hypothesis. A wrong pose can reach a small rms with few inliers.
+	@param fraction - a value in [0, 1]. Default is 0.3.
+	*/
+	void setMinInlierFraction(float fraction);
+
+
+	/*
+	Set the number of worker threads. Each worker refines one hypothesis at a time.
+	@param num_threads - number of threads. A value < 1 uses all hardware threads.
+	*/
+	void setNumThreads(int num_threads);
+
+
+	//-------------------------------------------------------------------------------
+	// ICP parameters, see ICP for details.
+
+	bool setVerbose(bool verbose, int verbose_level = 1);
+
+	void setMinError(float error);
+
+	void setMaxIterations(int max_iterations);
+
+	void setRejectMaxAngle(float max_angle);
+
+	void setRejectMaxDistance(float max_distance);
+
+	void setRejectionMethod(ICPReject::Testcase method);
+
+	void setErrorMetric(ICP::Metric metric);
+
+	void setCorrespondenceMode(ICP::Correspondence mode);
+
+	void setCameraIntrinsics(const DepthIntrinsics& intrinsics);
+
+	void setPyramid(const std::vector<ICPLevel>& levels);
+
+
+private:
+
+	/*
+	Create the workers and apply the ICP parameters.
+	@param num_workers - the number of workers.
+	*/
+	void prepareWorkers(int num_workers);
+
+
+	/*
+	Downsample the camera points for each pyramid level and build their kd-trees.
+	*/
+	void prepareCameraLevels(void);
+
+	/*
+	Downsample the model points for each pyramid level.
+	@param pc - the model points
+	*/
+	void prepareModelLevels(PointCloud& pc);
+
+
+	///////////////////////////////////////////////////////
+	// Members
+
+	// the shared camera points and their kd-tree cache key
+	PointCloud				_camera;
+	std::uint64_t			_camera_key;
+	bool					_camera_changed; // the workers must get the new camera points
+
+	// the shared downsampled camera points of the pyramid levels, one per voxel size
+	std::vector<float>			_level_voxel_sizes;
+	std::vector<PointCloud>		_level_cameras;
+	std::vector<std::uint64_t>	_level_keys;
+
+	// the shared downsampled model points of the pyramid levels, one per voxel size
+	std::vector<float>			_model_voxel_sizes;
+	std::vector<PointCloud>		_level_models;
+
+	// one ICP instance per worker thread
+	std::vector<ICP*>		_workers;
+
+	// batch params
+	int						_max_hypotheses;
+	int						_patience;
+	float					_abort_ratio;
+	int						_min_iterations;
+	float					_min_inlier_fraction;
+	int						_num_threads;
+
+	// icp params
+	bool					_verbose;
+	int						_verbose_level;
+	float					_max_error;
+	int						_max_iterations;
+	float					_reject_angle;
+	float					_reject_distance;
+	ICPReject::Testcase		_reject_method;
+	ICP::Metric				_metric;
+	ICP::Correspondence		_correspondence;
+	DepthIntrinsics			_intrinsics;
+	std::vector<ICPLevel>	_levels;
+	bool					_params_changed; // the workers must get the new params
+};
+
+
+}//namespace texpert{
@@ -9,7 +9,9 @@ Implemented outlier criteria are:
 - distance: points are rejected as outliers if 
 	their distance is larger than a threshold distance
 - normal vector alignment: points are considered as outliers if their 
-	normal vector direction deviate for more than a threshold
+	normal vector direction deviate for more than a threshold. 
+	A zero-length normal vector has no direction; its angle to any vector counts as 90 degrees. 
+	Thus, points with a zero normal vector are inliers if the max. angle is at least 90 degrees. 
 - distance + normal: both criteria combined. 
 
 Rafael Radkowski
@@ -24,6 +26,10 @@ Last edited:
 June 3, 2020, RR
 - Fixed a bug in testDistance, which computed the wrong length for the max distance. 
 
+Oct 17, 2026
+- Added accept(), an inline version of test() without acos and sqrt for the ICP inner loop. 
+- test() accepts all points for NONE. It returned an undefined value before. 
+- testAngle() and accept() treat zero-length normal vectors the same way, as an angle of 90 degrees. 
 
 */
 // stl
@@ -32,6 +38,7 @@ June 3, 2020, RR
 #include <string>
 #include <functional>
 #include <algorithm>
+#include <cmath>
 
 // Eigen 3
 #include <Eigen/Dense>
@@ -69,7 +76,8 @@ public:
 
 
 		/*
-		Test whether two normal vectors align so that they can be considered as inliers
+		Test whether two normal vectors align so that they can be considered as inliers.
+		A zero-length normal vector counts as an angle of 90 degrees.
 		@param n0 - reference to the first normal vectors of type Vector3f with (nx, ny, nz) coordinates. 
 		@param n1 - reference to the second normal vectors of type Vector3f with (nx, ny, nz) coordinates. 
 		@return true - if the points are inliers, false if the are outliers. 
@@ -99,6 +107,31 @@ public:
 		bool test(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, Eigen::Vector3f n0, Eigen::Vector3f n1, Testcase testcase );
 
 
+		/*
+		Test for outliers and select the case. Gives the same result as test(), but compares 
+		squared distances and the cosine of the angle. 
+		@param p0, p1 - the two points
+		@param n0, n1 - the normal vectors of the two points. They do not need to be normalized. 
+			A zero-length normal vector counts as an angle of 90 degrees, as in test(). 
+		@return true - if the points are inliers, false if the are outliers. 
+		*/
+		inline bool accept(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, const Eigen::Vector3f& n0, const Eigen::Vector3f& n1, Testcase testcase) const
+		{
+			if ((testcase == DIST || testcase == DIST_ANG) && !((p0 - p1).squaredNorm() < _max_distance2)) return false;
+
+			if (testcase == ANG || testcase == DIST_ANG) {
+				// angle <= max_angle  <=>  dot / (|n0| |n1|) >= cos(max_angle)
+				float l0 = n0.squaredNorm();
+				float l1 = n1.squaredNorm();
+				if (l0 <= 0.0f || l1 <= 0.0f) return _accept_zero_normal;
+				float dot = n0.dot(n1);
+				float len = std::sqrt(l0 * l1);
+				if (!(dot >= _cos_max_angle * len)) return false;
+			}
+			return true;
+		}
+
+
 		/*
 		Set the maximum distance limit for two points to be considered as inliers. 
 		@param max_distance - float value with a limit > 0.0;
@@ -119,4 +152,11 @@ private:
 		float	_max_distance;
 		float	_max_angle;
 
+		// squared distance and cosine of the angle for accept()
+		float	_max_distance2;
+		float	_cos_max_angle;
+
+		// true, if the max. angle is at least 90 degrees, the angle of a zero-length normal vector
+		bool	_accept_zero_normal;
+
 };
\ No newline at end of file
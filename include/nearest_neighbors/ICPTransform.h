@@ -27,6 +27,11 @@ Last edited:
 June 11, 2020, RR
 - Added a function to return the centroid of a object. 
 
+Oct 17, 2026
+- Added a linearized point-to-plane and symmetric solver (CalcPointToPlane()). 
+- Split the solvers into accumulation and solution steps (AccumulatePointToPlane(), SolvePointToPlane(), 
+  RotationFromCovariance()), so ICP can accumulate all terms in one pass over the correspondences. 
+
 */
 
 
@@ -101,6 +106,84 @@ public:
 	*/
 	static Vector3f CalculateCentroid(vector<Vector3f>& pVec0);
 
+
+	/*!
+	Calculate the rotation and translation that minimize the point-to-plane distances
+	between two point sets, using a linearized least-squares solution (Chen and Medioni, 1992).
+	The symmetric version minimizes the distances along the sum of both normal vectors and 
+	rotates both point sets by half of the rotation (Rusinkiewicz, A symmetric objective function for ICP, 2019).
+	The normal equations are accumulated in one parallel pass over all points. 
+	The transformation is p' = R * (p - centroid) + centroid + t, the convention of the ICP class. 
+	@param pVec0 - the test points [x, y, z]
+	@param pVec1 - the index-aligned matching points [x, y, z]
+	@param nVec0 - the normal vectors of the test points. Only used if symmetric is true. 
+	@param nVec1 - the normal vectors of the matching points.
+	@param centroid - the rotation center, e.g., the centroid of the test points. 
+	@param symmetric - true uses the symmetric objective, false the point-to-plane objective. 
+	@param R - output, the rotation. 
+	@param t - output, the translation.
+	@param rms - output, the rms point-to-plane distance after the transformation, as predicted by the linear model. 
+	@return false if the system cannot be solved. R and t are not changed in this case.  
+	*/
+	static bool CalcPointToPlane(vector<Vector3f>& pVec0, vector<Vector3f>& pVec1, vector<Vector3f>& nVec0, vector<Vector3f>& nVec1,
+								 const Vector3f& centroid, bool symmetric, Matrix3f& R, Vector3f& t, float& rms);
+
+
+	/*!
+	Return the rotation that aligns two centered point sets (Arun et al.) from their cross-covariance matrix 
+		W = sum (p0 - avg0) * (p1 - avg1)^T
+	The rotation is the identity matrix if the solution is a reflection. 
+	@param W - the cross-covariance matrix. 
+	@return the rotation. 
+	*/
+	static Matrix3f RotationFromCovariance(const Matrix3f& W);
+
+
+	/*!
+	Add one point pair to the normal equations of the point-to-plane or symmetric objective. 
+	The row of the pair is J = [a, n], the residual r = (p0 - p1) * n, with 
+	n = n1 and a = (p0 - c) x n for point-to-plane, and n = n0 +- n1 and a = (p0 - c + p1 - c) x n for the symmetric objective. 
+	@param p0, p1 - the test point and the matching point. 
+	@param n0, n1 - their normal vectors. n0 is only used if symmetric is true. 
+	@param centroid - the rotation center c. 
+	@param A, g, c - the normal equations A = sum J J^T, g = sum J r, and c = sum r^2. The pair is added. 
+	*/
+	static inline void AccumulatePointToPlane(const Vector3f& p0, const Vector3f& p1, const Vector3f& n0, const Vector3f& n1, const Vector3f& centroid,
+											  bool symmetric, Matrix<double, 6, 6>& A, Matrix<double, 6, 1>& g, double& c)
+	{
+		Vector3f n = n1;
+		Vector3f a;
+
+		if (symmetric) {
+			// the normal vectors of both sets may point in opposite directions
+			n = (n0.dot(n1) < 0.0f) ? Vector3f(n0 - n1) : Vector3f(n0 + n1);
+			a = (p0 - centroid + p1 - centroid).cross(n);
+		}
+		else {
+			a = (p0 - centroid).cross(n);
+		}
+
+		double r = (p0 - p1).dot(n);
+		Matrix<double, 6, 1> J;
+		J << a.x(), a.y(), a.z(), n.x(), n.y(), n.z();
+
+		A.noalias() += J * J.transpose();
+		g += J * r;
+		c += r * r;
+	}
+
+
+	/*!
+	Solve the normal equations of the point-to-plane or symmetric objective. 
+	@param A, g, c - the accumulated normal equations (AccumulatePointToPlane()). 
+	@param size - the number of accumulated point pairs. 
+	@param symmetric - true if the equations belong to the symmetric objective. 
+	@param R, t, rms - output, see CalcPointToPlane(). 
+	@return false if the system cannot be solved. R and t are not changed in this case.  
+	*/
+	static bool SolvePointToPlane(const Matrix<double, 6, 6>& A, const Matrix<double, 6, 1>& g, double c, int size,
+								  bool symmetric, Matrix3f& R, Vector3f& t, float& rms);
+
 };
 
 } //texpert 
\ No newline at end of file
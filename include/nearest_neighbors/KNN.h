@@ -17,6 +17,27 @@ Aug 5, 2020, RR
 - Added a KNN resource manager to the class. 
   The resource manager makes sure that only one instance of the kd-tree exists. 
   The kd-tree eats up a lot of gpu memory. Multiple instances exhaust the gpu resources too fast. 
+
+Oct 17, 2026
+- Added a cpu kd-tree backend. The backend can be selected with the constructor.
+  KD_AUTO selects the cuda kd-tree if a cuda device is available and the cpu kd-tree otherwise.
+- Added knn and radius search functions that return variable-length KNNResults.
+  The radius search of the cpu backend is not limited to KNN_MATCHES_LENGTH neighbors.
+- Added populate, knn, and radius functions that read the points from PointViews without copying them.
+  The KNNResults functions reuse the memory of the results, so repeated queries, e.g., in ICP, do not allocate memory.
+- Added populateCached(), which reuses the kd-tree of unchanged reference points (KdTreeCache).
+- Added an exact and an approximate search mode. The approximate mode of the cpu kd-tree visits
+  a limited number of leaves per search point. See tests/test_knn/knn_benchmark.cpp for recall vs. throughput.
+- The cpu backend builds its indices on the first query. Radius searches with KNNResults use a uniform grid
+  (Cpu_RadiusGrid) with the search radius as cell size, knn searches use the kd-tree. Thus, a radius-only
+  user never builds a kd-tree. setIndex() selects the kd-tree for all queries.
+- Reference point sets larger than the capacity of the cuda kd-tree (MAX_NUM_POINTS) go into the cpu kd-tree.
+- Added knnChunked() and radiusChunked(), which stream the results of large search point sets in chunks to a callback.
+- All calls that use the shared cuda kd-tree lock ResourceManager::GetKDTreeMutex(). A query reloads the reference 
+  points into the cuda kd-tree if another KNN instance loaded other points in the meantime. 
+- The cpu indices are built from the view of the reference points, the points are not copied.
+- The cuda kd-tree is approximate. Its default search mode is KNN_APPROXIMATE, and KNN_EXACT queries
+  go to the cpu indices.
 */
 
 
@@ -26,12 +47,20 @@ Aug 5, 2020, RR
 #include <vector>
 #include <numeric>
 #include <cassert>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 
 // Eigen 3
 #include <Eigen/Dense>
 
 // local
+#include "IKdTree.h"
+#include "KNNResults.h"
+#include "PointView.h"
 #include "Cuda_KdTree.h"
+#include "Cpu_RadiusGrid.h"
 #include "Types.h"
 
 using namespace std;
@@ -42,21 +71,91 @@ namespace texpert {
 
 using Matches = MyMatches;
 
+
+// default number of search points per chunk of knnChunked() and radiusChunked()
+#define KNN_STREAM_CHUNK 65536
+
+
+/*
+Receives the results of one chunk of search points.
+@param first - the index of the first search point of the chunk. Row i of the results belongs to search point first + i.
+@param results - the results of the chunk. The memory is reused for the next chunk.
+*/
+typedef std::function<void(int first, const KNNResults& results)> KNNCallback;
+
+
+/*
+The search quality of the queries.
+KNN_EXACT finds the exact neighbors.
+KNN_APPROXIMATE stops backtracking after a max. number of kd-tree leaves. It is faster,
+but may miss neighbors.
+The cuda kd-tree always stops backtracking early and cannot bound the number of leaves, so it is approximate 
+and ignores the leaf budget. Thus, KNN_EXACT queries of the cuda backend go to the cpu indices.
+*/
+typedef enum _KNNSearchMode
+{
+	KNN_EXACT = 0,
+	KNN_APPROXIMATE = 1
+
+}KNNSearchMode;
+
+
+/*
+The index used for the KNNResults radius searches of the cpu backend.
+KNN_INDEX_AUTO uses a uniform grid for radius searches and the kd-tree for knn searches.
+KNN_INDEX_KDTREE uses the kd-tree for all searches.
+The cuda backend always uses the kd-tree.
+*/
+typedef enum _KNNIndex
+{
+	KNN_INDEX_AUTO = 0,
+	KNN_INDEX_KDTREE = 1
+
+}KNNIndex;
+
+
 class KNN
 {
 public:
 
-	KNN();
+	/*
+	Constructor
+	The search mode of the cuda backend is KNN_APPROXIMATE, the mode of the cpu backend KNN_EXACT.
+	@param backend - the kd-tree backend, KD_AUTO, KD_CUDA, or KD_CPU.
+	*/
+	KNN(KdTreeBackend backend = KD_AUTO);
 	~KNN();
 
 
 	/*
 	Set the reference point cloud. 
 	This one goes into the kd-tree as soon as it is set. 
+	The cpu backend builds its index on the first query.
 	@param pc - reference to the point cloud model
 	*/
 	bool populate(PointCloud& pc);
 
+
+	/*
+	Set the reference points from a point view, e.g., PointView(pc.points).
+	The point ids in the results are the indices in the view.
+	The points are not copied. The cpu backend builds its indices from the view on the first query, and the
+	cuda backend keeps the view to reload the shared kd-tree. Thus, the points must stay valid until the next populate() or reset().
+	@param points - view of the reference points
+	*/
+	bool populate(const PointView& points);
+
+
+	/*
+	Set the reference points and reuse the kd-tree if the same points were indexed before.
+	The cpu backend takes the tree from the KdTreeCache, the cuda backend is only rebuilt
+	if other points were loaded into the shared tree in the meantime.
+	The points are not copied, see populate(const PointView&).
+	@param points - view of the reference points
+	@param key - a version token that changes whenever the points change, or 0 to use the content hash of the points.
+	*/
+	bool populateCached(const PointView& points, std::uint64_t key = 0);
+
 	
 
 
@@ -78,22 +177,145 @@ public:
 	int radius(PointCloud& pc, float radius, vector<Matches>& matches);
 
 
+	/*
+	Start the knn search and return variable-length results.
+	@param pc - the search point cloud.
+	@param k - the number of matches to return
+	@param results - reference to the results. The neighbors of point i are in [results.begin(i), results.end(i)).
+	*/
+	int knn(PointCloud& pc, int k, KNNResults& results);
+
+
+	/*
+	Run a radius search on the kd-tree and return all points in vicinity to the
+	search point as variable-length results.
+	@param pc - the search point cloud.
+	@param radius - the search radius
+	@param results - reference to the results. The neighbors of point i are in [results.begin(i), results.end(i)).
+	@param max_neighbors - the max. number of neighbors per search point. The closest points are kept.
+		A value <= 0 returns all points. Cut search points are counted in results.truncated.
+	*/
+	int radius(PointCloud& pc, float radius, KNNResults& results, int max_neighbors = -1);
+
+
+	/*
+	Start the knn search for the points in a view. The points are not copied
+	and the memory of the results is reused.
+	@param points - view of the search points
+	@param k - the number of matches to return
+	@param results - reference to the results.
+	*/
+	int knn(const PointView& points, int k, KNNResults& results);
+
+
+	/*
+	Run a radius search for the points in a view. The points are not copied
+	and the memory of the results is reused.
+	@param points - view of the search points
+	@param radius - the search radius
+	@param results - reference to the results.
+	@param max_neighbors - the max. number of neighbors per search point. A value <= 0 returns all points.
+	*/
+	int radius(const PointView& points, float radius, KNNResults& results, int max_neighbors = -1);
+
+
+	/*
+	Run the knn search for the points in a view in chunks and pass the results of each chunk to a callback.
+	Only one chunk of results is in memory at a time, so the number of search points is not limited.
+	@param points - view of the search points
+	@param k - the number of matches to return
+	@param callback - receives the results of each chunk, in order.
+	@param chunk_size - the number of search points per chunk.
+	*/
+	int knnChunked(const PointView& points, int k, KNNCallback callback, int chunk_size = KNN_STREAM_CHUNK);
+
+
+	/*
+	Run a radius search for the points in a view in chunks and pass the results of each chunk to a callback.
+	@param points - view of the search points
+	@param radius - the search radius
+	@param callback - receives the results of each chunk, in order.
+	@param max_neighbors - the max. number of neighbors per search point. A value <= 0 returns all points.
+	@param chunk_size - the number of search points per chunk.
+	*/
+	int radiusChunked(const PointView& points, float radius, KNNCallback callback, int max_neighbors = -1, int chunk_size = KNN_STREAM_CHUNK);
+
+
 	/*
 	Reset the tree
 	*/
 	int reset(void);
+
+
+	/*
+	Set the search quality. Default is KNN_EXACT for the cpu backend and KNN_APPROXIMATE for the cuda backend.
+	KNN_EXACT moves the reference points of the cuda backend into the cpu indices, KNN_APPROXIMATE moves them back.
+	@param mode - KNN_EXACT or KNN_APPROXIMATE.
+	@param max_leaves - the number of leaves to visit per search point in KNN_APPROXIMATE mode, >= 1.
+		Each leaf keeps up to 16 points. The cuda kd-tree ignores the budget.
+	*/
+	void setSearchMode(KNNSearchMode mode, int max_leaves = 8);
+
+
+	/*
+	Return the search quality.
+	*/
+	KNNSearchMode getSearchMode(void);
+	int getMaxLeaves(void);
+
+
+	/*
+	Set the index for radius searches with the cpu backend. Default is KNN_INDEX_AUTO.
+	The grid is exact and ignores the search mode.
+	@param index - KNN_INDEX_AUTO or KNN_INDEX_KDTREE.
+	*/
+	void setIndex(KNNIndex index);
+	KNNIndex getIndex(void);
+
+
+	/*
+	Return the backend of the kd-tree in use.
+	@return - KD_CUDA or KD_CPU
+	*/
+	KdTreeBackend getBackend(void);
 	
 
 
 private:
 
+	/*
+	Copy the search point cloud into the test points.
+	*/
+	void setTestPoints(PointCloud& pc);
+
+	/*
+	Check if the reference points go into a cpu index, either because the backend is the cpu,
+	because the points exceed the capacity of the cuda kd-tree, or because the search must be exact.
+	*/
+	bool useCpuIndex(const PointView& points);
+
 	/*
 	Check if this class is ready to run.
-	The kd-tree and the test points - both need to have points
+	The kd-tree needs to have points
 	@return - true, if it can run. 
 	*/
 	bool ready(void);
 
+	/*
+	Build the kd-tree for the reference points if it was not built yet.
+	*/
+	void buildTree(void);
+
+	/*
+	Build the grid for the reference points if it was not built yet for this radius.
+	*/
+	void buildGrid(float radius);
+
+	/*
+	Lock the shared cuda kd-tree. The returned lock does not own the mutex for the cpu backend.
+	*/
+	std::unique_lock<std::recursive_mutex> lockTree(void);
+
 	///////////////////////////////////////////////////////
 	// Members
 
@@ -103,10 +325,34 @@ private:
 	PointCloud*		_testPoint;
 
 	// the kd-tree
-	Cuda_KdTree*		_kdtree;
+	IKdTree*			_kdtree;
+
+	// the tree in use. Either _kdtree or a tree from the KdTreeCache.
+	IKdTree*			_tree;
+	std::shared_ptr<IKdTree>	_cached_tree;
+
+	// number of reference points
+	int					_ref_size;
+
+	// view of the reference points. The lazy cpu indices and the reload of the shared cuda kd-tree read it.
+	PointView			_ref_view;
 
-	// reference points
-	vector<Cuda_Point>	_rpoints;
+	// cache key of the reference points for the lazy cpu indices. The key is 0 for points set with populate().
+	std::uint64_t		_ref_key;
+
+	// key of the reference points in the shared cuda kd-tree
+	std::uint64_t		_cuda_key;
+
+	// true, if the reference points are in a cpu index
+	bool				_ref_cpu;
+
+	// true, if _tree contains the reference points
+	bool				_tree_ready;
+
+	// the grid for radius searches
+	Cpu_RadiusGrid*		_grid;
+	bool				_grid_ready;
+	KNNIndex			_index;
 
 	// test points
 	vector<Cuda_Point>	_tpoints;
@@ -114,9 +360,16 @@ private:
 	// the matches
 	Matches				_matches;
 
+	// the results of one chunk for knnChunked() and radiusChunked()
+	KNNResults			_chunk_results;
+
 
 	bool					_ready;
 
+	// search quality
+	KNNSearchMode			_search_mode;
+	int						_max_leaves;
+
 };
 
 
@@ -0,0 +1,86 @@
+#pragma once
+/*
+class MappedFile
+
+Read-only memory mapped file. The file content is mapped into the address space
+of the process, so it can be read without copying it into a buffer first.
+The mapping uses CreateFileMapping on Windows and mmap on all other platforms.
+
+Usage:
+	MappedFile file;
+	if (file.open("model.cpfdb")) {
+		const char* data = file.data();
+		size_t size = file.size();
+		...
+	}
+	file.close();
+
+Features:
+- Maps an entire file read-only.
+- Closes the mapping on destruction.
+
+MIT License
+------------------------------------------------------
+Last Changes:
+
+Oct 17, 2026
+- Added the class to load binary data without copies.
+*/
+
+// stl
+#include <iostream>
+#include <string>
+#include <cstddef>
+
+namespace texpert {
+
+	class MappedFile
+	{
+	public:
+
+		MappedFile();
+		~MappedFile();
+
+		/*
+		Map a file into memory.
+		@param path - the file path.
+		@return true, if the file was successfully mapped.
+		*/
+		bool open(const std::string& path);
+
+		/*
+		Unmap the file.
+		*/
+		void close(void);
+
+		/*
+		Return a pointer to the first byte of the file, or NULL if no file is mapped.
+		*/
+		const char* data(void) const;
+
+		/*
+		Return the file size in bytes.
+		*/
+		size_t size(void) const;
+
+		/*
+		Return true if a file is mapped.
+		*/
+		bool isOpen(void) const;
+
+	private:
+
+		// no copies
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const char*		_data;
+		size_t			_size;
+
+		// platform handles
+		void*			_file_handle;
+		void*			_map_handle;
+		int				_fd;
+	};
+
+}
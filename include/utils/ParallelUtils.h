@@ -0,0 +1,243 @@
+#pragma once
+/*
+class ParallelUtils
+
+The class provides a minimal parallel-for helper on top of a persistent thread pool.
+It splits an index range [0, size) into contiguous, equally sized chunks
+and processes each chunk as one task. The chunk boundaries only depend on
+the size and the number of threads, so results that are written per chunk can be merged
+in a deterministic order.
+
+The pool starts NumThreads() - 1 worker threads on the first parallel call and keeps them until
+the process ends, so a call does not pay for starting and joining threads. The calling thread
+processes the first chunk and then runs the queued chunks of its own call until all are done.
+Thus, nested calls, e.g., a parallel ICP inside a parallel ICPBatch worker, cannot deadlock, and a chunk
+never runs inside another chunk on the same thread.
+Chunks of one call may run on fewer threads than requested, so the chunks must not wait for each other.
+
+Usage:
+	ParallelUtils::For(N, ParallelUtils::NumThreads(), [&](int thread_id, int begin, int end){
+		for(int i=begin; i<end; i++) { ... }
+	});
+
+Features:
+- Parallel for loop with thread id and chunk range.
+- Hardware concurrency query.
+
+MIT License
+------------------------------------------------------
+Last Changes:
+
+Oct 17, 2026
+- For() runs the chunks on a persistent thread pool instead of starting new threads per call.
+
+*/
+
+// stl
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace texpert {
+
+	class ParallelUtils
+	{
+	public:
+
+		/*
+		Return the number of hardware threads available on this machine.
+		@return - number of threads >= 1.
+		*/
+		static int NumThreads(void)
+		{
+			int n = static_cast<int>(std::thread::hardware_concurrency());
+			return std::max(1, n);
+		}
+
+
+		/*
+		Return the number of chunks For() will use for a given range and thread count.
+		@param size - the size of the index range.
+		@param num_threads - the requested number of threads.
+		@param min_chunk - the minimum number of elements per chunk.
+		@return - the number of chunks, >= 1.
+		*/
+		static int NumChunks(int size, int num_threads, int min_chunk = 1)
+		{
+			int max_chunks = std::max(1, size / std::max(1, min_chunk));
+			return std::max(1, std::min(num_threads, max_chunks));
+		}
+
+
+		/*
+		Run func in parallel over the index range [0, size).
+		The range is split into contiguous chunks, one per thread.
+		The calling thread processes the first chunk.
+		@param size - the size of the index range.
+		@param num_threads - the number of threads to use. A value <= 1 runs the loop serially.
+		@param func - a callable with signature void(int thread_id, int begin, int end).
+		@param min_chunk - the minimum number of elements per chunk. Small ranges are not split.
+		*/
+		template<typename F>
+		static void For(int size, int num_threads, F func, int min_chunk = 1)
+		{
+			if (size <= 0) return;
+
+			int chunks = NumChunks(size, num_threads, min_chunk);
+
+			if (chunks == 1) {
+				func(0, 0, size);
+				return;
+			}
+
+			Pool& pool = GetPool();
+			int pending = chunks - 1;
+
+			{
+				std::lock_guard<std::mutex> lock(pool.mutex);
+				for (int t = 1; t < chunks; t++) {
+					Task task;
+					task.call = &Call<F>;
+					task.func = &func;
+					task.thread_id = t;
+					task.begin = ChunkBegin(size, chunks, t);
+					task.end = ChunkBegin(size, chunks, t + 1);
+					task.pending = &pending;
+					pool.tasks.push_back(task);
+				}
+			}
+			pool.work.notify_all();
+
+			func(0, 0, ChunkBegin(size, chunks, 1));
+
+			// run the queued chunks of this call until all are done. The calling thread does not run the chunks of
+			// other calls, since they could use the thread_local buffers of the chunks that wait here.
+			std::unique_lock<std::mutex> lock(pool.mutex);
+			while (pending > 0) {
+				std::deque<Task>::iterator own = pool.tasks.begin();
+				while (own != pool.tasks.end() && own->pending != &pending) own++;
+
+				if (own != pool.tasks.end()) {
+					RunTask(pool, own, lock);
+				}
+				else {
+					pool.done.wait(lock);
+				}
+			}
+		}
+
+
+		/*
+		Return the first index of a chunk.
+		@param size - the size of the index range.
+		@param chunks - the number of chunks.
+		@param chunk - the chunk id in [0, chunks].
+		@return - the first index of the chunk.
+		*/
+		static int ChunkBegin(int size, int chunks, int chunk)
+		{
+			return static_cast<int>((static_cast<long long>(size) * chunk) / chunks);
+		}
+
+
+	private:
+
+		/*
+		One chunk of a For() call. The task points to the callable of the call, so queuing it does not allocate.
+		*/
+		struct Task
+		{
+			void	(*call)(void* func, int thread_id, int begin, int end);
+			void*	func;
+			int		thread_id;
+			int		begin;
+			int		end;
+			int*	pending; // the unfinished chunks of the call, guarded by the pool mutex
+		};
+
+
+		/*
+		Call the callable of a For() call.
+		*/
+		template<typename F>
+		static void Call(void* func, int thread_id, int begin, int end)
+		{
+			(*static_cast<F*>(func))(thread_id, begin, end);
+		}
+
+
+		/*
+		The worker threads and the task queue.
+		*/
+		struct Pool
+		{
+			std::mutex								mutex;
+			std::condition_variable					work; // a task was queued or the pool stops
+			std::condition_variable					done; // a task finished
+			std::deque<Task>						tasks;
+			std::vector<std::thread>				threads;
+			bool									stop;
+
+			Pool() : stop(false)
+			{
+				for (int i = 1; i < NumThreads(); i++) {
+					threads.push_back(std::thread([this](void) {
+						std::unique_lock<std::mutex> lock(mutex);
+						while (true) {
+							work.wait(lock, [this](void) { return stop || !tasks.empty(); });
+							if (stop) return;
+							RunTask(*this, tasks.begin(), lock);
+						}
+					}));
+				}
+			}
+
+			~Pool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stop = true;
+				}
+				work.notify_all();
+				for (auto& t : threads) {
+					t.join();
+				}
+			}
+		};
+
+
+		/*
+		Return the pool. It is created on the first call.
+		*/
+		static Pool& GetPool(void)
+		{
+			static Pool pool;
+			return pool;
+		}
+
+
+		/*
+		Remove a task from the queue and run it. The lock is released while the task runs.
+		@param pool - the pool.
+		@param it - the queued task.
+		@param lock - the locked pool mutex, locked again when the function returns.
+		*/
+		static void RunTask(Pool& pool, std::deque<Task>::iterator it, std::unique_lock<std::mutex>& lock)
+		{
+			Task task = *it;
+			pool.tasks.erase(it);
+
+			lock.unlock();
+			task.call(task.func, task.thread_id, task.begin, task.end);
+			lock.lock();
+
+			(*task.pending)--;
+			pool.done.notify_all();
+		}
+	};
+
+} //texpert
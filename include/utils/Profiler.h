@@ -0,0 +1,186 @@
+#pragma once
+/*
+class Profiler
+
+Per-stage latency instrumentation for the detection and tracking pipeline.
+
+A stage is a named timer or counter. Timers measure the time of a scope, counters sum up values
+such as the number of ICP iterations. All measurements of a stage within one frame are accumulated,
+and Profiler::EndFrame() moves the per-frame sums into a history of the last frames. The history
+provides the mean, p50, p99, and max values per stage. Only frames in which a stage was used are recorded.
+
+Instrumentation is done with macros, which compile to nothing unless TRACKINGX_PROFILING is defined
+(cmake option TRAKINGX_ENABLE_PROFILING):
+
+	void KNN::populate(PointCloud& pc){
+		TX_PROFILE_SCOPE("knn_populate");
+		...
+		TX_PROFILE_COUNT("knn_points", pc.size());
+	}
+
+	// once per frame, e.g., after registration
+	TX_PROFILE_FRAME();
+
+The stage names are registered once per call site. Measuring a scope costs two clock reads
+and two atomic additions, so it can be used from multiple threads.
+
+Query the results:
+	ProfilerStats stats;
+	Profiler::GetStats("knn_populate", stats);
+	Profiler::WriteCSV("profile.csv");
+	Profiler::WriteJSON("profile.json");
+
+Features:
+- Scoped timers and counters.
+- Per-frame history with p50 and p99.
+- CSV and JSON output.
+
+MIT License
+------------------------------------------------------
+Last Changes:
+
+Oct 17, 2026
+- Added the class to measure the latency of each pipeline stage.
+*/
+
+// stl
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+
+#ifdef TRACKINGX_PROFILING
+	#define TX_PROFILE_CONCAT_(a, b) a##b
+	#define TX_PROFILE_CONCAT(a, b) TX_PROFILE_CONCAT_(a, b)
+
+	// measure the time until the end of the current scope.
+	#define TX_PROFILE_SCOPE(name) \
+		static const int TX_PROFILE_CONCAT(tx_profile_id_, __LINE__) = texpert::Profiler::Register(name, texpert::PROFILE_TIMER); \
+		texpert::ProfilerScope TX_PROFILE_CONCAT(tx_profile_scope_, __LINE__)(TX_PROFILE_CONCAT(tx_profile_id_, __LINE__))
+
+	// add a value to a counter
+	#define TX_PROFILE_COUNT(name, value) \
+		do { static const int tx_profile_id = texpert::Profiler::Register(name, texpert::PROFILE_COUNTER); \
+			 texpert::Profiler::Add(tx_profile_id, (std::int64_t)(value)); } while (0)
+
+	// finish the current frame
+	#define TX_PROFILE_FRAME() texpert::Profiler::EndFrame()
+#else
+	#define TX_PROFILE_SCOPE(name)
+	#define TX_PROFILE_COUNT(name, value) do {} while (0)
+	#define TX_PROFILE_FRAME() do {} while (0)
+#endif
+
+
+namespace texpert {
+
+	typedef enum _ProfileType
+	{
+		PROFILE_TIMER = 0,
+		PROFILE_COUNTER = 1
+
+	}ProfileType;
+
+
+	/*
+	Statistics of one stage over the recorded frames.
+	Timer values are in milliseconds, counter values are the per-frame sums.
+	*/
+	typedef struct _ProfilerStats
+	{
+		std::string		name;
+		ProfileType		type;
+		int				frames; // number of recorded frames
+		std::int64_t	calls; // number of measurements since the last reset
+		double			mean;
+		double			p50;
+		double			p99;
+		double			max;
+
+		_ProfilerStats()
+		{
+			type = PROFILE_TIMER;
+			frames = 0;
+			calls = 0;
+			mean = 0.0;
+			p50 = 0.0;
+			p99 = 0.0;
+			max = 0.0;
+		}
+
+	}ProfilerStats;
+
+
+	class Profiler
+	{
+	public:
+
+		/*
+		Register a stage. Returns the id of an existing stage with the same name.
+		@param name - the stage name.
+		@param type - PROFILE_TIMER or PROFILE_COUNTER.
+		@return the stage id, or -1 if no more stages can be registered.
+		*/
+		static int Register(const std::string& name, ProfileType type);
+
+		/*
+		Add a value to the current frame of a stage. Timers expect nanoseconds.
+		*/
+		static void Add(int id, std::int64_t value);
+
+		/*
+		Finish the current frame and move the frame values into the history.
+		*/
+		static void EndFrame(void);
+
+		/*
+		Set the number of frames kept in the history. Default is 1000.
+		*/
+		static void SetHistorySize(int frames);
+
+		/*
+		Return the statistics of a stage.
+		@return false if the stage does not exist.
+		*/
+		static bool GetStats(const std::string& name, ProfilerStats& stats);
+
+		/*
+		Return the statistics of all stages in registration order.
+		*/
+		static void GetAllStats(std::vector<ProfilerStats>& stats);
+
+		/*
+		Write the statistics of all stages to a csv or json file.
+		*/
+		static bool WriteCSV(const std::string& path);
+		static bool WriteJSON(const std::string& path);
+
+		/*
+		Clear the history and the current frame of all stages.
+		*/
+		static void Reset(void);
+	};
+
+
+	/*
+	Adds the lifetime of the object to a timer stage.
+	*/
+	class ProfilerScope
+	{
+	public:
+		ProfilerScope(int id) : _id(id), _start(std::chrono::steady_clock::now()) {}
+
+		~ProfilerScope()
+		{
+			std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - _start;
+			Profiler::Add(_id, (std::int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+		}
+
+	private:
+		int										_id;
+		std::chrono::steady_clock::time_point	_start;
+	};
+
+} //texpert
@@ -3,6 +3,7 @@
 
 // cuda bindings
 #include "cuda/cuPCU3f.h"  // point cloud samping
+#include "Profiler.h"
 
 
 using namespace texpert;
@@ -131,6 +132,8 @@ Process the current camera frame
 */
 bool PointCloudProducer::process(void)
 {
+	TX_PROFILE_SCOPE("pointcloud_production");
+
 	if(!_producer_ready) return false;
 
 	// grab an image
@@ -158,6 +161,26 @@ bool PointCloudProducer::process(void)
 	return true;
 }
 
+/*!
+Return the intrinsics of the depth camera and the sampling step. 
+*/
+DepthIntrinsics PointCloudProducer::getDepthIntrinsics(void)
+{
+	DepthIntrinsics intrinsics;
+	intrinsics.width = _depth_cols;
+	intrinsics.height = _depth_rows;
+	intrinsics.fx = _fx_depth;
+	intrinsics.fy = _fy_depth;
+	intrinsics.cx = _cx_depth;
+	intrinsics.cy = _cy_depth;
+
+	// the uniform sampling keeps every step-th pixel. The other modes do not follow a pixel pattern. 
+	intrinsics.step = (_sampling_method == UNIFORM) ? std::max(1, _sampling_param.uniform_step) : 1;
+
+	return intrinsics;
+}
+
+
 // raw point cloud sampling
 bool PointCloudProducer::run_sampling_raw(float* imgBuf)
 {
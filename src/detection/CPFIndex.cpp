@@ -0,0 +1,156 @@
+#include "CPFIndex.h"
+
+#include <algorithm>
+
+using namespace texpert;
+
+
+
+CPFSceneIndex::CPFSceneIndex()
+{
+
+}
+
+
+CPFSceneIndex::~CPFSceneIndex()
+{
+
+}
+
+
+/*
+Create the index for a set of scene descriptors.
+*/
+void CPFSceneIndex::build(const std::vector<CPFDiscreet>& descriptors)
+{
+	clear();
+
+	int size = (int)descriptors.size();
+	_order.reserve(size);
+
+	for (int i = 0; i < size; i++) {
+		if (descriptors[i].data[0] != 0) { // descriptors with data[0] == 0 do not vote
+			_order.push_back(i);
+		}
+	}
+
+	// a stable sort keeps the original descriptor order within one bucket.
+	std::stable_sort(_order.begin(), _order.end(),
+		[&descriptors](const int a, const int b) {
+			return CPFKey(descriptors[a]) < CPFKey(descriptors[b]);
+	});
+
+	// bucket ranges
+	_buckets.reserve(_order.size());
+
+	int n = (int)_order.size();
+	int begin = 0;
+	while (begin < n) {
+		CPFKey key(descriptors[_order[begin]]);
+		int end = begin + 1;
+		while (end < n && key == CPFKey(descriptors[_order[end]])) {
+			end++;
+		}
+		_buckets[key] = std::make_pair(begin, end);
+		begin = end;
+	}
+}
+
+
+/*
+Find all scene descriptors with the same values data[0..2] as the descriptor d.
+*/
+bool CPFSceneIndex::find(const CPFDiscreet& d, int& begin, int& end) const
+{
+	auto itr = _buckets.find(CPFKey(d));
+	if (itr == _buckets.end()) {
+		begin = 0;
+		end = 0;
+		return false;
+	}
+
+	begin = itr->second.first;
+	end = itr->second.second;
+	return true;
+}
+
+
+int CPFSceneIndex::size(void) const
+{
+	return (int)_order.size();
+}
+
+
+void CPFSceneIndex::clear(void)
+{
+	_order.clear();
+	_buckets.clear();
+}
+
+
+
+//-----------------------------------------------------------------------------------------------------------
+
+
+CPFModelIndex::CPFModelIndex()
+{
+	_offsets.push_back(0);
+}
+
+
+CPFModelIndex::~CPFModelIndex()
+{
+
+}
+
+
+/*
+Create the offset table for a set of model descriptors.
+*/
+void CPFModelIndex::build(const std::vector<CPFDiscreet>& descriptors, int num_points)
+{
+	build(descriptors.data(), (int)descriptors.size(), num_points);
+}
+
+
+/*
+Create the offset table for a set of model descriptors.
+Counting sort by point index.
+*/
+void CPFModelIndex::build(const CPFDiscreet* descriptors, int size, int num_points)
+{
+	_offsets.assign(num_points + 1, 0);
+	_order.assign(size, 0);
+
+	for (int i = 0; i < size; i++) {
+		int p = descriptors[i].point_idx;
+		if (p < 0 || p >= num_points) continue;
+		_offsets[p + 1]++;
+	}
+
+	for (int i = 0; i < num_points; i++) {
+		_offsets[i + 1] += _offsets[i];
+	}
+
+	std::vector<int> pos(_offsets.begin(), _offsets.end() - 1);
+	for (int i = 0; i < size; i++) {
+		int p = descriptors[i].point_idx;
+		if (p < 0 || p >= num_points) continue;
+		_order[pos[p]++] = i;
+	}
+
+	_order.resize(_offsets[num_points]);
+}
+
+
+int CPFModelIndex::numPoints(void) const
+{
+	return (int)_offsets.size() - 1;
+}
+
+
+void CPFModelIndex::clear(void)
+{
+	_order.clear();
+	_offsets.assign(1, 0);
+}
@@ -1,6 +1,7 @@
 #include "CPFMatchingExp.h"
 
 #include "ResourceManager.h"
+#include "Profiler.h"
 
 using namespace texpert;
 
@@ -12,12 +13,16 @@ CPFMatchingExp::CPFMatchingExp()
 	m_render_helpers = true;
 	m_verbose_level = 0;
 	m_multiplier = 10.0;
+	m_matching_mode = CPF_MATCH_INDEXED;
+	m_num_threads = ParallelUtils::NumThreads();
 
 	float angle_step_rad = m_params.angle_step / 180.0f * static_cast<float>(M_PI);
 	m_angle_bins = (int)(static_cast<float>(2 * M_PI) / angle_step_rad) + 1;
 	
 
-	m_knn = new KNN();
+	// the cpu backend returns all neighbors within the search radius. The cuda kd-tree
+	// stops at KNN_MATCHES_LENGTH neighbors, which would change the descriptors.
+	m_knn = new KNN(KD_CPU);
 }
 
 CPFMatchingExp::~CPFMatchingExp()
@@ -38,9 +43,6 @@ int CPFMatchingExp::addModel(PointCloud& points, std::string label)
 		return -1;
 	}
 
-	m_ref.push_back(points);
-	m_ref_labels.push_back(label);
-
 	if (m_verbose) {
 		std::cout << "[INFO] - CPFMatchingExp: start extracting descriptors from " << label << " with " << points.size() << " points." << std::endl;
 	}
@@ -54,17 +56,103 @@ int CPFMatchingExp::addModel(PointCloud& points, std::string label)
 
 	calculateDescriptors(points, m_params.search_radius, descriptors, curvatures);
 
-	m_model_descriptors.push_back(descriptors);
-	m_model_curvatures.push_back(curvatures);
+	if (m_verbose) {
+		std::cout << "[INFO] - CPFMatchingExp: finished extraction of " << descriptors.size() << " descriptors for  " << label << "." << std::endl;
+	}
+
+	CPFModelData model;
+	model.assign(descriptors, curvatures);
+	return storeModel(points, label, model);
+}
+
+
+/*
+Store a model with its descriptors and curvatures and create the model data.
+*/
+int CPFMatchingExp::storeModel(PointCloud& points, std::string label, CPFModelData& model)
+{
+	m_ref.push_back(points);
+	m_ref_labels.push_back(label);
+
+	// offset table to find the descriptors of each point
+	m_model_index.push_back(CPFModelIndex());
+	m_model_index.back().build(model.descriptors(), (int)model.size(), points.size());
+
+	m_models.push_back(std::move(model));
 
 	// create an empty data template. 
 	m_matching_results.push_back(CPFMatchingData());
 
+	return m_models.size() - 1;
+}
+
+
+/*
+Save a model to a binary model database file.
+*/
+bool CPFMatchingExp::saveModel(int model_id, std::string path)
+{
+	if(model_id < 0 || model_id >= m_ref.size() ){
+		std::cout << "[ERROR] - CPFMatchingExp: Selected model id " << model_id << " for saving does not exist." << std::endl;
+		return false;
+	}
+
+	const CPFModelData& model = m_models[model_id];
+	if (model.numCurvatures() != m_ref[model_id].points.size()) {
+		std::cout << "[ERROR] - CPFMatchingExp: model " << model_id << " has " << model.numCurvatures() << " curvatures for " << m_ref[model_id].points.size() << " points." << std::endl;
+		return false;
+	}
+
+	return CPFModelDatabase::Write(path, m_ref_labels[model_id], m_ref[model_id], model.curvatures(), model.descriptors(), model.size(), getDBParams());
+}
+
+
+/*
+Load a model from a binary model database file.
+*/
+int CPFMatchingExp::loadModel(std::string path)
+{
+	// the model keeps the file mapped and matches against the mapped descriptors
+	std::shared_ptr<CPFModelDatabase> db = std::make_shared<CPFModelDatabase>();
+	if (!db->open(path)) {
+		return -1;
+	}
+
+	std::string label = db->label();
+	PointCloud points;
+	db->getPointCloud(points);
+
+	if (!db->paramsMatch(getDBParams())) {
+		if (m_verbose) {
+			std::cout << "[INFO] - CPFMatchingExp: " << path << " was created with different parameters. Extracting descriptors again." << std::endl;
+		}
+		return addModel(points, label);
+	}
+
+	if (points.size() == 0) return -1;
+
 	if (m_verbose) {
-		std::cout << "[INFO] - CPFMatchingExp: finished extraction of " << descriptors.size() << " descriptors for  " << label << "." << std::endl;
+		std::cout << "[INFO] - CPFMatchingExp: loaded " << db->numDescriptors() << " descriptors for " << label << " from " << path << "." << std::endl;
 	}
 
-	return m_model_descriptors.size() - 1;
+	CPFModelData model;
+	model.assign(db);
+	return storeModel(points, label, model);
+}
+
+
+/*
+Return the parameters that affect the descriptor extraction.
+*/
+CPFModelDBParams CPFMatchingExp::getDBParams(void)
+{
+	CPFModelDBParams p;
+	p.search_radius = m_params.search_radius;
+	p.angle_step = m_params.angle_step;
+	p.multiplier = m_multiplier;
+	p.angle_bins = m_angle_bins;
+	p.max_neighbors = 0; // calculateDescriptors() uses all neighbors within the search radius, m_knn is a cpu KNN
+	return p;
 }
 
 
@@ -88,6 +176,9 @@ bool CPFMatchingExp::setScene(PointCloud& points)
 
 	calculateDescriptors(points, m_params.search_radius, m_scene_descriptors, m_scene_curvatures);
 
+	// hash index to find matching scene descriptors
+	m_scene_index.build(m_scene_descriptors);
+
 
 	if (m_verbose  && m_verbose_level == 2) {
 		std::cout << "[INFO] - CPFMatchingExp: finished extraction of " << m_scene_descriptors.size() << " scene descriptors for." << std::endl;
@@ -101,6 +192,8 @@ Detect all reference point in the camera point set.
 */
 bool CPFMatchingExp::match(int model_id)
 {
+	TX_PROFILE_SCOPE("cpf_match");
+
 	if(model_id < 0 || model_id >= m_ref.size() ){
 		std::cout << "[ERROR] - Selected model id " << model_id << " for matching does not exist.";
 		return false;
@@ -116,7 +209,12 @@ bool CPFMatchingExp::match(int model_id)
 	}
 
 	// matching and voting
-	matchDescriptors(m_model_descriptors[model_id], m_scene_descriptors, m_ref[model_id], m_scene, m_matching_results[model_id]);
+	if (m_matching_mode == CPF_MATCH_REFERENCE) {
+		matchDescriptorsReference(m_models[model_id], m_scene_descriptors, m_ref[model_id], m_scene, m_matching_results[model_id]);
+	}
+	else {
+		matchDescriptors(m_models[model_id], m_model_index[model_id], m_scene_descriptors, m_scene_index, m_ref[model_id], m_scene, m_matching_results[model_id]);
+	}
 
 	// cluster the poses
 	bool ret = clustering(m_matching_results[model_id]);
@@ -168,26 +266,60 @@ bool CPFMatchingExp::setParams(CPFParams params)
 }
 
 
+/*
+Set the descriptor matching mode.
+*/
+void CPFMatchingExp::setMatchingMode(CPFMatchingMode mode)
+{
+	m_matching_mode = mode;
+}
+
+
+CPFMatchingMode CPFMatchingExp::getMatchingMode(void)
+{
+	return m_matching_mode;
+}
+
+
+/*
+Set the number of threads for descriptor matching and voting.
+*/
+void CPFMatchingExp::setNumThreads(int num_threads)
+{
+	m_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+}
+
+
+int CPFMatchingExp::getNumThreads(void)
+{
+	return m_num_threads;
+}
+
+
+void CPFMatchingExp::setNeighborSearchMode(KNNSearchMode mode, int max_leaves)
+{
+	m_knn->setSearchMode(mode, max_leaves);
+}
+
+
 
 // Descriptor based on curvature pairs and the direction vector
 void CPFMatchingExp::calculateDescriptors(PointCloud& pc, float radius, std::vector<CPFDiscreet>& descriptors, std::vector<uint32_t>& curvatures)
 {
-	CPFTools::CPFParam param;
-	param.angle_bins = m_angle_bins;
-	CPFTools::SetParam(param);
+	TX_PROFILE_SCOPE("cpf_descriptors");
+
+	// the descriptor context of this instance
+	m_cpf_context.angle_bins = m_angle_bins;
 
 	//----------------------------------------------------------------------------------------------------------
 	// nearest neighbors
 
-	std::vector<Matches> matches;
 	size_t s = pc.size();
 
-	
-	m_knn->populate(pc);
+	// reuse the index if the model or scene was indexed before.
+	m_knn->populateCached(PointView(pc.points));
 
-	matches.clear();
-	
-	m_knn->radius(pc, radius, matches);
+	m_knn->radius(pc, radius, m_neighbors);
 
 	//----------------------------------------------------------------------------------------------------------
 	// Calculate point curvatures
@@ -197,27 +329,24 @@ void CPFMatchingExp::calculateDescriptors(PointCloud& pc, float radius, std::vec
 
 	for (int i = 0; i < s; i++) {
 	
-		uint32_t curv = CPFTools::DiscretizeCurvature(pc.points[i], pc.normals[i], pc, matches[i], m_multiplier);
+		uint32_t curv = CPFTools::DiscretizeCurvature(pc.points[i], pc.normals[i], pc, m_neighbors, i, m_multiplier);
 		curvatures.push_back(curv);
 	}	
 
 	//----------------------------------------------------------------------------------------------------------
 	// Calculate the descriptor
 	descriptors.clear();
-	descriptors.reserve(s);
+	descriptors.reserve(m_neighbors.total());
 	for (int i = 0; i < s; i++) {
 		uint32_t cur1 = curvatures[i];
 
 		// find the reference frame for this point
 		Eigen::Affine3f T = CPFTools::GetRefFrame(pc.points[i], pc.normals[i]);
 
-		// current knn matches length as defined in Cuda_Types.h
-		const int num_matches = KNN_MATCHES_LENGTH;
-
-		for (int j= 0; j < num_matches; j++) {
-			if( matches[i].matches[j].distance > 0.0){
+		for (int j = m_neighbors.begin(i); j < m_neighbors.end(i); j++) {
+			if( m_neighbors.distances[j] > 0.0f){
 
-				int id = matches[i].matches[j].second;
+				int id = m_neighbors.indices[j];
 				uint32_t cur2 =  curvatures[id];
 
 				// Move the point p1 into the coordinate frame of the point p0
@@ -230,7 +359,7 @@ void CPFMatchingExp::calculateDescriptors(PointCloud& pc, float radius, std::vec
 				}
 
 
-				CPFDiscreet cpf =  CPFTools::DiscretizeCPF(cur1, cur2, pc.points[i], pt); // get pc.points[id] into the current points coordinate frame.
+				CPFDiscreet cpf =  CPFTools::DiscretizeCPF(m_cpf_context, cur1, cur2, pc.points[i], pt); // get pc.points[id] into the current points coordinate frame.
 				//CPFDiscreet cpf =  CPFTools::DiscretizeCPF(cur1, cur2, pc.points[i], pc.points[id]);
 				cpf.point_idx = i;
 				
@@ -248,12 +377,163 @@ void CPFMatchingExp::calculateDescriptors(PointCloud& pc, float radius, std::vec
 }
 
 
+/*
+Match the model and scene descriptors using the descriptor index tables.
+The scene index returns all scene descriptors with identical values for a model descriptor. 
+Only the accumulator cells that received votes are visited to find the winner and reset, see VoteAccumulator. 
+The votes and pose candidates are identical to the reference implementation. 
+
+The model points are split into contiguous ranges, one per thread. Each thread votes 
+with its own buffer. The buffers are merged in thread order, which is the model point order,
+so the result does not depend on the number of threads. 
+*/
+void CPFMatchingExp::matchDescriptors(	const CPFModelData& src_model, CPFModelIndex& model_index, std::vector<CPFDiscreet>& src_scene, CPFSceneIndex& scene_index,
+										PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data)
+{
+	TX_PROFILE_SCOPE("cpf_voting");
+
+	if (m_verbose && m_verbose_level == 2) {
+		std::cout << "[INFO] - CPFMatchingExp: Start matching descriptors." << std::endl;
+	}
+
+	int model_point_size = std::min((int)pc_model.size(), model_index.numPoints());
+	int scene_point_size = pc_scene.size();
+
+	dst_data.voting_clear();
+
+	// min. number of model points per thread
+	const int min_chunk = 16;
+	int num_chunks = ParallelUtils::NumChunks(model_point_size, m_num_threads, min_chunk);
+
+	// prepare the per-thread memory. The accumulators are empty after each run. 
+	if (m_vote_buffers.size() < num_chunks) {
+		m_vote_buffers.resize(num_chunks);
+	}
+	for (int t = 0; t < num_chunks; t++) {
+		m_vote_buffers[t].accumulator.setNumCells(scene_point_size * m_angle_bins);
+		m_vote_buffers[t].results_clear();
+	}
+
+	ParallelUtils::For(model_point_size, num_chunks, [&](int thread_id, int begin, int end) {
+		voteRange(begin, end, src_model, model_index, src_scene, scene_index, pc_model, pc_scene, m_vote_buffers[thread_id]);
+	}, min_chunk);
+
+	// -------------------------------------------------------------------
+	// Merge the results in thread order
+
+	for (int t = 0; t < num_chunks; t++) {
+		CPFVoteBuffer& b = m_vote_buffers[t];
+
+		dst_data.pose_candidates.insert(dst_data.pose_candidates.end(), b.pose_candidates.begin(), b.pose_candidates.end());
+		dst_data.pose_candidates_votes.insert(dst_data.pose_candidates_votes.end(), b.pose_candidates_votes.begin(), b.pose_candidates_votes.end());
+		dst_data.vote_pair.insert(dst_data.vote_pair.end(), b.vote_pair.begin(), b.vote_pair.end());
+
+		// render helpers store the matches
+		if (m_render_helpers) {
+			for (int k = 0; k < b.matching_pairs.size(); k++) {
+				m_helpers.addMatchingPair(b.matching_pairs[k].first, b.matching_pairs[k].second);
+			}
+			for (int k = 0; k < b.vote_ids.size(); k++) {
+				m_helpers.addVotePair(b.vote_ids[k].first, b.vote_ids[k].second);
+			}
+		}
+		b.results_clear();
+	}
+
+	if (m_verbose && m_verbose_level == 2) {
+		std::cout << "[INFO] - CPFMatchingExp: Found " << dst_data.pose_candidates.size() << " pose candidates." << std::endl;
+	}
+}
+
+
+/*
+Vote for the model points [begin, end) and recover the pose candidates of these points.
+*/
+void CPFMatchingExp::voteRange(	int begin, int end, const CPFModelData& src_model, CPFModelIndex& model_index, std::vector<CPFDiscreet>& src_scene,
+								CPFSceneIndex& scene_index, PointCloud& pc_model, PointCloud& pc_scene, CPFVoteBuffer& buffer)
+{
+	VoteAccumulator& accumulator = buffer.accumulator;
+	std::vector<int>& max_votes_idx = buffer.max_votes_idx;
+	const CPFDiscreet* model_descriptors = src_model.descriptors();
+
+	for (int i = begin; i < end; i++) {
+
+		int point_id = i;
+
+		accumulator.reset();
+
+		// -------------------------------------------------------------------
+		// For each point i and its descriptors, find matching descriptors.
+		for (int k = model_index.begin(point_id); k < model_index.end(point_id); k++) {
+
+			const CPFDiscreet& src = model_descriptors[model_index.at(k)];
+
+			int s_begin, s_end;
+			if (!scene_index.find(src, s_begin, s_end)) continue;
+
+			for (int j = s_begin; j < s_end; j++) {
+
+				const CPFDiscreet& dst = src_scene[scene_index.at(j)];
+
+				// Voting, fill the accumulator
+				float alpha = src.alpha - dst.alpha;
+
+				accumulator.add(dst.point_idx * m_angle_bins + alphaBin(alpha));
+
+				// store the output vote pair
+				buffer.vote_pair.push_back(make_pair(i, alpha));
+
+				if (m_render_helpers) {
+					buffer.matching_pairs.push_back(make_pair(point_id, dst.point_idx));
+				}
+			}
+		}
+
+		// -------------------------------------------------------------------
+		// Find the voting winner
+
+		int max_vote = 0;
+		for (int k = 0; k < accumulator.size(); k++) {
+			max_vote = std::max(max_vote, accumulator.votes(k));
+		}
+
+		max_votes_idx.clear();
+		for (int k = 0; k < accumulator.size(); k++) {
+			if (accumulator.votes(k) == max_vote) {
+				max_votes_idx.push_back(accumulator.cell(k));
+			}
+		}
+
+		// same order as the accumulator scan of the reference implementation
+		std::sort(max_votes_idx.begin(), max_votes_idx.end());
+
+		// -----------------------------------------------------------------------
+		// Recover the pose
+
+		for (int k = 0; k < max_votes_idx.size(); k++) {
+			int max_scene_id = max_votes_idx[k] / m_angle_bins;
+			int max_alpha = max_votes_idx[k] % m_angle_bins;
+
+			buffer.pose_candidates.push_back(recoverPose(point_id, max_scene_id, max_alpha, pc_model, pc_scene));
+			buffer.pose_candidates_votes.push_back(max_vote);
+
+			if (m_render_helpers) {
+				buffer.vote_ids.push_back(make_pair(point_id, max_scene_id));
+			}
+		}
+	}
+}
+
+
 /*
 Match the model and scene descriptors.
+Reference implementation, compares all descriptor pairs.
 */
-void CPFMatchingExp::matchDescriptors(	std::vector<CPFDiscreet>& src_model, std::vector<CPFDiscreet>& src_scene,  PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data)
+void CPFMatchingExp::matchDescriptorsReference(	const CPFModelData& src_model, std::vector<CPFDiscreet>& src_scene,  PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data)
 									
 {
+	TX_PROFILE_SCOPE("cpf_voting");
+
 	if (m_verbose && m_verbose_level == 2) {
 		std::cout << "[INFO] - CPFMatchingExp: Start matching descriptors." << std::endl;
 	}
@@ -293,8 +573,7 @@ void CPFMatchingExp::matchDescriptors(	std::vector<CPFDiscreet>& src_model, std:
 					// Voting, fill the accumulator
 					float alpha = src.alpha - dst.alpha;
 					
-					int alpha_bin = static_cast<int>(static_cast<float>(m_angle_bins) * ((alpha + 2.0f * static_cast<float>(M_PI)) / (4.0f * static_cast<float>(M_PI))));
-					alpha_bin = std::max(0, std::min(alpha_bin, m_angle_bins));
+					int alpha_bin = alphaBin(alpha);
 
 				
 					accumulator[dst.point_idx * m_angle_bins + alpha_bin]++;
@@ -339,50 +618,80 @@ void CPFMatchingExp::matchDescriptors(	std::vector<CPFDiscreet>& src_model, std:
 				int max_scene_id = max_votes_idx[k] / m_angle_bins; // model id
 				int max_alpha = max_votes_idx[k] % m_angle_bins; // restores the angle
 
+				addPoseCandidate(point_id, max_scene_id, max_alpha, max_votes_value[k], pc_model, pc_scene, dst_data);
+			}
+		}
 
-				Eigen::Vector3f model_point(pc_model.points[point_id][0], pc_model.points[point_id][1], pc_model.points[point_id][2]);
-				Eigen::Vector3f model_normal(pc_model.normals[point_id].x(), pc_model.normals[point_id].y(), pc_model.normals[point_id].z());
+	}
+	
+	if (m_verbose && m_verbose_level == 2) {
+		std::cout << "[INFO] - CPFMatchingExp: Found " << dst_data.pose_candidates.size() << " pose candidates." << std::endl;
+	}
 
-				Eigen::Vector3f scene_point(pc_scene.points[max_scene_id][0], pc_scene.points[max_scene_id][1], pc_scene.points[max_scene_id][2]);
-				Eigen::Vector3f scene_normal(pc_scene.normals[max_scene_id].x(), pc_scene.normals[max_scene_id].y(), pc_scene.normals[max_scene_id].z());
 
-				Eigen::Affine3f T = CPFTools::GetRefFrame(model_point, model_normal);
-				Eigen::Affine3f Tmg = CPFTools::GetRefFrame(scene_point, scene_normal);
+}
 
-				float angle = (static_cast<float>(max_alpha) / static_cast<float>(m_angle_bins)) * 4.0f * static_cast<float>(M_PI) - 2.0f * static_cast<float>(M_PI);
 
-				Eigen::AngleAxisf rot(angle, Eigen::Vector3f::UnitX());
+/*
+Return the accumulator bin for the angle alpha = alpha_model - alpha_scene.
+alpha is in the range [-2pi, 2pi].
+*/
+int CPFMatchingExp::alphaBin(float alpha)
+{
+	int alpha_bin = static_cast<int>(static_cast<float>(m_angle_bins) * ((alpha + 2.0f * static_cast<float>(M_PI)) / (4.0f * static_cast<float>(M_PI))));
+	return std::max(0, std::min(alpha_bin, m_angle_bins - 1));
+}
 
-				// Compose the transformations for the final pose
-				Eigen::Affine3f final_transformation( Tmg.inverse() * rot * T  );
 
+/*
+Recover the pose from a model point, a scene point, and the voted angle bin.
+*/
+Eigen::Affine3f CPFMatchingExp::recoverPose(int point_id, int max_scene_id, int max_alpha, PointCloud& pc_model, PointCloud& pc_scene)
+{
+	Eigen::Vector3f model_point(pc_model.points[point_id][0], pc_model.points[point_id][1], pc_model.points[point_id][2]);
+	Eigen::Vector3f model_normal(pc_model.normals[point_id].x(), pc_model.normals[point_id].y(), pc_model.normals[point_id].z());
 
-				// RENDER HELPER
-				//vote_ids.push_back(make_pair(point_id, max_model_id));
-				if (m_render_helpers) {
-					m_helpers.addVotePair(point_id, max_scene_id);
-				}
+	Eigen::Vector3f scene_point(pc_scene.points[max_scene_id][0], pc_scene.points[max_scene_id][1], pc_scene.points[max_scene_id][2]);
+	Eigen::Vector3f scene_normal(pc_scene.normals[max_scene_id].x(), pc_scene.normals[max_scene_id].y(), pc_scene.normals[max_scene_id].z());
 
-				dst_data.pose_candidates.push_back(final_transformation);
-				dst_data.pose_candidates_votes.push_back(max_votes_value[k]);
+	Eigen::Affine3f T = CPFTools::GetRefFrame(model_point, model_normal);
+	Eigen::Affine3f Tmg = CPFTools::GetRefFrame(scene_point, scene_normal);
 
-				//std::cout << "\tangle: " << angle << std::endl;
-			}
-		}
+	float angle = (static_cast<float>(max_alpha) / static_cast<float>(m_angle_bins)) * 4.0f * static_cast<float>(M_PI) - 2.0f * static_cast<float>(M_PI);
+
+	Eigen::AngleAxisf rot(angle, Eigen::Vector3f::UnitX());
+
+	// Compose the transformations for the final pose
+	Eigen::Affine3f final_transformation( Tmg.inverse() * rot * T  );
+
+	return final_transformation;
+}
 
-	}
-	
-	if (m_verbose && m_verbose_level == 2) {
-		std::cout << "[INFO] - CPFMatchingExp: Found " << dst_data.pose_candidates.size() << " pose candidates." << std::endl;
-	}
 
+/*
+Recover the pose from a model point, a scene point, and the voted angle bin, and 
+store it as pose candidate. 
+*/
+void CPFMatchingExp::addPoseCandidate(int point_id, int max_scene_id, int max_alpha, int votes, PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data)
+{
+	Eigen::Affine3f final_transformation = recoverPose(point_id, max_scene_id, max_alpha, pc_model, pc_scene);
 
+	// RENDER HELPER
+	//vote_ids.push_back(make_pair(point_id, max_model_id));
+	if (m_render_helpers) {
+		m_helpers.addVotePair(point_id, max_scene_id);
+	}
+
+	dst_data.pose_candidates.push_back(final_transformation);
+	dst_data.pose_candidates_votes.push_back(votes);
 }
 
 
 
 bool CPFMatchingExp::clustering(CPFMatchingData& data)
 {
+	TX_PROFILE_SCOPE("cpf_clustering");
+
 
 	if( data.pose_candidates.size() == 0){
 		if (m_verbose) {
@@ -392,50 +701,29 @@ bool CPFMatchingExp::clustering(CPFMatchingData& data)
 	}
 	
 	data.cluster_clear();
-	int cluster_count = 0;
 
-	for (int i = 0; i < data.pose_candidates.size(); i++) {
+	// Group the candidates. Each candidate joins all clusters with a similar first pose. 
+	m_pose_clustering.setTranslationThreshold(m_params.cluster_trans_threshold);
+	m_pose_clustering.setRotationThreshold(0.0f); // translation only
 
-		bool cluster_found = false;
+	std::vector< std::vector<int> > members;
+	std::vector<int> votes;
+	int num_clusters = m_pose_clustering.cluster(data.pose_candidates, data.pose_candidates_votes, members, votes);
 
-		Eigen::Affine3f pose = data.pose_candidates[i];
-
-		// check whether the new pose fits into an existing cluster
-		for (int j = 0; j < data.pose_clusters.size(); j++) {
-
-			if (similarPose(pose, data.pose_clusters[j].front())) {
-				cluster_found = true;
-				data.pose_clusters[j].push_back(pose); // remember the cluster
-				data.pose_cluster_votes[j].first += data.pose_candidates_votes[i]; // count the votes
-				
-				// RENDER HELPER
-				if (m_render_helpers) {
-					data.debug_pose_candidates_id[j].push_back(i); // for debugging. Store the pose candiate id. 
-				}
-			}
+	data.pose_clusters.resize(num_clusters);
+	for (int j = 0; j < num_clusters; j++) {
 
+		std::vector<Eigen::Affine3f>& cluster = data.pose_clusters[j];
+		cluster.reserve(members[j].size());
+		for (int k = 0; k < members[j].size(); k++) {
+			cluster.push_back(data.pose_candidates[members[j][k]]); // remember the cluster
 		}
+		data.pose_cluster_votes.push_back(make_pair(votes[j], j)); // count the votes
 
-		// create a new cluster 
-		if (!cluster_found) {
-			std::vector<Eigen::Affine3f> cluster;
-			cluster.push_back(pose);
-			data.pose_clusters.push_back(cluster); // remember the cluster
-			data.pose_cluster_votes.push_back(make_pair(data.pose_candidates_votes[i], cluster_count)); // count the votes
-			cluster_count++;
-			
-			// RENDER HELPER
-			// to render the lines appropriate
-			if (m_render_helpers) {
-			
-				std::vector<int> debug_id;
-				debug_id.push_back(i);
-				data.debug_pose_candidates_id.push_back( debug_id); // for debugging. Store the pose candiate id. 
-			}
+		// RENDER HELPER
+		if (m_render_helpers) {
+			data.debug_pose_candidates_id.push_back(members[j]); // for debugging. Store the pose candiate id. 
 		}
-
-
-
 	}
 
 	// sort the cluster
@@ -452,22 +740,6 @@ bool CPFMatchingExp::clustering(CPFMatchingData& data)
 }
 
 
-bool CPFMatchingExp::similarPose(Eigen::Affine3f a, Eigen::Affine3f b)
-{
-	float translation_threshold = 0.03;
-	float rotation_threshold = 0.8;
-
-	// distance between the two positions. 
-	float delta_t = (a.translation() - b.translation()).norm();
-
-	// angle delta
-	Eigen::AngleAxisf aa(a.rotation().inverse() * b.rotation());
-	float delta_r = fabsf(aa.angle());
-
-	return delta_t < m_params.cluster_trans_threshold;// && delta_r < m_params.cluster_rot_threshold;
-}
-
-
 /*
 Return the poses for a particular model;
 */
@@ -581,7 +853,8 @@ int CPFMatchingExp::getNumPoseClusters(int model_id)
 
 bool CPFMatchingExp::getModelCurvature(const int model_id, std::vector<uint32_t>& model_cu )
 {
-	model_cu = m_model_curvatures[model_id];
+	const CPFModelData& model = m_models[model_id];
+	model_cu.assign(model.curvatures(), model.curvatures() + model.numCurvatures());
 	return true;
 }
 
@@ -1,6 +1,7 @@
 #include "CPFMatchingExpGPU.h"
 
 #include "ResourceManager.h"
+#include "Profiler.h"
 
 using namespace texpert;
 
@@ -40,9 +41,6 @@ int CPFMatchingExpGPU::addModel(PointCloud& points, std::string label)
 		return -1;
 	}
 
-	m_ref.push_back(points);
-	m_ref_labels.push_back(label);
-
 	if (m_verbose) {
 		std::cout << "[INFO] - CPFMatchingExpGPU: start extracting descriptors from " << label << " with " << points.size() << " points." << std::endl;
 	}
@@ -65,17 +63,99 @@ int CPFMatchingExpGPU::addModel(PointCloud& points, std::string label)
 
 	calculateDescriptors(points, m_params.search_radius, descriptors, curvatures);
 
-	m_model_descriptors.push_back(descriptors);
-	m_model_curvatures.push_back(curvatures);
+	if (m_verbose) {
+		std::cout << "[INFO] - CPFMatchingExpGPU: finished extraction of " << descriptors.size() << " descriptors for  " << label << "." << std::endl;
+	}
+
+	CPFModelData model;
+	model.assign(descriptors, curvatures);
+	return storeModel(points, label, model);
+}
+
+
+/*
+Store a model with its descriptors and curvatures and create the model data.
+*/
+int CPFMatchingExpGPU::storeModel(PointCloud& points, std::string label, CPFModelData& model)
+{
+	m_ref.push_back(points);
+	m_ref_labels.push_back(label);
+
+	m_models.push_back(std::move(model));
 
 	// create an empty data template. 
 	m_matching_results.push_back(CPFMatchingData());
 
+	return m_models.size() - 1;
+}
+
+
+/*
+Save a model to a binary model database file.
+*/
+bool CPFMatchingExpGPU::saveModel(int model_id, std::string path)
+{
+	if (model_id < 0 || model_id >= m_ref.size()) {
+		std::cout << "[ERROR] - CPFMatchingExpGPU: Selected model id " << model_id << " for saving does not exist." << std::endl;
+		return false;
+	}
+
+	const CPFModelData& model = m_models[model_id];
+	if (model.numCurvatures() != m_ref[model_id].points.size()) {
+		std::cout << "[ERROR] - CPFMatchingExpGPU: model " << model_id << " has " << model.numCurvatures() << " curvatures for " << m_ref[model_id].points.size() << " points." << std::endl;
+		return false;
+	}
+
+	return CPFModelDatabase::Write(path, m_ref_labels[model_id], m_ref[model_id], model.curvatures(), model.descriptors(), model.size(), getDBParams());
+}
+
+
+/*
+Load a model from a binary model database file.
+*/
+int CPFMatchingExpGPU::loadModel(std::string path)
+{
+	// the model keeps the file mapped and matches against the mapped descriptors
+	std::shared_ptr<CPFModelDatabase> db = std::make_shared<CPFModelDatabase>();
+	if (!db->open(path)) {
+		return -1;
+	}
+
+	std::string label = db->label();
+	PointCloud points;
+	db->getPointCloud(points);
+
+	if (!db->paramsMatch(getDBParams())) {
+		if (m_verbose) {
+			std::cout << "[INFO] - CPFMatchingExpGPU: " << path << " was created with different parameters. Extracting descriptors again." << std::endl;
+		}
+		return addModel(points, label);
+	}
+
+	if (points.size() == 0) return -1;
+
 	if (m_verbose) {
-		std::cout << "[INFO] - CPFMatchingExpGPU: finished extraction of " << descriptors.size() << " descriptors for  " << label << "." << std::endl;
+		std::cout << "[INFO] - CPFMatchingExpGPU: loaded " << db->numDescriptors() << " descriptors for " << label << " from " << path << "." << std::endl;
 	}
 
-	return m_model_descriptors.size() - 1;
+	CPFModelData model;
+	model.assign(db);
+	return storeModel(points, label, model);
+}
+
+
+/*
+Return the parameters that affect the descriptor extraction.
+*/
+CPFModelDBParams CPFMatchingExpGPU::getDBParams(void)
+{
+	CPFModelDBParams p;
+	p.search_radius = m_params.search_radius;
+	p.angle_step = m_params.angle_step;
+	p.multiplier = m_multiplier;
+	p.angle_bins = m_angle_bins;
+	p.max_neighbors = KNN_MATCHES_LENGTH; // the gpu descriptors use the MyMatches of the radius search
+	return p;
 }
 
 
@@ -119,6 +199,8 @@ Detect all reference point in the camera point set.
 */
 bool CPFMatchingExpGPU::match(int model_id)
 {
+	TX_PROFILE_SCOPE("cpf_match");
+
 	if (model_id < 0 || model_id >= m_ref.size()) {
 		std::cout << "[ERROR] - Selected model id " << model_id << " for matching does not exist.";
 		return false;
@@ -134,7 +216,7 @@ bool CPFMatchingExpGPU::match(int model_id)
 	}
 
 	// matching and voting
-	matchDescriptors(m_model_descriptors[model_id], m_scene_descriptors, m_ref[model_id], m_scene, m_matching_results[model_id]);
+	matchDescriptors(m_models[model_id], m_scene_descriptors, m_ref[model_id], m_scene, m_matching_results[model_id]);
 
 	// cluster the poses
 	bool ret = clustering(m_matching_results[model_id]);
@@ -190,6 +272,8 @@ bool CPFMatchingExpGPU::setParams(CPFParams params)
 // Descriptor based on curvature pairs and the direction vector
 void CPFMatchingExpGPU::calculateDescriptors(PointCloud& pc, float radius, std::vector<CPFDiscreet>& descriptors, std::vector<uint32_t>& curvatures)
 {
+	TX_PROFILE_SCOPE("cpf_descriptors");
+
 	CPFToolsGPU::CPFParamGPU param;
 	param.angle_bins = m_angle_bins;
 	CPFToolsGPU::SetParam(param);
@@ -201,7 +285,8 @@ void CPFMatchingExpGPU::calculateDescriptors(PointCloud& pc, float radius, std::
 	size_t s = pc.size();
 
 
-	m_knn->populate(pc);
+	// reuse the kd-tree if the model or scene was indexed before
+	m_knn->populateCached(PointView(pc.points));
 
 	matches.clear();
 
@@ -232,9 +317,11 @@ void CPFMatchingExpGPU::calculateDescriptors(PointCloud& pc, float radius, std::
 /*
 Match the model and scene descriptors.
 */
-void CPFMatchingExpGPU::matchDescriptors(std::vector<CPFDiscreet>& src_model, std::vector<CPFDiscreet>& src_scene, PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data)
+void CPFMatchingExpGPU::matchDescriptors(const CPFModelData& src_model, std::vector<CPFDiscreet>& src_scene, PointCloud& pc_model, PointCloud& pc_scene, CPFMatchingData& dst_data)
 
 {
+	TX_PROFILE_SCOPE("cpf_voting");
+
 	if (m_verbose && m_verbose_level == 2) {
 		std::cout << "[INFO] - CPFMatchingExpGPU: Start matching descriptors." << std::endl;
 	}
@@ -365,6 +452,8 @@ void CPFMatchingExpGPU::matchDescriptors(std::vector<CPFDiscreet>& src_model, st
 
 bool CPFMatchingExpGPU::clustering(CPFMatchingData& data)
 {
+	TX_PROFILE_SCOPE("cpf_clustering");
+
 
 	if (data.pose_candidates.size() == 0) {
 		if (m_verbose) {
@@ -563,7 +652,8 @@ int CPFMatchingExpGPU::getNumPoseClusters(int model_id)
 
 bool CPFMatchingExpGPU::getModelCurvature(const int model_id, std::vector<uint32_t>& model_cu)
 {
-	model_cu = m_model_curvatures[model_id];
+	const CPFModelData& model = m_models[model_id];
+	model_cu.assign(model.curvatures(), model.curvatures() + model.numCurvatures());
 	return true;
 }
 
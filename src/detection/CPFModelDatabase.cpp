@@ -0,0 +1,329 @@
+#include "CPFModelDatabase.h"
+
+#include <fstream>
+#include <cstring>
+
+using namespace texpert;
+
+
+namespace nsCPFModelDatabase
+{
+	const char		magic[8] = { 'T', 'X', 'C', 'P', 'F', 'D', 'B', '\0' };
+	const uint32_t	endian = 0x01020304;
+	const uint64_t	alignment = 16;
+
+	// the points are stored as packed float triplets
+	static_assert(sizeof(Eigen::Vector3f) == 3 * sizeof(float), "Eigen::Vector3f must be packed.");
+
+	// round up to the section alignment
+	inline uint64_t Align(uint64_t offset)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	// write zero bytes until the stream reaches offset
+	void Pad(std::ofstream& out, uint64_t offset)
+	{
+		static const char zeros[alignment] = { 0 };
+		uint64_t pos = static_cast<uint64_t>(out.tellp());
+		if (offset > pos) out.write(zeros, static_cast<std::streamsize>(offset - pos));
+	}
+
+	// check that a section is within the file
+	inline bool InFile(uint64_t offset, uint64_t bytes, uint64_t file_size)
+	{
+		return offset <= file_size && bytes <= file_size - offset && offset % alignment == 0;
+	}
+}
+
+using namespace nsCPFModelDatabase;
+
+
+
+CPFModelDatabase::CPFModelDatabase()
+{
+	_valid = false;
+	_header = CPFModelDBHeader();
+}
+
+
+CPFModelDatabase::~CPFModelDatabase()
+{
+	close();
+}
+
+
+/*
+Write a model to a file.
+*/
+//static
+bool CPFModelDatabase::Write(const std::string& path, const std::string& label, PointCloud& pc, const std::vector<uint32_t>& curvatures,
+							 const std::vector<CPFDiscreet>& descriptors, const CPFModelDBParams& params)
+{
+	if (curvatures.size() != pc.points.size()) {
+		std::cout << "[ERROR] - CPFModelDatabase: points and curvatures must have the same size (" << pc.points.size() << ", " <<
+			curvatures.size() << ")." << std::endl;
+		return false;
+	}
+
+	return Write(path, label, pc, curvatures.data(), descriptors.data(), descriptors.size(), params);
+}
+
+
+/*
+Write a model to a file.
+*/
+//static
+bool CPFModelDatabase::Write(const std::string& path, const std::string& label, PointCloud& pc, const uint32_t* curvatures,
+							 const CPFDiscreet* descriptors, size_t num_descriptors, const CPFModelDBParams& params)
+{
+	uint32_t N = static_cast<uint32_t>(pc.points.size());
+
+	if (pc.normals.size() != N) {
+		std::cout << "[ERROR] - CPFModelDatabase: points and normals must have the same size (" << N << ", " <<
+			pc.normals.size() << ")." << std::endl;
+		return false;
+	}
+
+	CPFModelDBHeader h{};
+	std::memcpy(h.magic, magic, sizeof(magic));
+	h.version = CPF_MODEL_DB_VERSION;
+	h.header_size = sizeof(CPFModelDBHeader);
+	h.endian = endian;
+	h.label_size = static_cast<uint32_t>(label.size());
+	h.params = params;
+	h.num_points = N;
+	h.num_descriptors = num_descriptors;
+
+	h.label_offset = Align(sizeof(CPFModelDBHeader));
+	h.points_offset = Align(h.label_offset + h.label_size);
+	h.normals_offset = Align(h.points_offset + uint64_t(N) * 3 * sizeof(float));
+	h.curvatures_offset = Align(h.normals_offset + uint64_t(N) * 3 * sizeof(float));
+	h.descriptors_offset = Align(h.curvatures_offset + uint64_t(N) * sizeof(uint32_t));
+	h.file_size = h.descriptors_offset + h.num_descriptors * sizeof(CPFDiscreet);
+
+	std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		std::cout << "[ERROR] - CPFModelDatabase: cannot open file " << path << " for writing." << std::endl;
+		return false;
+	}
+
+	out.write(reinterpret_cast<const char*>(&h), sizeof(CPFModelDBHeader));
+
+	Pad(out, h.label_offset);
+	out.write(label.data(), h.label_size);
+
+	Pad(out, h.points_offset);
+	if (N > 0) out.write(reinterpret_cast<const char*>(pc.points.data()), uint64_t(N) * 3 * sizeof(float));
+
+	Pad(out, h.normals_offset);
+	if (N > 0) out.write(reinterpret_cast<const char*>(pc.normals.data()), uint64_t(N) * 3 * sizeof(float));
+
+	Pad(out, h.curvatures_offset);
+	if (N > 0) out.write(reinterpret_cast<const char*>(curvatures), uint64_t(N) * sizeof(uint32_t));
+
+	Pad(out, h.descriptors_offset);
+	if (h.num_descriptors > 0) out.write(reinterpret_cast<const char*>(descriptors), h.num_descriptors * sizeof(CPFDiscreet));
+
+	bool ok = out.good();
+	out.close();
+
+	if (!ok) {
+		std::cout << "[ERROR] - CPFModelDatabase: failed to write file " << path << "." << std::endl;
+	}
+	return ok;
+}
+
+
+/*
+Read a model from a file into the given containers.
+*/
+//static
+CPFModelDBStatus CPFModelDatabase::Read(const std::string& path, const CPFModelDBParams& params, std::string& label, PointCloud& pc,
+										std::vector<uint32_t>& curvatures, std::vector<CPFDiscreet>& descriptors)
+{
+	CPFModelDatabase db;
+	if (!db.open(path)) return CPF_DB_ERROR;
+
+	int N = db.numPoints();
+
+	label = db.label();
+	db.getPointCloud(pc);
+
+	if (!db.paramsMatch(params)) {
+		curvatures.clear();
+		descriptors.clear();
+		return CPF_DB_PARAMS_MISMATCH;
+	}
+
+	curvatures.assign(db.curvatures(), db.curvatures() + N);
+	descriptors.assign(db.descriptors(), db.descriptors() + db.numDescriptors());
+
+	return CPF_DB_OK;
+}
+
+
+/*
+Map a database file into memory and validate it.
+*/
+bool CPFModelDatabase::open(const std::string& path)
+{
+	close();
+
+	if (!_file.open(path)) return false;
+
+	uint64_t size = _file.size();
+
+	if (size < sizeof(CPFModelDBHeader)) {
+		std::cout << "[ERROR] - CPFModelDatabase: file " << path << " is too small." << std::endl;
+		close();
+		return false;
+	}
+
+	std::memcpy(&_header, _file.data(), sizeof(CPFModelDBHeader));
+
+	if (std::memcmp(_header.magic, magic, sizeof(magic)) != 0) {
+		std::cout << "[ERROR] - CPFModelDatabase: file " << path << " is not a model database." << std::endl;
+		close();
+		return false;
+	}
+
+	if (_header.version != CPF_MODEL_DB_VERSION || _header.header_size != sizeof(CPFModelDBHeader) || _header.endian != endian) {
+		std::cout << "[ERROR] - CPFModelDatabase: file " << path << " has version " << _header.version << ", expected " << CPF_MODEL_DB_VERSION <<
+			". Please re-create the database." << std::endl;
+		close();
+		return false;
+	}
+
+	uint64_t N = _header.num_points;
+	if (_header.file_size > size ||
+		!InFile(_header.label_offset, _header.label_size, size) ||
+		!InFile(_header.points_offset, N * 3 * sizeof(float), size) ||
+		!InFile(_header.normals_offset, N * 3 * sizeof(float), size) ||
+		!InFile(_header.curvatures_offset, N * sizeof(uint32_t), size) ||
+		_header.num_descriptors > size / sizeof(CPFDiscreet) ||
+		!InFile(_header.descriptors_offset, _header.num_descriptors * sizeof(CPFDiscreet), size)) {
+		std::cout << "[ERROR] - CPFModelDatabase: file " << path << " is corrupt." << std::endl;
+		close();
+		return false;
+	}
+
+	_valid = true;
+	return true;
+}
+
+
+void CPFModelDatabase::close(void)
+{
+	_file.close();
+	_valid = false;
+	_header = CPFModelDBHeader();
+}
+
+
+bool CPFModelDatabase::paramsMatch(const CPFModelDBParams& params) const
+{
+	return _valid && _header.params == params;
+}
+
+
+/*
+Copy the points and normals of the mapped file into a point cloud.
+*/
+void CPFModelDatabase::getPointCloud(PointCloud& pc) const
+{
+	int N = _valid ? numPoints() : 0;
+
+	pc.points.resize(N);
+	pc.normals.resize(N);
+	if (N > 0) {
+		const float* p = points();
+		const float* n = normals();
+		for (int i = 0; i < N; i++) {
+			pc.points[i] = Eigen::Map<const Eigen::Vector3f>(p + 3 * i);
+			pc.normals[i] = Eigen::Map<const Eigen::Vector3f>(n + 3 * i);
+		}
+	}
+	pc.size();
+}
+
+
+const CPFModelDBHeader& CPFModelDatabase::header(void) const
+{
+	return _header;
+}
+
+
+std::string CPFModelDatabase::label(void) const
+{
+	if (!_valid) return "";
+	return std::string(_file.data() + _header.label_offset, _header.label_size);
+}
+
+
+int CPFModelDatabase::numPoints(void) const
+{
+	return static_cast<int>(_header.num_points);
+}
+
+
+size_t CPFModelDatabase::numDescriptors(void) const
+{
+	return static_cast<size_t>(_header.num_descriptors);
+}
+
+
+const float* CPFModelDatabase::points(void) const
+{
+	if (!_valid) return NULL;
+	return reinterpret_cast<const float*>(_file.data() + _header.points_offset);
+}
+
+
+const float* CPFModelDatabase::normals(void) const
+{
+	if (!_valid) return NULL;
+	return reinterpret_cast<const float*>(_file.data() + _header.normals_offset);
+}
+
+
+const uint32_t* CPFModelDatabase::curvatures(void) const
+{
+	if (!_valid) return NULL;
+	return reinterpret_cast<const uint32_t*>(_file.data() + _header.curvatures_offset);
+}
+
+
+const CPFDiscreet* CPFModelDatabase::descriptors(void) const
+{
+	if (!_valid) return NULL;
+	return reinterpret_cast<const CPFDiscreet*>(_file.data() + _header.descriptors_offset);
+}
+
+
+
+//-----------------------------------------------------------------------------------------------------
+// CPFModelData
+
+/*
+Take the extracted descriptors and curvatures.
+*/
+void CPFModelData::assign(std::vector<CPFDiscreet>& descriptors, std::vector<uint32_t>& curvatures)
+{
+	_db.reset();
+	_descriptors.clear();
+	_curvatures.clear();
+	_descriptors.swap(descriptors);
+	_curvatures.swap(curvatures);
+}
+
+
+/*
+Use the descriptors and curvatures of an open database file without copying them.
+*/
+void CPFModelData::assign(std::shared_ptr<CPFModelDatabase> db)
+{
+	_descriptors.clear();
+	_curvatures.clear();
+	_db = db;
+}
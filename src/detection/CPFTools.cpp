@@ -4,7 +4,9 @@
 
 namespace nsCPFTools {
 
-	int angle_bins = 12;
+	// default context for the functions without context parameter. 
+	// thread-local, so that concurrent callers do not interfere. 
+	thread_local CPFTools::CPFContext default_context;
 
 }
 
@@ -71,47 +73,80 @@ uint32_t CPFTools::DiscretizeCurvature(const Eigen::Vector3f& p1, const Eigen::V
 }
 
 
-float max_ang_value = 0.0;
-float min_ang_value = 10000000.0;
+uint32_t CPFTools::DiscretizeCurvature(const Eigen::Vector3f& p1, const Eigen::Vector3f& n1, const PointCloud& pc, const KNNResults& results, const int index, const float range)
+{
+	int count = 0;
+	float angle_global = 0;
+	for (int j = results.begin(index); j < results.end(index); j++) {
+		if (results.distances[j] > 0.0f) {
+			angle_global += AngleBetween(n1, pc.normals[results.indices[j]]) * range;
+			count++;
+		}
+	}
+
+	if (count == 0) return 0;
+
+	return static_cast<uint32_t>(angle_global / count);
+}
+
 
 //static 
-CPFDiscreet CPFTools::DiscretizeCPF(const std::uint32_t& c0, const std::uint32_t& c1, const Eigen::Vector3f& p0, const Eigen::Vector3f& p1)
+CPFDiscreet CPFTools::DiscretizeCPF(CPFContext& ctx, const std::uint32_t& c0, const std::uint32_t& c1, const Eigen::Vector3f& p0, const Eigen::Vector3f& p1)
 {
 	CPFDiscreet cpf;
-	Eigen::Vector3f p01;
 	float ang =  p0.normalized().dot(p1.normalized()); // [-1,1]
-	float ang_deg =  (ang +M_PI);
 	cpf[0] = c0;
 	cpf[1] = c1;
-	cpf[2] = ((ang +1) * angle_bins/2.0 );
+	cpf[2] = ((ang +1) * ctx.angle_bins/2.0 );
 	cpf[3] = 0;//c0-c1;
 
-	if(ang > max_ang_value)
-		max_ang_value = ang;
-	if(ang < min_ang_value)
-		min_ang_value = ang;
+	if(ang > ctx.max_ang_value)
+		ctx.max_ang_value = ang;
+	if(ang < ctx.min_ang_value)
+		ctx.min_ang_value = ang;
 
 	return cpf;
 }
 
 
+//static 
+void CPFTools::GetMaxMinAng(const CPFContext& ctx, float& max, float& min)
+{
+	max = ctx.max_ang_value;
+	min = ctx.min_ang_value;
+}
+
+
+//static 
+void CPFTools::Reset(CPFContext& ctx)
+{
+	ctx.max_ang_value = 0.0;
+	ctx.min_ang_value = 10000000.0;
+}
+
+
+//static 
+CPFDiscreet CPFTools::DiscretizeCPF(const std::uint32_t& c0, const std::uint32_t& c1, const Eigen::Vector3f& p0, const Eigen::Vector3f& p1)
+{
+	return DiscretizeCPF(default_context, c0, c1, p0, p1);
+}
+
+
 //static 
 void CPFTools::GetMaxMinAng(float& max, float& min)
 {
-	max = max_ang_value;
-	min = min_ang_value;
+	GetMaxMinAng(default_context, max, min);
 }
 
 //static 
 void CPFTools::Reset(void)
 {
-	max_ang_value = 0.0;
-	min_ang_value = 10000000.0;
+	Reset(default_context);
 }
 
 
 //static 
 void CPFTools::SetParam(CPFParam& param)
 {
-	angle_bins = param.angle_bins;
+	default_context.angle_bins = param.angle_bins;
 }
\ No newline at end of file
@@ -9,6 +9,9 @@ FDClustering::FDClustering()
 	_translation_threshold = 0.05f;
 	_rotation_threshold = 0.2f;
 	_invert = false;
+
+	_clustering.setTranslationThreshold(_translation_threshold);
+	_clustering.setRotationThreshold(_rotation_threshold);
 }
 
 
@@ -28,34 +31,28 @@ bool FDClustering::clusterPoses(const std::vector<Pose>& poses, vector<Pose>& po
 	_temp_cluster_votes.clear();
 	_temp_clustered_poses.clear();
 
-	std::vector<Pose>::const_iterator itr = poses.begin();
-	while (itr != poses.end()) {
-
-		bool cluster_found = false;
-
-		int cluster_count = 0;
-		// check whether the new pose fits into an existing cluster
-		for_each(_temp_clustered_poses.begin(), _temp_clustered_poses.end(), [&](std::vector<Pose>& cluster) {
-			if (similar((*itr).t, cluster.front().t)) {
-				cluster_found = true;
-				cluster.push_back(((*itr)));
-				_temp_cluster_votes[cluster_count].first += (*itr).votes; // count the number of votes
-				//_temp_cluster_votes[cluster_count].second++; // count the number of poses
-			}
-			cluster_count++;
-		});
-
-		// create a new cluster 
-		if (!cluster_found) {
-			std::vector<Pose> cluster;
-			cluster.push_back((*itr));
-			_temp_clustered_poses.push_back(cluster);
-			_temp_cluster_votes.push_back(make_pair((*itr).votes, cluster_index));
-			cluster_index++;
-		}
+	if (poses.size() == 0) return false;
+
+	// Group the poses. Each pose joins all clusters with a similar first pose. 
+	_temp_transformations.resize(poses.size());
+	_temp_votes.resize(poses.size());
+	for (size_t i = 0; i < poses.size(); i++) {
+		_temp_transformations[i] = poses[i].t;
+		_temp_votes[i] = poses[i].votes;
+	}
 
+	std::vector< std::vector<int> > members;
+	std::vector<int> cluster_votes;
+	int num_clusters = _clustering.cluster(_temp_transformations, _temp_votes, members, cluster_votes);
 
-		itr++;
+	for (cluster_index = 0; cluster_index < num_clusters; cluster_index++) {
+		std::vector<Pose> cluster;
+		cluster.reserve(members[cluster_index].size());
+		for (size_t k = 0; k < members[cluster_index].size(); k++) {
+			cluster.push_back(poses[members[cluster_index][k]]);
+		}
+		_temp_clustered_poses.push_back(cluster);
+		_temp_cluster_votes.push_back(make_pair(cluster_votes[cluster_index], cluster_index)); // count the number of votes
 	}
 
 	// sort the cluster
@@ -99,23 +96,11 @@ bool FDClustering::clusterPoses(const std::vector<Pose>& poses, vector<Pose>& po
 }
 
 
-bool FDClustering::similar(Eigen::Affine3f a, Eigen::Affine3f b)
-{
-	// distance between the two positions. 
-	float delta_t = (a.translation() - b.translation()).norm();
-
-	// angle delta
-	Eigen::AngleAxisf aa(a.rotation().inverse() * b.rotation());
-	float delta_r = fabsf(aa.angle());
-
-	return delta_t < _translation_threshold && delta_r < _rotation_threshold;
-}
-
-
 void FDClustering::setTranslationThreshold(float value)
 {
 	if (value > 0) {
 		_translation_threshold = value;
+		_clustering.setTranslationThreshold(_translation_threshold);
 	}
 }
 
@@ -123,6 +108,7 @@ void FDClustering::setRotationThreshold(float value)
 {
 	if (value > 0) {
 		_rotation_threshold = value / 180.0f * 3.14159265359f;
+		_clustering.setRotationThreshold(_rotation_threshold);
 	}
 }
 
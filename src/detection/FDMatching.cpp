@@ -1,19 +1,69 @@
 #include "FDMatching.h"
+#include "Profiler.h"
+
+#include <climits>
+#include <algorithm>
 
 
 using namespace texpert;
 
 #define M_PI 3.14159265359
 
+
+namespace nsFDMatching
+{
+	// min. number of model points per thread for the feature extraction
+	const int min_extract_chunk = 16;
+
+	// min. number of scene points per thread for the voting
+	const int min_detect_chunk = 64;
+
+	// number of model points per radius search in the distance-bounded extraction
+	const int extract_block = 4096;
+
+
+	// the pairs of one chunk of model points in the distance-bounded extraction
+	typedef struct _ExtractChunk
+	{
+		std::vector<std::uint64_t>	keys;
+		std::vector<VotePair>		pairs;
+		std::vector<int>			neighbors;
+	}ExtractChunk;
+}
+
+using namespace nsFDMatching;
+
+
+/*
+Compute the table key and the vote pair of the model point pair (p0, p1).
+*/
+inline void FDMatching::PairFeature(const Eigen::Vector3f& p0, const Eigen::Vector3f& n0, const Eigen::Affine3f& T,
+	const Eigen::Vector3f& p1, const Eigen::Vector3f& n1, int point_index, std::uint64_t& key, VotePair& vote_pair) const
+{
+	PPFDiscreet ppf = FDTools::DiscretizePPF(p0, n0, p1, n1, _distance_step, _angle_step);
+
+	// Move the point p1 into the coordinate frame of the point p0
+	Eigen::Vector3f pt = T * p1;
+
+	// get the angle
+	// The point p0 is in the frame orign. n is aligned with the x-axis. 
+	float alpha_m = atan2(-pt(2), pt(1));
+
+	key = PPFTable::Key(ppf);
+	vote_pair = VotePair(point_index, alpha_m);
+}
+
 FDMatching::FDMatching()
 {
-	_kdtree = NULL;
+	_knn = NULL;
 	_points_test = NULL;
 	_normals_test = NULL;
 	_N = 0;
 	_k = KNN_MATCHES_LENGTH-1;
 	
 	_verbose = false;
+	_num_threads = ParallelUtils::NumThreads();
+	_max_pair_distance = 0.0f;
 
 	_distance_step = 0.01;
 	_angle_step = 12.0 / 180.0f * static_cast<float>(M_PI);
@@ -23,7 +73,7 @@ FDMatching::FDMatching()
 
 FDMatching::~FDMatching()
 {
-
+	delete _knn;
 
 }
 
@@ -71,6 +121,7 @@ Extract the ppf features from points and normal vectors
 */
 bool FDMatching::extract_feature_map(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>* normals)
 {
+	TX_PROFILE_SCOPE("fd_extract_feature_map");
 
 	//_distance_step = g_ppf_dist_step;
 	//_angle_step = g_ppf_ang_step / 180.0f * static_cast<float>(M_PI);
@@ -81,77 +132,166 @@ bool FDMatching::extract_feature_map(vector<Eigen::Vector3f>* points, vector<Eig
 
 	_map_test_points.clear();
 
+	// A max. distance that covers the entire model pairs all points. The loop over all points is faster in this case. 
+	bool bounded = false;
+	if (_max_pair_distance > 0.0f && _N > 0) {
+		Eigen::Vector3f min_p = (*points)[0];
+		Eigen::Vector3f max_p = (*points)[0];
+		for (int i = 1; i < _N; i++) {
+			min_p = min_p.cwiseMin((*points)[i]);
+			max_p = max_p.cwiseMax((*points)[i]);
+		}
+		bounded = _max_pair_distance < (max_p - min_p).norm();
+	}
+
+	if (!bounded && (long long)_N * (_N - 1) > INT_MAX) {
+		std::cout << "[ERROR] - FDMatching: too many model points (" << _N << ") to pair all points. Set a max. pair distance." << std::endl;
+		return false;
+	}
+
 
 	//int k = g_dlg_ppf_nn;
 
 	//------------------------------------------------------------------------------------------------------------
 	
-	// Pair all the points in the cloud
-	vector<Eigen::Vector3f>::iterator pItr = _points_test->begin();
-	vector<Eigen::Vector3f>::iterator nItr = _normals_test->begin();
+	if(_verbose)
+		_cprintf("\n[PPFExtTracking] - Start extracting descriptors.");
 
-	int counter = 0;
-	int counter2 = 0;
+	std::vector<std::uint64_t> keys;
+	std::vector<VotePair> pairs;
+
+	if (!bounded) {
+		// Pair all the points in the cloud. 
+		// Each point writes its N-1 pairs into its own range, so the entries keep the order of the serial loop. 
+		const int pairs_per_point = std::max(0, _N - 1);
+		keys.resize(_N * pairs_per_point);
+		pairs.resize(_N * pairs_per_point);
+
+		ParallelUtils::For(_N, _num_threads, [&](int thread_id, int begin, int end) {
+			for (int point_index = begin; point_index < end; point_index++)
+			{
+				// find the reference frame for this point
+				Eigen::Vector3f p0 = (*points)[point_index];
+				Eigen::Vector3f n0 = (*normals)[point_index];
+				Eigen::Affine3f T = FDTools::getRefFrame(p0, n0);
+
+				// link the first point with all other points in the scene
+				int dst = point_index * pairs_per_point;
+				for (int j = 0; j < _N; j++)
+				{
+					if (j == point_index) continue; // same point;
+
+					PairFeature(p0, n0, T, (*points)[j], (*normals)[j], point_index, keys[dst], pairs[dst]);
+					dst++;
+				}
+			}
+		}, min_extract_chunk);
+	}
+	else if (!extractBounded(points, normals, keys, pairs)) {
+		return false;
+	}
+
+	// sort the pairs into the flat table. 
+	_map_test_points.build(keys, pairs);
+
+	if (_map_test_points.numSkipped() > 0) {
+		std::cout << "[ERROR] - FDMatching: " << _map_test_points.numSkipped() << " features exceed the feature table range. Increase the distance step." << std::endl;
+	}
 
 	if(_verbose)
-		_cprintf("\n[PPFExtTracking] - Start extracting descriptors.");
+		_cprintf("\n[PPFExtTracking] - Descriptors for %d points extracted. \n", _N);
+	return true;
 
-	int point_index = 0;
-	while (pItr != points->end())
-	{
-		Eigen::Vector3f p0((*pItr)[0], (*pItr)[1], (*pItr)[2]);
-		Eigen::Vector3f n0((*nItr).x(), (*nItr).y(), (*nItr).z());
+}
 
-		// find the reference frame for this point
-		Eigen::Affine3f T = FDTools::getRefFrame(p0, n0);
 
-		// link the first point with all other points in the scene
-		vector<Eigen::Vector3f>::iterator pItr2 = points->begin();
-		vector<Eigen::Vector3f>::iterator nItr2 = normals->begin();
 
-		counter2 = 0;
-		while (pItr2 != points->end())
-		{
-			if (pItr == pItr2) {
-				counter2++;
-				pItr2++;
-				nItr2++;
-				continue; // same point;
-			}
+/*
+Pair each model point with the model points within the max. pair distance. 
+*/
+bool FDMatching::extractBounded(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>* normals,
+	std::vector<std::uint64_t>& keys, std::vector<VotePair>& pairs)
+{
+	// a grid with the pair distance as cell size finds the neighbors in the 3 x 3 x 3 cells around a point
+	Cpu_RadiusGrid grid;
+	grid.setNumThreads(_num_threads);
+	grid.initialize(PointView(*points), _max_pair_distance);
+
+	KNNResults neighbors;
+	std::vector<ExtractChunk> chunks;
+
+	// The model points are processed in blocks, so that the neighbor lists of all points are never in memory at once. 
+	for (int block = 0; block < _N; block += extract_block)
+	{
+		const int block_size = std::min(extract_block, _N - block);
+		grid.radius_search(PointView((*points)[block].data(), block_size, sizeof(Eigen::Vector3f)), neighbors, _max_pair_distance, 0);
 
-			Eigen::Vector3f p1((*pItr2)[0], (*pItr2)[1], (*pItr2)[2]);
-			Eigen::Vector3f n1((*nItr2).x(), (*nItr2).y(), (*nItr2).z());
+		const int num_chunks = ParallelUtils::NumChunks(block_size, _num_threads, min_extract_chunk);
+		if ((int)chunks.size() < num_chunks) chunks.resize(num_chunks);
 
-			PPFDiscreet ppf = FDTools::DiscretizePPF(p0, n0, p1, n1, _distance_step, _angle_step);
-			ppf.point_index = point_index;
+		// each thread collects the pairs of its points
+		ParallelUtils::For(block_size, _num_threads, [&](int thread_id, int begin, int end) {
+			ExtractChunk& c = chunks[thread_id];
+			c.keys.clear();
+			c.pairs.clear();
 
-			// Move the point p1 into the coordinate frame of the point p0
-			Eigen::Vector3f pt = T * p1;
+			for (int i = begin; i < end; i++)
+			{
+				const int point_index = block + i;
 
-			// get the angle
-			// The point p0 is in the frame orign. n is aligned with the x-axis. 
-			float alpha_m = atan2(-pt(2), pt(1));
+				// find the reference frame for this point
+				Eigen::Vector3f p0 = (*points)[point_index];
+				Eigen::Vector3f n0 = (*normals)[point_index];
+				Eigen::Affine3f T = FDTools::getRefFrame(p0, n0);
 
-			VotePair vp(point_index, alpha_m);
+				// visit the neighbors in index order, the order of the loop over all points
+				c.neighbors.assign(neighbors.indices.begin() + neighbors.begin(i), neighbors.indices.begin() + neighbors.end(i));
+				std::sort(c.neighbors.begin(), c.neighbors.end());
 
-			// Create the tuple for the map
-			_map_test_points.insert(make_pair(ppf, vp));
+				for (int j : c.neighbors)
+				{
+					if (j == point_index) continue; // same point;
 
-			counter2++;
-			pItr2++;
-			nItr2++;
+					c.keys.push_back(0);
+					c.pairs.push_back(VotePair());
+					PairFeature(p0, n0, T, (*points)[j], (*normals)[j], point_index, c.keys.back(), c.pairs.back());
+				}
+			}
+		}, min_extract_chunk);
+
+		// merge the partial lists in chunk order
+		long long total = (long long)keys.size();
+		for (int c = 0; c < num_chunks; c++) total += (long long)chunks[c].keys.size();
+		if (total > INT_MAX) {
+			std::cout << "[ERROR] - FDMatching: too many model point pairs (" << total << "). Reduce the max. pair distance." << std::endl;
+			keys.clear();
+			pairs.clear();
+			return false;
 		}
 
-		counter++;
-		pItr++;
-		nItr++;
-		point_index++;
+		for (int c = 0; c < num_chunks; c++) {
+			keys.insert(keys.end(), chunks[c].keys.begin(), chunks[c].keys.end());
+			pairs.insert(pairs.end(), chunks[c].pairs.begin(), chunks[c].pairs.end());
+		}
 	}
 
-	if(_verbose)
-		_cprintf("\n[PPFExtTracking] - Descriptors for %d points extracted. \n", counter);
 	return true;
+}
 
+
+/*
+Set the max. distance between two paired model points.
+*/
+bool FDMatching::setMaxPairDistance(float max_distance)
+{
+	if (max_distance < 0.0f) {
+		std::cout << "[ERROR] - FDMatching: the max. pair distance must be >= 0 (" << max_distance << ")." << std::endl;
+		return false;
+	}
+
+	_max_pair_distance = max_distance;
+
+	return true;
 }
 
 
@@ -170,6 +310,7 @@ Extract the ppf features from points and normal vectors
 */
 bool FDMatching::detect(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>* normals,  std::vector<Pose>& poses)
 {
+	TX_PROFILE_SCOPE("fd_detect");
 
 	//_distance_step = g_ppf_dist_step;
 	//_angle_step = g_ppf_ang_step / 180.0f * static_cast<float>(M_PI);
@@ -177,8 +318,6 @@ bool FDMatching::detect(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>
 
 	poses.clear();
 
-	std::vector<int> accumulator(_N * _angle_bins, 0);
-
 	//------------------------------------------------------------------------------------------------------------
 	// Principle curvatures
 
@@ -186,165 +325,133 @@ bool FDMatching::detect(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>
 
 	//------------------------------------------------------------------------------------------------------------
 	// Search knn
-	if (_kdtree == NULL) {
-		_kdtree = new Cuda_KdTree();
-	}
-	else {
-		_kdtree->resetDevTree();
-	}
-
-
-	vector< vector<int> > index_vector;
-	vector< vector<float> > distance_vector;
-	vector<Cuda_Point> data;
-
-	for (int i = 0; i < points->size(); i++)
-	{
-		Eigen::Vector3f p = (*points)[i];
-		data.push_back(Cuda_Point(p.x(), p.y(), p.z() ));
-		data[i]._id = i;
+	if (_knn == NULL) {
+		_knn = new KNN();
 	}
 
 	// search for nearest neighbors
 	// The function searches for k+1 because the first result is the  querry point itself. 
-	_kdtree->initialize(data);
-	vector<MyMatches> matches;
-	_kdtree->knn(data, matches, k+1);
+	// The kd-tree is only rebuilt if the points changed since the last call. 
+	PointView data(*points);
+	_knn->populateCached(data);
+	_knn->knn(data, k+1, _matches);
 
 
 	//------------------------------------------------------------------------------------------------------------
 	// Extract features and match 
 
-	// Pair all the points in the cloud
-	vector<Eigen::Vector3f>::iterator pItr = points->begin();
-	vector<Eigen::Vector3f>::iterator nItr = normals->begin();
-
-	int counter = 0;
-	int counter2 = 0;
+	const int num_points = (int)points->size();
 
 	if(_verbose)
 		_cprintf("\n[PPFExtTracking] - Start extracting descriptors.");
 
+	vector<Pose> poses_candidates(num_points);
 
-	vector<Pose> poses_candidates;
-
-	int overall_max_votes = 0;
-	int point_index = 0;
-	while (pItr != points->end())
-	{
-		Eigen::Vector3f p0((*pItr)[0], (*pItr)[1], (*pItr)[2]);
-		Eigen::Vector3f n0((*nItr).x(), (*nItr).y(), (*nItr).z());
+	// Each chunk votes into its own accumulator. The accumulator only stores the cells with votes, 
+	// so the search for the best cell and the reset cost O(votes). 
+	int chunks = ParallelUtils::NumChunks(num_points, _num_threads, min_detect_chunk);
+	if ((int)_accumulators.size() < chunks) _accumulators.resize(chunks);
 
-		// find the reference frame for this point
+	ParallelUtils::For(num_points, _num_threads, [&](int thread_id, int begin, int end) {
+		FDAccumulator& acc = _accumulators[thread_id];
+		acc.votes.setNumCells(_N * _angle_bins);
 
-		Affine3f T = FDTools::getRefFrame(p0, n0);
+		for (int point_index = begin; point_index < end; point_index++)
+		{
+			Eigen::Vector3f p0 = (*points)[point_index];
+			Eigen::Vector3f n0 = (*normals)[point_index];
 
-		// link the first point with all other points in the scene
-	//	vector<dPoint>::iterator pItr2 = points->begin();
-	//	vector<Vec3>::iterator nItr2 = normals->begin();
+			// find the reference frame for this point
+			Affine3f T = FDTools::getRefFrame(p0, n0);
 
+			// the features of all nearest neighbors
+			acc.keys.clear();
+			acc.alpha_s.clear();
+			for (int j = _matches.begin(point_index); j < _matches.end(point_index); j++)
+			{
+				int pidx = _matches.indices[j];
 
-		MyMatches m = matches[point_index];
-		
+				if (pidx == point_index) continue;
+				if (_matches.distances[j] == 0) continue;
 
-		// loop through all nearest neighbors
-		for (int j = 0; j < KNN_MATCHES_LENGTH; j++)
-		{
-			MyMatch n = m.matches[j];
-			
-			if (n.first == n.second) continue;
-			if (n.distance == 0) continue;
-			
-			int pidx = n.second;
-			Eigen::Vector3f p1((*points)[pidx].x(), (*points)[pidx].y(), (*points)[pidx].z());
-			Eigen::Vector3f n1((*normals)[pidx].x(), (*normals)[pidx].y(), (*normals)[pidx].z());
-
-			
-			PPFDiscreet ppf = FDTools::DiscretizePPF(p0, n0, p1, n1, _distance_step, _angle_step);
-			ppf.point_index = point_index;
-
-			// Compute the alpha_s angle
-
-			// Rotate the point
-			Eigen::Vector3f pt = T * p1;
-
-			// get the angle
-			float alpha_s = atan2(-pt(2), pt(1));
-
-			// get similar fieatures
-			auto similar_features = _map_test_points.equal_range(ppf);
-
-			// Accumulate the votes of similar features
-			std::for_each(
-				similar_features.first,
-				similar_features.second,
-				[&](const std::pair<PPFDiscreet, VotePair>& match)
-				{
-					int model_i = match.second.model_i;
-					float alpha_m = match.second.alpha_m;
+				const Eigen::Vector3f& p1 = (*points)[pidx];
+				const Eigen::Vector3f& n1 = (*normals)[pidx];
 
-					float alpha = alpha_m - alpha_s;
-					int alpha_bin = static_cast<int>(static_cast<float>(_angle_bins) * ((alpha + 2.0f * static_cast<float>(M_PI)) / (4.0f * static_cast<float>(M_PI))));
+				PPFDiscreet ppf = FDTools::DiscretizePPF(p0, n0, p1, n1, _distance_step, _angle_step);
 
-					// Count votes
-					accumulator[model_i * _angle_bins + alpha_bin]++;
-				}
-			);
+				// Compute the alpha_s angle
 
+				// Rotate the point
+				Eigen::Vector3f pt = T * p1;
 
-		}
+				// get the angle
+				acc.keys.push_back(PPFTable::Key(ppf));
+				acc.alpha_s.push_back(atan2(-pt(2), pt(1)));
+			}
 
-		//------------------------------------------------------------------------------------------------------------
-		// Look for the best vote
+			// get similar features, all lookups at once
+			const int num_keys = (int)acc.keys.size();
+			acc.begin.resize(num_keys);
+			acc.end.resize(num_keys);
+			_map_test_points.find(acc.keys.data(), num_keys, acc.begin.data(), acc.end.data());
 
+			// Accumulate the votes of similar features. 
+			// The best vote is the first cell with the max. number of votes, as for a scan over all cells. 
+			int max_votes = 0;
+			int max_votes_idx = 0;
 
-		int max_votes = 0;
-		int max_votes_idx = 0;
+			for (int j = 0; j < num_keys; j++)
+			{
+				const float alpha_s = acc.alpha_s[j];
 
-		for (int k = 0; k < accumulator.size(); k++) {
-			if (accumulator[k] > max_votes) {
-				max_votes = accumulator[k];
-				max_votes_idx = k;
-			}
-			accumulator[k] = 0; // Set it to zero for next iteration
-		}
+				for (int m = acc.begin[j]; m < acc.end[j]; m++)
+				{
+					const VotePair& match = _map_test_points.at(m);
 
-		int max_model_i = max_votes_idx / _angle_bins;
-		int max_alpha = max_votes_idx % _angle_bins;
-		
-		Eigen::Vector3f model_point((*_points_test)[max_model_i][0], (*_points_test)[max_model_i][1],(* _points_test)[max_model_i][2]);
-		Eigen::Vector3f model_normal((*_normals_test)[max_model_i].x(), (*_normals_test)[max_model_i].y(), (*_normals_test)[max_model_i].z());
+					float alpha = match.alpha_m - alpha_s;
+					int alpha_bin = static_cast<int>(static_cast<float>(_angle_bins) * ((alpha + 2.0f * static_cast<float>(M_PI)) / (4.0f * static_cast<float>(M_PI))));
 
-		Affine3f Tmg = FDTools::getRefFrame(model_point, model_normal);
+					// Count votes
+					int idx = match.model_i * _angle_bins + alpha_bin;
+					int v = acc.votes.add(idx);
 
-		float angle = (static_cast<float>(max_alpha) / static_cast<float>(_angle_bins)) * 4.0f * static_cast<float>(M_PI) - 2.0f * static_cast<float>(M_PI);
+					if (v > max_votes || (v == max_votes && idx < max_votes_idx)) {
+						max_votes = v;
+						max_votes_idx = idx;
+					}
+				}
+			}
 
-		Eigen::AngleAxisf rot(angle, Eigen::Vector3f::UnitX());
+			// Clear the votes for the next point
+			acc.votes.reset();
 
-		// Compose the transformations for the final pose
-		Eigen::Affine3f final_transformation(T.inverse() * rot * Tmg);
+			//------------------------------------------------------------------------------------------------------------
+			// The pose of the best vote
 
+			int max_model_i = max_votes_idx / _angle_bins;
+			int max_alpha = max_votes_idx % _angle_bins;
 
+			Eigen::Vector3f model_point = (*_points_test)[max_model_i];
+			Eigen::Vector3f model_normal = (*_normals_test)[max_model_i];
 
-		Pose pose;
-		pose.t = final_transformation;
-		pose.votes = max_votes;
-		pose.to_scene_idx = point_index;
-		pose.from_model_idx = max_model_i;
+			Affine3f Tmg = FDTools::getRefFrame(model_point, model_normal);
 
-		
-		//pose.t = pose.t.inverse();
+			float angle = (static_cast<float>(max_alpha) / static_cast<float>(_angle_bins)) * 4.0f * static_cast<float>(M_PI) - 2.0f * static_cast<float>(M_PI);
 
-		poses_candidates.push_back(pose);
+			Eigen::AngleAxisf rot(angle, Eigen::Vector3f::UnitX());
 
+			// Compose the transformations for the final pose
+			Eigen::Affine3f final_transformation(T.inverse() * rot * Tmg);
 
-	
+			Pose& pose = poses_candidates[point_index];
+			pose.t = final_transformation;
+			pose.votes = max_votes;
+			pose.to_scene_idx = point_index;
+			pose.from_model_idx = max_model_i;
 
-		counter++;
-		pItr++;
-		nItr++;
-		point_index++;
-	}
+			//pose.t = pose.t.inverse();
+		}
+	}, min_detect_chunk);
 
 
 	// sort all poses
@@ -357,7 +464,7 @@ bool FDMatching::detect(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>
 
 
 	if (_verbose) {
-		_cprintf("\n[PPFExtTracking] - Descriptors for %d environment points extracted. ", counter);
+		_cprintf("\n[PPFExtTracking] - Descriptors for %d environment points extracted. ", num_points);
 		_cprintf("\n[PPFExtTracking] - Found  %d point to point relations.\n ", poses.size());
 	}
 
@@ -366,6 +473,16 @@ bool FDMatching::detect(vector<Eigen::Vector3f>* points, vector<Eigen::Vector3f>
 
 
 
+/*
+Set the number of threads for the feature extraction and the voting. 
+*/
+void FDMatching::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+	_map_test_points.setNumThreads(_num_threads);
+}
+
+
 /*
 Enable console outputs. 
 */
@@ -47,6 +47,11 @@ bool PCRegistratation::addReferenceObject(PointCloud& reference_point_cloud)
 	_reference_point_clouds.push_back(reference_point_cloud);
 	_rms_error.push_back(100000.0);
 
+	PoseTracker tracker;
+	tracker.setHealthThresholds(_params.tracking_max_rms, _params.tracking_min_inlier_fraction, _params.tracking_min_inlier_ratio);
+	tracker.setConstantVelocity(_params.tracking_constant_velocity);
+	_trackers.push_back(tracker);
+
 	// extract the feature map for this point cloud. 
 	bool ret = _fm->extract_feature_map(&reference_point_cloud.points, &reference_point_cloud.normals);
 
@@ -72,44 +77,70 @@ bool  PCRegistratation::process(PointCloud& camera_point_cloud)
 	// no data to match
 	if(_reference_point_clouds.size() <= 0) return false;
 
-	if(_rms_error[0] > 3.0){
+	_icp->setCameraData( camera_point_cloud);
+
+	// frame-to-frame tracking. Skip the feature matching if all objects are tracked. 
+	bool tracked = true;
+	for (size_t i = 0; i < _trackers.size() && tracked; i++) {
+		std::vector<Eigen::Affine3f> seeds;
+		tracked = _trackers[i].predict(seeds);
+		if (tracked) {
+			Pose p;
+			p.t = seeds[0];
+			_poses.push_back(p);
+		}
+	}
+
+	if (tracked) {
+		tracked = refinePoses();
+	}
+
+	if(!tracked){
+		_poses.clear();
+		_gl_poses.clear();
+
+		// the detection re-acquires all objects
+		for (PoseTracker& tracker : _trackers) tracker.reset();
 
 		// detect the object
 		ret = _fm->searchIn(&camera_point_cloud.points, &camera_point_cloud.normals, _poses);
 
 		cout << "[INFO] - Acquired new global pose " << endl;
-	
-		//--------- debug -- /
-	}else{
-		Pose p;
-		p.t = Matrix4f::Identity();
-		_poses.push_back(p);
+
+		refinePoses();
 	}
 
+	return ret;
+}
+
+
+/*
+Refine the poses with ICP and update the tracking states.
+*/
+bool PCRegistratation::refinePoses(void)
+{
+	bool healthy = true;
+
 	// -----------------------------------------
 	// Refine the pose for each object
-	int index = 0;
-	for(auto p : _poses){
+	for (size_t index = 0; index < _poses.size() && index < _reference_point_clouds.size(); index++) {
 		// final result
 		Eigen::Matrix4f mat;
 
-		// Set the camera data and run ICP with the initial pose
-		_icp->setCameraData( camera_point_cloud);
-		 bool has_pose = _icp->compute(_reference_point_clouds[index] , p, mat, _rms_error[index]);
+		// run ICP with the initial pose
+		bool has_pose = _icp->compute(_reference_point_clouds[index], _poses[index], mat, _rms_error[index]);
 
-		 if(has_pose){
-			 // get the pose and transform it into a opengl pose
-			_poses[index].t = mat;
+		if(has_pose){
+			// get the pose and transform it into a opengl pose
+			_poses[index].t = _icp->getPose();
 			glm::mat4 m = MatrixUtils::Affine3f2Mat4(_poses[index].t);
 			_gl_poses.push_back(m);
 		}
 
-		//MatrixUtils::PrintGlm4(m);
-		index++;
+		healthy = _trackers[index].update(has_pose, _poses[index].t.matrix(), _rms_error[index], _icp->getInlierFraction()) && healthy;
 	}
 
-
-	return ret;
+	return healthy;
 }
 
 
@@ -157,4 +188,9 @@ void PCRegistratation::setRegistrationParams(PCRegParams params)
 	_fm->setDistanceStep(_params.ppf_distance_step);
 	_fm->setClusteringThreshold(_params.ppf_cluster_distance_th,
 								_params.ppf_cluster_angle_th);
+
+	for (PoseTracker& tracker : _trackers) {
+		tracker.setHealthThresholds(_params.tracking_max_rms, _params.tracking_min_inlier_fraction, _params.tracking_min_inlier_ratio);
+		tracker.setConstantVelocity(_params.tracking_constant_velocity);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "PPFTable.h"
+
+#include <climits>
+
+
+using namespace texpert;
+
+
+namespace nsPPFTable
+{
+	// min. number of entries per thread
+	const int min_sort_chunk = 65536;
+
+	// radix sort digit width
+	const int digit_bits = 8;
+	const int num_buckets = 1 << digit_bits;
+
+	// min. size of the hash table
+	const int min_table_size = 64;
+}
+
+using namespace nsPPFTable;
+
+
+PPFTable::PPFTable()
+{
+	_mask = 0;
+	_skipped = 0;
+	_num_threads = ParallelUtils::NumThreads();
+}
+
+
+PPFTable::~PPFTable()
+{
+	clear();
+}
+
+
+/*!
+Create the table. Entries with an invalid key are skipped.
+*/
+void PPFTable::build(std::vector<std::uint64_t>& keys, std::vector<VotePair>& pairs)
+{
+	clear();
+
+	if (keys.size() != pairs.size()) {
+		std::cout << "[ERROR] - PPFTable: keys size != pairs size: " << keys.size() << " != " << pairs.size() << "." << std::endl;
+		return;
+	}
+	if (keys.size() > (size_t)INT_MAX) {
+		std::cout << "[ERROR] - PPFTable: too many entries (" << keys.size() << ")." << std::endl;
+		return;
+	}
+
+	const int n = (int)keys.size();
+	if (n == 0) return;
+
+	const int chunks = ParallelUtils::NumChunks(n, _num_threads, min_sort_chunk);
+
+	// the bits that differ between the keys. Digits without such bits are already sorted.
+	std::vector<std::uint64_t> chunk_or(chunks, 0);
+	std::vector<std::uint64_t> chunk_and(chunks, ~0ULL);
+	ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+		std::uint64_t o = 0, a = ~0ULL;
+		for (int i = begin; i < end; i++) {
+			o |= keys[i];
+			a &= keys[i];
+		}
+		chunk_or[thread_id] = o;
+		chunk_and[thread_id] = a;
+	}, min_sort_chunk);
+
+	std::uint64_t key_or = 0, key_and = ~0ULL;
+	for (int c = 0; c < chunks; c++) {
+		key_or |= chunk_or[c];
+		key_and &= chunk_and[c];
+	}
+	const std::uint64_t diff = key_or ^ key_and;
+
+	// stable lsd radix sort of the keys and the pairs
+	std::vector<std::uint64_t> keys_tmp(n);
+	std::vector<VotePair> pairs_tmp(n);
+	std::vector<int> hist(chunks * num_buckets);
+
+	for (int shift = 0; shift < 64; shift += digit_bits) {
+		if (((diff >> shift) & (num_buckets - 1)) == 0) continue;
+
+		// count the digits per chunk
+		ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+			int* h = &hist[thread_id * num_buckets];
+			std::fill(h, h + num_buckets, 0);
+			for (int i = begin; i < end; i++) {
+				h[(keys[i] >> shift) & (num_buckets - 1)]++;
+			}
+		}, min_sort_chunk);
+
+		// the first location of each digit and chunk. Chunk order within a digit keeps the sort stable.
+		int offset = 0;
+		for (int d = 0; d < num_buckets; d++) {
+			for (int c = 0; c < chunks; c++) {
+				int count = hist[c * num_buckets + d];
+				hist[c * num_buckets + d] = offset;
+				offset += count;
+			}
+		}
+
+		ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+			int* h = &hist[thread_id * num_buckets];
+			for (int i = begin; i < end; i++) {
+				int dst = h[(keys[i] >> shift) & (num_buckets - 1)]++;
+				keys_tmp[dst] = keys[i];
+				pairs_tmp[dst] = pairs[i];
+			}
+		}, min_sort_chunk);
+
+		keys.swap(keys_tmp);
+		pairs.swap(pairs_tmp);
+	}
+	keys_tmp.clear();
+	keys_tmp.shrink_to_fit();
+	pairs_tmp.clear();
+	pairs_tmp.shrink_to_fit();
+
+	// the invalid keys are at the end
+	int valid = n;
+	while (valid > 0 && keys[valid - 1] == invalid_key) valid--;
+	_skipped = n - valid;
+
+	// the runs of equal keys
+	int num_runs = 0;
+	for (int i = 0; i < valid; i++) {
+		if (i == 0 || keys[i] != keys[i - 1]) num_runs++;
+	}
+
+	_start.resize(num_runs + 1);
+	std::vector<std::uint64_t> run_keys(num_runs);
+	int r = 0;
+	for (int i = 0; i < valid; i++) {
+		if (i == 0 || keys[i] != keys[i - 1]) {
+			run_keys[r] = keys[i];
+			_start[r++] = i;
+		}
+	}
+	_start[num_runs] = valid;
+
+	// the sorted pairs become the table
+	keys.clear();
+	keys.shrink_to_fit();
+	pairs.resize(valid);
+	pairs.shrink_to_fit();
+	_pairs.swap(pairs);
+	pairs.clear();
+
+	// the hash table is at most half full
+	int table_size = min_table_size;
+	while (table_size < 2 * num_runs && table_size < (1 << 30)) table_size <<= 1;
+	_mask = (std::uint64_t)table_size - 1;
+	_slots.assign(table_size, Slot{ 0, -1 });
+
+	for (int i = 0; i < num_runs; i++) {
+		std::uint64_t s = Mix(run_keys[i]) & _mask;
+		while (_slots[s].run >= 0) s = (s + 1) & _mask;
+		_slots[s].key = run_keys[i];
+		_slots[s].run = i;
+	}
+}
+
+
+/*!
+Find the runs of multiple keys.
+*/
+void PPFTable::find(const std::uint64_t* keys, const int n, int* begin, int* end) const
+{
+	for (int i = 0; i < n; i++) {
+		find(keys[i], begin[i], end[i]);
+	}
+}
+
+
+/*!
+Return the number of stored vote pairs.
+*/
+int PPFTable::size(void) const
+{
+	return (int)_pairs.size();
+}
+
+
+/*!
+Return the number of distinct keys.
+*/
+int PPFTable::numKeys(void) const
+{
+	return _start.empty() ? 0 : (int)_start.size() - 1;
+}
+
+
+/*!
+Return the number of entries that were skipped because of an invalid key.
+*/
+int PPFTable::numSkipped(void) const
+{
+	return _skipped;
+}
+
+
+/*!
+Clear the table.
+*/
+void PPFTable::clear(void)
+{
+	_pairs.clear();
+	_start.clear();
+	_slots.clear();
+	_mask = 0;
+	_skipped = 0;
+}
+
+
+/*!
+Set the number of threads for building the table.
+*/
+void PPFTable::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+}
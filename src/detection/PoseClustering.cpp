@@ -0,0 +1,132 @@
+#include "PoseClustering.h"
+
+
+using namespace texpert;
+
+
+namespace nsPoseClustering
+{
+	// bits per axis for the grid cell key
+	const int		key_bits = 21;
+	const int		key_offset = 1 << (key_bits - 1);
+	const std::uint64_t key_mask = (std::uint64_t(1) << key_bits) - 1;
+}
+
+using namespace nsPoseClustering;
+
+
+PoseClustering::PoseClustering()
+{
+	_translation_threshold = 0.03f;
+	_rotation_threshold = 0.0f;
+}
+
+
+PoseClustering::~PoseClustering()
+{
+
+}
+
+
+/*
+Cluster the poses.
+*/
+int PoseClustering::cluster(const std::vector<Eigen::Affine3f>& poses, const std::vector<int>& votes,
+							std::vector< std::vector<int> >& cluster_members, std::vector<int>& cluster_votes)
+{
+	cluster_members.clear();
+	cluster_votes.clear();
+
+	// the grid only contains the cells of this run
+	_grid.clear();
+
+	int size = (int)poses.size();
+
+	for (int i = 0; i < size; i++) {
+
+		const Eigen::Affine3f& pose = poses[i];
+		Eigen::Vector3f t = pose.translation();
+
+		bool cluster_found = false;
+
+		// check whether the new pose fits into an existing cluster.
+		// Similar seeds are in one of the 27 neighboring cells.
+		for (int dx = -1; dx <= 1; dx++) {
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dz = -1; dz <= 1; dz++) {
+
+					auto itr = _grid.find(cellKey(t, dx, dy, dz));
+					if (itr == _grid.end()) continue;
+
+					const std::vector<int>& seeds = itr->second;
+					for (size_t s = 0; s < seeds.size(); s++) {
+						int c = seeds[s];
+						if (similar(pose, poses[cluster_members[c].front()])) {
+							cluster_found = true;
+							cluster_members[c].push_back(i);
+							cluster_votes[c] += votes[i];
+						}
+					}
+				}
+			}
+		}
+
+		// create a new cluster
+		if (!cluster_found) {
+			int c = (int)cluster_members.size();
+			cluster_members.push_back(std::vector<int>(1, i));
+			cluster_votes.push_back(votes[i]);
+			_grid[cellKey(t, 0, 0, 0)].push_back(c);
+		}
+	}
+
+	return (int)cluster_members.size();
+}
+
+
+/*
+Test whether two poses are similar.
+*/
+bool PoseClustering::similar(const Eigen::Affine3f& a, const Eigen::Affine3f& b)
+{
+	// distance between the two positions.
+	float delta_t = (a.translation() - b.translation()).norm();
+	if (delta_t >= _translation_threshold) return false;
+
+	if (_rotation_threshold <= 0.0f) return true;
+
+	// angle delta
+	Eigen::AngleAxisf aa(a.linear().transpose() * b.linear());
+	float delta_r = fabsf(aa.angle());
+
+	return delta_r < _rotation_threshold;
+}
+
+
+/*
+Return the grid cell key for a translation and a cell offset.
+*/
+std::uint64_t PoseClustering::cellKey(const Eigen::Vector3f& t, int dx, int dy, int dz)
+{
+	std::int64_t x = (std::int64_t)std::floor(t.x() / _translation_threshold) + dx + key_offset;
+	std::int64_t y = (std::int64_t)std::floor(t.y() / _translation_threshold) + dy + key_offset;
+	std::int64_t z = (std::int64_t)std::floor(t.z() / _translation_threshold) + dz + key_offset;
+
+	return	((std::uint64_t)x & key_mask) |
+			(((std::uint64_t)y & key_mask) << key_bits) |
+			(((std::uint64_t)z & key_mask) << (2 * key_bits));
+}
+
+
+void PoseClustering::setTranslationThreshold(float value)
+{
+	if (value > 0) {
+		_translation_threshold = value;
+	}
+}
+
+
+void PoseClustering::setRotationThreshold(float value)
+{
+	_rotation_threshold = value;
+}
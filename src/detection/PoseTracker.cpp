@@ -0,0 +1,144 @@
+#include "PoseTracker.h"
+
+
+using namespace texpert;
+
+
+PoseTracker::PoseTracker()
+{
+	_max_rms = 0.01f;
+	_min_inlier_fraction = 0.3f;
+	_min_inlier_ratio = 0.5f;
+	_constant_velocity = true;
+	_verbose = false;
+
+	reset();
+}
+
+
+PoseTracker::~PoseTracker()
+{
+
+}
+
+
+/*
+Return the seed poses for ICP if the object is tracked.
+*/
+bool PoseTracker::predict(std::vector<Eigen::Affine3f>& seeds)
+{
+	seeds.clear();
+
+	if (_state != TRACKING) return false;
+
+	if (_constant_velocity && _has_velocity) {
+		// the motion between the last two frames, in camera coordinates
+		Eigen::Matrix4f D = _pose * _prev_pose.inverse();
+		seeds.push_back(Eigen::Affine3f(D * _pose));
+	}
+	seeds.push_back(Eigen::Affine3f(_pose));
+
+	return true;
+}
+
+
+/*
+Report the refined pose of the current frame.
+*/
+bool PoseTracker::update(bool converged, const Eigen::Matrix4f& pose, float rms, float inlier_fraction)
+{
+	bool healthy = converged && rms <= _max_rms && inlier_fraction >= _min_inlier_fraction;
+	if (_state == TRACKING) {
+		healthy = healthy && inlier_fraction >= _min_inlier_ratio * _reference_inliers;
+	}
+
+	if (!healthy) {
+		if (_verbose && _state == TRACKING) {
+			std::cout << "[INFO] - PoseTracker: lost the object after " << _tracked_frames << " frames (rms: " << rms << ", inliers: " << inlier_fraction << ")." << std::endl;
+		}
+		reset();
+		return false;
+	}
+
+	if (_state == TRACKING) {
+		_prev_pose = _pose;
+		_has_velocity = true;
+		_tracked_frames++;
+	}
+	else {
+		if (_verbose) {
+			std::cout << "[INFO] - PoseTracker: acquired the object (rms: " << rms << ", inliers: " << inlier_fraction << ")." << std::endl;
+		}
+		_state = TRACKING;
+		_reference_inliers = inlier_fraction;
+		_has_velocity = false;
+		_tracked_frames = 0;
+	}
+	_pose = pose;
+
+	return true;
+}
+
+
+/*
+Drop the lock. The next frame runs global detection.
+*/
+void PoseTracker::reset(void)
+{
+	_state = DETECTING;
+	_pose = Eigen::Matrix4f::Identity();
+	_prev_pose = Eigen::Matrix4f::Identity();
+	_has_velocity = false;
+	_reference_inliers = 0.0f;
+	_tracked_frames = 0;
+}
+
+
+/*
+Return the current state.
+*/
+PoseTracker::State PoseTracker::getState(void)
+{
+	return _state;
+}
+
+
+/*
+Return the number of frames tracked since the lock was acquired.
+*/
+int PoseTracker::getTrackedFrames(void)
+{
+	return _tracked_frames;
+}
+
+
+/*
+Set the health thresholds of a refined pose.
+*/
+void PoseTracker::setHealthThresholds(float max_rms, float min_inlier_fraction, float min_inlier_ratio)
+{
+	if (max_rms <= 0.0f || min_inlier_fraction < 0.0f || min_inlier_fraction > 1.0f || min_inlier_ratio < 0.0f || min_inlier_ratio > 1.0f) {
+		std::cout << "[ERROR] - PoseTracker: health thresholds out of range. Values clamped to max_rms > 0 and fractions in [0, 1]." << std::endl;
+	}
+	_max_rms = std::max(0.000001f, max_rms);
+	_min_inlier_fraction = std::min(1.0f, std::max(0.0f, min_inlier_fraction));
+	_min_inlier_ratio = std::min(1.0f, std::max(0.0f, min_inlier_ratio));
+}
+
+
+/*
+Enable the constant-velocity model to predict the pose of the next frame.
+*/
+void PoseTracker::setConstantVelocity(bool enable)
+{
+	_constant_velocity = enable;
+}
+
+
+/*
+Enable extra debug messages.
+*/
+void PoseTracker::setVerbose(bool verbose)
+{
+	_verbose = verbose;
+}
@@ -0,0 +1,83 @@
+#include "VoteAccumulator.h"
+
+
+using namespace texpert;
+
+
+namespace nsVoteAccumulator
+{
+	// initial number of table slots, a power of 2
+	const int min_table_size = 256;
+
+	// Max. number of cells with dense counters, 64 MB per accumulator. 
+	// The votes of one table run arrive in point order, so the dense counters are faster even if they do
+	// not fit into the cache. The sparse counters only bound the memory of very large models and scenes.
+	const int max_dense_cells = 1 << 24;
+}
+
+using namespace nsVoteAccumulator;
+
+
+VoteAccumulator::VoteAccumulator()
+{
+	_slots.assign(min_table_size, Slot{ -1, 0 });
+	_mask = min_table_size - 1;
+	_dense = false;
+}
+
+
+VoteAccumulator::~VoteAccumulator()
+{
+
+}
+
+
+/*!
+Remove all votes. Only the voted cells are cleared.
+*/
+void VoteAccumulator::reset(void)
+{
+	if (_dense) {
+		for (int c : _touched) _counts[c] = 0;
+	}
+	else {
+		for (int s : _touched) _slots[s].cell = -1;
+	}
+	_touched.clear();
+}
+
+
+/*!
+Set the number of cells and select the dense or sparse counters. Removes all votes.
+*/
+void VoteAccumulator::setNumCells(int num_cells)
+{
+	reset();
+
+	_dense = num_cells <= max_dense_cells;
+
+	// the counters are only grown. All counters are zero after reset().
+	if (_dense && (int)_counts.size() < num_cells) {
+		_counts.resize(num_cells, 0);
+	}
+}
+
+
+/*
+Double the table size and re-insert the voted cells in their order.
+*/
+void VoteAccumulator::grow(void)
+{
+	std::vector<Slot> old(_slots.size() * 2, Slot{ -1, 0 });
+	old.swap(_slots);
+	_mask = (std::uint32_t)_slots.size() - 1;
+
+	for (int k = 0; k < (int)_touched.size(); k++) {
+		const Slot& o = old[_touched[k]];
+
+		std::uint32_t s = Mix((std::uint32_t)o.cell) & _mask;
+		while (_slots[s].cell >= 0) s = (s + 1) & _mask;
+		_slots[s] = o;
+		_touched[k] = (int)s;
+	}
+}
@@ -0,0 +1,546 @@
+#include "Cpu_KdTree.h"
+
+using namespace texpert;
+
+
+namespace nsCpu_KdTree
+{
+	// min. number of search points per thread
+	const int min_query_chunk = 256;
+
+	// bounded, sorted list of the k closest points. The caller provides the memory for k points.
+	typedef struct _KBest
+	{
+		float*	dist;
+		int*	idx;
+		int		count;
+		int		k;
+		float	max_dist2;
+
+		// the current search distance
+		inline float bound(void) const
+		{
+			return (count < k) ? max_dist2 : dist[k - 1];
+		}
+
+		// insert the point at index i into the sorted list, if it is closer than the bound.
+		inline void insert(float d, int i)
+		{
+			if (count < k) {
+				if (d > max_dist2) return;
+				count++;
+			}
+			else if (d >= dist[k - 1]) {
+				return;
+			}
+
+			int j = count - 1;
+			while (j > 0 && dist[j - 1] > d) {
+				dist[j] = dist[j - 1];
+				idx[j] = idx[j - 1];
+				j--;
+			}
+			dist[j] = d;
+			idx[j] = i;
+		}
+	}KBest;
+
+
+	// unbounded list of all points within the search radius
+	typedef struct _RadiusList
+	{
+		std::vector<std::pair<float, int>>*	points;
+		float								max_dist2;
+
+		inline float bound(void) const
+		{
+			return max_dist2;
+		}
+
+		inline void insert(float d, int i)
+		{
+			if (d <= max_dist2) points->push_back(std::make_pair(d, i));
+		}
+	}RadiusList;
+
+}
+
+using namespace nsCpu_KdTree;
+
+
+Cpu_KdTree::Cpu_KdTree()
+{
+	_N = 0;
+	_depth = 0;
+	_num_threads = ParallelUtils::NumThreads();
+}
+
+
+Cpu_KdTree::~Cpu_KdTree()
+{
+	resetDevTree();
+}
+
+
+/**
+Create the kd-tree
+@param points, a vector with all points
+*/
+void Cpu_KdTree::initialize(std::vector<MyPoint>& points)
+{
+	build(PointView(points));
+
+	for (int i = 0; i < _N; i++) {
+		_ids[i] = points[_perm[i]]._id;
+	}
+	_perm.clear();
+}
+
+
+/**
+Create the kd-tree from a point view. The point ids are the indices in the view.
+*/
+void Cpu_KdTree::initialize(const PointView& points)
+{
+	build(points);
+
+	for (int i = 0; i < _N; i++) {
+		_ids[i] = _perm[i];
+	}
+	_perm.clear();
+}
+
+
+/*
+Build the tree nodes and copy the points into leaf order.
+*/
+void Cpu_KdTree::build(const PointView& points)
+{
+	resetDevTree();
+
+	_N = points.size();
+	if (_N == 0) return;
+
+	// depth so that each leaf keeps at most CPU_KD_LEAF_SIZE points
+	_depth = 0;
+	while ((_N >> _depth) > CPU_KD_LEAF_SIZE) _depth++;
+
+	_nodes.resize((size_t(1) << (_depth + 1)) - 1);
+	_perm.resize(_N);
+	for (int i = 0; i < _N; i++) _perm[i] = i;
+
+	_build_points = points;
+
+	// build the top levels serially, then the subtrees in parallel.
+	int stop_level = 0;
+	while ((1 << stop_level) < _num_threads && stop_level < _depth) stop_level++;
+
+	std::vector<int> tasks;
+	buildNode(0, 0, _N, 0, stop_level, &tasks);
+
+	ParallelUtils::For((int)tasks.size(), _num_threads, [&](int thread_id, int begin, int end) {
+		for (int t = begin; t < end; t++) {
+			CpuKdNode& n = _nodes[tasks[t]];
+			buildNode(tasks[t], n.begin, n.end, stop_level, -1, NULL);
+		}
+	});
+
+	// copy the points into leaf order
+	_x.resize(_N);
+	_y.resize(_N);
+	_z.resize(_N);
+	_ids.resize(_N);
+
+	ParallelUtils::For(_N, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			const float* p = _build_points[_perm[i]];
+			_x[i] = p[0];
+			_y[i] = p[1];
+			_z[i] = p[2];
+		}
+	}, min_query_chunk);
+
+	_build_points = PointView();
+}
+
+
+/*
+Recursively build the subtree for a node.
+*/
+void Cpu_KdTree::buildNode(int node, int begin, int end, int level, int stop_level, std::vector<int>* tasks)
+{
+	CpuKdNode& n = _nodes[node];
+	n.begin = begin;
+	n.end = end;
+	n.dim = -1;
+	n.split = 0.0f;
+
+	if (level == _depth) return; // leaf
+
+	if (level == stop_level && tasks != NULL) {
+		tasks->push_back(node);
+		return;
+	}
+
+	// find the widest dimension
+	float min_v[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float max_v[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int i = begin; i < end; i++) {
+		const float* p = _build_points[_perm[i]];
+		for (int d = 0; d < 3; d++) {
+			min_v[d] = std::min(min_v[d], p[d]);
+			max_v[d] = std::max(max_v[d], p[d]);
+		}
+	}
+
+	int dim = 0;
+	for (int d = 1; d < 3; d++) {
+		if (max_v[d] - min_v[d] > max_v[dim] - min_v[dim]) dim = d;
+	}
+
+	// median split
+	int mid = (begin + end) / 2;
+	const PointView& pts = _build_points;
+	std::nth_element(_perm.begin() + begin, _perm.begin() + mid, _perm.begin() + end,
+		[&pts, dim](int a, int b) { return pts[a][dim] < pts[b][dim]; });
+
+	n.dim = dim;
+	n.split = pts[_perm[mid]][dim];
+
+	buildNode(2 * node + 1, begin, mid, level + 1, stop_level, tasks);
+	buildNode(2 * node + 2, mid, end, level + 1, stop_level, tasks);
+}
+
+
+/**
+Clears the tree memory.
+*/
+bool Cpu_KdTree::resetDevTree(void)
+{
+	_nodes.clear();
+	_x.clear();
+	_y.clear();
+	_z.clear();
+	_ids.clear();
+	_perm.clear();
+	_N = 0;
+	_depth = 0;
+	return true;
+}
+
+
+/**
+Returns the number of points in this tree.
+*/
+int Cpu_KdTree::size(void)
+{
+	return _N;
+}
+
+
+/*
+Searches for k nearest neighbors.
+*/
+void Cpu_KdTree::knn(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int k)
+{
+	k = std::max(1, std::min(k, KNN_MATCHES_LENGTH));
+	search(search_points, output, k, FLT_MAX);
+}
+
+
+/*
+Searches for the points within a given radius.
+*/
+void Cpu_KdTree::radius_search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, double radius)
+{
+	search(search_points, output, KNN_MATCHES_LENGTH, (float)(radius * radius));
+}
+
+
+/*
+Searches for k nearest neighbors and returns variable-length results.
+*/
+void Cpu_KdTree::knn(std::vector<MyPoint>& search_points, KNNResults& output, int k)
+{
+	search(PointView(search_points), output, k, FLT_MAX, 0);
+}
+
+
+/*
+Searches for the points within a given radius and returns variable-length results.
+*/
+void Cpu_KdTree::radius_search(std::vector<MyPoint>& search_points, KNNResults& output, double radius, int max_neighbors)
+{
+	search(PointView(search_points), output, max_neighbors, (float)(radius * radius), 0);
+}
+
+
+/*
+Searches for k nearest neighbors of the points in a view.
+*/
+void Cpu_KdTree::knn(const PointView& search_points, KNNResults& output, int k, int max_leaves)
+{
+	search(search_points, output, k, FLT_MAX, max_leaves);
+}
+
+
+/*
+Searches for the points within a given radius of the points in a view.
+*/
+void Cpu_KdTree::radius_search(const PointView& search_points, KNNResults& output, double radius, int max_neighbors, int max_leaves)
+{
+	search(search_points, output, max_neighbors, (float)(radius * radius), max_leaves);
+}
+
+
+/*
+Run a query for all search points in parallel.
+*/
+void Cpu_KdTree::search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int k, float max_dist2)
+{
+	int n = (int)search_points.size();
+	output.clear();
+	output.resize(n);
+
+	if (_N == 0) {
+		std::cout << "[ERROR] - Cpu_KdTree: the tree is empty. Call initialize() first." << std::endl;
+		return;
+	}
+
+	ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			searchPoint(search_points[i]._data, k, max_dist2, i, output[i]);
+		}
+	}, min_query_chunk);
+}
+
+
+/*
+Traverse the tree for a single point.
+*/
+template<typename T>
+void Cpu_KdTree::traverse(const float* q, T& collector, int max_leaves)
+{
+	const float qx = q[0];
+	const float qy = q[1];
+	const float qz = q[2];
+
+	// explicit stack of (node, squared distance to the node's half space)
+	int		stack_node[64];
+	float	stack_dist[64];
+	int		top = 0;
+
+	stack_node[top] = 0;
+	stack_dist[top] = 0.0f;
+	top++;
+
+	float leaf_dist[2 * CPU_KD_LEAF_SIZE + 2];
+	int leaves = 0;
+
+	while (top > 0) {
+		top--;
+		int node = stack_node[top];
+		if (stack_dist[top] > collector.bound()) continue;
+
+		// descend to the leaf on the near side, push the far children.
+		while (_nodes[node].dim >= 0) {
+			const CpuKdNode& n = _nodes[node];
+			float diff = q[n.dim] - n.split;
+			int near_node = (diff < 0.0f) ? 2 * node + 1 : 2 * node + 2;
+			int far_node = (diff < 0.0f) ? 2 * node + 2 : 2 * node + 1;
+			float far_dist = diff * diff;
+
+			if (far_dist <= collector.bound()) {
+				assert(top < 64);
+				stack_node[top] = far_node;
+				stack_dist[top] = far_dist;
+				top++;
+			}
+			node = near_node;
+		}
+
+		// leaf scan. The distance loop is kept free of branches so the compiler can vectorize it.
+		const CpuKdNode& leaf = _nodes[node];
+		const int b = leaf.begin;
+		const int m = leaf.end - leaf.begin;
+		assert(m <= 2 * CPU_KD_LEAF_SIZE + 2);
+
+		const float* px = &_x[b];
+		const float* py = &_y[b];
+		const float* pz = &_z[b];
+		for (int i = 0; i < m; i++) {
+			float dx = px[i] - qx;
+			float dy = py[i] - qy;
+			float dz = pz[i] - qz;
+			leaf_dist[i] = dx * dx + dy * dy + dz * dz;
+		}
+
+		for (int i = 0; i < m; i++) {
+			collector.insert(leaf_dist[i], b + i);
+		}
+
+		// approximate search, stop backtracking
+		if (max_leaves > 0 && ++leaves >= max_leaves) break;
+	}
+}
+
+
+/*
+Search a single point.
+*/
+void Cpu_KdTree::searchPoint(const float* q, int k, float max_dist2, int index, MyMatches& result)
+{
+	float dist[KNN_MATCHES_LENGTH];
+	int idx[KNN_MATCHES_LENGTH];
+
+	KBest best;
+	best.dist = dist;
+	best.idx = idx;
+	best.count = 0;
+	best.k = k;
+	best.max_dist2 = max_dist2;
+
+	traverse(q, best, 0);
+
+	// write the result
+	for (int i = 0; i < best.count; i++) {
+		result.matches[i].first = index;
+		result.matches[i].second = _ids[best.idx[i]];
+		result.matches[i].distance = best.dist[i];
+	}
+	for (int i = best.count; i < KNN_MATCHES_LENGTH; i++) {
+		result.matches[i].first = index;
+		result.matches[i].second = -1;
+		result.matches[i].distance = 0.0;
+	}
+}
+
+
+/*
+Run a query for all search points in parallel and pack the results.
+A radius search (max_dist2 < FLT_MAX) collects all points within the radius and keeps the k closest ones.
+A knn search (max_dist2 == FLT_MAX) uses a bounded list of k points.
+*/
+void Cpu_KdTree::search(const PointView& search_points, KNNResults& output, int k, float max_dist2, int max_leaves)
+{
+	int n = search_points.size();
+	output.clear();
+	output.offsets.assign(n + 1, 0);
+
+	if (_N == 0) {
+		std::cout << "[ERROR] - Cpu_KdTree: the tree is empty. Call initialize() first." << std::endl;
+		return;
+	}
+	if (n == 0) return;
+
+	const bool radius = max_dist2 < FLT_MAX;
+	if (!radius) k = std::max(1, std::min(k, _N));
+
+	// the chunk buffers belong to the calling thread and are kept between calls
+	static thread_local std::vector<CpuKdChunk> thread_chunks;
+	int chunks = ParallelUtils::NumChunks(n, _num_threads, min_query_chunk);
+	if ((int)thread_chunks.size() < chunks) thread_chunks.resize(chunks);
+	std::vector<CpuKdChunk>& chunk_buffers = thread_chunks; // the worker threads must use the buffers of the calling thread
+
+	// search and keep the results per chunk. The count of search point i goes to offsets[i + 1].
+	ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+		CpuKdChunk& r = chunk_buffers[thread_id];
+		r.begin = begin;
+		r.truncated = 0;
+		r.indices.clear();
+		r.distances.clear();
+
+		if (!radius && (int)r.best_dist.size() < k) {
+			r.best_dist.resize(k);
+			r.best_idx.resize(k);
+		}
+
+		for (int i = begin; i < end; i++) {
+			if (radius) {
+				std::vector<std::pair<float, int>>& row = r.row;
+				row.clear();
+				RadiusList list;
+				list.points = &row;
+				list.max_dist2 = max_dist2;
+				traverse(search_points[i], list, max_leaves);
+
+				// keep the k closest points. Ties are resolved by the leaf order, so the result does not depend on the threads.
+				if (k > 0 && (int)row.size() > k) {
+					std::nth_element(row.begin(), row.begin() + k, row.end());
+					row.resize(k);
+					r.truncated++;
+				}
+				std::sort(row.begin(), row.end());
+
+				for (const std::pair<float, int>& p : row) {
+					r.indices.push_back(_ids[p.second]);
+					r.distances.push_back(p.first);
+				}
+				output.offsets[i + 1] = (int)row.size();
+			}
+			else {
+				KBest best;
+				best.dist = &r.best_dist[0];
+				best.idx = &r.best_idx[0];
+				best.count = 0;
+				best.k = k;
+				best.max_dist2 = max_dist2;
+				traverse(search_points[i], best, max_leaves);
+
+				for (int j = 0; j < best.count; j++) {
+					r.indices.push_back(_ids[best.idx[j]]);
+					r.distances.push_back(best.dist[j]);
+				}
+				output.offsets[i + 1] = best.count;
+			}
+		}
+	}, min_query_chunk);
+
+	// prefix sum over the counts
+	for (int i = 0; i < n; i++) {
+		output.offsets[i + 1] += output.offsets[i];
+	}
+
+	output.indices.resize(output.offsets[n]);
+	output.distances.resize(output.offsets[n]);
+	for (int c = 0; c < chunks; c++) {
+		output.truncated += chunk_buffers[c].truncated;
+	}
+
+	// copy the chunks into place
+	ParallelUtils::For(chunks, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int c = begin; c < end; c++) {
+			CpuKdChunk& r = chunk_buffers[c];
+			int dst = output.offsets[r.begin];
+			std::copy(r.indices.begin(), r.indices.end(), output.indices.begin() + dst);
+			std::copy(r.distances.begin(), r.distances.end(), output.distances.begin() + dst);
+		}
+	});
+}
+
+
+/*
+Return the backend type of this tree.
+*/
+KdTreeBackend Cpu_KdTree::backend(void)
+{
+	return KD_CPU;
+}
+
+
+/*
+Set the number of threads for tree construction and queries.
+*/
+void Cpu_KdTree::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+}
+
+
+/*
+Return the number of threads in use.
+*/
+int Cpu_KdTree::getNumThreads(void)
+{
+	return _num_threads;
+}
@@ -0,0 +1,376 @@
+#include "Cpu_RadiusGrid.h"
+
+#include <cfloat>
+
+using namespace texpert;
+
+
+namespace nsCpu_RadiusGrid
+{
+	// min. number of points per thread
+	const int min_build_chunk = 4096;
+
+	// min. number of rows per thread for sorting
+	const int min_sort_chunk = 256;
+
+	// min. number of search points per thread
+	const int min_query_chunk = 256;
+
+	// min. size of the hash table
+	const int min_table_size = 64;
+
+
+	inline std::uint64_t Mix(std::uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+
+	// the distance between a value and the interval [lo, lo + size], minus a tolerance for the
+	// rounding of the cell coordinates. 0 if the value is in the interval.
+	inline float Gap(float v, float lo, float size, float tol)
+	{
+		float g = std::max(lo - v, v - (lo + size));
+		return std::max(0.0f, g - tol);
+	}
+}
+
+using namespace nsCpu_RadiusGrid;
+
+
+Cpu_RadiusGrid::Cpu_RadiusGrid()
+{
+	_N = 0;
+	_table_mask = 0;
+	_cell = 0.0f;
+	_inv_cell = 0.0f;
+	_min[0] = _min[1] = _min[2] = 0.0f;
+	_num_threads = ParallelUtils::NumThreads();
+}
+
+
+Cpu_RadiusGrid::~Cpu_RadiusGrid()
+{
+	reset();
+}
+
+
+/*
+Create the grid from a point view. The point ids are the indices in the view.
+*/
+void Cpu_RadiusGrid::initialize(const PointView& points, float cell_size)
+{
+	reset();
+
+	if (points.size() == 0) return;
+	if (cell_size <= 0.0f) {
+		std::cout << "[ERROR] - Cpu_RadiusGrid: the cell size must be larger than 0 (" << cell_size << ")." << std::endl;
+		return;
+	}
+
+	_N = points.size();
+	_cell = cell_size;
+	_inv_cell = 1.0f / cell_size;
+
+	// bounding box, per chunk
+	int chunks = ParallelUtils::NumChunks(_N, _num_threads, min_build_chunk);
+	std::vector<float> chunk_min(3 * chunks, FLT_MAX);
+
+	ParallelUtils::For(_N, _num_threads, [&](int thread_id, int begin, int end) {
+		float* m = &chunk_min[3 * thread_id];
+		for (int i = begin; i < end; i++) {
+			const float* p = points[i];
+			m[0] = std::min(m[0], p[0]);
+			m[1] = std::min(m[1], p[1]);
+			m[2] = std::min(m[2], p[2]);
+		}
+	}, min_build_chunk);
+
+	for (int d = 0; d < 3; d++) {
+		_min[d] = FLT_MAX;
+		for (int c = 0; c < chunks; c++) {
+			_min[d] = std::min(_min[d], chunk_min[3 * c + d]);
+		}
+	}
+
+	// the row key of each point
+	std::vector<std::uint64_t> keys(_N);
+	ParallelUtils::For(_N, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			const float* p = points[i];
+			keys[i] = rowKey(cell(p[1], 1), cell(p[2], 2));
+		}
+	}, min_build_chunk);
+
+	// number the rows in the order of their first point. The table is at most half full.
+	int table_size = min_table_size;
+	while (table_size < 2 * _N && table_size < (1 << 30)) table_size <<= 1;
+	_table_mask = (std::uint64_t)table_size - 1;
+	_table.assign(table_size, RowSlot{ 0, -1 });
+
+	std::vector<int> point_row(_N);
+	int num_rows = 0;
+	for (int i = 0; i < _N; i++) {
+		point_row[i] = insertRow(keys[i], num_rows);
+	}
+
+	// shrink the table to the number of rows, so that the queries work on a small table
+	std::vector<RowSlot> rows;
+	rows.reserve(num_rows);
+	for (const RowSlot& slot : _table) {
+		if (slot.row >= 0) rows.push_back(slot);
+	}
+
+	table_size = min_table_size;
+	while (table_size < 2 * num_rows && table_size < (1 << 30)) table_size <<= 1;
+	_table_mask = (std::uint64_t)table_size - 1;
+	_table.assign(table_size, RowSlot{ 0, -1 });
+
+	for (const RowSlot& slot : rows) {
+		std::uint64_t s = Mix(slot.key) & _table_mask;
+		while (_table[s].row >= 0) s = (s + 1) & _table_mask;
+		_table[s] = slot;
+	}
+
+	// counting sort by row. The points keep their order within a row.
+	_start.assign(num_rows + 1, 0);
+	for (int i = 0; i < _N; i++) {
+		_start[point_row[i] + 1]++;
+	}
+	for (int r = 0; r < num_rows; r++) {
+		_start[r + 1] += _start[r];
+	}
+
+	_ids.resize(_N);
+	std::vector<int> fill(_start.begin(), _start.end() - 1);
+	for (int i = 0; i < _N; i++) {
+		_ids[fill[point_row[i]]++] = i;
+	}
+
+	// sort the points of each row by x. Ties are resolved by the point id.
+	ParallelUtils::For(num_rows, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int r = begin; r < end; r++) {
+			std::sort(_ids.begin() + _start[r], _ids.begin() + _start[r + 1], [&](int a, int b) {
+				float xa = points[a][0];
+				float xb = points[b][0];
+				return xa < xb || (xa == xb && a < b);
+			});
+		}
+	}, min_sort_chunk);
+
+	// copy the points into row order
+	_x.resize(_N);
+	_y.resize(_N);
+	_z.resize(_N);
+	ParallelUtils::For(_N, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			const float* p = points[_ids[i]];
+			_x[i] = p[0];
+			_y[i] = p[1];
+			_z[i] = p[2];
+		}
+	}, min_build_chunk);
+}
+
+
+/*
+Clears the grid memory.
+*/
+void Cpu_RadiusGrid::reset(void)
+{
+	_table.clear();
+	_start.clear();
+	_x.clear();
+	_y.clear();
+	_z.clear();
+	_ids.clear();
+	_table_mask = 0;
+	_N = 0;
+}
+
+
+/*
+Returns the number of points in this grid.
+*/
+int Cpu_RadiusGrid::size(void)
+{
+	return _N;
+}
+
+
+/*
+Returns the edge length of a cell.
+*/
+float Cpu_RadiusGrid::cellSize(void)
+{
+	return _cell;
+}
+
+
+/*
+Return the row index of a row key, or -1 if the row does not exist.
+*/
+int Cpu_RadiusGrid::findRow(std::uint64_t key) const
+{
+	std::uint64_t s = Mix(key) & _table_mask;
+	while (_table[s].row >= 0) {
+		if (_table[s].key == key) return _table[s].row;
+		s = (s + 1) & _table_mask;
+	}
+	return -1;
+}
+
+
+/*
+Insert a row key into the hash table if it does not exist.
+*/
+int Cpu_RadiusGrid::insertRow(std::uint64_t key, int& num_rows)
+{
+	std::uint64_t s = Mix(key) & _table_mask;
+	while (_table[s].row >= 0) {
+		if (_table[s].key == key) return _table[s].row;
+		s = (s + 1) & _table_mask;
+	}
+	_table[s].key = key;
+	_table[s].row = num_rows++;
+	return _table[s].row;
+}
+
+
+/*
+Searches for the points within a given radius of the points in a view.
+*/
+void Cpu_RadiusGrid::radius_search(const PointView& search_points, KNNResults& output, double radius, int max_neighbors)
+{
+	int n = search_points.size();
+	output.clear();
+	output.offsets.assign(n + 1, 0);
+
+	if (_N == 0) {
+		std::cout << "[ERROR] - Cpu_RadiusGrid: the grid is empty. Call initialize() first." << std::endl;
+		return;
+	}
+	if (n == 0) return;
+
+	const float max_dist2 = (float)(radius * radius);
+	const int k = max_neighbors;
+
+	// number of rows to scan in each direction
+	const int reach = std::max(1, (int)std::ceil(radius / (double)_cell));
+
+	// the chunk buffers belong to the calling thread and are kept between calls
+	static thread_local std::vector<GridChunk> thread_chunks;
+	int chunks = ParallelUtils::NumChunks(n, _num_threads, min_query_chunk);
+	if ((int)thread_chunks.size() < chunks) thread_chunks.resize(chunks);
+	std::vector<GridChunk>& chunk_buffers = thread_chunks; // the worker threads must use the buffers of the calling thread
+
+	// search and keep the results per chunk. The count of search point i goes to offsets[i + 1].
+	ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+		GridChunk& r = chunk_buffers[thread_id];
+		r.begin = begin;
+		r.truncated = 0;
+		r.indices.clear();
+		r.distances.clear();
+
+		std::vector<std::pair<float, int>>& row = r.row;
+
+		// local pointers, the compiler cannot keep the members in registers while row grows
+		const float* px = _x.data();
+		const float* py = _y.data();
+		const float* pz = _z.data();
+		const int* start = _start.data();
+
+		for (int i = begin; i < end; i++) {
+			const float* q = search_points[i];
+			std::int64_t cy = cell(q[1], 1);
+			std::int64_t cz = cell(q[2], 2);
+
+			float tol_y = 1e-4f * _cell + 4.0f * FLT_EPSILON * (std::fabs(q[1]) + std::fabs(_min[1]) + _cell);
+			float tol_z = 1e-4f * _cell + 4.0f * FLT_EPSILON * (std::fabs(q[2]) + std::fabs(_min[2]) + _cell);
+
+			row.clear();
+			for (std::int64_t z = cz - reach; z <= cz + reach; z++) {
+				float gz = Gap(q[2], _min[2] + z * _cell, _cell, tol_z);
+				for (std::int64_t y = cy - reach; y <= cy + reach; y++) {
+					float gy = Gap(q[1], _min[1] + y * _cell, _cell, tol_y);
+
+					// the part of the search sphere that intersects the row
+					float rest = max_dist2 - gy * gy - gz * gz;
+					if (rest < 0.0f) continue;
+
+					int row_index = findRow(rowKey(y, z));
+					if (row_index < 0) continue;
+
+					float half = std::sqrt(rest);
+					int row_end = start[row_index + 1];
+					int j = (int)(std::lower_bound(px + start[row_index], px + row_end, q[0] - half) - px);
+					float x_max = q[0] + half;
+
+					for (; j < row_end && px[j] <= x_max; j++) {
+						float dx = px[j] - q[0];
+						float dy = py[j] - q[1];
+						float dz = pz[j] - q[2];
+						float d = dx * dx + dy * dy + dz * dz;
+						if (d <= max_dist2) row.push_back(std::make_pair(d, j));
+					}
+				}
+			}
+
+			// keep the k closest points. Ties are resolved by the row order, so the result does not depend on the threads.
+			if (k > 0 && (int)row.size() > k) {
+				std::nth_element(row.begin(), row.begin() + k, row.end());
+				row.resize(k);
+				r.truncated++;
+			}
+			std::sort(row.begin(), row.end());
+
+			for (const std::pair<float, int>& p : row) {
+				r.indices.push_back(_ids[p.second]);
+				r.distances.push_back(p.first);
+			}
+			output.offsets[i + 1] = (int)row.size();
+		}
+	}, min_query_chunk);
+
+	// prefix sum over the counts
+	for (int i = 0; i < n; i++) {
+		output.offsets[i + 1] += output.offsets[i];
+	}
+
+	output.indices.resize(output.offsets[n]);
+	output.distances.resize(output.offsets[n]);
+	for (int c = 0; c < chunks; c++) {
+		output.truncated += chunk_buffers[c].truncated;
+	}
+
+	// copy the chunks into place
+	ParallelUtils::For(chunks, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int c = begin; c < end; c++) {
+			GridChunk& r = chunk_buffers[c];
+			int dst = output.offsets[r.begin];
+			std::copy(r.indices.begin(), r.indices.end(), output.indices.begin() + dst);
+			std::copy(r.distances.begin(), r.distances.end(), output.distances.begin() + dst);
+		}
+	});
+}
+
+
+/*
+Set the number of threads for construction and queries.
+*/
+void Cpu_RadiusGrid::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+}
+
+
+/*
+Return the number of threads in use.
+*/
+int Cpu_RadiusGrid::getNumThreads(void)
+{
+	return _num_threads;
+}
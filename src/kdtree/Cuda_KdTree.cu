@@ -851,9 +851,14 @@ void Cuda_KdTree::initialize_full(vector<MyPoint>& points, int sort_tpb, int sor
 
 
 
+	if (points.size() > MAX_NUM_POINTS) {
+		std::cout << "[ERROR] - Cuda_KdTree: " << points.size() << " points exceed the max. number of points (" << MAX_NUM_POINTS << "). Use the cpu kd-tree (KD_CPU)." << std::endl;
+		_N = 0;
+		return;
+	}
+
 	_data = points;
 	_N = _data.size();
-	assert(_N <= MAX_NUM_POINTS);
 	//struct cudaDeviceProp info;
 	//cudaGetDeviceProperties(&info, 0);
 	//printf("Shader clock freq: %d\n", info.clockRate);
@@ -1162,19 +1167,7 @@ This function looks only for ONE nearest neighbor in the tree.
 */
 void Cuda_KdTree::knn(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output)
 {
-	size_t n = search_points.size();
-	assert(n <= MAX_SEARCH_POINTS);
-	output.resize(n);
-
-	Cuda_Helpers::HostToDevice<MyPoint>(&search_points.front(), d_query_points, n);  CudaCheckError();
-
-	// start the search
-	knn_search << < (n + TPB - 1) / TPB, TPB >> > (_d_tree, d_query_points, d_query_results, n);
-	cudaDeviceSynchronize();
-	CudaCheckError();
-
-	Cuda_Helpers::DeviceToHost<MyMatches>(d_query_results, &output.front(), n);
-	CudaCheckError();
+	search(search_points, output, 0, 1, 0.0);
 }
 
 
@@ -1187,25 +1180,9 @@ Searches for k nearest neighbors.
 */
 void Cuda_KdTree::knn(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int k)
 {
-
-	size_t n = search_points.size();
-	assert(n <= MAX_SEARCH_POINTS);
-	assert(n  <= MAX_OUTPUT_POINTS);
 	assert(k <= KNN_MATCHES_LENGTH);
 	output.clear();
-	output.resize(n);
-
-	Cuda_Helpers::HostToDevice<MyPoint>(&search_points.front(), d_query_points, n); 
-	CudaCheckError();
-
-	// start the search
-	knn_search << < (n + TPB - 1) / TPB, TPB >> > (_d_tree, d_query_points, d_query_results, n, k);
-	cudaDeviceSynchronize();
-	CudaCheckError();
-
-	Cuda_Helpers::DeviceToHost<MyMatches>(d_query_results, &output.front(),  n);
-	CudaCheckError();
-
+	search(search_points, output, 1, k, 0.0);
 }
 
 
@@ -1219,20 +1196,64 @@ The function can only return the KNN_MATCHES_LENGTH closests matches to the sear
 */
 void Cuda_KdTree::radius_search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, double radius)
 {
-	size_t n = search_points.size();
-	assert(n <= MAX_SEARCH_POINTS);
-	assert(n <= MAX_OUTPUT_POINTS);
+	search(search_points, output, 2, 0, radius);
+}
+
+
+
+/*
+Run a search in chunks of CUDA_KD_QUERY_CHUNK points. The device query buffers are split into two halves.
+Chunk c uses half c % 2 and stream c % 2. The operations of one stream run in order, so a half is not overwritten
+before its results were copied back, while the copies of one chunk overlap with the search of the other chunk.
+Note that the copies only overlap completely with page-locked host memory.
+@param mode - 0: nearest neighbor, 1: k nearest neighbors, 2: radius search.
+*/
+void Cuda_KdTree::search(std::vector<MyPoint>& search_points, std::vector<MyMatches>& output, int mode, int k, double radius)
+{
+	int n = (int)search_points.size();
 	output.resize(n);
+	if (n == 0) return;
 
-	Cuda_Helpers::HostToDevice<MyPoint>(&search_points.front(), d_query_points, n);  CudaCheckError();
+	const int chunk = CUDA_KD_QUERY_CHUNK;
 
-	// start the search
-	knn_radius_search << < (n + TPB - 1) / TPB, TPB >> > (_d_tree, d_query_points, d_query_results, n, radius);
-	cudaDeviceSynchronize();
-	CudaCheckError();
+	for (int begin = 0, c = 0; begin < n; begin += chunk, c++) {
+		int count = std::min(chunk, n - begin);
+		int half = c % 2;
+		cudaStream_t stream = streams[half];
+		MyPoint* d_points = d_query_points + half * chunk;
+		MyMatches* d_results = d_query_results + half * chunk;
 
-	Cuda_Helpers::DeviceToHost<MyMatches>(d_query_results, &output.front(), n);
+		cudaMemcpyAsync(d_points, &search_points[begin], count * sizeof(MyPoint), cudaMemcpyHostToDevice, stream);
+		CudaCheckError();
+
+		// start the search
+		switch (mode) {
+		case 0:
+			knn_search << < (count + TPB - 1) / TPB, TPB, 0, stream >> > (_d_tree, d_points, d_results, count);
+			break;
+		case 1:
+			knn_search << < (count + TPB - 1) / TPB, TPB, 0, stream >> > (_d_tree, d_points, d_results, count, k);
+			break;
+		case 2:
+			knn_radius_search << < (count + TPB - 1) / TPB, TPB, 0, stream >> > (_d_tree, d_points, d_results, count, radius);
+			break;
+		}
+		CudaCheckError();
+
+		cudaMemcpyAsync(&output[begin], d_results, count * sizeof(MyMatches), cudaMemcpyDeviceToHost, stream);
+		CudaCheckError();
+	}
+
+	cudaStreamSynchronize(streams[0]);
+	cudaStreamSynchronize(streams[1]);
 	CudaCheckError();
+
+	// the kernels store the search point index within the chunk
+	for (int i = chunk; i < n; i++) {
+		for (int j = 0; j < KNN_MATCHES_LENGTH; j++) {
+			output[i].matches[j].first = i;
+		}
+	}
 }
 
 
@@ -0,0 +1,214 @@
+#include "KdTreeCache.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "Cpu_KdTree.h"
+#include "ParallelUtils.h"
+
+using namespace texpert;
+
+
+namespace nsKdTreeCache
+{
+	// number of points per hash block
+	const int hash_block = 4096;
+
+	typedef struct _CacheEntry
+	{
+		std::uint64_t				key;
+		int							size;
+		std::uint64_t				last_use;
+		std::shared_ptr<IKdTree>	tree;
+	}CacheEntry;
+
+	std::vector<CacheEntry>		entries;
+	int							capacity = 8;
+	std::uint64_t				use_counter = 0;
+	KdTreeCacheStats			stats;
+
+	// the keys of shared trees
+	std::vector<std::pair<IKdTree*, std::uint64_t>>	built;
+
+	// guards all data
+	std::mutex					cache_mutex;
+
+
+	inline std::uint64_t Mix(std::uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+
+	// hash of the points [begin, end)
+	std::uint64_t HashBlock(const PointView& points, int begin, int end)
+	{
+		std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ (std::uint64_t)begin;
+		for (int i = begin; i < end; i++) {
+			std::uint32_t v[3];
+			memcpy(v, points[i], sizeof(v));
+			h = (h ^ (v[0] | (std::uint64_t(v[1]) << 32))) * 0x87c37b91114253d5ULL;
+			h = (h ^ v[2]) * 0x4cf5ad432745937fULL;
+			h ^= h >> 29;
+		}
+		return Mix(h);
+	}
+
+
+	// remove the least recently used entries until size <= max_size. Expects a lock.
+	void Evict(int max_size)
+	{
+		while ((int)entries.size() > max_size) {
+			size_t lru = 0;
+			for (size_t i = 1; i < entries.size(); i++) {
+				if (entries[i].last_use < entries[lru].last_use) lru = i;
+			}
+			entries.erase(entries.begin() + lru);
+		}
+	}
+}
+
+using namespace nsKdTreeCache;
+
+
+//static
+std::uint64_t KdTreeCache::Hash(const PointView& points)
+{
+	int n = points.size();
+	int blocks = (n + hash_block - 1) / hash_block;
+	std::vector<std::uint64_t> block_hash(blocks);
+
+	ParallelUtils::For(blocks, ParallelUtils::NumThreads(), [&](int thread_id, int begin, int end) {
+		for (int b = begin; b < end; b++) {
+			block_hash[b] = HashBlock(points, b * hash_block, std::min(n, (b + 1) * hash_block));
+		}
+	}, 4);
+
+	std::uint64_t h = Mix((std::uint64_t)n + 0x9e3779b97f4a7c15ULL);
+	for (int b = 0; b < blocks; b++) {
+		h = Mix(h ^ block_hash[b]);
+	}
+
+	return (h == 0) ? 1 : h;
+}
+
+
+//static
+std::shared_ptr<IKdTree> KdTreeCache::Get(const PointView& points, std::uint64_t key)
+{
+	if (points.size() == 0) return std::shared_ptr<IKdTree>();
+	if (key == 0) key = Hash(points);
+
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		for (CacheEntry& e : entries) {
+			if (e.key == key && e.size == points.size()) {
+				e.last_use = ++use_counter;
+				stats.hits++;
+				return e.tree;
+			}
+		}
+		stats.misses++;
+	}
+
+	// build the tree without holding the lock
+	std::shared_ptr<IKdTree> tree(new Cpu_KdTree());
+	tree->initialize(points);
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	// another thread may have built the same tree in the meantime
+	for (CacheEntry& e : entries) {
+		if (e.key == key && e.size == points.size()) {
+			e.last_use = ++use_counter;
+			return e.tree;
+		}
+	}
+
+	Evict(capacity - 1);
+
+	CacheEntry e;
+	e.key = key;
+	e.size = points.size();
+	e.last_use = ++use_counter;
+	e.tree = tree;
+	entries.push_back(e);
+
+	return tree;
+}
+
+
+//static
+void KdTreeCache::MarkBuilt(IKdTree* tree, std::uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	for (size_t i = 0; i < built.size(); i++) {
+		if (built[i].first == tree) {
+			if (key == 0) built.erase(built.begin() + i);
+			else built[i].second = key;
+			return;
+		}
+	}
+	if (key != 0) built.push_back(std::make_pair(tree, key));
+}
+
+
+//static
+bool KdTreeCache::IsBuilt(IKdTree* tree, std::uint64_t key)
+{
+	if (key == 0) return false;
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	for (const std::pair<IKdTree*, std::uint64_t>& b : built) {
+		if (b.first == tree) return b.second == key;
+	}
+	return false;
+}
+
+
+//static
+void KdTreeCache::SetCapacity(int num_trees)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	capacity = std::max(1, num_trees);
+	Evict(capacity);
+}
+
+
+//static
+int KdTreeCache::GetCapacity(void)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return capacity;
+}
+
+
+//static
+void KdTreeCache::Clear(void)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	entries.clear();
+	stats = KdTreeCacheStats();
+}
+
+
+//static
+KdTreeCacheStats KdTreeCache::GetStats(void)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	KdTreeCacheStats s = stats;
+	s.trees = (int)entries.size();
+	s.points = 0;
+	for (const CacheEntry& e : entries) s.points += e.size;
+	return s;
+}
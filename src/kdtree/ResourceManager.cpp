@@ -1,4 +1,5 @@
 #include "ResourceManager.h"
+#include "KdTreeCache.h"
 
 
 #include "cuDeviceMemory3f.h"
@@ -8,7 +9,14 @@ namespace ns_ResourceManager{
 	Cuda_KdTree*		g_kdtree_ref = NULL;
 	int					g_kdtree_ref_cout = 0;
 
+	// the backend KD_AUTO resolves to
+	KdTreeBackend		g_default_backend = KD_AUTO;
 
+	// guards the shared cuda kd-tree
+	std::recursive_mutex	g_kdtree_mutex;
+
+	// guards g_kdtree_ref and g_kdtree_ref_cout
+	std::mutex			g_ref_mutex;
 
 }
 
@@ -19,8 +27,18 @@ using namespace ns_ResourceManager;
 
 
 //static 
-Cuda_KdTree* ResourceManager::GetKDTree(void)
+IKdTree* ResourceManager::GetKDTree(KdTreeBackend backend)
 {
+	if (backend == KD_AUTO) {
+		backend = GetDefaultBackend();
+	}
+
+	if (backend == KD_CPU) {
+		return new Cpu_KdTree();
+	}
+
+	std::lock_guard<std::mutex> lock(g_ref_mutex);
+
 	if (g_kdtree_ref_cout > 0 ) {
 		g_kdtree_ref_cout++;
 		//return g_kdtree_ref;
@@ -35,12 +53,58 @@ Cuda_KdTree* ResourceManager::GetKDTree(void)
 }
 
 //static 
-bool ResourceManager::UnrefKDTree(Cuda_KdTree* tree)
+bool ResourceManager::UnrefKDTree(IKdTree* tree)
 {
-	if (tree != NULL) {
-		g_kdtree_ref_cout--;
-		if(g_kdtree_ref_cout == 0) delete g_kdtree_ref;
+	if (tree == NULL) return false;
+
+	if (tree->backend() == KD_CPU) {
+		delete tree;
 		return true;
 	}
-	return false;
+
+	std::lock_guard<std::mutex> lock(g_ref_mutex);
+
+	g_kdtree_ref_cout--;
+	if (g_kdtree_ref_cout == 0) {
+		KdTreeCache::MarkBuilt(g_kdtree_ref, 0);
+		delete g_kdtree_ref;
+		g_kdtree_ref = NULL;
+	}
+	return true;
+}
+
+
+//static 
+void ResourceManager::SetDefaultBackend(KdTreeBackend backend)
+{
+	g_default_backend = backend;
+}
+
+
+//static 
+KdTreeBackend ResourceManager::GetDefaultBackend(void)
+{
+	if (g_default_backend != KD_AUTO) return g_default_backend;
+
+	if (HasCudaDevice()) return KD_CUDA;
+
+	return KD_CPU;
+}
+
+
+//static 
+bool ResourceManager::HasCudaDevice(void)
+{
+	int count = 0;
+	cudaError_t err = cudaGetDeviceCount(&count);
+	if (err != cudaSuccess) return false;
+	return count > 0;
+}
+
+
+
+//static 
+std::recursive_mutex& ResourceManager::GetKDTreeMutex(void)
+{
+	return g_kdtree_mutex;
 }
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "FastLoaderOBJ.h"
+
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+
+using namespace texpert;
+
+
+namespace nsFastLoaderOBJ
+{
+	// smallest chunk a thread parses, in bytes
+	const size_t min_chunk_bytes = 1 << 20;
+
+	// the data of one chunk
+	typedef struct _OBJChunk
+	{
+		const char*						begin;
+		const char*						end;
+		std::vector<Eigen::Vector3f>	points;
+		std::vector<Eigen::Vector3f>	normals;
+		int								points_err;
+		int								normals_err;
+
+		_OBJChunk()
+		{
+			begin = NULL;
+			end = NULL;
+			points_err = 0;
+			normals_err = 0;
+		}
+	}OBJChunk;
+
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+
+	// parse three numbers in [pos, end). Returns false if one is not a number.
+	inline bool ParseVector(const char* pos, const char* end, Eigen::Vector3f& v)
+	{
+		for (int i = 0; i < 3; i++) {
+			while (pos < end && IsSpace(*pos)) pos++;
+			if (pos < end && *pos == '+') pos++;
+			std::from_chars_result r = std::from_chars(pos, end, v[i]);
+			if (r.ec != std::errc()) return false;
+			pos = r.ptr;
+			if (pos < end && !IsSpace(*pos)) return false;
+		}
+		return true;
+	}
+
+
+	// parse all v and vn lines of one chunk
+	void ParseChunk(OBJChunk& chunk, const bool invert_z)
+	{
+		const char* pos = chunk.begin;
+		const char* end = chunk.end;
+
+		while (pos < end) {
+
+			const char* line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+			if (line_end == NULL) line_end = end;
+
+			while (pos < line_end && IsSpace(*pos)) pos++;
+
+			if (line_end - pos > 2 && pos[0] == 'v') {
+
+				if (IsSpace(pos[1])) {
+					Eigen::Vector3f p;
+					if (ParseVector(pos + 2, line_end, p)) {
+						if (invert_z) p.z() = -p.z();
+						chunk.points.push_back(p);
+					}
+					else {
+						chunk.points.push_back(Eigen::Vector3f(0.0f, 0.0f, 0.0f));
+						chunk.points_err++;
+					}
+				}
+				else if (pos[1] == 'n' && IsSpace(pos[2])) {
+					Eigen::Vector3f n;
+					if (ParseVector(pos + 3, line_end, n)) {
+						if (invert_z) n.z() = -n.z();
+						if (n.norm() > 1.001)
+							n.normalize();
+						chunk.normals.push_back(n);
+					}
+					else {
+						chunk.normals.push_back(Eigen::Vector3f(0.0f, 0.0f, 0.0f));
+						chunk.normals_err++;
+					}
+				}
+			}
+
+			pos = line_end + 1;
+		}
+	}
+}
+
+using namespace nsFastLoaderOBJ;
+
+
+/*!
+Load the vertices and normal vectors of an obj file.
+*/
+//static
+bool FastLoaderOBJ::Read(const std::string file, std::vector<Eigen::Vector3f>& dst_points, std::vector<Eigen::Vector3f>& dst_normals,
+						 const bool invert_z, int num_threads, const bool verbose)
+{
+	dst_points.clear();
+	dst_normals.clear();
+
+	MappedFile mf;
+	if (!mf.open(file)) {
+		std::cout << "[ERROR] - FastLoaderOBJ: could not open file " << file << "." << std::endl;
+		return false;
+	}
+
+	if (num_threads <= 0) num_threads = ParallelUtils::NumThreads();
+
+	const char* data = mf.data();
+	size_t size = mf.size();
+
+	// split the file into chunks that start at the beginning of a line
+	int num_chunks = (int)std::max(size_t(1), std::min(size_t(num_threads), size / min_chunk_bytes));
+	std::vector<OBJChunk> chunks(num_chunks);
+
+	const char* begin = data;
+	for (int i = 0; i < num_chunks; i++) {
+		const char* end = data + (i == num_chunks - 1 ? size : size * (i + 1) / num_chunks);
+		if (end < begin) end = begin;
+		while (end > data && end < data + size && *(end - 1) != '\n') end++;
+		chunks[i].begin = begin;
+		chunks[i].end = end;
+		begin = end;
+	}
+
+	ParallelUtils::For(num_chunks, num_chunks, [&](int thread_id, int first, int last) {
+		for (int i = first; i < last; i++) {
+			ParseChunk(chunks[i], invert_z);
+		}
+	});
+
+	// merge the chunks in file order
+	std::vector<size_t> point_offset(num_chunks + 1, 0);
+	std::vector<size_t> normal_offset(num_chunks + 1, 0);
+	int points_err = 0;
+	int normals_err = 0;
+	for (int i = 0; i < num_chunks; i++) {
+		point_offset[i + 1] = point_offset[i] + chunks[i].points.size();
+		normal_offset[i + 1] = normal_offset[i] + chunks[i].normals.size();
+		points_err += chunks[i].points_err;
+		normals_err += chunks[i].normals_err;
+	}
+
+	dst_points.resize(point_offset[num_chunks]);
+	dst_normals.resize(normal_offset[num_chunks]);
+
+	ParallelUtils::For(num_chunks, num_chunks, [&](int thread_id, int first, int last) {
+		for (int i = first; i < last; i++) {
+			std::copy(chunks[i].points.begin(), chunks[i].points.end(), dst_points.begin() + point_offset[i]);
+			std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), dst_normals.begin() + normal_offset[i]);
+			std::vector<Eigen::Vector3f>().swap(chunks[i].points);
+			std::vector<Eigen::Vector3f>().swap(chunks[i].normals);
+		}
+	});
+
+	mf.close();
+
+	if (verbose) {
+		std::cout << "[INFO] - FastLoaderOBJ: loaded " << dst_points.size() - points_err << " points and " << dst_normals.size() - normals_err << " normal vectors from file " << file << "." << std::endl;
+		if (points_err > 0 || normals_err > 0) {
+			std::cout << "[INFO] - FastLoaderOBJ: detected " << points_err << " invalid points and " << normals_err << " invalid normal vectors in file " << file << "." << std::endl;
+		}
+	}
+
+	return true;
+}
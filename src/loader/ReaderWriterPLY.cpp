@@ -1,5 +1,177 @@
 #include "ReaderWriterPLY.h"
 
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <algorithm>
+
+
+
+namespace nsReaderWriterPLY
+{
+	typedef enum _PLYType
+	{
+		PLY_NONE,
+		PLY_INT8,
+		PLY_UINT8,
+		PLY_INT16,
+		PLY_UINT16,
+		PLY_INT32,
+		PLY_UINT32,
+		PLY_FLOAT32,
+		PLY_FLOAT64
+	}PLYType;
+
+	typedef struct _PLYProperty
+	{
+		std::string		name;
+		PLYType			type;
+		PLYType			count_type; // != PLY_NONE for list properties
+	}PLYProperty;
+
+	typedef struct _PLYElement
+	{
+		std::string					name;
+		size_t						count;
+		std::vector<PLYProperty>	properties;
+	}PLYElement;
+
+	typedef enum _PLYEncoding
+	{
+		ENC_ASCII,
+		ENC_BINARY_LE,
+		ENC_BINARY_BE
+	}PLYEncoding;
+
+
+	PLYType ToType(const std::string& t)
+	{
+		if (t == "char" || t == "int8") return PLY_INT8;
+		if (t == "uchar" || t == "uint8") return PLY_UINT8;
+		if (t == "short" || t == "int16") return PLY_INT16;
+		if (t == "ushort" || t == "uint16") return PLY_UINT16;
+		if (t == "int" || t == "int32") return PLY_INT32;
+		if (t == "uint" || t == "uint32") return PLY_UINT32;
+		if (t == "float" || t == "float32") return PLY_FLOAT32;
+		if (t == "double" || t == "float64") return PLY_FLOAT64;
+		return PLY_NONE;
+	}
+
+
+	size_t TypeSize(PLYType t)
+	{
+		switch (t) {
+		case PLY_INT8: case PLY_UINT8: return 1;
+		case PLY_INT16: case PLY_UINT16: return 2;
+		case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+		case PLY_FLOAT64: return 8;
+		default: return 0;
+		}
+	}
+
+
+	bool HostIsLittleEndian(void)
+	{
+		const uint32_t one = 1;
+		unsigned char c;
+		std::memcpy(&c, &one, 1);
+		return c == 1;
+	}
+
+
+	// read one binary value and convert it to double
+	double ReadBinary(const char* src, PLYType t, bool swap)
+	{
+		unsigned char b[8];
+		size_t n = TypeSize(t);
+		std::memcpy(b, src, n);
+		if (swap) std::reverse(b, b + n);
+
+		switch (t) {
+		case PLY_INT8: { int8_t v; std::memcpy(&v, b, 1); return v; }
+		case PLY_UINT8: { uint8_t v; std::memcpy(&v, b, 1); return v; }
+		case PLY_INT16: { int16_t v; std::memcpy(&v, b, 2); return v; }
+		case PLY_UINT16: { uint16_t v; std::memcpy(&v, b, 2); return v; }
+		case PLY_INT32: { int32_t v; std::memcpy(&v, b, 4); return v; }
+		case PLY_UINT32: { uint32_t v; std::memcpy(&v, b, 4); return v; }
+		case PLY_FLOAT32: { float v; std::memcpy(&v, b, 4); return v; }
+		case PLY_FLOAT64: { double v; std::memcpy(&v, b, 8); return v; }
+		default: return 0.0;
+		}
+	}
+
+
+	// Size of one binary record of element e starting at src. Returns 0 if the record exceeds end.
+	size_t RecordSize(const PLYElement& e, const char* src, const char* end, bool swap)
+	{
+		size_t size = 0;
+		for (const PLYProperty& p : e.properties) {
+			if (p.count_type == PLY_NONE) {
+				size += TypeSize(p.type);
+			}
+			else {
+				size_t cs = TypeSize(p.count_type);
+				if (src + size + cs > end) return 0;
+				double n = ReadBinary(src + size, p.count_type, swap);
+				if (n < 0) return 0;
+				size += cs + size_t(n) * TypeSize(p.type);
+			}
+			if (src + size > end) return 0;
+		}
+		return size;
+	}
+
+
+	// size of a record without list properties, 0 otherwise
+	size_t FixedRecordSize(const PLYElement& e)
+	{
+		size_t size = 0;
+		for (const PLYProperty& p : e.properties) {
+			if (p.count_type != PLY_NONE) return 0;
+			size += TypeSize(p.type);
+		}
+		return size;
+	}
+
+
+	// returns the next line in [pos, end) without the line break and advances pos
+	std::string NextLine(const char*& pos, const char* end)
+	{
+		const char* start = pos;
+		while (pos < end && *pos != '\n') pos++;
+		const char* stop = pos;
+		if (stop > start && *(stop - 1) == '\r') stop--;
+		if (pos < end) pos++;
+		return std::string(start, stop);
+	}
+
+
+	// split at any whitespace
+	std::vector<std::string> Tokens(const std::string& line)
+	{
+		std::vector<std::string> tokens;
+		std::istringstream ss(line);
+		std::string t;
+		while (ss >> t) tokens.push_back(t);
+		return tokens;
+	}
+
+
+	// parse the next ascii number in [pos, end), locale independent
+	bool NextNumber(const char*& pos, const char* end, double& value)
+	{
+		while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')) pos++;
+		if (pos >= end) return false;
+		if (*pos == '+') pos++;
+		std::from_chars_result r = std::from_chars(pos, end, value);
+		if (r.ec != std::errc()) return false;
+		pos = r.ptr;
+		return true;
+	}
+}
+
+using namespace nsReaderWriterPLY;
 
 
 	/*!
@@ -17,21 +189,8 @@ bool ReaderWriterPLY::Read(const std::string file, std::vector<Eigen::Vector3f>&
 		return false;
 	}
 
-
-	// append a ply ending 
-	size_t index = file.find_last_of(".");
-	std::string outfile;
-
-	if (index != std::string::npos)
-	{
-		outfile = file.substr(0, index);
-	}
-	outfile.append(".ply");
-
-
-	std::ifstream infile(file);
-
-    if(!infile.is_open()){
+	texpert::MappedFile mf;
+	if (!mf.open(file)) {
         #ifdef _WIN32
         _cprintf("[ERROR] - ReaderWriterPLY: could not open file %s.\n", file.c_str());
         #else
@@ -43,79 +202,252 @@ bool ReaderWriterPLY::Read(const std::string file, std::vector<Eigen::Vector3f>&
 	dst_points.clear();
 	dst_normals.clear();
 
-	int count = 0;
-	int size = 0;
+	const char* pos = mf.data();
+	const char* end = mf.data() + mf.size();
+
+	//--------------------------------------------------------------
+	// header
+
+	if (NextLine(pos, end).compare(0, 3, "ply") != 0) {
+		ErrorMsg("file " + file + " is not a ply file");
+		return false;
+	}
+
+	PLYEncoding encoding = ENC_ASCII;
+	std::vector<PLYElement> elements;
 	bool found_data = false;
-	std::string str;
-    while(std::getline(infile, str))
-    {
-		std::vector<string> e = ReaderWriter::split(str, ' ');
-		if(e.size() == 0) continue;
 
-		if (!found_data) {
-	
-			if (e[0].compare("element") == 0) {
-				if (e.size() == 3) {
-					if (e[1].compare("vertex") == 0) {
-						string s = e[2];
-						if(ReaderWriter::is_number(s))
-						{
-							size = std::atoi(s.c_str());
-							if (size > 0) {
-								dst_points.reserve(size);
-								dst_normals.reserve(size);	
-							}
-						}
-					}
+	while (pos < end) {
+		std::vector<std::string> e = Tokens(NextLine(pos, end));
+		if (e.size() == 0) continue;
+
+		if (e[0].compare("format") == 0 && e.size() >= 2) {
+			if (e[1].compare("ascii") == 0) encoding = ENC_ASCII;
+			else if (e[1].compare("binary_little_endian") == 0) encoding = ENC_BINARY_LE;
+			else if (e[1].compare("binary_big_endian") == 0) encoding = ENC_BINARY_BE;
+			else {
+				ErrorMsg("unknown format " + e[1]);
+				return false;
+			}
+		}
+		else if (e[0].compare("element") == 0 && e.size() == 3) {
+			PLYElement el;
+			el.name = e[1];
+			el.count = ReaderWriter::is_number(e[2]) ? size_t(std::atoll(e[2].c_str())) : 0;
+			elements.push_back(el);
+		}
+		else if (e[0].compare("property") == 0 && elements.size() > 0) {
+			PLYProperty p;
+			if (e.size() == 5 && e[1].compare("list") == 0) {
+				p.count_type = ToType(e[2]);
+				p.type = ToType(e[3]);
+				p.name = e[4];
+			}
+			else if (e.size() == 3) {
+				p.count_type = PLY_NONE;
+				p.type = ToType(e[1]);
+				p.name = e[2];
+			}
+			else {
+				ErrorMsg("invalid property definition");
+				return false;
+			}
+			if (p.type == PLY_NONE || (e[1].compare("list") == 0 && p.count_type == PLY_NONE)) {
+				ErrorMsg("unknown property type for " + p.name);
+				return false;
+			}
+			elements.back().properties.push_back(p);
+		}
+		else if (e[0].compare("end_header") == 0) {
+			found_data = true;
+			break;
+		}
+	}
+
+	if (!found_data) {
+		ErrorMsg("file " + file + " has no end_header");
+		return false;
+	}
+
+	//--------------------------------------------------------------
+	// vertex layout
+
+	int vertex_element = -1;
+	for (size_t i = 0; i < elements.size(); i++) {
+		if (elements[i].name.compare("vertex") == 0) {
+			vertex_element = (int)i;
+			break;
+		}
+	}
+
+	if (vertex_element < 0) {
+		ErrorMsg("file " + file + " has no vertex element");
+		return false;
+	}
+
+	const PLYElement& vertex = elements[vertex_element];
+	const char* names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+	int column[6] = { -1, -1, -1, -1, -1, -1 };
+	for (size_t i = 0; i < vertex.properties.size(); i++) {
+		for (int j = 0; j < 6; j++) {
+			if (vertex.properties[i].name.compare(names[j]) == 0 && vertex.properties[i].count_type == PLY_NONE) column[j] = (int)i;
+		}
+	}
+
+	if (column[0] < 0 || column[1] < 0 || column[2] < 0) {
+		ErrorMsg("file " + file + " has no x, y, z vertex properties");
+		return false;
+	}
+	bool has_normals = column[3] >= 0 && column[4] >= 0 && column[5] >= 0;
+
+	size_t size = vertex.count;
+	if (size > 0) {
+		dst_points.resize(size);
+		dst_normals.resize(size, Eigen::Vector3f::Zero());
+	}
+
+	size_t count = 0;
+
+	//--------------------------------------------------------------
+	// ascii data
+
+	if (encoding == ENC_ASCII) {
+
+		// skip the elements in front of the vertices
+		for (int i = 0; i < vertex_element; i++) {
+			for (size_t j = 0; j < elements[i].count && pos < end; j++) NextLine(pos, end);
+		}
+
+		std::vector<double> values(vertex.properties.size());
+
+		for (count = 0; count < size; count++) {
+
+			const char* line_end = pos;
+			while (line_end < end && *line_end != '\n') line_end++;
+
+			bool valid = true;
+			for (size_t i = 0; i < values.size(); i++) {
+				if (!NextNumber(pos, line_end, values[i])) { valid = false; break; }
+				if (vertex.properties[i].count_type != PLY_NONE) { // skip list items
+					for (int k = 0; k < int(values[i]) && valid; k++) { double d; valid = NextNumber(pos, line_end, d); }
 				}
 			}
-			else if (e[0].compare("end_header") == 0) {
-				found_data = true;
+			pos = line_end < end ? line_end + 1 : end;
+
+			if (!valid) {
+				ErrorMsg("vertex " + std::to_string(count) + " is NaN or incomplete");
+				break;
+			}
+
+			dst_points[count] = Eigen::Vector3f((float)values[column[0]], (float)values[column[1]], (float)values[column[2]]);
+			if (has_normals) {
+				dst_normals[count] = Eigen::Vector3f((float)values[column[3]], (float)values[column[4]], (float)values[column[5]]);
+			}
+		}
+	}
+
+	//--------------------------------------------------------------
+	// binary data
+
+	else {
+		bool swap = (encoding == ENC_BINARY_LE) != HostIsLittleEndian();
+
+		// skip the elements in front of the vertices
+		for (int i = 0; i < vertex_element; i++) {
+			for (size_t j = 0; j < elements[i].count; j++) {
+				size_t rs = RecordSize(elements[i], pos, end, swap);
+				if (rs == 0) { pos = end; break; }
+				pos += rs;
 			}
 		}
-		else{
-			
-			float x, y, z, nx, ny, nz;
-			if (e.size() == 6) {
-				if(ReaderWriter::is_number(e[0]))
-					x = (float)std::atof(e[0].c_str());
-				else ErrorMsg("coordinate x is NaN at vertex " + std::to_string(count));
 
-				if(ReaderWriter::is_number(e[1]))
-					y = (float)std::atof(e[1].c_str());
-				else ErrorMsg("coordinate y is NaN at vertex " + std::to_string(count));
+		size_t stride = FixedRecordSize(vertex);
 
-				if(ReaderWriter::is_number(e[2]))
-					z = (float)std::atof(e[2].c_str());
-				else ErrorMsg("coordinate z is NaN at vertex " + std::to_string(count));
-						
-				if(ReaderWriter::is_number(e[3]))
-					nx = (float)std::atof(e[3].c_str());
-				else ErrorMsg("coordinate nx is NaN at vertex " + std::to_string(count));
+		if (stride > 0) {
 
-				if(ReaderWriter::is_number(e[4]))
-					ny = (float)std::atof(e[4].c_str());
-				else ErrorMsg("coordinate ny is NaN at vertex " + std::to_string(count));
+			// number of complete records in the file
+			size_t available = size_t(end - pos) / stride;
+			if (available < size) {
+				ErrorMsg("file " + file + " is truncated, found " + std::to_string(available) + " of " + std::to_string(size) + " vertices");
+			}
+			count = std::min(size, available);
 
-				if(ReaderWriter::is_number(e[5]))
-					nz = (float)std::atof(e[5].c_str());
-				else ErrorMsg("coordinate nz is NaN at vertex " + std::to_string(count));
+			size_t offset[6];
+			for (int j = 0; j < 6; j++) {
+				offset[j] = 0;
+				for (int i = 0; i < column[j]; i++) offset[j] += TypeSize(vertex.properties[i].type);
+			}
 
-				dst_points.push_back(Eigen::Vector3f(x, y, z));
-				Eigen::Vector3f n(nx, ny, nz);
-				if(n.norm() > 1.01f)
-					n.normalize();
+			// fast path: float x, y, z and float nx, ny, nz stored consecutively in host byte order
+			bool float_xyz = !swap && vertex.properties[column[0]].type == PLY_FLOAT32 && vertex.properties[column[1]].type == PLY_FLOAT32 &&
+				vertex.properties[column[2]].type == PLY_FLOAT32 && offset[1] == offset[0] + 4 && offset[2] == offset[0] + 8;
+			bool float_n = has_normals && !swap && vertex.properties[column[3]].type == PLY_FLOAT32 && vertex.properties[column[4]].type == PLY_FLOAT32 &&
+				vertex.properties[column[5]].type == PLY_FLOAT32 && offset[4] == offset[3] + 4 && offset[5] == offset[3] + 8;
 
-				dst_normals.push_back(n);
+			for (size_t i = 0; i < count; i++) {
+				const char* rec = pos + i * stride;
+				if (float_xyz) {
+					std::memcpy(dst_points[i].data(), rec + offset[0], 3 * sizeof(float));
+				}
+				else {
+					dst_points[i] = Eigen::Vector3f((float)ReadBinary(rec + offset[0], vertex.properties[column[0]].type, swap),
+													(float)ReadBinary(rec + offset[1], vertex.properties[column[1]].type, swap),
+													(float)ReadBinary(rec + offset[2], vertex.properties[column[2]].type, swap));
+				}
+				if (float_n) {
+					std::memcpy(dst_normals[i].data(), rec + offset[3], 3 * sizeof(float));
+				}
+				else if (has_normals) {
+					dst_normals[i] = Eigen::Vector3f((float)ReadBinary(rec + offset[3], vertex.properties[column[3]].type, swap),
+													 (float)ReadBinary(rec + offset[4], vertex.properties[column[4]].type, swap),
+													 (float)ReadBinary(rec + offset[5], vertex.properties[column[5]].type, swap));
+				}
+			}
+		}
+		else {
+			// the vertex element has list properties; walk each record.
+			std::vector<double> values(vertex.properties.size());
+			for (count = 0; count < size; count++) {
+				size_t rs = RecordSize(vertex, pos, end, swap);
+				if (rs == 0) {
+					ErrorMsg("file " + file + " is truncated, found " + std::to_string(count) + " of " + std::to_string(size) + " vertices");
+					break;
+				}
+				const char* rec = pos;
+				for (size_t i = 0; i < values.size(); i++) {
+					const PLYProperty& p = vertex.properties[i];
+					if (p.count_type == PLY_NONE) {
+						values[i] = ReadBinary(rec, p.type, swap);
+						rec += TypeSize(p.type);
+					}
+					else {
+						rec += TypeSize(p.count_type) + size_t(ReadBinary(rec, p.count_type, swap)) * TypeSize(p.type);
+					}
+				}
+				pos += rs;
 
-				count++;
+				dst_points[count] = Eigen::Vector3f((float)values[column[0]], (float)values[column[1]], (float)values[column[2]]);
+				if (has_normals) {
+					dst_normals[count] = Eigen::Vector3f((float)values[column[3]], (float)values[column[4]], (float)values[column[5]]);
+				}
 			}
 		}
+	}
 
+	dst_points.resize(count);
+	dst_normals.resize(count);
 
+	if (has_normals) {
+		for (size_t i = 0; i < count; i++) {
+			if (dst_normals[i].norm() > 1.01f)
+				dst_normals[i].normalize();
+		}
+	}
+	else {
+		std::cout << "[INFO] - ReaderWriterPLY: file " << file << " has no normal vectors." << std::endl;
 	}
 
-	infile.close();
+	mf.close();
 
 	std::cout << "[INFO] - ReaderWriterPLY: loaded " << count << " points and normal vectors from file " << file << "." << std::endl;
 
@@ -129,10 +461,11 @@ Write the point cloud data to a file
 @param dst_points - vector of vector3f points containing x, y, z coordinates
 @param dst_normals - vector of vector3f normal vectors index-aligned to the points.
 @param scale_points - float value > 0.0 that scales all points and normal vectors. 
+@param format - PLY_ASCII or PLY_BINARY_LE. 
 */
 //virtual 
 //static 
-bool ReaderWriterPLY::Write(std::string file, std::vector<Eigen::Vector3f>& src_points, std::vector<Eigen::Vector3f>& src_normals, const float scale_points)
+bool ReaderWriterPLY::Write(std::string file, std::vector<Eigen::Vector3f>& src_points, std::vector<Eigen::Vector3f>& src_normals, const float scale_points, const PLYFormat format)
 {
 	
 	// check if the number of points matches the number of normals
@@ -154,7 +487,12 @@ bool ReaderWriterPLY::Write(std::string file, std::vector<Eigen::Vector3f>& src_
 
 
 	std::ofstream of;
-	of.open(outfile, std::ofstream::out);
+	if (format == PLY_BINARY_LE) {
+		of.open(outfile, std::ofstream::out | std::ofstream::binary);
+	}
+	else {
+		of.open(outfile, std::ofstream::out);
+	}
 
 	size_t size = src_points.size();
 
@@ -162,12 +500,19 @@ bool ReaderWriterPLY::Write(std::string file, std::vector<Eigen::Vector3f>& src_
 		std::cout << "[ERROR] - ReaderWriterPLY: cannot open file " << outfile << " for writing." << std::endl;
 		return false;
 	}
+
+	// points at the origin are not written
+	size_t count = 0;
+	for (size_t i = 0; i < size; i++) {
+		const Eigen::Vector3f& p = src_points[i];
+		if (p[0] || p[1] || p[2]) count++;
+	}
 	
 
 	of << "ply\n";
-	of << "format ascii 1.0\n";
+	of << (format == PLY_BINARY_LE ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
 	of << "comment SurfExtract output\n";
-	of << "element vertex " << size << "\n";
+	of << "element vertex " << count << "\n";
 	of << "property float x\n";
 	of << "property float y\n";
 	of << "property float z\n";
@@ -182,9 +527,15 @@ bool ReaderWriterPLY::Write(std::string file, std::vector<Eigen::Vector3f>& src_
 	T(2,2) = scale_points;
 	Eigen::Matrix3f Tit = (T.inverse()).transpose(); 
 
+	bool swap = !HostIsLittleEndian();
+
+	// binary records are written in blocks
+	const size_t block_size = 4096;
+	std::vector<float> block;
+	if (format == PLY_BINARY_LE) block.reserve(block_size * 6);
 
 
-	for (int i = 0; i < size; i++) {
+	for (size_t i = 0; i < size; i++) {
 
 		Eigen::Vector3f p = src_points[i];
 		Eigen::Vector3f n = src_normals[i];
@@ -193,13 +544,32 @@ bool ReaderWriterPLY::Write(std::string file, std::vector<Eigen::Vector3f>& src_
 		Eigen::Vector3f o_n =  Tit * n;
 				
 		if (p[0] || p[1] || p[2]) {
-			of << std::fixed << scale_points * o_p.x() << " " << scale_points * o_p.y() << " " << scale_points * o_p.z() << " "  << o_n.x() << " " << o_n.y() << " " << o_n.z() << "\n";
+			if (format == PLY_BINARY_LE) {
+				float v[6] = { scale_points * o_p.x(), scale_points * o_p.y(), scale_points * o_p.z(), o_n.x(), o_n.y(), o_n.z() };
+				if (swap) {
+					for (int j = 0; j < 6; j++) {
+						unsigned char* c = reinterpret_cast<unsigned char*>(&v[j]);
+						std::reverse(c, c + 4);
+					}
+				}
+				block.insert(block.end(), v, v + 6);
+				if (block.size() >= block_size * 6) {
+					of.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(float));
+					block.clear();
+				}
+			}
+			else {
+				of << std::fixed << scale_points * o_p.x() << " " << scale_points * o_p.y() << " " << scale_points * o_p.z() << " "  << o_n.x() << " " << o_n.y() << " " << o_n.z() << "\n";
+			}
 		}
 	}
+	if (block.size() > 0) {
+		of.write(reinterpret_cast<const char*>(block.data()), block.size() * sizeof(float));
+	}
 	of.close();
 	
 
-	std::cout << "[INFO] - ReaderWriterPLY: saved " << size << " points and normal vectors to file " << outfile << "." << std::endl;
+	std::cout << "[INFO] - ReaderWriterPLY: saved " << count << " points and normal vectors to file " << outfile << "." << std::endl;
 
 
 	return true;
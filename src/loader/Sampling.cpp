@@ -1,4 +1,5 @@
 #include "Sampling.h"
+#include "Profiler.h"
 
 
 namespace Sampling_ns{
@@ -26,88 +27,24 @@ This filter is voxel based and will put one point into a vocel
 //static 
 void Sampling::Uniform( PointCloud& src, PointCloud& dst, SamplingParam param)
 {	
-    //--------------
-    // find min and max values 
-    float maxX =  std::numeric_limits<float>::min();
-    float maxY =  std::numeric_limits<float>::min();
-    float maxZ =  std::numeric_limits<float>::min();
-    float minX =  std::numeric_limits<float>::max();
-    float minY =  std::numeric_limits<float>::max();
-    float minZ =  std::numeric_limits<float>::max();
-
-    for( auto p : src.points){
-       if(p.x() > maxX) maxX = p.x();
-       if(p.x() < minX) minX = p.x();
-       if(p.y() > maxY) maxY = p.y();
-       if(p.y() < minY) minY = p.y();
-       if(p.z() > maxZ) maxZ = p.z();
-       if(p.z() < minZ) minZ = p.z();
-    }
+	int src_size = (int)src.points.size();
 
-    if(g_verbose && g_verbose_level == 2){
-        cout << "[INFO] Sampling - Min x: " << minX << ", max x: " << maxX << endl;
-        cout << "[INFO] Sampling - Min y: " << minY << ", max y: " << maxY << endl;
-        cout << "[INFO] Sampling - Min z: " << minZ << ", max z: " << maxZ << endl;
-    }
+	// one filter per thread, keeps its buffers between frames.
+	static thread_local VoxelGrid voxel_grid;
 
-    //--------------
-    // calculate the number of voxels for the given grid size. 
-    float dimX  = maxX - minX;
-    float dimY  = maxY - minY;
-    float dimZ  = maxZ - minZ;
-    float voxX = param.grid_x;
-    float voxY = param.grid_y;
-    float voxZ = param.grid_z;
-
-    // size check
-    if(voxX  > dimX ) voxX = dimX;
-    if(voxY  > dimY ) voxY = dimY;
-    if(voxZ  > dimZ ) voxZ = dimZ;
-
-    // number of cells
-    int vx = std::ceil ( dimX / voxX );
-    int vy = std::ceil ( dimY / voxY );
-    int vz = std::ceil ( dimZ / voxZ );
-
-    if(g_verbose  && g_verbose_level == 2){
-        cout << "[INFO] Sampling - Num cells Vx: " << vx << endl;
-        cout << "[INFO] Sampling - Num cells Vy: " << vy << endl;
-        cout << "[INFO] Sampling - Num cells Vz: " << vz << endl;
-    }
+	voxel_grid.setGridSize(param.grid_x, param.grid_y, param.grid_z);
+	voxel_grid.setRepresentative(param.voxel_representative);
+	voxel_grid.setNumThreads(param.num_threads);
 
-	//hashmap, each index correlates to a bool. 0 means empty voxel, 1 = filled. This is pretty fast and space efficient
-	unordered_map<int, bool> hashTable = unordered_map<int, bool>();
-
-	// for min is negative
-    float offset_x = dimX - maxX;
-    float offset_y = dimY - maxY;
-    float offset_z = dimZ - maxZ ;
-
-
-	PointCloud ret = PointCloud();
-    for( int i=0; i<src.points.size(); i++){
-        int idx = ceil((src.points[i].x() + offset_x) / voxX );
-        int idy = ceil((src.points[i].y() + offset_y) / voxY );
-        int idz = ceil((src.points[i].z() + offset_z) / voxZ );
-		int index = idz * (vy * vx) + idy * (vx)+idx;
-        if(hashTable[index] == false)
-        {
-			//check if index already in hash table
-			hashTable[index] == true;
-			//if not, mark it in hashtable adn add to final PC
-			ret.points.push_back(src.points[i]);
-			ret.normals.push_back(src.normals[i]);
-        }
-    }
+	voxel_grid.filter(src, dst);
 
     if(g_verbose && g_verbose_level == 2){
-        cout << "[INFO] - Downsampled fr0m " << src.N << " to " << ret.points.size() << " points. " << endl;
+        cout << "[INFO] - Downsampled fr0m " << src_size << " to " << dst.points.size() << " points. " << endl;
     }
 
     if(g_verbose && g_verbose_level == 1){ 
-        cout << "[INFO] Sampling - Sampling successfull; output contains " << ret.points.size() << " points and normals. "  << endl;
+        cout << "[INFO] Sampling - Sampling successfull; output contains " << dst.points.size() << " points and normals. "  << endl;
     }
-	dst = ret;
 	
 }
 
@@ -149,6 +86,8 @@ Start the sampling procedure
 //static 
 void Sampling::Run(PointCloud& src, PointCloud& dst, bool verbose)
 {
+	TX_PROFILE_SCOPE("sampling");
+
     g_verbose = verbose;
     switch(curr_method){
         case RAW:
@@ -0,0 +1,301 @@
+#include "VoxelGrid.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "ParallelUtils.h"
+
+using namespace texpert;
+
+
+namespace nsVoxelGrid
+{
+	// minimum number of points per thread
+	const int min_chunk = 16384;
+
+	// bits per radix sort pass
+	const int radix_bits = 8;
+	const int radix_size = 1 << radix_bits;
+
+	// the key bits, one bit is reserved to mark invalid points
+	const int max_key_bits = 63;
+
+	// number of bits to store values in [0, cells)
+	int BitsFor(double cells)
+	{
+		int bits = 0;
+		while (bits < 64 && std::ldexp(1.0, bits) < cells) bits++;
+		return bits;
+	}
+}
+
+using namespace nsVoxelGrid;
+
+
+VoxelGrid::VoxelGrid()
+{
+	_grid = Eigen::Vector3f(0.01f, 0.01f, 0.01f);
+	_used_grid = _grid;
+	_representative = VOXEL_FIRST;
+	_num_threads = ParallelUtils::NumThreads();
+}
+
+
+VoxelGrid::~VoxelGrid()
+{
+
+}
+
+
+/*
+Set the voxel size in model units.
+*/
+void VoxelGrid::setGridSize(float grid_x, float grid_y, float grid_z)
+{
+	_grid.x() = std::max(0.0001f, grid_x);
+	_grid.y() = std::max(0.0001f, grid_y);
+	_grid.z() = std::max(0.0001f, grid_z);
+}
+
+
+void VoxelGrid::setRepresentative(VoxelRepresentative representative)
+{
+	_representative = representative;
+}
+
+
+void VoxelGrid::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads <= 0) ? ParallelUtils::NumThreads() : num_threads;
+}
+
+
+Eigen::Vector3f VoxelGrid::getUsedGridSize(void)
+{
+	return _used_grid;
+}
+
+
+/*
+Downsample the point cloud.
+*/
+int VoxelGrid::filter(PointCloud& src, PointCloud& dst)
+{
+	int N = (int)src.points.size();
+	bool has_normals = src.normals.size() == src.points.size();
+
+	if (N == 0) {
+		dst.points.clear();
+		dst.normals.clear();
+		dst.size();
+		return 0;
+	}
+
+	//--------------
+	// bounding box of all finite points
+	int chunks = ParallelUtils::NumChunks(N, _num_threads, min_chunk);
+	std::vector<Eigen::Vector3f> chunk_min(chunks, Eigen::Vector3f::Constant(std::numeric_limits<float>::max()));
+	std::vector<Eigen::Vector3f> chunk_max(chunks, Eigen::Vector3f::Constant(-std::numeric_limits<float>::max()));
+
+	ParallelUtils::For(N, _num_threads, [&](int thread_id, int begin, int end) {
+		Eigen::Vector3f mi = chunk_min[thread_id];
+		Eigen::Vector3f ma = chunk_max[thread_id];
+		for (int i = begin; i < end; i++) {
+			const Eigen::Vector3f& p = src.points[i];
+			if (!p.allFinite()) continue;
+			mi = mi.cwiseMin(p);
+			ma = ma.cwiseMax(p);
+		}
+		chunk_min[thread_id] = mi;
+		chunk_max[thread_id] = ma;
+	}, min_chunk);
+
+	Eigen::Vector3f min = chunk_min[0];
+	Eigen::Vector3f max = chunk_max[0];
+	for (int i = 1; i < chunks; i++) {
+		min = min.cwiseMin(chunk_min[i]);
+		max = max.cwiseMax(chunk_max[i]);
+	}
+
+	if (min.x() > max.x()) { // no finite points
+		dst.points.clear();
+		dst.normals.clear();
+		dst.size();
+		return 0;
+	}
+
+	//--------------
+	// bits per axis. Increase the voxel size if the extent does not fit into the key.
+	Eigen::Vector3f grid = _grid;
+	int bits[3];
+	while (true) {
+		for (int a = 0; a < 3; a++) {
+			double cells = std::floor(double(max[a] - min[a]) / double(grid[a])) + 1.0;
+			bits[a] = BitsFor(cells);
+		}
+		if (bits[0] + bits[1] + bits[2] <= max_key_bits) break;
+		grid *= 2.0f;
+	}
+
+	if (grid != _used_grid && grid != _grid) {
+		std::cout << "[WARNING] - VoxelGrid: the point cloud extent is too large for the voxel size. Using voxel size " << grid.transpose() << "." << std::endl;
+	}
+	_used_grid = grid;
+
+	int key_bits = bits[0] + bits[1] + bits[2];
+	const std::uint64_t invalid = std::uint64_t(1) << key_bits; // sorts after all valid keys
+	Eigen::Vector3f inv_grid = grid.cwiseInverse();
+
+	//--------------
+	// voxel keys
+	_keys.resize(N);
+	_index.resize(N);
+
+	ParallelUtils::For(N, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			const Eigen::Vector3f& p = src.points[i];
+			_index[i] = i;
+			if (!p.allFinite()) {
+				_keys[i] = invalid;
+				continue;
+			}
+			Eigen::Vector3f c = (p - min).cwiseProduct(inv_grid);
+			std::uint64_t x = (std::uint64_t)std::max(0.0f, std::floor(c.x()));
+			std::uint64_t y = (std::uint64_t)std::max(0.0f, std::floor(c.y()));
+			std::uint64_t z = (std::uint64_t)std::max(0.0f, std::floor(c.z()));
+			// rounding at the upper bound
+			x = std::min(x, (std::uint64_t(1) << bits[0]) - 1);
+			y = std::min(y, (std::uint64_t(1) << bits[1]) - 1);
+			z = std::min(z, (std::uint64_t(1) << bits[2]) - 1);
+			_keys[i] = x | (y << bits[0]) | (z << (bits[0] + bits[1]));
+		}
+	}, min_chunk);
+
+	sortKeys(N, key_bits + 1);
+
+	//--------------
+	// voxel ranges in the sorted keys
+	_voxel_start.clear();
+	int valid = N;
+	for (int i = 0; i < N; i++) {
+		if (_keys[i] == invalid) {
+			valid = i;
+			break;
+		}
+		if (i == 0 || _keys[i] != _keys[i - 1]) _voxel_start.push_back(i);
+	}
+	int num_voxels = (int)_voxel_start.size();
+	_voxel_start.push_back(valid);
+
+	// order the voxels by their first point, which is the first point of the range due to the stable sort
+	_voxel_of_point.assign(N, -1);
+	for (int v = 0; v < num_voxels; v++) {
+		_voxel_of_point[_index[_voxel_start[v]]] = v;
+	}
+	_order.clear();
+	for (int i = 0; i < N; i++) {
+		if (_voxel_of_point[i] >= 0) _order.push_back(_voxel_of_point[i]);
+	}
+
+	//--------------
+	// representatives
+	_out_points.resize(num_voxels);
+	_out_normals.resize(has_normals ? num_voxels : 0);
+
+	ParallelUtils::For(num_voxels, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int k = begin; k < end; k++) {
+			int v = _order[k];
+			int first = _index[_voxel_start[v]];
+
+			if (_representative == VOXEL_FIRST) {
+				_out_points[k] = src.points[first];
+				if (has_normals) _out_normals[k] = src.normals[first];
+				continue;
+			}
+
+			Eigen::Vector3f sum_p = Eigen::Vector3f::Zero();
+			Eigen::Vector3f sum_n = Eigen::Vector3f::Zero();
+			for (int j = _voxel_start[v]; j < _voxel_start[v + 1]; j++) {
+				sum_p += src.points[_index[j]];
+				if (has_normals) sum_n += src.normals[_index[j]];
+			}
+			_out_points[k] = sum_p / float(_voxel_start[v + 1] - _voxel_start[v]);
+
+			if (!has_normals) continue;
+
+			if (_representative == VOXEL_NORMAL_AVERAGE && sum_n.norm() > 1e-6f) {
+				_out_normals[k] = sum_n.normalized();
+			}
+			else {
+				_out_normals[k] = src.normals[first];
+			}
+		}
+	}, min_chunk / 8);
+
+	// swap the results into dst. This also works if &src == &dst.
+	dst.points.swap(_out_points);
+	dst.normals.swap(_out_normals);
+	dst.size();
+
+	return dst.N;
+}
+
+
+/*
+Sort _keys and _index by the lowest bits of the key with a parallel LSD radix sort.
+Each thread counts and scatters its own contiguous chunk, which keeps the sort stable.
+*/
+void VoxelGrid::sortKeys(int size, int bits)
+{
+	int chunks = ParallelUtils::NumChunks(size, _num_threads, min_chunk);
+	int passes = (bits + radix_bits - 1) / radix_bits;
+
+	_keys_tmp.resize(size);
+	_index_tmp.resize(size);
+	_counts.resize(chunks * radix_size);
+
+	for (int pass = 0; pass < passes; pass++) {
+		int shift = pass * radix_bits;
+
+		// histogram per chunk
+		ParallelUtils::For(size, _num_threads, [&](int thread_id, int begin, int end) {
+			int* count = &_counts[thread_id * radix_size];
+			std::fill(count, count + radix_size, 0);
+			for (int i = begin; i < end; i++) {
+				count[(_keys[i] >> shift) & (radix_size - 1)]++;
+			}
+		}, min_chunk);
+
+		// skip the pass if all keys have the same digit
+		bool skip = false;
+		for (int d = 0; d < radix_size && !skip; d++) {
+			int total = 0;
+			for (int t = 0; t < chunks; t++) total += _counts[t * radix_size + d];
+			if (total == size) skip = true;
+		}
+		if (skip) continue;
+
+		// start position of each digit and chunk
+		int sum = 0;
+		for (int d = 0; d < radix_size; d++) {
+			for (int t = 0; t < chunks; t++) {
+				int c = _counts[t * radix_size + d];
+				_counts[t * radix_size + d] = sum;
+				sum += c;
+			}
+		}
+
+		ParallelUtils::For(size, _num_threads, [&](int thread_id, int begin, int end) {
+			int* pos = &_counts[thread_id * radix_size];
+			for (int i = begin; i < end; i++) {
+				int p = pos[(_keys[i] >> shift) & (radix_size - 1)]++;
+				_keys_tmp[p] = _keys[i];
+				_index_tmp[p] = _index[i];
+			}
+		}, min_chunk);
+
+		_keys.swap(_keys_tmp);
+		_index.swap(_index_tmp);
+	}
+}
@@ -1,10 +1,43 @@
 #include "ICP.h"
+#include "Profiler.h"
+#include "ParallelUtils.h"
 
 
+namespace nsICP
+{
+	// min. number of test points per thread for projective correspondences
+	const int min_projective_chunk = 1024;
+
+	// max. half size of the projective search window
+	const int max_window = 16;
+
+	// min. number of test points per thread for the rejection, accumulation, and transformation pass
+	const int min_fused_chunk = 2048;
+
+
+	// Project a point into the depth image, in sampled pixels. 
+	// This is the inverse of the projection in the point cloud production (cuPCU3f). 
+	// @return false if the point is behind the camera or far outside the image. 
+	inline bool Project(const DepthIntrinsics& c, const Eigen::Vector3f& p, int& u, int& v)
+	{
+		if (p.z() <= 0.0f) return false;
+
+		float i = (c.width / 2) - (p.x() - c.cx) * c.fx / p.z();
+		float j = (c.height / 2) - (p.y() - c.cy) * c.fy / p.z();
+		if (!(i > -c.width && i < 2 * c.width && j > -c.height && j < 2 * c.height)) return false;
+
+		u = (int)std::floor(i / c.step + 0.5f);
+		v = (int)std::floor(j / c.step + 0.5f);
+		return true;
+	}
+}
+
+using namespace nsICP;
+
 
 using namespace  texpert;
 
-ICP::ICP() {
+ICP::ICP(KdTreeBackend backend) {
 
 	_max_error = 0.0001;
 	_max_iterations = 20;
@@ -13,8 +46,28 @@ ICP::ICP() {
 	_verbose_level = 0;
 
 	_Rt_initial = Eigen::Matrix4f::Identity();
-
-	_knn = new KNN();
+	_rotation_center = Eigen::Vector3f::Zero();
+
+	_backend = backend;
+	_knn = new KNN(_backend);
+	_knn_ready = false;
+	_camera = &_cameraPoints;
+	_camera_key = 0;
+	_inlier_fraction = 0.0f;
+	_iterations = 0;
+	_converged = false;
+	_num_threads = ParallelUtils::NumThreads();
+
+	_metric = POINT_TO_POINT;
+	_correspondence = KNN_SEARCH;
+	_window = 2;
+	_pixel_cols = 0;
+	_pixel_rows = 0;
+	_pixel_ready = false;
+
+	_active_camera = &_cameraPoints;
+	_active_level = -1;
+	_voxel_grid.setRepresentative(VOXEL_NORMAL_AVERAGE);
 
 	_outlier_rejectmethod = ICPReject::DIST_ANG;
 	_outlier_reject.setMaxNormalVectorAngle(45.0f);
@@ -26,6 +79,7 @@ ICP::ICP() {
 
 ICP::~ICP(){
 
+	clearCameraLevels();
 	delete _knn;
 }
 
@@ -43,12 +97,84 @@ bool ICP::setCameraData(PointCloud& pc) {
 	}
 
 	_cameraPoints = pc;
+	_camera = &_cameraPoints;
+	_camera_key = 0;
+
+	// the kd-tree or the pixel index is created in compute(), depending on the correspondence mode. 
+	_knn_ready = false;
+	_pixel_ready = false;
+
+	// the pyramid levels are downsampled again when they are used. 
+	for (CameraLevel& cl : _camera_levels) {
+		cl.filtered = false;
+	}
+	return true;
+}
+
+
+/*
+Set the reference point cloud without copying it. 
+*/
+bool ICP::setCameraDataRef(PointCloud& pc, std::uint64_t key) {
+
+	if (pc.size() <= 0) {
+		std::cout << "[ERROR] ICP: no camera points given. " << std::endl;
+		return false;
+	}
+
+	_cameraPoints = PointCloud();
+	_camera = &pc;
+	_camera_key = key;
+
+	_knn_ready = false;
+	_pixel_ready = false;
+
+	for (CameraLevel& cl : _camera_levels) {
+		cl.filtered = false;
+	}
+	return true;
+}
+
+/*
+Set the downsampled camera points of a pyramid level without copying them. 
+*/
+bool ICP::setCameraLevelRef(float voxel_size, PointCloud& pc, std::uint64_t key) {
+
+	if (voxel_size <= 0.0f || pc.size() <= 0) {
+		std::cout << "[ERROR] ICP: no camera points or no voxel size given for the pyramid level. " << std::endl;
+		return false;
+	}
+
+	CameraLevel& cl = _camera_levels[findCameraLevel(voxel_size)];
+	cl.shared = &pc;
+	cl.key = key;
+	cl.filtered = true;
+	cl.ready = false;
+	return true;
+}
 
-	_knn->reset();
-	_knn->populate(pc);
+
+/*
+Set the downsampled model points of a pyramid level for the next compute() call. 
+*/
+bool ICP::setModelLevelRef(float voxel_size, PointCloud& pc) {
+
+	if (voxel_size <= 0.0f || pc.size() <= 0) {
+		std::cout << "[ERROR] ICP: no model points or no voxel size given for the pyramid level. " << std::endl;
+		return false;
+	}
+
+	for (std::pair<float, PointCloud*>& ml : _model_level_refs) {
+		if (ml.first == voxel_size) {
+			ml.second = &pc;
+			return true;
+		}
+	}
+	_model_level_refs.push_back(std::make_pair(voxel_size, &pc));
 	return true;
 }
 
+
 /*
 Set the test model, this is tested agains the 
 reference model in the kd-tree
@@ -68,8 +194,14 @@ bool  ICP::compute(PointCloud& pc, Pose initial_pose, Eigen::Matrix4f& result_po
 // note that the two point clouds must be equal for this test. 
 	return test_rejection(pc, initial_pose,  result_pose,  rms);
 #endif
+	TX_PROFILE_SCOPE("icp");
+
 	_Rt_initial = initial_pose.t.matrix();
 	_Rt_affine = initial_pose.t;
+
+	// the shared model levels apply to this call only
+	_model_levels.swap(_model_level_refs);
+	_model_level_refs.clear();
 	
 	// TODO: copies all points into a new object. Line 90, 91 does the same. Why?
 	// remember the test points
@@ -90,137 +222,207 @@ bool  ICP::compute(PointCloud& pc, Pose initial_pose, Eigen::Matrix4f& result_po
 	_t_all = Eigen::Vector3f(0.0, 0.0, 0.0);
 	_Rt_final = Eigen::Matrix4f::Identity();
 
-	// TODO: Remove teh manual copy since the code in line 70 already copies the points. 
-	// copy test points into a new struct
-	vector<Vector3f> in0, nn0;
-	std::copy(_testPoints.points.begin(), _testPoints.points.end(), back_inserter(in0));
-	std::copy(_testPoints.normals.begin(), _testPoints.normals.end(), back_inserter(nn0));
+	// copy the test points and apply the initial pose. 
+	// The memory of all buffers is reused, so the iterations do not allocate memory after the first frame. 
+	Matrix3f R0 = initial_pose.t.rotation();
+	Vector3f t0 = initial_pose.t.translation();
+	const int num_points = (int)_testPoints.points.size();
+	_testPointsInitial.points.resize(num_points);
+	_testPointsInitial.normals.resize(num_points);
+	ParallelUtils::For(num_points, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			_testPointsInitial.points[i] = (R0 * _testPoints.points[i]) + t0;
+			_testPointsInitial.normals[i] = R0 * _testPoints.normals[i];
+		}
+	}, min_fused_chunk);
+	_testPointsInitial.size();
 
-	// Apply the initial rotation to all copied test points
-	Matrix3f R = initial_pose.t.rotation();
-	Vector3f t = initial_pose.t.translation();
-	for_each(in0.begin(), in0.end(), [&](Vector3f& p){p = (R * p) + t;});
-	for_each(nn0.begin(), nn0.end(), [&](Vector3f& n){n = (R * n);});
+	// the rotation center, the centroid of the test points. It moves with the test points. 
+	_testPoint_centroid = ICPTransform::CalculateCentroid(_testPointsInitial.points);
+	const Vector3f centroid0 = _testPoint_centroid;
+	_rotation_center = centroid0;
 
-	// prepare for knn
-	_testPointsProcessing.points = in0;
-	_testPointsProcessing.normals = nn0;
-	_testPointsProcessing.size();
+	const bool use_normals = (_metric != POINT_TO_POINT);
+	const bool symmetric = (_metric == SYMMETRIC);
 
-	// reserve memory for all aligning points. 
-	// matching_points are camera points that were selected as nearest neighbosr
-	// accepted_points contains the model points that survived the outlier test. 
-	std::vector<Eigen::Vector3f> matching_points, accepted_points;
-	matching_points.reserve(_testPointsProcessing.size());
-	accepted_points.reserve(_testPointsProcessing.size());
+	// Without a pyramid, ICP runs one level with all points. 
+	const size_t num_levels = std::max((size_t)1, _levels.size());
 
 	if(_verbose && _verbose_level == 2)
 			cout << "\n[ICP] - Start to register." << endl;
 
 	// the loop expects that both vectors are already index aligned. 
 	int itr = 0;
-	// search for nearest neighbors
-	
-	for (int i = 0; i < _max_iterations; i++)
-	{
-
-		_local_matches.clear();
-		_local_matches.reserve(_testPointsProcessing.size());
+	bool stop = false;
+	_inlier_fraction = 0.0f;
+	_iterations = 0;
+	_converged = false;
 
-		// find nearest neighbors
-		_knn->knn(_testPointsProcessing, 1, _local_matches);
-
-		matching_points.clear();
-		accepted_points.clear();
-
-		// Reject nearest neighbors that are most likely outliers. 
-		// get a vector with all the matching points. 
-		for_each(_local_matches.begin(), _local_matches.end(), [&](Matches m )
-		{
-			if( _outlier_reject.test(_testPointsProcessing.points[m.matches[0].first ], _cameraPoints.points[m.matches[0].second],
-									 _testPointsProcessing.normals[m.matches[0].first ], _cameraPoints.normals[m.matches[0].second], _outlier_rejectmethod))
-			{
-				 matching_points.push_back(_cameraPoints.points[m.matches[0].second]);
-				 accepted_points.push_back(_testPointsProcessing.points[m.matches[0].first ] );
-			}
-		});
+	for (size_t l = 0; l < num_levels && !stop; l++)
+	{
+		const ICPLevel level = _levels.empty() ? ICPLevel(0.0f, _max_iterations) : _levels[l];
+		const bool last_level = (l + 1 == num_levels);
 
-		// Check if sufficient points are available to register the points
-		if (matching_points.size() < 16) {
-			cout << "[ICP] - Break: insufficient points after outlier rejection." << endl;
-			result_pose = overall;
-			if(_verbose && _verbose_level == 2)
-				MatrixUtils::PrintMatrix4f(result_pose);
-			return false;
+		// prepare the test points and the camera points of this level
+		if (level.voxel_size > 0.0f) {
+			prepareLevel(level, initial_pose, centroid0);
+		}
+		else {
+			// all points, moved to the current pose
+			_testPointsProcessing.points.resize(num_points);
+			_testPointsProcessing.normals.resize(num_points);
+			ParallelUtils::For(num_points, _num_threads, [&](int thread_id, int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					_testPointsProcessing.points[i] = (_R_all * (_testPointsInitial.points[i] - centroid0)) + _testPoint_centroid;
+					_testPointsProcessing.normals[i] = _R_all * _testPointsInitial.normals[i];
+				}
+			}, min_fused_chunk);
+			_active_camera = _camera;
+			_active_level = -1;
 		}
+		_testPointsProcessing.size();
 
-		//  Calculate the rotation delta
-		Matrix3f R = ICPTransform::CalcRotationArun(accepted_points, matching_points);
-		Vector3f t = ICPTransform::CalculateTranslation(accepted_points, matching_points);
-		Matrix3f R_inv = R;// Matrix3f::Identity();
-		//R =  Matrix3f::Identity();
-	
+		// the outlier rejection thresholds of this level
+		_level_reject = _outlier_reject;
+		if (level.reject_distance > 0.0f) _level_reject.setMaxThreshold(level.reject_distance);
+		if (level.reject_angle > 0.0f) _level_reject.setMaxNormalVectorAngle(level.reject_angle);
 
-		result = Matrix4f::Identity();
-		// maintaining row-major
-		result(0) = R_inv(0);
-		result(1) = R_inv(1);
-		result(2) = R_inv(2);
+		if(_verbose && _verbose_level == 2 && num_levels > 1)
+			cout << "[ICP] - Level " << l << " with " << _testPointsProcessing.size() << " test points and " << _active_camera->points.size() << " camera points." << endl;
 
-		result(4) = R_inv(3);
-		result(5) = R_inv(4);
-		result(6) = R_inv(5);
+		float last_rms = 100000000.0;
+		rms = 100000000.0;
 
-		result(8) = R_inv(6);
-		result(9) = R_inv(7);
-		result(10) = R_inv(8);
+		for (int i = 0; i < level.max_iterations; i++)
+		{
+			TX_PROFILE_SCOPE("icp_iteration");
 
-		result(12) = t.x();
-		result(13) = t.y();
-		result(14) = t.z();
-		result(15) = 1.0;
+			// find the corresponding camera points
+			findCorrespondences();
 
-		//cout << "R -> "  << R << endl;
-		//cout << "T -> "  << t.x() << "\t" << t.y() << "\t" << t.z() << std::endl;
+			// Reject nearest neighbors that are most likely outliers and 
+			// accumulate the sums of all remaining pairs in one pass. 
+			const ICPSums& sums = accumulateMatches(_metric);
+			_inlier_fraction = (float)sums.count / std::max(1, _testPointsProcessing.size());
 
+			// Check if sufficient points are available to register the points
+			if (sums.count < 16) {
+				// a coarse level can have too few points. Continue with the next level. 
+				if (!last_level) {
+					if(_verbose && _verbose_level == 2)
+						cout << "[ICP] - Insufficient points on level " << l << ", continue with the next level." << endl;
+					break;
+				}
+
+				TX_PROFILE_COUNT("icp_iterations", itr);
+				_iterations = itr;
+				cout << "[ICP] - Break: insufficient points after outlier rejection." << endl;
+				result_pose = overall;
+				if(_verbose && _verbose_level == 2)
+					MatrixUtils::PrintMatrix4f(result_pose);
+				return false;
+			}
 
-		_testPoint_centroid = ICPTransform::CalculateCentroid(_testPointsProcessing.points);
+			//  Calculate the rotation delta
+			Matrix3f R;
+			Vector3f t;
+			bool plane_solved = use_normals && ICPTransform::SolvePointToPlane(sums.A, sums.g, sums.c, sums.count, symmetric, R, t, rms);
+			if (!plane_solved) {
+				// point-to-point, or a fallback if the point-to-plane system is degenerate. 
+				// The fallback needs a second pass, the matches do not change. 
+				if (use_normals) accumulateMatches(POINT_TO_POINT);
+
+				// the centroids of the accepted points and their matches, relative to the rotation center
+				Vector3f avg0 = (sums.p / sums.count).cast<float>();
+				Vector3f avg1 = (sums.q / sums.count).cast<float>();
+
+				// The cross-covariance of the centered points: sum (p - avg0)(q - avg1)^T = sum p q^T - n avg0 avg1^T
+				Matrix3d W = sums.cov - (sums.p * sums.q.transpose()) / sums.count;
+				R = ICPTransform::RotationFromCovariance(W.cast<float>());
+				t = avg1 - avg0;
+			}
+			Matrix3f R_inv = R;// Matrix3f::Identity();
+			//R =  Matrix3f::Identity();
+		
 
-		// update the point transformation
-		/// TODO: performance teste. Which function is faster for_each vs. std::transform
-		// p' = (R * p) + t;
-		for_each(accepted_points.begin(), accepted_points.end(), [&](Vector3f& p){p = (R * (p - _testPoint_centroid)) + (t + _testPoint_centroid) ;});
+			result = Matrix4f::Identity();
+			// maintaining row-major
+			result(0) = R_inv(0);
+			result(1) = R_inv(1);
+			result(2) = R_inv(2);
+
+			result(4) = R_inv(3);
+			result(5) = R_inv(4);
+			result(6) = R_inv(5);
+
+			result(8) = R_inv(6);
+			result(9) = R_inv(7);
+			result(10) = R_inv(8);
+
+			result(12) = t.x();
+			result(13) = t.y();
+			result(14) = t.z();
+			result(15) = 1.0;
+
+			//cout << "R -> "  << R << endl;
+			//cout << "T -> "  << t.x() << "\t" << t.y() << "\t" << t.z() << std::endl;
+
+			// The rms of the accepted pairs after the update, from the sums: 
+			// sum |R p + t - q|^2 = sum |p|^2 + sum |q|^2 + n |t|^2 + 2 t^T (R sum p - sum q) - 2 trace(R sum p q^T)
+			// The point-to-plane solver already returns the rms after the update. 
+			if (!plane_solved) {
+				Matrix3d Rd = R.cast<double>();
+				Vector3d td = t.cast<double>();
+				double res = sums.pp + sums.qq + sums.count * td.squaredNorm() + 2.0 * td.dot(Rd * sums.p - sums.q) - 2.0 * (Rd * sums.cov).trace();
+				rms = (float)std::sqrt(std::max(0.0, res) / sums.count);
+			}
 
+			// transform the original points and normal vectors
+			// p' = R * (p - c) + t + c;
+			transformTestPoints(R, t);
+		
+			overall =    result * overall;
 		
+			_R_all = R * _R_all;
+			_t_all = t + _t_all;
+			_testPoint_centroid = _testPoint_centroid + t;
 
-	//	cout << "before " << _testPointsProcessing.points[0].x() <<  ",  " << _testPointsProcessing.points[0].y() <<  ", " << _testPointsProcessing.points[0].z() << endl;
-		// transform the original points and normal vectors
-		for_each(_testPointsProcessing.points.begin(), _testPointsProcessing.points.end(), [&](Vector3f& p){p = (R * (p - _testPoint_centroid)) + (t + _testPoint_centroid) ;});
-		for_each(_testPointsProcessing.normals.begin(), _testPointsProcessing.normals.end(), [&](Vector3f& n){n = (R * n);});
-	//	cout << "after " << _testPointsProcessing.points[0].x() <<  ",  " << _testPointsProcessing.points[0].y() << ", " << _testPointsProcessing.points[0].z() << endl;
-	
-		overall =    result * overall;
-	
-		_R_all = R * _R_all;
-		_t_all = t + _t_all;
 
+			if(_verbose && _verbose_level == 2)
+					MatrixUtils::PrintMatrix4f(result);
 
-		if(_verbose && _verbose_level == 2)
-				MatrixUtils::PrintMatrix4f(result);
+			itr++;
 
-		itr++;
-		rms = ICPTransform::CheckRMS(accepted_points,  matching_points);
+			if(_verbose && _verbose_level == 2)
+				cout << "[ICP] - RMS: " << rms << " at " << itr << "." << endl;
 
-		if(_verbose && _verbose_level == 2)
-			cout << "[ICP] - RMS: " << rms << " at " << itr << "." << endl;
 
 
 
+			if (rms < _max_error) {
+				_converged = last_level;
+				break;
+			}
 
-		if (rms < _max_error) break;
+			// the caller can stop the iterations, e.g., to abort a bad pose hypothesis
+			if (_iteration_callback && !_iteration_callback(itr, rms)) {
+				stop = true;
+				break;
+			}
 
-		
+			// the rms does not reach 0 with noisy data. Stop if it does not change anymore. 
+			if (std::fabs(last_rms - rms) < _max_error) {
+				_converged = last_level;
+				break;
+			}
+			last_rms = rms;
+
+			
+		}
 	}
+	TX_PROFILE_COUNT("icp_iterations", itr);
+	_iterations = itr;
+
 	_Rt_final = overall;
 	result_pose =  overall;
 
@@ -241,6 +443,314 @@ bool  ICP::compute(PointCloud& pc, Pose initial_pose, Eigen::Matrix4f& result_po
 }
 
 
+/*
+Find the corresponding camera point of each test point and write them into _local_matches.
+*/
+void ICP::findCorrespondences(void)
+{
+	if (_correspondence == PROJECTIVE) {
+		findProjective();
+		return;
+	}
+
+	// the downsampled camera points of a pyramid level
+	if (_active_level >= 0) {
+		CameraLevel& cl = _camera_levels[_active_level];
+		if (!cl.ready) {
+			cl.knn->populateCached(PointView(_active_camera->points), cl.key);
+			cl.ready = true;
+		}
+		cl.knn->knn(PointView(_testPointsProcessing.points), 1, _local_matches);
+		return;
+	}
+
+	if (!_knn_ready) {
+		// reuse the kd-tree if the camera points did not change, e.g., for a static scene or multiple objects. 
+		_knn->populateCached(PointView(_camera->points), _camera_key);
+		_knn_ready = true;
+	}
+
+	// find nearest neighbors. The view does not copy the points. 
+	_knn->knn(PointView(_testPointsProcessing.points), 1, _local_matches);
+}
+
+
+/*
+Reject the outliers among the matches and accumulate the sums of all accepted pairs. 
+*/
+const ICP::ICPSums& ICP::accumulateMatches(Metric metric)
+{
+	TX_PROFILE_SCOPE("icp_accumulate");
+
+	const int n = _testPointsProcessing.size();
+	const int num_threads = _num_threads;
+	const int chunks = ParallelUtils::NumChunks(n, num_threads, min_fused_chunk);
+
+	// the chunk sums are kept between iterations and frames
+	if ((int)_chunk_sums.size() < chunks) _chunk_sums.resize(chunks);
+
+	const PointCloud& camera = *_active_camera;
+	const Vector3f c = _testPoint_centroid;
+	const bool use_normals = (metric != POINT_TO_POINT);
+	const bool symmetric = (metric == SYMMETRIC);
+
+	ParallelUtils::For(n, num_threads, [&](int thread_id, int begin, int end) {
+		ICPSums& s = _chunk_sums[thread_id];
+		s.setZero();
+
+		for (int j = begin; j < end; j++)
+		{
+			if (_local_matches.count(j) == 0) continue;
+			int id = _local_matches.indices[_local_matches.begin(j)];
+
+			const Vector3f& p = _testPointsProcessing.points[j];
+			const Vector3f& q = camera.points[id];
+			const Vector3f& np = _testPointsProcessing.normals[j];
+			const Vector3f& nq = camera.normals[id];
+
+			if (!_level_reject.accept(p, q, np, nq, _outlier_rejectmethod)) continue;
+
+			s.count++;
+			if (use_normals) {
+				ICPTransform::AccumulatePointToPlane(p, q, np, nq, c, symmetric, s.A, s.g, s.c);
+				continue;
+			}
+
+			// the points relative to the rotation center keep the sums small
+			Vector3d pc = (p - c).cast<double>();
+			Vector3d qc = (q - c).cast<double>();
+
+			s.p += pc;
+			s.q += qc;
+			s.pp += pc.squaredNorm();
+			s.qq += qc.squaredNorm();
+			s.cov.noalias() += pc * qc.transpose();
+		}
+	}, min_fused_chunk);
+
+	// sum the chunks in order, so the result does not depend on the threads
+	_sums.setZero();
+	for (int k = 0; k < chunks; k++) {
+		const ICPSums& s = _chunk_sums[k];
+		_sums.count += s.count;
+		if (use_normals) {
+			_sums.A += s.A;
+			_sums.g += s.g;
+			_sums.c += s.c;
+		}
+		else {
+			_sums.p += s.p;
+			_sums.q += s.q;
+			_sums.pp += s.pp;
+			_sums.qq += s.qq;
+			_sums.cov += s.cov;
+		}
+	}
+
+	return _sums;
+}
+
+
+/*
+Move the test points and normal vectors of the current level by one iteration. 
+*/
+void ICP::transformTestPoints(const Matrix3f& R, const Vector3f& t)
+{
+	TX_PROFILE_SCOPE("icp_transform");
+
+	const Vector3f c = _testPoint_centroid;
+	const Vector3f tc = t + c;
+
+	ParallelUtils::For(_testPointsProcessing.size(), _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			Vector3f& p = _testPointsProcessing.points[i];
+			Vector3f& n = _testPointsProcessing.normals[i];
+			p = (R * (p - c)) + tc;
+			n = R * n;
+		}
+	}, min_fused_chunk);
+}
+
+
+/*
+Find correspondences by projecting the test points into the depth image. 
+*/
+void ICP::findProjective(void)
+{
+	TX_PROFILE_SCOPE("icp_projective");
+
+	if (!_pixel_ready) {
+		createPixelIndex();
+	}
+
+	int n = (int)_testPointsProcessing.points.size();
+	_projective_matches.resize(n);
+
+	ParallelUtils::For(n, _num_threads, [&](int thread_id, int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			const Vector3f& p = _testPointsProcessing.points[i];
+			_projective_matches[i] = std::make_pair(-1, 0.0f);
+
+			int u, v;
+			if (!Project(_intrinsics, p, u, v)) continue;
+
+			int u_min = std::max(0, u - _window);
+			int u_max = std::min(_pixel_cols - 1, u + _window);
+			int v_min = std::max(0, v - _window);
+			int v_max = std::min(_pixel_rows - 1, v + _window);
+
+			// the closest camera point in the window
+			int best = -1;
+			float best_dist = 0.0f;
+			for (int y = v_min; y <= v_max; y++) {
+				const int* row = &_pixel_index[y * _pixel_cols];
+				for (int x = u_min; x <= u_max; x++) {
+					int id = row[x];
+					if (id < 0) continue;
+
+					float d = (_camera->points[id] - p).squaredNorm();
+					if (best < 0 || d < best_dist) {
+						best = id;
+						best_dist = d;
+					}
+				}
+			}
+			_projective_matches[i] = std::make_pair(best, best_dist);
+		}
+	}, min_projective_chunk);
+
+	// one or no match per test point
+	_local_matches.clear();
+	_local_matches.offsets.resize(n + 1);
+	_local_matches.offsets[0] = 0;
+	for (int i = 0; i < n; i++) {
+		if (_projective_matches[i].first >= 0) {
+			_local_matches.indices.push_back(_projective_matches[i].first);
+			_local_matches.distances.push_back(_projective_matches[i].second);
+		}
+		_local_matches.offsets[i + 1] = (int)_local_matches.indices.size();
+	}
+}
+
+
+/*
+Project all camera points into the depth image and store their indices per pixel. 
+*/
+void ICP::createPixelIndex(void)
+{
+	const int step = _intrinsics.step;
+	_pixel_cols = (_intrinsics.width + step - 1) / step;
+	_pixel_rows = (_intrinsics.height + step - 1) / step;
+	_pixel_index.assign(_pixel_cols * _pixel_rows, -1);
+
+	int n = (int)_camera->points.size();
+	for (int i = 0; i < n; i++) {
+		const Vector3f& p = _camera->points[i];
+
+		int u, v;
+		if (!Project(_intrinsics, p, u, v)) continue;
+		if (u < 0 || u >= _pixel_cols || v < 0 || v >= _pixel_rows) continue;
+
+		// keep the point closest to the camera if two points fall into one pixel
+		int& id = _pixel_index[v * _pixel_cols + u];
+		if (id < 0 || p.z() < _camera->points[id].z()) {
+			id = i;
+		}
+	}
+
+	_pixel_ready = true;
+}
+
+
+/*
+Downsample the test points for a pyramid level and move them to the current pose. 
+Select the camera points of the level. 
+*/
+void ICP::prepareLevel(const ICPLevel& level, Pose& initial_pose, const Vector3f& centroid0)
+{
+	TX_PROFILE_SCOPE("icp_level");
+
+	_voxel_grid.setGridSize(level.voxel_size, level.voxel_size, level.voxel_size);
+
+	// the test points, downsampled or shared with setModelLevelRef()
+	const PointCloud* model = NULL;
+	for (const std::pair<float, PointCloud*>& ml : _model_levels) {
+		if (ml.first == level.voxel_size) model = ml.second;
+	}
+	if (model == NULL) {
+		_voxel_grid.filter(_testPoints, _model_level);
+		model = &_model_level;
+	}
+
+	// move them by the initial pose and the iterations of the previous levels
+	Matrix3f R = _R_all * initial_pose.t.rotation();
+	Vector3f t = _R_all * (initial_pose.t.translation() - centroid0) + _testPoint_centroid;
+
+	int n = (int)model->points.size();
+	_testPointsProcessing.points.resize(n);
+	_testPointsProcessing.normals.resize(n);
+	for (int i = 0; i < n; i++) {
+		_testPointsProcessing.points[i] = R * model->points[i] + t;
+		_testPointsProcessing.normals[i] = R * model->normals[i];
+	}
+
+	// projective correspondences search all camera points
+	if (_correspondence == PROJECTIVE) {
+		_active_camera = _camera;
+		_active_level = -1;
+		return;
+	}
+
+	// the camera points, downsampled once per camera frame or shared with setCameraLevelRef()
+	_active_level = findCameraLevel(level.voxel_size);
+
+	CameraLevel& cl = _camera_levels[_active_level];
+	if (!cl.filtered) {
+		_voxel_grid.filter(*_camera, cl.points);
+		cl.shared = NULL;
+		cl.key = 0;
+		cl.filtered = true;
+		cl.ready = false;
+	}
+	_active_camera = cl.shared ? cl.shared : &cl.points;
+}
+
+
+/*
+Delete the downsampled camera points of all levels. 
+*/
+void ICP::clearCameraLevels(void)
+{
+	for (CameraLevel& cl : _camera_levels) {
+		delete cl.knn;
+	}
+	_camera_levels.clear();
+	_active_camera = _camera;
+	_active_level = -1;
+}
+
+
+/*
+Return the index of the camera level with this voxel size. The level is created if it does not exist. 
+*/
+int ICP::findCameraLevel(float voxel_size)
+{
+	for (size_t i = 0; i < _camera_levels.size(); i++) {
+		if (_camera_levels[i].voxel_size == voxel_size) return (int)i;
+	}
+
+	CameraLevel cl;
+	cl.voxel_size = voxel_size;
+	cl.shared = NULL;
+	cl.key = 0;
+	cl.knn = new KNN(_backend);
+	cl.filtered = false;
+	cl.ready = false;
+	_camera_levels.push_back(cl);
+	return (int)_camera_levels.size() - 1;
+}
+
+
 Matrix4f ICP::Rt(void){
 
 	Eigen::Matrix4f finalRt = Eigen::Matrix4f::Identity();
@@ -517,7 +1027,7 @@ The kd-tree and the test points - both need to have points
 */
 bool ICP::ready(void)
 {
-	if (_testPoints.size() <= 0 || _cameraPoints.size() <= 0) {
+	if (_testPoints.size() <= 0 || _camera->size() <= 0) {
 		std::cout << "[ERROR] ICP: no points given. " << std::endl;
 		return false;
 	}
@@ -594,6 +1104,167 @@ void ICP::setRejectionMethod(ICPReject::Testcase method)
 }
 
 
+/*
+Set the levels for coarse-to-fine registration. 
+@param levels - the pyramid levels. An empty vector runs one level with all points. 
+*/
+void ICP::setPyramid(const std::vector<ICPLevel>& levels)
+{
+	_levels = levels;
+
+	for (ICPLevel& level : _levels) {
+		if (level.voxel_size < 0.0f || level.max_iterations < 1 || level.max_iterations > 1000 || level.reject_distance < 0.0f || level.reject_angle < 0.0f || level.reject_angle > 180.0f) {
+			std::cout << "[ERROR] - ICP pyramid level parameters out of range. Values clamped to voxel size >= 0, iterations [1, 1000], distance >= 0, and angle [0, 180]." << std::endl;
+		}
+		level.voxel_size = std::max(0.0f, level.voxel_size);
+		level.max_iterations = std::min(1000, std::max(1, level.max_iterations));
+		level.reject_distance = std::max(0.0f, level.reject_distance);
+		level.reject_angle = std::min(180.0f, std::max(0.0f, level.reject_angle));
+	}
+
+	// the camera levels are created again for the new voxel sizes
+	clearCameraLevels();
+}
+
+
+/*
+Return the pyramid levels. 
+*/
+std::vector<ICPLevel> ICP::getPyramid(void)
+{
+	return _levels;
+}
+
+
+/*
+Set the error metric that ICP minimizes. 
+@param metric - POINT_TO_POINT, POINT_TO_PLANE, or SYMMETRIC. Default is POINT_TO_POINT. 
+*/
+void ICP::setErrorMetric(Metric metric)
+{
+	_metric = metric;
+}
+
+
+/*
+Return the error metric. 
+*/
+ICP::Metric ICP::getErrorMetric(void)
+{
+	return _metric;
+}
+
+
+/*
+Set how ICP finds the camera point that corresponds to a model point. 
+@param mode - KNN_SEARCH or PROJECTIVE. Default is KNN_SEARCH. 
+*/
+void ICP::setCorrespondenceMode(Correspondence mode)
+{
+	if (mode == PROJECTIVE && !_intrinsics.valid()) {
+		std::cout << "[ERROR] - ICP: projective correspondences require the camera intrinsics. Call setCameraIntrinsics() first. Using KNN_SEARCH." << std::endl;
+		mode = KNN_SEARCH;
+	}
+	_correspondence = mode;
+}
+
+
+/*
+Return the correspondence mode. 
+*/
+ICP::Correspondence ICP::getCorrespondenceMode(void)
+{
+	return _correspondence;
+}
+
+
+/*
+Set a function that is called after each iteration. 
+*/
+void ICP::setIterationCallback(std::function<bool(int, float)> callback)
+{
+	_iteration_callback = callback;
+}
+
+
+/*
+Return the refined pose of the test points, the initial pose followed by the ICP transformation. 
+*/
+Affine3f ICP::getPose(void)
+{
+	// x = R_all * (T0 * p - c) + c + t_all
+	Affine3f pose = Affine3f::Identity();
+	pose.linear() = _R_all * _Rt_affine.linear();
+	pose.translation() = _R_all * (_Rt_affine.translation() - _rotation_center) + _rotation_center + _t_all;
+	return pose;
+}
+
+
+/*
+Return the fraction of the test points that were accepted as inliers in the last iteration. 
+*/
+float ICP::getInlierFraction(void)
+{
+	return _inlier_fraction;
+}
+
+
+/*
+Return the number of iterations of the last compute() call over all pyramid levels. 
+*/
+int ICP::getIterations(void)
+{
+	return _iterations;
+}
+
+
+/*
+Return true if the last compute() call converged before the iteration limit. 
+*/
+bool ICP::hasConverged(void)
+{
+	return _converged;
+}
+
+
+/*
+Set the number of threads for the iterations. 
+*/
+void ICP::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+	_voxel_grid.setNumThreads(_num_threads);
+}
+
+
+/*
+Set the intrinsics of the depth camera that produced the camera points. 
+@param intrinsics - the camera intrinsics and the pixel step of the sampling pattern. 
+*/
+void ICP::setCameraIntrinsics(const DepthIntrinsics& intrinsics)
+{
+	if (!intrinsics.valid()) {
+		std::cout << "[ERROR] - ICP: invalid camera intrinsics (" << intrinsics.width << " x " << intrinsics.height << ", fx = " << intrinsics.fx << ", fy = " << intrinsics.fy << ")." << std::endl;
+		return;
+	}
+	_intrinsics = intrinsics;
+	_pixel_ready = false;
+}
+
+
+/*
+Set the size of the search window for projective correspondences. 
+@param half_size - the window covers (2 * half_size + 1)^2 pixels. 
+	The value must be in the range [0, 16]. Default is 2.
+*/
+void ICP::setProjectiveWindow(int half_size)
+{
+	if(half_size > max_window) std::cout << "[ERROR] - ICP projective window > " << max_window << " is not permitted. Value set to " << max_window << "." << std::endl;
+	if(half_size < 0) std::cout << "[ERROR] - ICP projective window < 0 is not permitted. Value set to 0." << std::endl;
+	_window = std::min(max_window, std::max(0, half_size));
+}
+
+
 
 
 /* DEBUG FUNCTION
@@ -607,14 +1278,18 @@ std::vector<std::pair<int, int> >& ICP::getNN(void)
 {
 	_verbose_matches.clear();
 
-	for_each(_local_matches.begin(), _local_matches.end(),  [&](Matches m )
+	for (int j = 0; j < _local_matches.size(); j++)
 	{
-		if( _outlier_reject.test(_testPointsProcessing.points[m.matches[0].first ], _cameraPoints.points[m.matches[0].second],
-									 _testPointsProcessing.normals[m.matches[0].first ], _cameraPoints.normals[m.matches[0].second], _outlier_rejectmethod))
+		if (_local_matches.count(j) == 0) continue;
+		int id = _local_matches.indices[_local_matches.begin(j)];
+
+		// the ids point to the camera points of the last pyramid level
+		if( _level_reject.test(_testPointsProcessing.points[j], _active_camera->points[id],
+									 _testPointsProcessing.normals[j], _active_camera->normals[id], _outlier_rejectmethod))
 		{
-			_verbose_matches.push_back(std::make_pair(m.matches[0].first, m.matches[0].second) );
+			_verbose_matches.push_back(std::make_pair(j, id) );
 		}
-	});
+	}
 
 	return _verbose_matches;
 }
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include "ICPBatch.h"
+#include "VoxelGrid.h"
+#include "Profiler.h"
+
+
+namespace nsICPBatch
+{
+	// min. relative rms improvement that resets the patience
+	const float min_improvement = 0.01f;
+
+
+	// Set value to min(value, v).
+	inline void AtomicMin(std::atomic<float>& value, float v)
+	{
+		float current = value.load();
+		while (v < current && !value.compare_exchange_weak(current, v)) {}
+	}
+
+
+	// the distinct voxel sizes of the downsampled pyramid levels
+	inline void VoxelSizes(const std::vector<texpert::ICPLevel>& levels, std::vector<float>& sizes)
+	{
+		sizes.clear();
+		for (const texpert::ICPLevel& level : levels) {
+			if (level.voxel_size <= 0.0f) continue;
+			if (std::find(sizes.begin(), sizes.end(), level.voxel_size) != sizes.end()) continue;
+			sizes.push_back(level.voxel_size);
+		}
+	}
+
+
+	// the ranking: valid hypotheses first, then by rms
+	inline bool Better(const texpert::ICPHypothesis& a, bool valid_a, const texpert::ICPHypothesis& b, bool valid_b)
+	{
+		if (valid_a != valid_b) return valid_a;
+		if (a.rms != b.rms) return a.rms < b.rms;
+		return a.id < b.id;
+	}
+}
+
+using namespace nsICPBatch;
+using namespace texpert;
+
+
+ICPBatch::ICPBatch()
+{
+	_camera_key = 0;
+	_camera_changed = false;
+
+	_max_hypotheses = 12;
+	_patience = 3;
+	_abort_ratio = 3.0f;
+	_min_iterations = 3;
+	_min_inlier_fraction = 0.3f;
+	_num_threads = ParallelUtils::NumThreads();
+
+	// the ICP defaults
+	_verbose = false;
+	_verbose_level = 1;
+	_max_error = 0.0001f;
+	_max_iterations = 20;
+	_reject_angle = 45.0f;
+	_reject_distance = 0.1f;
+	_reject_method = ICPReject::DIST_ANG;
+	_metric = ICP::POINT_TO_POINT;
+	_correspondence = ICP::KNN_SEARCH;
+	_params_changed = true;
+}
+
+
+ICPBatch::~ICPBatch()
+{
+	for (ICP* icp : _workers) {
+		delete icp;
+	}
+	_workers.clear();
+}
+
+
+/*
+Set the camera points. The class keeps a copy, which all workers share.
+*/
+bool ICPBatch::setCameraData(PointCloud& pc)
+{
+	if (pc.size() <= 0) {
+		std::cout << "[ERROR] - ICPBatch: no camera points given. " << std::endl;
+		return false;
+	}
+
+	_camera = pc;
+	_camera_key = KdTreeCache::Hash(PointView(_camera.points));
+	_camera_changed = true;
+	return true;
+}
+
+
+/*
+Refine the pose hypotheses of a model and rank them.
+*/
+bool ICPBatch::compute(PointCloud& pc, const std::vector<Eigen::Affine3f>& poses, std::vector<ICPHypothesis>& results)
+{
+	TX_PROFILE_SCOPE("icp_batch");
+
+	results.clear();
+
+	if (_camera.size() <= 0) {
+		std::cout << "[ERROR] - ICPBatch: no camera points. Call setCameraData() first." << std::endl;
+		return false;
+	}
+	if (pc.size() <= 0 || poses.empty()) return false;
+
+	const int K = std::min((int)poses.size(), _max_hypotheses);
+	const int num_workers = std::min(K, _num_threads);
+
+	prepareWorkers(num_workers);
+	prepareModelLevels(pc);
+
+	// build the shared kd-tree once, instead of in all workers at the same time
+	if (_correspondence == ICP::KNN_SEARCH && (_levels.empty() || _levels.back().voxel_size <= 0.0f)) {
+		KdTreeCache::Get(PointView(_camera.points), _camera_key);
+	}
+
+	// the abort tests start after the coarse pyramid levels
+	int start_iteration = _min_iterations;
+	for (size_t l = 0; l + 1 < _levels.size(); l++) {
+		start_iteration += _levels[l].max_iterations;
+	}
+
+	// the rms of the best finished hypothesis
+	std::atomic<float> best_rms(100000000.0f);
+	std::atomic<int> next(0);
+
+	results.resize(K);
+
+	ParallelUtils::For(num_workers, num_workers, [&](int thread_id, int begin, int end) {
+		for (int w = begin; w < end; w++) {
+			ICP& icp = *_workers[w];
+
+			// the best-voted hypotheses start first
+			for (int h = next++; h < K; h = next++) {
+				ICPHypothesis& r = results[h];
+				r = ICPHypothesis();
+				r.id = h;
+
+				float own_best = 100000000.0f;
+				int stalled = 0;
+				bool settled = false; // the patience test stopped the hypothesis
+
+				icp.setIterationCallback([&](int itr, float rms) {
+					if (itr <= start_iteration) return true;
+
+					if (rms < own_best * (1.0f - min_improvement)) {
+						own_best = rms;
+						stalled = 0;
+					}
+					else if (++stalled >= _patience) {
+						settled = true;
+						return false;
+					}
+
+					if (rms > _abort_ratio * best_rms.load()) {
+						r.aborted = true;
+						return false;
+					}
+					return true;
+				});
+
+				Pose initial_pose;
+				initial_pose.t = poses[h];
+
+				// the downsampled model points, shared by all hypotheses
+				for (size_t l = 0; l < _level_models.size(); l++) {
+					if (!_level_models[l].points.empty()) icp.setModelLevelRef(_model_voxel_sizes[l], _level_models[l]);
+				}
+
+				Eigen::Matrix4f result_pose;
+				bool found = icp.compute(pc, initial_pose, result_pose, r.rms);
+				r.converged = found && (icp.hasConverged() || settled);
+				r.inlier_fraction = icp.getInlierFraction();
+				r.iterations = icp.getIterations();
+				r.pose = icp.Rt();
+				r.model_pose = icp.getPose();
+				r.R = icp.R();
+				r.t = icp.t();
+
+				if (r.converged && !r.aborted && r.inlier_fraction >= _min_inlier_fraction) {
+					AtomicMin(best_rms, r.rms);
+				}
+			}
+
+			icp.setIterationCallback(std::function<bool(int, float)>());
+		}
+	}, 1);
+
+	// rank the hypotheses
+	std::vector<bool> valid(K);
+	for (int h = 0; h < K; h++) {
+		valid[h] = results[h].converged && !results[h].aborted && results[h].inlier_fraction >= _min_inlier_fraction;
+	}
+
+	std::sort(results.begin(), results.end(), [&](const ICPHypothesis& a, const ICPHypothesis& b) {
+		return Better(a, valid[a.id], b, valid[b.id]);
+	});
+
+	if (_verbose) {
+		int aborted = 0;
+		for (const ICPHypothesis& r : results) aborted += r.aborted ? 1 : 0;
+		std::cout << "[INFO] - ICPBatch refined " << K << " hypotheses, " << aborted << " aborted. Best hypothesis " << results[0].id
+			<< " with RMS " << results[0].rms << "." << std::endl;
+	}
+
+	return valid[results[0].id];
+}
+
+
+/*
+Create the workers and apply the ICP parameters.
+*/
+void ICPBatch::prepareWorkers(int num_workers)
+{
+	int old_size = (int)_workers.size();
+	while ((int)_workers.size() < num_workers) {
+		// the cuda kd-tree cannot run from multiple threads
+		_workers.push_back(new ICP(KD_CPU));
+	}
+
+	bool levels_changed = _params_changed || _camera_changed;
+	if (levels_changed) prepareCameraLevels();
+
+	// the workers split the threads
+	int worker_threads = std::max(1, _num_threads / std::max(1, num_workers));
+
+	for (int w = 0; w < (int)_workers.size(); w++) {
+		ICP& icp = *_workers[w];
+
+		if (_params_changed || w >= old_size) {
+			icp.setVerbose(_verbose, _verbose_level);
+			icp.setMinError(_max_error);
+			icp.setMaxIterations(_max_iterations);
+			icp.setRejectMaxAngle(_reject_angle);
+			icp.setRejectMaxDistance(_reject_distance);
+			icp.setRejectionMethod(_reject_method);
+			icp.setErrorMetric(_metric);
+			if (_intrinsics.valid()) icp.setCameraIntrinsics(_intrinsics);
+			icp.setCorrespondenceMode(_correspondence);
+			icp.setPyramid(_levels);
+		}
+		if (_camera_changed || w >= old_size) {
+			icp.setCameraDataRef(_camera, _camera_key);
+		}
+		if (levels_changed || w >= old_size) {
+			for (size_t l = 0; l < _level_cameras.size(); l++) {
+				icp.setCameraLevelRef(_level_voxel_sizes[l], _level_cameras[l], _level_keys[l]);
+			}
+		}
+		icp.setNumThreads(worker_threads);
+	}
+
+	_params_changed = false;
+	_camera_changed = false;
+}
+
+
+/*
+Downsample the camera points for each pyramid level and build their kd-trees.
+*/
+void ICPBatch::prepareCameraLevels(void)
+{
+	_level_voxel_sizes.clear();
+	_level_cameras.clear();
+	_level_keys.clear();
+
+	// the projective search does not use the downsampled camera points
+	if (_correspondence != ICP::KNN_SEARCH || _camera.size() <= 0) return;
+
+	VoxelSizes(_levels, _level_voxel_sizes);
+
+	// the same filter as ICP uses
+	VoxelGrid voxel_grid;
+	voxel_grid.setRepresentative(VOXEL_NORMAL_AVERAGE);
+	voxel_grid.setNumThreads(_num_threads);
+
+	_level_cameras.resize(_level_voxel_sizes.size());
+	_level_keys.resize(_level_voxel_sizes.size());
+	for (size_t l = 0; l < _level_voxel_sizes.size(); l++) {
+		float v = _level_voxel_sizes[l];
+		voxel_grid.setGridSize(v, v, v);
+		voxel_grid.filter(_camera, _level_cameras[l]);
+		_level_keys[l] = KdTreeCache::Hash(PointView(_level_cameras[l].points));
+		KdTreeCache::Get(PointView(_level_cameras[l].points), _level_keys[l]);
+	}
+}
+
+
+/*
+Downsample the model points for each pyramid level.
+*/
+void ICPBatch::prepareModelLevels(PointCloud& pc)
+{
+	VoxelSizes(_levels, _model_voxel_sizes);
+
+	// the same filter as ICP uses
+	VoxelGrid voxel_grid;
+	voxel_grid.setRepresentative(VOXEL_NORMAL_AVERAGE);
+	voxel_grid.setNumThreads(_num_threads);
+
+	_level_models.resize(_model_voxel_sizes.size());
+	for (size_t l = 0; l < _model_voxel_sizes.size(); l++) {
+		float v = _model_voxel_sizes[l];
+		voxel_grid.setGridSize(v, v, v);
+		voxel_grid.filter(pc, _level_models[l]);
+	}
+}
+
+
+/*
+Set the max. number of hypotheses to refine.
+*/
+void ICPBatch::setMaxHypotheses(int k)
+{
+	if (k < 1) std::cout << "[ERROR] - ICPBatch: the number of hypotheses must be >= 1. Value set to 1." << std::endl;
+	_max_hypotheses = std::max(1, k);
+}
+
+
+/*
+Set the early abort criteria.
+*/
+void ICPBatch::setAbortCriteria(int patience, float abort_ratio, int min_iterations)
+{
+	if (patience < 1 || abort_ratio < 1.0f || min_iterations < 0) {
+		std::cout << "[ERROR] - ICPBatch: abort criteria out of range. Values clamped to patience >= 1, ratio >= 1, and min. iterations >= 0." << std::endl;
+	}
+	_patience = std::max(1, patience);
+	_abort_ratio = std::max(1.0f, abort_ratio);
+	_min_iterations = std::max(0, min_iterations);
+}
+
+
+/*
+Set the min. inlier fraction of a valid hypothesis.
+*/
+void ICPBatch::setMinInlierFraction(float fraction)
+{
+	_min_inlier_fraction = std::min(1.0f, std::max(0.0f, fraction));
+}
+
+
+/*
+Set the number of worker threads.
+*/
+void ICPBatch::setNumThreads(int num_threads)
+{
+	_num_threads = (num_threads < 1) ? ParallelUtils::NumThreads() : num_threads;
+}
+
+
+bool ICPBatch::setVerbose(bool verbose, int verbose_level)
+{
+	_verbose = verbose;
+	_verbose_level = verbose_level;
+	_params_changed = true;
+	return true;
+}
+
+
+void ICPBatch::setMinError(float error)
+{
+	_max_error = error;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setMaxIterations(int max_iterations)
+{
+	_max_iterations = max_iterations;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setRejectMaxAngle(float max_angle)
+{
+	_reject_angle = max_angle;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setRejectMaxDistance(float max_distance)
+{
+	_reject_distance = max_distance;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setRejectionMethod(ICPReject::Testcase method)
+{
+	_reject_method = method;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setErrorMetric(ICP::Metric metric)
+{
+	_metric = metric;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setCorrespondenceMode(ICP::Correspondence mode)
+{
+	_correspondence = mode;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setCameraIntrinsics(const DepthIntrinsics& intrinsics)
+{
+	_intrinsics = intrinsics;
+	_params_changed = true;
+}
+
+
+void ICPBatch::setPyramid(const std::vector<ICPLevel>& levels)
+{
+	_levels = levels;
+	_params_changed = true;
+}
@@ -5,6 +5,9 @@ ICPReject::ICPReject()
 {
 	_max_distance = 0.01;
 	_max_angle = 0.1;
+	_max_distance2 = _max_distance * _max_distance;
+	_cos_max_angle = std::cos(_max_angle);
+	_accept_zero_normal = false;
 }
 
 ICPReject::~ICPReject()
@@ -25,7 +28,8 @@ bool ICPReject::testDistance(const Eigen::Vector3f& p0, const Eigen::Vector3f& p
 
 
 /*
-Test whether two normal vectors align so that they can be considered as inliers
+Test whether two normal vectors align so that they can be considered as inliers.
+A zero-length normal vector counts as an angle of 90 degrees.
 @param n0 - reference to the first normal vectors of type Vector3f with (nx, ny, nz) coordinates. 
 @param n1 - reference to the second normal vectors of type Vector3f with (nx, ny, nz) coordinates. 
 @return true - if the points are inliers, false if the are outliers. 
@@ -34,6 +38,9 @@ bool ICPReject::testAngle(Eigen::Vector3f n0, Eigen::Vector3f n1)
 {
 //https://developer.rhino3d.com/samples/cpp/calculate-the-angle-between-two-vectors/
 	
+	// a zero vector has no direction. The same rule as in accept().
+	if (n0.squaredNorm() <= 0.0f || n1.squaredNorm() <= 0.0f) return _accept_zero_normal;
+
 	// normalize
 	n0.normalize();
 	n1.normalize();
@@ -79,6 +86,7 @@ bool ICPReject::test(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, Eigen
 {
 	switch (testcase) {
 		case NONE:
+			return true;
 		break;
 		case DIST:
 			return testDistance(p0,  p1);
@@ -90,6 +98,7 @@ bool ICPReject::test(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, Eigen
 			return testDistanceAngle(p0, p1, n0, n1);
 			break;
 	}
+	return true;
 }
 
 
@@ -102,6 +111,7 @@ Note that the point will be set to 0.0 if the value is negative
 bool ICPReject::setMaxThreshold(float max_distance)
 {
 	_max_distance = std::max(0.0f, max_distance);
+	_max_distance2 = _max_distance * _max_distance;
 	return true;
 }
 
@@ -114,6 +124,8 @@ bool ICPReject::setMaxNormalVectorAngle(float max_angle_degree)
 {
 	float angle = std::min(180.0f, std::max(0.0f, max_angle_degree));
 	_max_angle = angle/ 180.0 * 3.14159265358;
+	_cos_max_angle = std::cos(_max_angle);
+	_accept_zero_normal = angle >= 90.0f;
 
 	return true;
 }
\ No newline at end of file
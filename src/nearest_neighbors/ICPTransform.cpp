@@ -2,6 +2,8 @@
 
 #include <cassert>
 
+#include "ParallelUtils.h"
+
 using namespace texpert; 
 
 /*
@@ -114,9 +116,17 @@ Matrix3f ICPTransform::CalcRotationArun(vector<Vector3f>& pVec0, vector<Vector3f
 		// x-cov matrix
 		W = W + p0 *  p1.transpose() ;
 	}
-		
-	float d = W.determinant();
-		
+
+	return RotationFromCovariance(W);
+}
+
+
+/*
+Return the rotation that aligns two centered point sets from their cross-covariance matrix. 
+*/
+//static 
+Matrix3f ICPTransform::RotationFromCovariance(const Matrix3f& W)
+{
 	//Singular value decompositon
 	JacobiSVD<Matrix3f> svd(W, ComputeFullU | ComputeFullV);
 	Matrix3f R = (svd.matrixV() * svd.matrixU().transpose());
@@ -213,4 +223,115 @@ Vector3f ICPTransform::CalculateCentroid(vector<Vector3f>& pVec0)
 {
 	Vector3f avg0 = accumulate(pVec0.begin(), pVec0.end(), Vector3f(0, 0, 0), [currIndex = 0U, lastIndex = pVec0.size()](Vector3f x, Vector3f y) mutable { return x + y; }) / pVec0.size();
 	return avg0;
-}
\ No newline at end of file
+}
+
+
+namespace nsICPTransform
+{
+	// min. number of points per thread
+	const int min_chunk = 2048;
+
+	// the normal equations of one chunk of points
+	typedef struct _NormalEquations
+	{
+		Matrix<double, 6, 6>	A; // J^T J
+		Matrix<double, 6, 1>	g; // J^T r
+		double					c; // r^T r
+
+		void setZero(void)
+		{
+			A.setZero();
+			g.setZero();
+			c = 0.0;
+		}
+
+	}NormalEquations;
+}
+
+
+/*
+Calculate the rotation and translation that minimize the point-to-plane distances
+between two point sets, using a linearized least-squares solution. 
+*/
+//static 
+bool ICPTransform::CalcPointToPlane(vector<Vector3f>& pVec0, vector<Vector3f>& pVec1, vector<Vector3f>& nVec0, vector<Vector3f>& nVec1,
+									const Vector3f& centroid, bool symmetric, Matrix3f& R, Vector3f& t, float& rms)
+{
+	using namespace nsICPTransform;
+
+	assert(pVec0.size() == pVec1.size() && pVec1.size() == nVec1.size()); 
+	assert(!symmetric || nVec0.size() == pVec0.size());
+
+	int size = (int)pVec0.size();
+	if (size < 6) return false;
+
+	// Each point adds one row to the system
+	int num_threads = ParallelUtils::NumThreads();
+	int chunks = ParallelUtils::NumChunks(size, num_threads, min_chunk);
+	std::vector<NormalEquations> chunk_eq(chunks);
+
+	ParallelUtils::For(size, num_threads, [&](int thread_id, int begin, int end) {
+		NormalEquations& eq = chunk_eq[thread_id];
+		eq.setZero();
+
+		for (int i = begin; i < end; i++) {
+			AccumulatePointToPlane(pVec0[i], pVec1[i], symmetric ? nVec0[i] : nVec1[i], nVec1[i], centroid, symmetric, eq.A, eq.g, eq.c);
+		}
+	}, min_chunk);
+
+	// sum the chunks in order, so the result does not depend on the threads
+	NormalEquations sum;
+	sum.setZero();
+	for (const NormalEquations& eq : chunk_eq) {
+		sum.A += eq.A;
+		sum.g += eq.g;
+		sum.c += eq.c;
+	}
+
+	return SolvePointToPlane(sum.A, sum.g, sum.c, size, symmetric, R, t, rms);
+}
+
+
+/*
+Solve the normal equations of the point-to-plane or symmetric objective. 
+*/
+//static 
+bool ICPTransform::SolvePointToPlane(const Matrix<double, 6, 6>& A_sum, const Matrix<double, 6, 1>& g, double c, int size,
+									 bool symmetric, Matrix3f& R, Vector3f& t, float& rms)
+{
+	if (size < 6) return false;
+
+	// a small damping keeps degenerate geometry, e.g., a plane, solvable
+	Matrix<double, 6, 6> A = A_sum;
+	A.diagonal().array() += 1e-9 * A_sum.trace() + 1e-12;
+
+	LDLT<Matrix<double, 6, 6>> ldlt(A);
+	if (ldlt.info() != Success) return false;
+
+	Matrix<double, 6, 1> x = ldlt.solve(-g);
+	if (!x.allFinite()) return false;
+
+	// the rms after the transformation, predicted by the linear model: |r + J x|^2 = c + 2 x^T g + x^T A x
+	double res = c + 2.0 * x.dot(g) + x.dot(A_sum * x);
+	rms = (float)std::sqrt(std::max(0.0, res) / size);
+
+	Vector3d w = x.head<3>();
+	Vector3d dt = x.tail<3>();
+	double angle = w.norm();
+
+	if (!symmetric) {
+		Matrix3d Rd = Matrix3d::Identity();
+		if (angle > 0.0) Rd = AngleAxisd(angle, w / angle).toRotationMatrix();
+		R = Rd.cast<float>();
+		t = dt.cast<float>();
+		return true;
+	}
+
+	// The symmetric objective rotates the test points by Rh and the matching points by Rh^-1. 
+	// Applied to the test points only: p' = Rh^2 (p - c) + c + Rh t
+	Matrix3d Rh = Matrix3d::Identity();
+	if (angle > 0.0) Rh = AngleAxisd(std::atan(angle), w / angle).toRotationMatrix();
+	R = (Rh * Rh).cast<float>();
+	t = (Rh * dt).cast<float>();
+	return true;
+}
@@ -1,20 +1,37 @@
 #include "KNN.h"
 
 #include "ResourceManager.h"
+#include "KdTreeCache.h"
+#include "Profiler.h"
 
 using namespace  texpert;
 
-KNN::KNN() {
+KNN::KNN(KdTreeBackend backend) {
 
 	/*
 	The kd-tree runs on cuda and requires plenty of
 	memory. This makes sure that only one instance 
 	exists in the entire app. 
+	The cpu kd-tree is used if no cuda device is available.
 	*/
-	_kdtree = ResourceManager::GetKDTree();
+	_kdtree = ResourceManager::GetKDTree(backend);
+	_tree = _kdtree;
 	
 
 	_ready = false;
+	_ref_size = 0;
+
+	// the cuda kd-tree stops backtracking early
+	_search_mode = (_kdtree->backend() == KD_CUDA) ? KNN_APPROXIMATE : KNN_EXACT;
+	_max_leaves = 8;
+
+	_ref_key = 0;
+	_cuda_key = 0;
+	_ref_cpu = false;
+	_tree_ready = false;
+	_grid = NULL;
+	_grid_ready = false;
+	_index = KNN_INDEX_AUTO;
 
 	_refPoint = NULL;
 	_testPoint = NULL;
@@ -22,7 +39,9 @@ KNN::KNN() {
 }
 KNN::~KNN(){
 	
+	_cached_tree.reset();
 	ResourceManager::UnrefKDTree(_kdtree);
+	delete _grid;
 	//delete _kdtree;
 }
 
@@ -34,23 +53,98 @@ This one goes into the kd-tree as soon as it is set.
 */
 bool KNN::populate(PointCloud& pc) {
 
+	if (!populate(PointView(pc.points))) return false;
+	_refPoint = &pc;
+
+	return true;
+}
+
+
+/*
+Set the reference points from a point view. 
+The points are not copied. The cpu indices are built from the view on the first query,
+and the cuda backend keeps the view to reload the shared kd-tree. 
+*/
+bool KNN::populate(const PointView& points) {
+	TX_PROFILE_SCOPE("knn_populate");
+
 	assert(_kdtree);
 
-	_rpoints.clear();
-	
+	if (points.size() == 0) return false;
 
-	vector<Eigen::Vector3f> p = pc.points;
-	size_t size = pc.points.size();
+	std::unique_lock<std::recursive_mutex> lock = lockTree();
 
-	for (int i = 0; i < size; i++) {
-		Cuda_Point k = Cuda_Point(p[i].x(), p[i].y(), p[i].z());
-		k._id = i;
-		_rpoints.push_back(k);
+	_cached_tree.reset();
+	_tree = _kdtree;
+
+	_ref_view = points;
+	_ref_cpu = useCpuIndex(points);
+	if (_ref_cpu) {
+		// the cpu fallback of the cuda backend takes its kd-tree from the cache
+		_ref_key = (_kdtree->backend() == KD_CPU) ? 0 : KdTreeCache::Hash(points);
+		_cuda_key = 0;
+		_tree_ready = false;
+	}
+	else {
+		_cuda_key = KdTreeCache::Hash(points);
+		_kdtree->initialize(points);
+		KdTreeCache::MarkBuilt(_kdtree, _cuda_key);
+		_tree_ready = true;
 	}
+	_grid_ready = false;
+	_ref_size = points.size();
+	_refPoint = NULL;
 
-	if (_rpoints.size() == 0) return false;
-	_kdtree->initialize(_rpoints);
-	_refPoint = &pc;
+	// check if ready
+	_ready = ready();
+
+	return true;
+}
+
+/*
+Set the reference points and reuse an existing kd-tree for the same points.
+*/
+bool KNN::populateCached(const PointView& points, std::uint64_t key) {
+	TX_PROFILE_SCOPE("knn_populate");
+
+	assert(_kdtree);
+
+	if (points.size() == 0) return false;
+	if (key == 0) key = KdTreeCache::Hash(points);
+
+	std::unique_lock<std::recursive_mutex> lock = lockTree();
+
+	// the indices of the same points can be kept, but the view may point to another copy of them
+	_ref_view = points;
+
+	if (useCpuIndex(points)) {
+		// keep the indices if the points did not change
+		if (!_ref_cpu || _ref_key != key || _ref_size != points.size()) {
+			_cached_tree.reset();
+			_tree = _kdtree;
+			_ref_cpu = true;
+			_ref_key = key;
+			_tree_ready = false;
+			_grid_ready = false;
+		}
+		_cuda_key = 0;
+	}
+	else {
+		// the cuda kd-tree exists once. Rebuild it only if another point set was loaded in the meantime.
+		_cached_tree.reset();
+		_tree = _kdtree;
+		if (!KdTreeCache::IsBuilt(_kdtree, key)) {
+			_kdtree->initialize(points);
+			KdTreeCache::MarkBuilt(_kdtree, key);
+		}
+		_ref_cpu = false;
+		_ref_key = 0;
+		_cuda_key = key;
+		_tree_ready = true;
+	}
+
+	_ref_size = points.size();
+	_refPoint = NULL;
 
 	// check if ready
 	_ready = ready();
@@ -58,6 +152,7 @@ bool KNN::populate(PointCloud& pc) {
 	return true;
 }
 
+
 /*
 Set the test model, this is tested agains the 
 reference model in the kd-tree
@@ -91,22 +186,9 @@ Start the knn search and return matches.
 */
 int KNN::knn(PointCloud& pc, int k,  vector<Matches>& matches)
 {
-	// copy all models into the cuda structure. 
-
-	_tpoints.clear();
+	TX_PROFILE_SCOPE("knn_search");
 
-	vector<Eigen::Vector3f>& p = pc.points ;
-
-	for (int i = 0; i < pc.points.size(); i++) {
-		Cuda_Point k = Cuda_Point(p[i].x(), p[i].y(), p[i].z());
-		k._id = i;
-		_tpoints.push_back(k);
-	}
-
-	_testPoint = &pc;
-
-	// check if ready
-	_ready = ready();
+	setTestPoints(pc);
 
 
 	assert(_kdtree);
@@ -114,7 +196,9 @@ int KNN::knn(PointCloud& pc, int k,  vector<Matches>& matches)
 	if (!_ready) return -1;
 	if (_tpoints.size() == 0) return -1;
 
-	_kdtree->knn(_tpoints, matches, k);
+	std::unique_lock<std::recursive_mutex> lock = lockTree();
+	buildTree();
+	_tree->knn(_tpoints, matches, k);
 
 	return 1;
 }
@@ -128,10 +212,105 @@ search point.
 @param matches - reference to the matches
 */
 int KNN::radius(PointCloud& pc, float radius, vector<Matches>& matches)
+{
+	TX_PROFILE_SCOPE("knn_radius");
+
+	setTestPoints(pc);
+
+
+	assert(_kdtree);
+
+	if (!_ready) return -1;
+	if (_tpoints.size() == 0) return -1;
+
+	std::unique_lock<std::recursive_mutex> lock = lockTree();
+	buildTree();
+	_tree->radius_search(_tpoints, matches, radius);
+
+	return 1;
+}
+
+
+/*
+Start the knn search and return variable-length results.
+*/
+int KNN::knn(PointCloud& pc, int k, KNNResults& results)
+{
+	_testPoint = &pc;
+	return knn(PointView(pc.points), k, results);
+}
+
+
+/*
+Run a radius search on the kd-tree and return all points in vicinity to the
+search point as variable-length results.
+*/
+int KNN::radius(PointCloud& pc, float radius, KNNResults& results, int max_neighbors)
+{
+	_testPoint = &pc;
+	return this->radius(PointView(pc.points), radius, results, max_neighbors);
+}
+
+
+/*
+Start the knn search for the points in a view.
+*/
+int KNN::knn(const PointView& points, int k, KNNResults& results)
+{
+	TX_PROFILE_SCOPE("knn_search");
+
+	assert(_kdtree);
+
+	results.clear();
+	if (!ready()) return -1;
+	if (points.size() == 0) return -1;
+
+	std::unique_lock<std::recursive_mutex> lock = lockTree();
+	buildTree();
+	_tree->knn(points, results, k, (_search_mode == KNN_APPROXIMATE) ? _max_leaves : 0);
+
+	return 1;
+}
+
+
+/*
+Run a radius search for the points in a view.
+*/
+int KNN::radius(const PointView& points, float radius, KNNResults& results, int max_neighbors)
+{
+	TX_PROFILE_SCOPE("knn_radius");
+
+	assert(_kdtree);
+
+	results.clear();
+	if (!ready()) return -1;
+	if (points.size() == 0) return -1;
+
+	if (_index == KNN_INDEX_AUTO && _ref_cpu && radius > 0.0f) {
+		buildGrid(radius);
+		_grid->radius_search(points, results, radius, max_neighbors);
+	}
+	else {
+		std::unique_lock<std::recursive_mutex> lock = lockTree();
+		buildTree();
+		_tree->radius_search(points, results, radius, max_neighbors, (_search_mode == KNN_APPROXIMATE) ? _max_leaves : 0);
+	}
+
+	TX_PROFILE_COUNT("knn_radius_neighbors", results.total());
+
+	return 1;
+}
+
+
+/*
+Copy the search point cloud into the test points.
+*/
+void KNN::setTestPoints(PointCloud& pc)
 {
 	// copy all models into the cuda structure. 
 
 	_tpoints.clear();
+	_tpoints.reserve(pc.points.size());
 
 	vector<Eigen::Vector3f>& p = pc.points ;
 
@@ -144,28 +323,131 @@ int KNN::radius(PointCloud& pc, float radius, vector<Matches>& matches)
 	_testPoint = &pc;
 
 	// check if ready
-	_ready = ready();
+	_ready = ready() && _tpoints.size() > 0;
+}
 
 
-	assert(_kdtree);
+/*
+Stream the knn search for the points in a view in chunks.
+*/
+int KNN::knnChunked(const PointView& points, int k, KNNCallback callback, int chunk_size)
+{
+	if (!ready()) return -1;
+	if (points.size() == 0) return -1;
+
+	chunk_size = std::max(1, chunk_size);
+	for (int begin = 0; begin < points.size(); begin += chunk_size) {
+		int count = std::min(chunk_size, points.size() - begin);
+		knn(PointView(points[begin], count, points.stride), k, _chunk_results);
+		callback(begin, _chunk_results);
+	}
 
-	if (!_ready) return -1;
-	if (_tpoints.size() == 0) return -1;
+	return 1;
+}
 
-	_kdtree->radius_search(_tpoints, matches, radius);
+
+/*
+Stream the radius search for the points in a view in chunks.
+*/
+int KNN::radiusChunked(const PointView& points, float radius, KNNCallback callback, int max_neighbors, int chunk_size)
+{
+	if (!ready()) return -1;
+	if (points.size() == 0) return -1;
+
+	chunk_size = std::max(1, chunk_size);
+	for (int begin = 0; begin < points.size(); begin += chunk_size) {
+		int count = std::min(chunk_size, points.size() - begin);
+		this->radius(PointView(points[begin], count, points.stride), radius, _chunk_results, max_neighbors);
+		callback(begin, _chunk_results);
+	}
 
 	return 1;
 }
 
 
+/*
+Check if the reference points go into a cpu index. This is the case for the cpu backend,
+for point sets that exceed the capacity of the cuda kd-tree, and for exact searches, since
+the cuda kd-tree is approximate.
+*/
+bool KNN::useCpuIndex(const PointView& points)
+{
+	if (_kdtree->backend() == KD_CPU) return true;
+	if (_search_mode == KNN_EXACT) return true;
+
+	int max_points = _kdtree->maxPoints();
+	if (max_points > 0 && points.size() > max_points) {
+		if (!_ref_cpu) std::cout << "[INFO] - KNN: " << points.size() << " reference points exceed the capacity of the cuda kd-tree (" << max_points << "). Using the cpu kd-tree." << std::endl;
+		return true;
+	}
+	return false;
+}
+
+
+/*
+Build the kd-tree for the reference points if it was not built yet.
+Points set with populateCached() take the tree from the KdTreeCache.
+The caller holds the lock of the cuda kd-tree.
+*/
+void KNN::buildTree(void)
+{
+	// another KNN instance may have loaded other points into the shared cuda kd-tree
+	if (!_ref_cpu && _cuda_key != 0 && !KdTreeCache::IsBuilt(_kdtree, _cuda_key)) {
+		TX_PROFILE_SCOPE("knn_build");
+		_kdtree->initialize(_ref_view);
+		KdTreeCache::MarkBuilt(_kdtree, _cuda_key);
+	}
+
+	if (_tree_ready) return;
+
+	TX_PROFILE_SCOPE("knn_build");
+
+	if (_ref_key != 0) {
+		_cached_tree = KdTreeCache::Get(_ref_view, _ref_key);
+		_tree = _cached_tree.get();
+	}
+	else {
+		_kdtree->initialize(_ref_view);
+		_tree = _kdtree;
+	}
+	_tree_ready = true;
+}
+
+
+/*
+Build the grid for the reference points if it was not built yet for this radius.
+*/
+void KNN::buildGrid(float radius)
+{
+	if (_grid_ready && _grid->cellSize() == radius) return;
+
+	TX_PROFILE_SCOPE("knn_grid_build");
+
+	if (_grid == NULL) _grid = new Cpu_RadiusGrid();
+	_grid->initialize(_ref_view, radius);
+	_grid_ready = true;
+}
+
+
+/*
+Lock the shared cuda kd-tree. The returned lock does not own the mutex for the cpu backend.
+*/
+std::unique_lock<std::recursive_mutex> KNN::lockTree(void)
+{
+	std::unique_lock<std::recursive_mutex> lock(ResourceManager::GetKDTreeMutex(), std::defer_lock);
+	if (_kdtree->backend() == KD_CUDA) lock.lock();
+	return lock;
+}
+
+
 /*
 Check if this class is ready to run.
-The kd-tree and the test points - both need to have points
+The kd-tree needs to have points
 @return - true, if it can run. 
 */
 bool KNN::ready(void)
 {
-	if (_rpoints.size() > 0 && _tpoints.size() > 0)
+	if (_ref_size > 0)
 		return true;
 
 	return false;
@@ -179,8 +461,83 @@ Reset the tree
 int KNN::reset(void) {
 
 	assert(_kdtree);
+	std::unique_lock<std::recursive_mutex> lock = lockTree();
 	_kdtree->resetDevTree();
+	KdTreeCache::MarkBuilt(_kdtree, 0);
+	_cached_tree.reset();
+	_tree = _kdtree;
+	_ref_size = 0;
+	_ref_key = 0;
+	_cuda_key = 0;
+	_ref_view = PointView();
+	_ref_cpu = false;
+	_tree_ready = false;
+	_grid_ready = false;
+	if (_grid) _grid->reset();
+	_ready = false;
 
 	return 1;
 }
-	
\ No newline at end of file
+	
+
+
+/*
+Return the backend of the kd-tree in use.
+*/
+KdTreeBackend KNN::getBackend(void)
+{
+	assert(_kdtree);
+	if (_ref_cpu) return KD_CPU;
+	return _kdtree->backend();
+}
+
+
+/*
+Set the search quality.
+The cuda backend moves the reference points between the cuda kd-tree and the cpu indices.
+*/
+void KNN::setSearchMode(KNNSearchMode mode, int max_leaves)
+{
+	_search_mode = mode;
+	_max_leaves = std::max(1, max_leaves);
+
+	if (_kdtree->backend() != KD_CUDA) return;
+
+	if (mode == KNN_APPROXIMATE) {
+		std::cout << "[WARNING] - KNN: the cuda kd-tree ignores the leaf budget of KNN_APPROXIMATE." << std::endl;
+	}
+
+	// move the reference points into the index of the new mode
+	if (ready() && useCpuIndex(_ref_view) != _ref_cpu) {
+		PointCloud* ref = _refPoint;
+		populateCached(_ref_view);
+		_refPoint = ref;
+	}
+}
+
+
+KNNSearchMode KNN::getSearchMode(void)
+{
+	return _search_mode;
+}
+
+
+int KNN::getMaxLeaves(void)
+{
+	return _max_leaves;
+}
+
+
+/*
+Set the index for radius searches with the cpu backend.
+*/
+void KNN::setIndex(KNNIndex index)
+{
+	_index = index;
+}
+
+
+KNNIndex KNN::getIndex(void)
+{
+	return _index;
+}
\ No newline at end of file
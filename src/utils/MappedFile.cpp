@@ -0,0 +1,143 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <Windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace texpert;
+
+
+MappedFile::MappedFile()
+{
+	_data = NULL;
+	_size = 0;
+	_file_handle = NULL;
+	_map_handle = NULL;
+	_fd = -1;
+}
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+/*
+Map a file into memory.
+*/
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		std::cout << "[ERROR] - MappedFile: cannot open file " << path << "." << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		std::cout << "[ERROR] - MappedFile: file " << path << " is empty." << std::endl;
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map == NULL) {
+		std::cout << "[ERROR] - MappedFile: cannot map file " << path << "." << std::endl;
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* data = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		std::cout << "[ERROR] - MappedFile: cannot map file " << path << "." << std::endl;
+		CloseHandle(map);
+		CloseHandle(file);
+		return false;
+	}
+
+	_file_handle = file;
+	_map_handle = map;
+	_data = static_cast<const char*>(data);
+	_size = static_cast<size_t>(size.QuadPart);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		std::cout << "[ERROR] - MappedFile: cannot open file " << path << "." << std::endl;
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		std::cout << "[ERROR] - MappedFile: file " << path << " is empty." << std::endl;
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		std::cout << "[ERROR] - MappedFile: cannot map file " << path << "." << std::endl;
+		::close(fd);
+		return false;
+	}
+
+	_fd = fd;
+	_data = static_cast<const char*>(data);
+	_size = static_cast<size_t>(st.st_size);
+#endif
+
+	return true;
+}
+
+
+/*
+Unmap the file.
+*/
+void MappedFile::close(void)
+{
+	if (_data == NULL) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+	CloseHandle(static_cast<HANDLE>(_map_handle));
+	CloseHandle(static_cast<HANDLE>(_file_handle));
+#else
+	munmap(const_cast<char*>(_data), _size);
+	::close(_fd);
+#endif
+
+	_data = NULL;
+	_size = 0;
+	_file_handle = NULL;
+	_map_handle = NULL;
+	_fd = -1;
+}
+
+
+const char* MappedFile::data(void) const
+{
+	return _data;
+}
+
+
+size_t MappedFile::size(void) const
+{
+	return _size;
+}
+
+
+bool MappedFile::isOpen(void) const
+{
+	return _data != NULL;
+}
@@ -0,0 +1,244 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+using namespace texpert;
+
+
+namespace nsProfiler
+{
+	const int max_stages = 256;
+
+	typedef struct _Stage
+	{
+		std::string					name;
+		ProfileType					type;
+
+		// current frame
+		std::atomic<std::int64_t>	value;
+		std::atomic<std::int64_t>	calls;
+
+		// history, ring buffer of per-frame values
+		std::vector<std::int64_t>	history;
+		int							history_pos;
+		std::int64_t				history_calls;
+	}Stage;
+
+	// fixed storage, so stages can be added while others are measured.
+	Stage					stages[max_stages];
+	std::atomic<int>		num_stages(0);
+	int						history_size = 1000;
+
+	// guards registration and the history
+	std::mutex				mutex;
+
+
+	// p in [0, 1]
+	double Percentile(std::vector<std::int64_t>& values, double p)
+	{
+		size_t k = (size_t)(p * (values.size() - 1) + 0.5);
+		std::nth_element(values.begin(), values.begin() + k, values.end());
+		return (double)values[k];
+	}
+
+
+	void Stats(Stage& s, ProfilerStats& stats)
+	{
+		double scale = (s.type == PROFILE_TIMER) ? 1.0e-6 : 1.0;
+
+		stats.name = s.name;
+		stats.type = s.type;
+		stats.frames = (int)s.history.size();
+		stats.calls = s.history_calls;
+		stats.mean = stats.p50 = stats.p99 = stats.max = 0.0;
+
+		if (s.history.size() == 0) return;
+
+		std::vector<std::int64_t> v = s.history;
+		double sum = 0.0;
+		for (std::int64_t x : v) sum += (double)x;
+
+		stats.mean = scale * sum / v.size();
+		stats.max = scale * (double)*std::max_element(v.begin(), v.end());
+		stats.p50 = scale * Percentile(v, 0.5);
+		stats.p99 = scale * Percentile(v, 0.99);
+	}
+}
+
+using namespace nsProfiler;
+
+
+//static
+int Profiler::Register(const std::string& name, ProfileType type)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int n = num_stages.load();
+	for (int i = 0; i < n; i++) {
+		if (stages[i].name == name) return i;
+	}
+
+	if (n >= max_stages) {
+		std::cout << "[ERROR] - Profiler: cannot register " << name << ", max. " << max_stages << " stages." << std::endl;
+		return -1;
+	}
+
+	stages[n].name = name;
+	stages[n].type = type;
+	stages[n].value = 0;
+	stages[n].calls = 0;
+	stages[n].history.clear();
+	stages[n].history_pos = 0;
+	stages[n].history_calls = 0;
+	num_stages = n + 1;
+
+	return n;
+}
+
+
+//static
+void Profiler::Add(int id, std::int64_t value)
+{
+	if (id < 0) return;
+	stages[id].value.fetch_add(value, std::memory_order_relaxed);
+	stages[id].calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//static
+void Profiler::EndFrame(void)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int n = num_stages.load();
+	for (int i = 0; i < n; i++) {
+		Stage& s = stages[i];
+
+		std::int64_t calls = s.calls.exchange(0);
+		std::int64_t value = s.value.exchange(0);
+		if (calls == 0) continue;
+
+		if ((int)s.history.size() < history_size) {
+			s.history.push_back(value);
+		}
+		else {
+			s.history[s.history_pos] = value;
+			s.history_pos = (s.history_pos + 1) % history_size;
+		}
+		s.history_calls += calls;
+	}
+}
+
+
+//static
+void Profiler::SetHistorySize(int frames)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	history_size = std::max(1, frames);
+
+	int n = num_stages.load();
+	for (int i = 0; i < n; i++) {
+		stages[i].history.clear();
+		stages[i].history_pos = 0;
+		stages[i].history_calls = 0;
+	}
+}
+
+
+//static
+bool Profiler::GetStats(const std::string& name, ProfilerStats& stats)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int n = num_stages.load();
+	for (int i = 0; i < n; i++) {
+		if (stages[i].name == name) {
+			Stats(stages[i], stats);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+//static
+void Profiler::GetAllStats(std::vector<ProfilerStats>& stats)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int n = num_stages.load();
+	stats.resize(n);
+	for (int i = 0; i < n; i++) {
+		Stats(stages[i], stats[i]);
+	}
+}
+
+
+//static
+bool Profiler::WriteCSV(const std::string& path)
+{
+	std::vector<ProfilerStats> stats;
+	GetAllStats(stats);
+
+	std::ofstream of(path, std::ofstream::out);
+	if (!of.is_open()) {
+		std::cout << "[ERROR] - Profiler: cannot open file " << path << " for writing." << std::endl;
+		return false;
+	}
+
+	of << "stage,type,frames,calls,mean,p50,p99,max\n";
+	for (const ProfilerStats& s : stats) {
+		of << s.name << "," << (s.type == PROFILE_TIMER ? "ms" : "count") << "," << s.frames << "," << s.calls << "," << std::fixed << std::setprecision(4) <<
+			s.mean << "," << s.p50 << "," << s.p99 << "," << s.max << "\n";
+	}
+	of.close();
+
+	return true;
+}
+
+
+//static
+bool Profiler::WriteJSON(const std::string& path)
+{
+	std::vector<ProfilerStats> stats;
+	GetAllStats(stats);
+
+	std::ofstream of(path, std::ofstream::out);
+	if (!of.is_open()) {
+		std::cout << "[ERROR] - Profiler: cannot open file " << path << " for writing." << std::endl;
+		return false;
+	}
+
+	of << "{\n  \"stages\": [\n";
+	for (size_t i = 0; i < stats.size(); i++) {
+		const ProfilerStats& s = stats[i];
+		of << "    {\"stage\": \"" << s.name << "\", \"type\": \"" << (s.type == PROFILE_TIMER ? "ms" : "count") << "\", \"frames\": " << s.frames <<
+			", \"calls\": " << s.calls << std::fixed << std::setprecision(4) << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50 << ", \"p99\": " << s.p99 <<
+			", \"max\": " << s.max << "}" << (i + 1 < stats.size() ? ",\n" : "\n");
+	}
+	of << "  ]\n}\n";
+	of.close();
+
+	return true;
+}
+
+
+//static
+void Profiler::Reset(void)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	int n = num_stages.load();
+	for (int i = 0; i < n; i++) {
+		stages[i].value = 0;
+		stages[i].calls = 0;
+		stages[i].history.clear();
+		stages[i].history_pos = 0;
+		stages[i].history_calls = 0;
+	}
+}
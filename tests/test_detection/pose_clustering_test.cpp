@@ -0,0 +1,143 @@
+/*
+@file pose_clustering_test.cpp
+
+This file tests the hash grid pose clustering (PoseClustering).
+It compares the clusters with the quadratic clustering that CPFMatchingExp and FDClustering used before:
+each candidate is tested against the first pose of all clusters and joins every cluster with a similar pose.
+Cluster order, members, and votes must be identical.
+
+The test runs multiple rounds with the same instance and different candidates, so stale grid cells
+of a previous round would show up as wrong clusters.
+
+Usage:
+	test_pose_clustering
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the pose clustering test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+// TrackingExpert
+#include "PoseClustering.h"
+
+using namespace texpert;
+
+
+/*
+The quadratic reference clustering.
+*/
+int ClusterNaive(const std::vector<Eigen::Affine3f>& poses, const std::vector<int>& votes, float t_threshold, float r_threshold,
+	std::vector< std::vector<int> >& members, std::vector<int>& cluster_votes)
+{
+	members.clear();
+	cluster_votes.clear();
+
+	for (size_t i = 0; i < poses.size(); i++) {
+		bool cluster_found = false;
+
+		for (size_t c = 0; c < members.size(); c++) {
+			const Eigen::Affine3f& seed = poses[members[c].front()];
+
+			if ((poses[i].translation() - seed.translation()).norm() >= t_threshold) continue;
+			if (r_threshold > 0.0f && fabsf(Eigen::AngleAxisf(poses[i].linear().transpose() * seed.linear()).angle()) >= r_threshold) continue;
+
+			cluster_found = true;
+			members[c].push_back((int)i);
+			cluster_votes[c] += votes[i];
+		}
+
+		if (!cluster_found) {
+			members.push_back(std::vector<int>(1, (int)i));
+			cluster_votes.push_back(votes[i]);
+		}
+	}
+	return (int)members.size();
+}
+
+
+/*
+Create candidates around a few object poses plus uniform outliers.
+*/
+void GenerateCandidates(std::mt19937& gen, float offset, std::vector<Eigen::Affine3f>& poses, std::vector<int>& votes)
+{
+	std::normal_distribution<float> noise(0.0f, 0.02f);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	std::uniform_int_distribution<int> vote(1, 50);
+
+	poses.clear();
+	votes.clear();
+
+	for (int o = 0; o < 10; o++) {
+		Eigen::Vector3f center(offset + uniform(gen), uniform(gen), uniform(gen));
+		Eigen::Vector3f axis = Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)).normalized();
+		float angle = 3.0f * uniform(gen);
+
+		for (int i = 0; i < 300; i++) {
+			Eigen::Affine3f T = Eigen::Translation3f(center + Eigen::Vector3f(noise(gen), noise(gen), noise(gen))) *
+				Eigen::AngleAxisf(angle + 5.0f * noise(gen), axis);
+			poses.push_back(T);
+			votes.push_back(vote(gen));
+		}
+	}
+	for (int i = 0; i < 2000; i++) {
+		Eigen::Affine3f T = Eigen::Translation3f(offset + uniform(gen), uniform(gen), uniform(gen)) *
+			Eigen::AngleAxisf(3.0f * uniform(gen), Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)).normalized());
+		poses.push_back(T);
+		votes.push_back(vote(gen));
+	}
+	std::shuffle(poses.begin(), poses.end(), gen);
+}
+
+
+int main(void)
+{
+	std::mt19937 gen(11);
+
+	const float t_threshold = 0.05f;
+	const float r_thresholds[2] = { 0.0f, 0.2f };
+
+	int errors = 0;
+
+	for (float r_threshold : r_thresholds) {
+		PoseClustering clustering;
+		clustering.setTranslationThreshold(t_threshold);
+		clustering.setRotationThreshold(r_threshold);
+
+		for (int round = 0; round < 5; round++) {
+			std::vector<Eigen::Affine3f> poses;
+			std::vector<int> votes;
+			GenerateCandidates(gen, 0.5f * round, poses, votes);
+
+			std::vector< std::vector<int> > members, members_ref;
+			std::vector<int> cluster_votes, cluster_votes_ref;
+
+			int n = clustering.cluster(poses, votes, members, cluster_votes);
+			int n_ref = ClusterNaive(poses, votes, t_threshold, r_threshold, members_ref, cluster_votes_ref);
+
+			bool same = (n == n_ref) && (members == members_ref) && (cluster_votes == cluster_votes_ref);
+			if (!same) errors++;
+
+			std::cout << "[INFO] - rotation threshold " << r_threshold << ", round " << round << ": " << n << " clusters, reference "
+				<< n_ref << " clusters, " << (same ? "identical" : "DIFFERENT") << std::endl;
+		}
+	}
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - PoseClustering: " << errors << " rounds differ from the reference clustering." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - PoseClustering: all rounds identical to the reference clustering." << std::endl;
+	return 0;
+}
@@ -0,0 +1,161 @@
+/*
+@file pose_tracker_test.cpp
+
+This file tests the state transitions of the frame-to-frame tracking state machine (PoseTracker).
+It feeds a sequence of refined poses into the tracker and checks
+- the lock: a healthy pose switches from DETECTING to TRACKING,
+- the seeds: the previous pose, and the constant-velocity prediction after two tracked frames,
+- the loss of the lock: ICP did not converge, the rms is too large, the inlier fraction is below the min. fraction,
+  or below the min. ratio of the inlier fraction at the time the lock was acquired,
+- the re-detection: a healthy pose after a loss acquires a new lock with a new reference inlier fraction.
+
+Usage:
+	test_pose_tracker
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the pose tracker test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <string>
+
+// Eigen
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+// TrackingExpert
+#include "PoseTracker.h"
+
+using namespace texpert;
+
+
+int errors = 0;
+
+
+/*
+Count an error if the condition is false.
+*/
+void Check(bool condition, std::string what)
+{
+	if (!condition) {
+		std::cout << "[ERROR] - PoseTracker: " << what << "." << std::endl;
+		errors++;
+	}
+	else {
+		std::cout << "[INFO] - " << what << "." << std::endl;
+	}
+}
+
+
+/*
+Check the state and the number of seeds returned by predict().
+*/
+bool StateIs(PoseTracker& tracker, PoseTracker::State state, int num_seeds)
+{
+	std::vector<Eigen::Affine3f> seeds;
+	bool tracked = tracker.predict(seeds);
+	return tracker.getState() == state && tracked == (state == PoseTracker::TRACKING) && (int)seeds.size() == num_seeds;
+}
+
+
+/*
+Create a pose from a rotation about the y-axis and a translation.
+*/
+Eigen::Matrix4f MakePose(float angle, const Eigen::Vector3f& t)
+{
+	Eigen::Affine3f pose = Eigen::Translation3f(t) * Eigen::AngleAxisf(angle, Eigen::Vector3f::UnitY());
+	return pose.matrix();
+}
+
+
+int main(void)
+{
+	PoseTracker tracker;
+	tracker.setHealthThresholds(0.01f, 0.3f, 0.5f);
+	tracker.setConstantVelocity(true);
+
+	const Eigen::Matrix4f pose0 = MakePose(0.0f, Eigen::Vector3f(0.0f, 0.0f, 1.0f));
+	const Eigen::Matrix4f pose1 = MakePose(0.05f, Eigen::Vector3f(0.01f, 0.0f, 1.0f));
+	const Eigen::Matrix4f pose2 = MakePose(0.10f, Eigen::Vector3f(0.02f, 0.0f, 1.0f));
+
+	//------------------------------------------------------------------
+	// lock
+
+	Check(StateIs(tracker, PoseTracker::DETECTING, 0), "a new tracker detects");
+
+	Check(!tracker.update(true, pose0, 0.02f, 0.9f) && StateIs(tracker, PoseTracker::DETECTING, 0), "a large rms does not acquire the lock");
+	Check(!tracker.update(true, pose0, 0.005f, 0.2f) && StateIs(tracker, PoseTracker::DETECTING, 0), "few inliers do not acquire the lock");
+	Check(!tracker.update(false, pose0, 0.005f, 0.9f) && StateIs(tracker, PoseTracker::DETECTING, 0), "an unconverged pose does not acquire the lock");
+
+	Check(tracker.update(true, pose0, 0.005f, 0.8f) && StateIs(tracker, PoseTracker::TRACKING, 1), "a healthy pose acquires the lock");
+	Check(tracker.getTrackedFrames() == 0, "no tracked frames after the lock was acquired");
+
+	std::vector<Eigen::Affine3f> seeds;
+	tracker.predict(seeds);
+	Check(!seeds.empty() && seeds[0].matrix().isApprox(pose0), "the seed is the previous pose");
+
+	//------------------------------------------------------------------
+	// constant velocity
+
+	Check(tracker.update(true, pose1, 0.005f, 0.7f) && StateIs(tracker, PoseTracker::TRACKING, 2), "a second healthy pose adds the velocity seed");
+	Check(tracker.getTrackedFrames() == 1, "one tracked frame");
+
+	tracker.predict(seeds);
+	Eigen::Matrix4f predicted = pose1 * pose0.inverse() * pose1;
+	Check(seeds.size() == 2 && seeds[0].matrix().isApprox(predicted, 1e-5f) && seeds[1].matrix().isApprox(pose1),
+		"the prediction continues the motion, the previous pose follows");
+
+	tracker.setConstantVelocity(false);
+	Check(StateIs(tracker, PoseTracker::TRACKING, 1), "without the constant-velocity model, the seed is the previous pose");
+	tracker.setConstantVelocity(true);
+
+	//------------------------------------------------------------------
+	// loss of the lock
+
+	// the reference inlier fraction is 0.8, the ratio limit is 0.5 * 0.8 = 0.4
+	Check(tracker.update(true, pose2, 0.005f, 0.45f) && StateIs(tracker, PoseTracker::TRACKING, 2), "a pose above the inlier ratio keeps the lock");
+
+	Check(!tracker.update(true, pose2, 0.005f, 0.35f) && StateIs(tracker, PoseTracker::DETECTING, 0),
+		"an inlier fraction below the ratio of the reference inliers drops the lock");
+	Check(tracker.getTrackedFrames() == 0, "the loss resets the tracked frames");
+
+	tracker.update(true, pose0, 0.005f, 0.8f);
+	Check(!tracker.update(true, pose1, 0.02f, 0.8f) && StateIs(tracker, PoseTracker::DETECTING, 0), "a large rms drops the lock");
+
+	tracker.update(true, pose0, 0.005f, 0.8f);
+	Check(!tracker.update(false, pose1, 0.005f, 0.8f) && StateIs(tracker, PoseTracker::DETECTING, 0), "an unconverged pose drops the lock");
+
+	tracker.setHealthThresholds(0.01f, 0.3f, 0.0f);
+	tracker.update(true, pose0, 0.005f, 0.8f);
+	Check(!tracker.update(true, pose1, 0.005f, 0.25f) && StateIs(tracker, PoseTracker::DETECTING, 0), "an inlier fraction below the min. fraction drops the lock");
+	tracker.setHealthThresholds(0.01f, 0.3f, 0.5f);
+
+	tracker.update(true, pose0, 0.005f, 0.8f);
+	tracker.reset();
+	Check(StateIs(tracker, PoseTracker::DETECTING, 0), "reset() drops the lock");
+
+	//------------------------------------------------------------------
+	// re-detection
+
+	// the new lock uses the new inlier fraction as reference, 0.35 >= 0.5 * 0.6
+	Check(tracker.update(true, pose2, 0.005f, 0.6f) && StateIs(tracker, PoseTracker::TRACKING, 1), "a detected pose acquires a new lock");
+	Check(tracker.update(true, pose2, 0.005f, 0.35f) && StateIs(tracker, PoseTracker::TRACKING, 2), "the new lock uses the new reference inliers");
+
+	tracker.predict(seeds);
+	Check(!seeds.empty() && seeds.back().matrix().isApprox(pose2), "the new lock seeds the re-detected pose");
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - PoseTracker: " << errors << " checks failed." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - PoseTracker: all checks passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,131 @@
+/*
+@file ppf_benchmark.cpp
+
+This file measures the point pair feature extraction and detection of FDMatching.
+It samples a synthetic model, an ellipsoid, places it with a known pose in front of a plane,
+and runs extract_feature_map() and detect() with 1 thread and with all threads.
+
+The table reports the time of each step, the size of the feature table, and the distance between
+the best pose cluster and the true pose.
+
+Usage:
+	test_ppf_benchmark [model_points] [scene_points] [repetitions] [max_pair_distance]
+
+A max_pair_distance > 0 only pairs model points within this distance, see FDMatching::setMaxPairDistance().
+The model diameter is 120 units.
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the point pair feature benchmark.
+- Added the max. pair distance argument.
+
+*/
+
+// STL
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+// TrackingExpert
+#include "FDMatching.h"
+#include "ParallelUtils.h"
+
+using namespace texpert;
+
+
+/*
+Sample the model, an ellipsoid, and the scene, the posed model points in front of a plane.
+*/
+void GenerateData(int model_points, int scene_points, const Eigen::Affine3f& pose,
+	std::vector<Eigen::Vector3f>& mp, std::vector<Eigen::Vector3f>& mn, std::vector<Eigen::Vector3f>& sp, std::vector<Eigen::Vector3f>& sn)
+{
+	std::mt19937 gen(5);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+	const Eigen::Vector3f axes(60.0f, 40.0f, 25.0f);
+
+	for (int i = 0; i < model_points; i++) {
+		Eigen::Vector3f d = Eigen::Vector3f(normal(gen), normal(gen), normal(gen)).normalized();
+		mp.push_back(d.cwiseProduct(axes));
+		mn.push_back(d.cwiseQuotient(axes).normalized());
+	}
+
+	for (int i = 0; i < scene_points / 2; i++) {
+		int k = gen() % model_points;
+		sp.push_back(pose * mp[k] + 0.3f * Eigen::Vector3f(normal(gen), normal(gen), normal(gen)));
+		sn.push_back(pose.rotation() * mn[k]);
+	}
+	for (int i = scene_points / 2; i < scene_points; i++) {
+		sp.push_back(Eigen::Vector3f(300.0f * uniform(gen), 300.0f * uniform(gen), 500.0f + 5.0f * uniform(gen)));
+		sn.push_back(Eigen::Vector3f(0.0f, 0.0f, -1.0f));
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	int model_points = 1000;
+	int scene_points = 6000;
+	int repetitions = 3;
+	float max_pair_distance = 0.0f;
+
+	if (argc > 1) model_points = std::max(16, atoi(argv[1]));
+	if (argc > 2) scene_points = std::max(16, atoi(argv[2]));
+	if (argc > 3) repetitions = std::max(1, atoi(argv[3]));
+	if (argc > 4) max_pair_distance = std::max(0.0f, (float)atof(argv[4]));
+
+	Eigen::Affine3f pose = Eigen::Translation3f(30.0f, -20.0f, 400.0f) * Eigen::AngleAxisf(0.7f, Eigen::Vector3f(0.2f, 1.0f, 0.3f).normalized());
+
+	std::vector<Eigen::Vector3f> mp, mn, sp, sn;
+	GenerateData(model_points, scene_points, pose, mp, mn, sp, sn);
+
+	std::cout << "[INFO] - ppf benchmark with " << model_points << " model points, " << scene_points << " scene points, "
+		<< repetitions << " repetitions, max. pair distance " << max_pair_distance << "." << std::endl;
+
+	std::cout << "\n" << std::right << std::setw(8) << "threads" << std::setw(14) << "extract ms" << std::setw(14) << "detect ms"
+		<< std::setw(14) << "pose error" << std::endl;
+
+	std::vector<int> threads = { 1, ParallelUtils::NumThreads() };
+	if (threads[1] == 1) threads.pop_back();
+
+	for (int t : threads) {
+		FDMatching fm;
+		fm.setNumThreads(t);
+		fm.setDistanceStep(3.0f);
+		fm.setAngleStep(12.0f);
+		fm.setClusteringThreshold(20.0f, 12.0f);
+		fm.setMaxPairDistance(max_pair_distance);
+
+		double extract_ms = 0.0;
+		double detect_ms = 0.0;
+		std::vector<Pose> poses;
+
+		for (int r = 0; r < repetitions; r++) {
+			auto t0 = std::chrono::high_resolution_clock::now();
+			fm.extract_feature_map(&mp, &mn);
+			auto t1 = std::chrono::high_resolution_clock::now();
+			fm.detect(&sp, &sn, poses);
+			auto t2 = std::chrono::high_resolution_clock::now();
+
+			extract_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			detect_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+		}
+
+		float error = poses.empty() ? -1.0f : (poses[0].t.translation() - pose.translation()).norm();
+
+		std::cout << std::setw(8) << t << std::fixed << std::setprecision(2)
+			<< std::setw(14) << extract_ms / repetitions
+			<< std::setw(14) << detect_ms / repetitions
+			<< std::setw(14) << std::setprecision(4) << error << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,108 @@
+/*
+@file vote_accumulator_test.cpp
+
+This file tests the dense and the sparse counters of the vote accumulator (VoteAccumulator).
+It casts the same random votes into a dense accumulator and into a sparse accumulator with a cell range
+too large for dense counters. For each reference point, both accumulators must return the same vote counts
+from add(), the same voted cells with the same votes in the same order, and thus the same peaks.
+The votes of the later reference points grow the sparse table several times.
+
+Usage:
+	test_vote_accumulator
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the vote accumulator test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <random>
+#include <climits>
+#include <algorithm>
+
+// TrackingExpert
+#include "VoteAccumulator.h"
+
+using namespace texpert;
+
+
+int main(void)
+{
+	std::mt19937 gen(11);
+
+	// the cells of a model with 20000 points and 30 angle bins
+	const int num_cells = 20000 * 30;
+
+	VoteAccumulator dense, sparse;
+	dense.setNumCells(num_cells);
+	sparse.setNumCells(INT_MAX);
+
+	if (!dense.dense() || sparse.dense()) {
+		std::cout << "[ERROR] - VoteAccumulator: expected dense and sparse counters, got " << (dense.dense() ? "dense" : "sparse")
+			<< " and " << (sparse.dense() ? "dense" : "sparse") << "." << std::endl;
+		return 1;
+	}
+
+	int errors = 0;
+
+	for (int ref = 0; ref < 50; ref++) {
+		dense.reset();
+		sparse.reset();
+
+		// a few strong peaks in the noise, more votes for the later reference points
+		int num_votes = 1000 + ref * 2000;
+		std::uniform_int_distribution<int> noise(0, num_cells - 1);
+		std::uniform_int_distribution<int> peak(0, 9);
+		std::vector<int> peaks(10);
+		for (int& p : peaks) p = noise(gen);
+
+		int add_differ = 0;
+		for (int v = 0; v < num_votes; v++) {
+			int cell = (v % 4 == 0) ? peaks[peak(gen)] : noise(gen);
+			if (dense.add(cell) != sparse.add(cell)) add_differ++;
+		}
+
+		int cells_differ = 0;
+		if (dense.size() != sparse.size()) {
+			cells_differ = std::max(dense.size(), sparse.size());
+		}
+		else {
+			for (int k = 0; k < dense.size(); k++) {
+				if (dense.cell(k) != sparse.cell(k) || dense.votes(k) != sparse.votes(k)) cells_differ++;
+			}
+		}
+
+		// the peak: the first cell with the most votes
+		int dense_peak = -1, dense_max = 0, sparse_peak = -1, sparse_max = 0;
+		for (int k = 0; k < dense.size(); k++) {
+			if (dense.votes(k) > dense_max) { dense_max = dense.votes(k); dense_peak = dense.cell(k); }
+		}
+		for (int k = 0; k < sparse.size(); k++) {
+			if (sparse.votes(k) > sparse_max) { sparse_max = sparse.votes(k); sparse_peak = sparse.cell(k); }
+		}
+
+		if (add_differ > 0 || cells_differ > 0 || dense_peak != sparse_peak || dense_max != sparse_max) {
+			errors++;
+			std::cout << "[ERROR] - reference point " << ref << ": " << add_differ << " votes and " << cells_differ
+				<< " cells differ, peak " << dense_peak << " (" << dense_max << " votes) vs. " << sparse_peak << " (" << sparse_max << " votes)." << std::endl;
+		}
+		else if (ref % 10 == 0) {
+			std::cout << "[INFO] - reference point " << ref << ": " << num_votes << " votes, " << dense.size() << " cells, peak "
+				<< dense_peak << " with " << dense_max << " votes." << std::endl;
+		}
+	}
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - VoteAccumulator: the dense and sparse counters differ for " << errors << " reference points." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - VoteAccumulator: the dense and sparse counters give the same votes and peaks." << std::endl;
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+@file icp_batch_test.cpp
+
+This file tests the batch refinement of pose hypotheses (ICPBatch).
+It renders a synthetic depth scene with two spheres in front of a plane, cuts the model points
+from the large sphere, and creates 12 initial poses around the true pose.
+Each hypothesis of the batch must give the same rms, pose, number of iterations, and convergence as a sequential
+ICP::compute() call with the same parameters and the same initial pose. With a low iteration limit, the hypotheses
+must not converge.
+The early abort tests are disabled, since they depend on the timing of the worker threads.
+The test runs with one level and with a coarse-to-fine pyramid, whose downsampled camera and model points
+the batch shares between its workers.
+
+Usage:
+	test_icp_batch
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the icp batch test.
+- Compares the convergence (ICP::hasConverged()) and runs a low iteration limit.
+- The batch also shares the downsampled model points.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+// Eigen
+#include <Eigen/Dense>
+
+// TrackingExpert
+#include "ICP.h"
+#include "ICPBatch.h"
+
+using namespace texpert;
+
+
+/*
+Render the depth scene and cut the model points around the large sphere.
+*/
+void CreateScene(PointCloud& camera, PointCloud& model)
+{
+	std::mt19937 gen(3);
+	std::normal_distribution<float> noise(0.0f, 0.0005f);
+
+	const int width = 320;
+	const int height = 240;
+	const float f = 285.0f;
+
+	const Eigen::Vector3f center(0.02f, -0.01f, 0.9f);
+	const Eigen::Vector3f centers[2] = { center, center + Eigen::Vector3f(0.12f, 0.08f, 0.05f) };
+	const float radii[2] = { 0.12f, 0.06f };
+
+	Eigen::Vector3f plane_n = Eigen::Vector3f(0.3f, 0.2f, -1.0f).normalized();
+	float plane_d = plane_n.dot(Eigen::Vector3f(0.0f, 0.0f, 1.1f));
+
+	for (int j = 0; j < height; j++) {
+		for (int i = 0; i < width; i++) {
+			Eigen::Vector3f dir(-(float)(i - width / 2) / f, -(float)(j - height / 2) / f, 1.0f);
+
+			// closest surface along the ray
+			float depth = plane_d / plane_n.dot(dir);
+			Eigen::Vector3f n = plane_n;
+			for (int s = 0; s < 2; s++) {
+				float a = dir.squaredNorm();
+				float b = -2.0f * dir.dot(centers[s]);
+				float c = centers[s].squaredNorm() - radii[s] * radii[s];
+				float disc = b * b - 4.0f * a * c;
+				if (disc < 0.0f) continue;
+				float d = (-b - std::sqrt(disc)) / (2.0f * a);
+				if (d < depth) {
+					depth = d;
+					n = (dir * d - centers[s]).normalized();
+				}
+			}
+
+			Eigen::Vector3f p = dir * depth + Eigen::Vector3f(noise(gen), noise(gen), noise(gen));
+			camera.points.push_back(p);
+			camera.normals.push_back(n);
+
+			// the model points get their own noise, no pose fits them exactly
+			if ((p - center).norm() < 0.25f && i % 2 == 0 && j % 2 == 0) {
+				model.points.push_back(dir * depth + Eigen::Vector3f(noise(gen), noise(gen), noise(gen)));
+				model.normals.push_back(n);
+			}
+		}
+	}
+	camera.size();
+	model.size();
+}
+
+
+/*
+Compare the batch results with sequential ICP runs.
+@param num_converged - returns the number of converged hypotheses.
+@return the number of hypotheses that differ.
+*/
+int CompareWithSequential(std::string name, PointCloud& camera, PointCloud& model, const std::vector<Eigen::Affine3f>& poses,
+	const std::vector<ICPLevel>& levels, int num_threads, int max_iterations, int& num_converged)
+{
+	const float min_error = 1e-6f;
+	const float reject_distance = 0.05f;
+
+	ICPBatch batch;
+	batch.setNumThreads(num_threads);
+	batch.setMaxHypotheses((int)poses.size());
+	batch.setAbortCriteria(1000, 1000000.0f, 0);
+	batch.setMaxIterations(max_iterations);
+	batch.setMinError(min_error);
+	batch.setRejectMaxDistance(reject_distance);
+	batch.setPyramid(levels);
+	batch.setCameraData(camera);
+
+	std::vector<ICPHypothesis> results;
+	batch.compute(model, poses, results);
+
+	if (results.size() != poses.size()) {
+		std::cout << "[ERROR] - " << name << ": " << results.size() << " results for " << poses.size() << " poses." << std::endl;
+		return (int)poses.size();
+	}
+
+	ICP icp(KD_CPU);
+	icp.setVerbose(false);
+	icp.setNumThreads(1);
+	icp.setMaxIterations(max_iterations);
+	icp.setMinError(min_error);
+	icp.setRejectMaxDistance(reject_distance);
+	icp.setPyramid(levels);
+	icp.setCameraData(camera);
+
+	int wrong = 0;
+	num_converged = 0;
+	for (const ICPHypothesis& r : results) {
+		Pose initial_pose;
+		initial_pose.t = poses[r.id];
+
+		Eigen::Matrix4f result_pose;
+		float rms = 0.0f;
+		bool converged = icp.compute(model, initial_pose, result_pose, rms) && icp.hasConverged();
+		if (r.converged) num_converged++;
+
+		float pose_error = (icp.Rt() - r.pose).cwiseAbs().maxCoeff();
+		bool same = converged == r.converged && std::fabs(rms - r.rms) <= 1e-5f * std::max(1.0f, rms) &&
+			pose_error <= 1e-4f && icp.getIterations() == r.iterations && !r.aborted;
+		if (!same) wrong++;
+
+		std::cout << "[INFO] - " << name << ", hypothesis " << r.id << ": batch rms " << r.rms << ", " << r.iterations
+			<< " iterations" << (r.converged ? "" : ", not converged") << "; sequential rms " << rms << ", " << icp.getIterations()
+			<< " iterations; pose error " << pose_error
+			<< (same ? "" : " - DIFFERENT") << std::endl;
+	}
+	return wrong;
+}
+
+
+int main(void)
+{
+	PointCloud camera, model;
+	CreateScene(camera, model);
+
+	// 12 poses around the true pose
+	std::vector<Eigen::Affine3f> poses;
+	for (int h = 0; h < 12; h++) {
+		float angle = 0.02f + 0.01f * h;
+		Eigen::Vector3f axis = Eigen::Vector3f(0.3f, 1.0f, 0.2f * h).normalized();
+		Eigen::Vector3f t(0.01f * std::sin((float)h), 0.008f * std::cos((float)h), 0.005f);
+		poses.push_back(Eigen::Affine3f(Eigen::Translation3f(t) * Eigen::AngleAxisf(angle, axis)));
+	}
+
+	std::vector<ICPLevel> pyramid;
+	pyramid.push_back(ICPLevel(0.02f, 10, 0.1f, 60.0f));
+	pyramid.push_back(ICPLevel(0.01f, 10, 0.05f, 45.0f));
+	pyramid.push_back(ICPLevel(0.0f, 20));
+
+	int errors = 0;
+	int converged = 0;
+	errors += CompareWithSequential("one level, 1 thread", camera, model, poses, std::vector<ICPLevel>(), 1, 40, converged);
+	errors += CompareWithSequential("one level, 4 threads", camera, model, poses, std::vector<ICPLevel>(), 4, 40, converged);
+	errors += CompareWithSequential("pyramid, 4 threads", camera, model, poses, pyramid, 4, 40, converged);
+
+	// the iteration limit stops all hypotheses before they converge
+	errors += CompareWithSequential("2 iterations, 4 threads", camera, model, poses, std::vector<ICPLevel>(), 4, 2, converged);
+	if (converged > 0) {
+		std::cout << "[ERROR] - ICPBatch: " << converged << " hypotheses converged within 2 iterations." << std::endl;
+		errors += converged;
+	}
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - ICPBatch: " << errors << " hypotheses differ from the sequential ICP." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - ICPBatch: all hypotheses match the sequential ICP." << std::endl;
+	return 0;
+}
@@ -0,0 +1,220 @@
+/*
+@file icp_benchmark.cpp
+
+This file measures the per-iteration cost of ICP.
+It renders a synthetic depth image of a scene with two spheres in front of a tilted plane,
+cuts the model points out of the scene, and registers the model from a perturbed pose
+with all correspondence modes and error metrics.
+
+Each configuration runs a fixed number of iterations (min. error 0), so the time per iteration
+does not depend on the convergence. The first frame is a warm up that allocates all buffers;
+the following frames reuse them. The table reports the time per frame and per iteration, and the
+mean point error of the registered model after the last frame.
+
+With profiling enabled (TRACKINGX_PROFILING), the per-iteration time is split into the
+correspondence search and the fused rejection and accumulation pass.
+
+Usage:
+	test_icp_benchmark [pixel_step] [iterations] [frames]
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the icp per-iteration benchmark.
+
+*/
+
+// STL
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+// TrackingExpert
+#include "ICP.h"
+#include "Profiler.h"
+#include "ParallelUtils.h"
+
+using namespace texpert;
+
+
+/*
+Return the point of the depth image pixel (i, j) at depth d, the projection of the point cloud producer.
+*/
+Eigen::Vector3f BackProject(const DepthIntrinsics& c, int i, int j, float d)
+{
+	return Eigen::Vector3f(-(float)(i - c.width / 2) * d / c.fx + c.cx, -(float)(j - c.height / 2) * d / c.fy + c.cy, d);
+}
+
+
+/*
+Render the scene into a point cloud with one point per sampled pixel.
+The model contains the scene points within a radius around the first sphere.
+*/
+void GenerateScene(const DepthIntrinsics& c, PointCloud& camera, PointCloud& model)
+{
+	std::mt19937 gen(3);
+	std::normal_distribution<float> noise(0.0f, 0.0005f);
+
+	const Eigen::Vector3f center[2] = { Eigen::Vector3f(0.02f, -0.01f, 0.9f), Eigen::Vector3f(0.14f, 0.07f, 0.95f) };
+	const float radius[2] = { 0.12f, 0.06f };
+
+	Eigen::Vector3f plane_n = Eigen::Vector3f(0.3f, 0.2f, -1.0f).normalized();
+	float plane_d = plane_n.dot(Eigen::Vector3f(0.0f, 0.0f, 1.1f));
+
+	camera.points.clear();
+	camera.normals.clear();
+	model.points.clear();
+	model.normals.clear();
+
+	for (int j = 0; j < c.height; j += c.step) {
+		for (int i = 0; i < c.width; i += c.step) {
+			Eigen::Vector3f dir = BackProject(c, i, j, 1.0f);
+
+			// the closest surface along the ray
+			float best = plane_d / plane_n.dot(dir);
+			Eigen::Vector3f n = plane_n;
+
+			for (int s = 0; s < 2; s++) {
+				float a = dir.squaredNorm();
+				float b = -2.0f * dir.dot(center[s]);
+				float cc = center[s].squaredNorm() - radius[s] * radius[s];
+				float disc = b * b - 4.0f * a * cc;
+				if (disc < 0.0f) continue;
+
+				float d = (-b - std::sqrt(disc)) / (2.0f * a);
+				if (d < best) {
+					best = d;
+					n = (dir * d - center[s]).normalized();
+				}
+			}
+
+			Eigen::Vector3f p = dir * best + Eigen::Vector3f(noise(gen), noise(gen), noise(gen));
+			camera.points.push_back(p);
+			camera.normals.push_back(n);
+
+			if ((p - center[0]).norm() < 0.25f) {
+				model.points.push_back(p);
+				model.normals.push_back(n);
+			}
+		}
+	}
+	camera.size();
+	model.size();
+}
+
+
+/*
+Return the mean distance between the registered model points and their true position.
+*/
+double PointError(ICP& icp, PointCloud& model, const Pose& pose)
+{
+	Eigen::Vector3f c0(0.0f, 0.0f, 0.0f);
+	for (const Eigen::Vector3f& p : model.points) c0 += pose.t * p;
+	c0 /= (float)model.points.size();
+
+	double err = 0.0;
+	for (const Eigen::Vector3f& p : model.points) {
+		Eigen::Vector3f r = icp.R() * (pose.t * p - c0) + c0 + icp.t();
+		err += (r - p).norm();
+	}
+	return err / model.points.size();
+}
+
+
+/*
+Print the mean time of a profiler stage.
+*/
+void PrintStage(const std::string& name)
+{
+#ifdef TRACKINGX_PROFILING
+	ProfilerStats stats;
+	if (Profiler::GetStats(name, stats)) {
+		std::cout << std::setw(14) << name << ": " << std::fixed << std::setprecision(3) << stats.mean << " ms/frame" << std::endl;
+	}
+#endif
+}
+
+
+int main(int argc, char** argv)
+{
+	int step = 2;
+	int iterations = 20;
+	int frames = 20;
+
+	if (argc > 1) step = std::max(1, atoi(argv[1]));
+	if (argc > 2) iterations = std::max(1, std::min(1000, atoi(argv[2])));
+	if (argc > 3) frames = std::max(1, atoi(argv[3]));
+
+	DepthIntrinsics c;
+	c.width = 640;
+	c.height = 480;
+	c.fx = 570.0f;
+	c.fy = 570.0f;
+	c.cx = 0.01f;
+	c.cy = -0.02f;
+	c.step = step;
+
+	PointCloud camera, model;
+	GenerateScene(c, camera, model);
+
+	std::cout << "[INFO] - icp benchmark with " << camera.size() << " camera points, " << model.size() << " model points, "
+		<< iterations << " iterations, " << frames << " frames, " << ParallelUtils::NumThreads() << " threads." << std::endl;
+
+	Pose pose;
+	pose.t = Eigen::Affine3f(Eigen::Translation3f(0.01f, -0.008f, 0.006f) * Eigen::AngleAxisf(0.06f, Eigen::Vector3f(0.3f, 1.0f, 0.2f).normalized()));
+
+	const std::string metric_names[3] = { "point", "plane", "symmetric" };
+
+	std::cout << "\n" << std::left << std::setw(14) << "matching" << std::setw(12) << "metric" << std::right
+		<< std::setw(12) << "ms/frame" << std::setw(12) << "ms/iter" << std::setw(14) << "error" << std::endl;
+
+	for (int mode = 0; mode < 2; mode++) {
+		for (int metric = 0; metric < 3; metric++) {
+
+			ICP icp;
+			icp.setVerbose(false);
+			icp.setMaxIterations(iterations);
+			icp.setMinError(0.0f);
+			icp.setRejectMaxDistance(0.05f);
+			icp.setRejectMaxAngle(45.0f);
+			icp.setCameraIntrinsics(c);
+			icp.setCorrespondenceMode(mode == 0 ? ICP::KNN_SEARCH : ICP::PROJECTIVE);
+			icp.setErrorMetric((ICP::Metric)metric);
+			icp.setCameraData(camera);
+
+			Eigen::Matrix4f result;
+			float rms = 0.0f;
+
+			// warm up, builds the index and allocates all buffers
+			icp.compute(model, pose, result, rms);
+
+#ifdef TRACKINGX_PROFILING
+			Profiler::Reset();
+#endif
+			auto t0 = std::chrono::high_resolution_clock::now();
+			for (int f = 0; f < frames; f++) {
+				icp.compute(model, pose, result, rms);
+				TX_PROFILE_FRAME();
+			}
+			auto t1 = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / frames;
+
+			std::cout << std::left << std::setw(14) << (mode == 0 ? "knn" : "projective") << std::setw(12) << metric_names[metric] << std::right << std::fixed
+				<< std::setw(12) << std::setprecision(3) << ms
+				<< std::setw(12) << std::setprecision(4) << ms / iterations
+				<< std::setw(14) << std::setprecision(6) << PointError(icp, model, pose) << std::endl;
+
+			PrintStage("icp_iteration");
+			PrintStage("icp_accumulate");
+			PrintStage("icp_transform");
+		}
+	}
+
+	return 0;
+}
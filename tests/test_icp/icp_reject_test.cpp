@@ -0,0 +1,123 @@
+/*
+@file icp_reject_test.cpp
+
+This file tests the outlier rejection of ICP (ICPReject).
+ICP uses accept(), which compares squared distances and the cosine of the angle, while test() computes
+the distance and the angle. Both functions must accept and reject the same point pairs for all test cases
+and thresholds, including pairs with zero-length normal vectors. A zero-length normal vector counts as
+an angle of 90 degrees, so these pairs are inliers only if the max. angle is at least 90 degrees.
+Pairs within a small margin of a threshold are skipped, since the two computations round differently.
+
+Usage:
+	test_icp_reject
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the outlier rejection test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cmath>
+
+// Eigen
+#include <Eigen/Dense>
+
+// TrackingExpert
+#include "ICPReject.h"
+
+
+/*
+Check if the pair is close to the distance or angle threshold.
+*/
+bool AtThreshold(const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, const Eigen::Vector3f& n0, const Eigen::Vector3f& n1,
+	double max_distance, double max_angle)
+{
+	if (std::fabs((p0 - p1).cast<double>().norm() - max_distance) < 1e-5) return true;
+	if (n0.squaredNorm() > 0.0f && n1.squaredNorm() > 0.0f) {
+		double c = n0.cast<double>().normalized().dot(n1.cast<double>().normalized());
+		double angle = std::acos(std::max(-1.0, std::min(1.0, c)));
+		if (std::fabs(angle - max_angle) < 1e-4) return true;
+	}
+	return false;
+}
+
+
+int main(void)
+{
+	std::mt19937 gen(17);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+	const float distances[2] = { 0.01f, 0.05f };
+	const float angles[8] = { 0.0f, 10.0f, 45.0f, 89.0f, 90.0f, 91.0f, 135.0f, 180.0f };
+	const ICPReject::Testcase testcases[4] = { ICPReject::NONE, ICPReject::DIST, ICPReject::ANG, ICPReject::DIST_ANG };
+	const std::string names[4] = { "NONE", "DIST", "ANG", "DIST_ANG" };
+
+	// random pairs around the distance thresholds. Every fifth pair has a zero-length normal vector.
+	std::vector<Eigen::Vector3f> p0, p1, n0, n1;
+	for (int i = 0; i < 20000; i++) {
+		Eigen::Vector3f p(uniform(gen), uniform(gen), uniform(gen));
+		p0.push_back(p);
+		p1.push_back(p + 0.04f * Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)));
+
+		Eigen::Vector3f a(uniform(gen), uniform(gen), uniform(gen));
+		Eigen::Vector3f b(uniform(gen), uniform(gen), uniform(gen));
+		switch (i % 5) {
+		case 0: a.setZero(); break;
+		case 1: b.setZero(); break;
+		case 2: if (i % 10 == 2) { a.setZero(); b.setZero(); } break;
+		default: break;
+		}
+		n0.push_back(a);
+		n1.push_back(b);
+	}
+
+	int errors = 0;
+
+	for (float max_distance : distances) {
+		for (float max_angle : angles) {
+			ICPReject reject;
+			reject.setMaxThreshold(max_distance);
+			reject.setMaxNormalVectorAngle(max_angle);
+
+			for (int t = 0; t < 4; t++) {
+				int differ = 0;
+				int zero_wrong = 0;
+				int inliers = 0;
+
+				for (size_t i = 0; i < p0.size(); i++) {
+					if (AtThreshold(p0[i], p1[i], n0[i], n1[i], max_distance, max_angle / 180.0 * 3.14159265358)) continue;
+
+					bool a = reject.test(p0[i], p1[i], n0[i], n1[i], testcases[t]);
+					bool b = reject.accept(p0[i], p1[i], n0[i], n1[i], testcases[t]);
+					if (a != b) differ++;
+					if (b) inliers++;
+
+					// the documented rule for zero-length normal vectors
+					if (testcases[t] == ICPReject::ANG && (n0[i].squaredNorm() == 0.0f || n1[i].squaredNorm() == 0.0f)) {
+						if (b != (max_angle >= 90.0f)) zero_wrong++;
+					}
+				}
+				if (differ > 0 || zero_wrong > 0) errors++;
+
+				std::cout << "[INFO] - " << names[t] << ", max. distance " << max_distance << ", max. angle " << max_angle << ": " << inliers
+					<< " inliers, " << differ << " different, " << zero_wrong << " zero normal errors." << std::endl;
+			}
+		}
+	}
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - ICPReject: test() and accept() differ in " << errors << " cases." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - ICPReject: test() and accept() agree in all cases." << std::endl;
+	return 0;
+}
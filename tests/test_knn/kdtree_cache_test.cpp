@@ -0,0 +1,146 @@
+/*
+@file kdtree_cache_test.cpp
+
+This file tests the kd-tree cache (KdTreeCache).
+It checks that
+- the same points return the cached tree (hit),
+- changed points build a new tree (miss), which contains the changed points,
+- the least recently used tree is evicted if the cache is full, and an evicted tree stays valid for its holders.
+
+Usage:
+	test_kdtree_cache
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the kd-tree cache test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+
+// Eigen
+#include <Eigen/Dense>
+
+// TrackingExpert
+#include "KdTreeCache.h"
+
+
+int errors = 0;
+
+
+/*
+Count an error if the condition is false.
+*/
+void Check(bool condition, std::string what)
+{
+	if (!condition) {
+		std::cout << "[ERROR] - KdTreeCache: " << what << "." << std::endl;
+		errors++;
+	}
+	else {
+		std::cout << "[INFO] - " << what << "." << std::endl;
+	}
+}
+
+
+/*
+Check the cache statistics.
+*/
+bool StatsAre(std::int64_t hits, std::int64_t misses, int trees)
+{
+	KdTreeCacheStats stats = KdTreeCache::GetStats();
+	return stats.hits == hits && stats.misses == misses && stats.trees == trees;
+}
+
+
+/*
+Check if the nearest neighbor of each point is the point itself.
+*/
+bool ContainsPoints(std::shared_ptr<IKdTree> tree, const std::vector<Eigen::Vector3f>& points)
+{
+	KNNResults results;
+	tree->knn(PointView(points), results, 1, 0);
+	if (results.size() != (int)points.size()) return false;
+
+	for (int i = 0; i < results.size(); i++) {
+		if (results.end(i) - results.begin(i) != 1) return false;
+		if (results.distances[results.begin(i)] != 0.0f) return false;
+	}
+	return true;
+}
+
+
+int main(void)
+{
+	std::mt19937 gen(9);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+	std::vector<Eigen::Vector3f> a(2000), b(2000), c(2000);
+	for (int i = 0; i < 2000; i++) {
+		a[i] = Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen));
+		b[i] = Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen));
+		c[i] = Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen));
+	}
+
+	int capacity = KdTreeCache::GetCapacity();
+	KdTreeCache::Clear();
+
+	//------------------------------------------------------------------
+	// hit
+
+	std::shared_ptr<IKdTree> tree_a = KdTreeCache::Get(PointView(a));
+	Check(tree_a != NULL && StatsAre(0, 1, 1), "the first request builds the tree");
+
+	std::vector<Eigen::Vector3f> copy_a = a;
+	std::shared_ptr<IKdTree> tree_a2 = KdTreeCache::Get(PointView(copy_a));
+	Check(tree_a2 == tree_a && StatsAre(1, 1, 1), "a copy of the same points returns the cached tree");
+
+	//------------------------------------------------------------------
+	// miss after the content changes
+
+	copy_a[1000].x() += 0.001f;
+	Check(KdTreeCache::Hash(PointView(copy_a)) != KdTreeCache::Hash(PointView(a)), "one changed coordinate changes the hash");
+
+	std::shared_ptr<IKdTree> tree_changed = KdTreeCache::Get(PointView(copy_a));
+	Check(tree_changed != tree_a && StatsAre(1, 2, 2), "changed points build a new tree");
+	Check(ContainsPoints(tree_changed, copy_a), "the new tree contains the changed points");
+	Check(ContainsPoints(tree_a, a), "the old tree still contains the old points");
+
+	//------------------------------------------------------------------
+	// LRU eviction
+
+	KdTreeCache::Clear();
+	KdTreeCache::SetCapacity(2);
+
+	tree_a = KdTreeCache::Get(PointView(a));
+	std::shared_ptr<IKdTree> tree_b = KdTreeCache::Get(PointView(b));
+	KdTreeCache::Get(PointView(a)); // a is now the most recently used tree
+	Check(StatsAre(1, 2, 2), "two trees in a cache of capacity 2");
+
+	KdTreeCache::Get(PointView(c)); // evicts b
+	Check(StatsAre(1, 3, 2), "a third tree evicts one tree");
+
+	Check(KdTreeCache::Get(PointView(a)) == tree_a && StatsAre(2, 3, 2), "the recently used tree is kept");
+
+	Check(ContainsPoints(tree_b, b), "the evicted tree stays valid for its holder");
+
+	Check(KdTreeCache::Get(PointView(b)) != tree_b && StatsAre(2, 4, 2), "the least recently used tree was evicted");
+
+	KdTreeCache::SetCapacity(capacity);
+	KdTreeCache::Clear();
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - KdTreeCache: " << errors << " checks failed." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - KdTreeCache: all checks passed." << std::endl;
+	return 0;
+}
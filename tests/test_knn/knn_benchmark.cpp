@@ -0,0 +1,218 @@
+/*
+@file knn_benchmark.cpp
+
+This file measures the accuracy and the throughput of the knn search modes.
+It generates a random point cloud, runs the knn search for all points with the exact mode
+and with the approximate mode for different leaf budgets, and reports the recall@k against
+a brute-force search and the number of queries per second.
+
+Two datasets are used: points in a cube and points on a noisy sphere surface.
+The sphere is closer to camera data, where the points lie on surfaces.
+
+The cpu kd-tree is always tested. The cuda kd-tree is tested if a cuda device is available;
+it ignores the search mode, so only one row is reported for it.
+
+Usage:
+	test_knn_benchmark [num_points] [k] [num_recall_queries]
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the knn recall and throughput benchmark.
+
+*/
+
+// STL
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+// TrackingExpert
+#include "KNN.h"
+#include "ResourceManager.h"
+#include "ParallelUtils.h"
+
+using namespace texpert;
+
+
+/*
+Generate random points in a cube.
+*/
+void GenerateCube(PointCloud& pc, int num_points)
+{
+	std::mt19937 gen(11);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	pc.points.resize(num_points);
+	pc.normals.resize(num_points);
+	for (int i = 0; i < num_points; i++) {
+		pc.points[i] = Eigen::Vector3f(dist(gen), dist(gen), dist(gen));
+		pc.normals[i] = pc.points[i].normalized();
+	}
+	pc.size();
+}
+
+
+/*
+Generate random points on a sphere surface with some noise.
+*/
+void GenerateSphere(PointCloud& pc, int num_points)
+{
+	std::mt19937 gen(13);
+	std::normal_distribution<float> dist(0.0f, 1.0f);
+
+	pc.points.resize(num_points);
+	pc.normals.resize(num_points);
+	for (int i = 0; i < num_points; i++) {
+		Eigen::Vector3f n = Eigen::Vector3f(dist(gen), dist(gen), dist(gen)).normalized();
+		pc.points[i] = n * (1.0f + 0.002f * dist(gen));
+		pc.normals[i] = n;
+	}
+	pc.size();
+}
+
+
+/*
+Find the k nearest neighbors of the query points by comparing all points.
+@param truth - the point ids of the k nearest neighbors, k per query point.
+*/
+void BruteForce(PointCloud& pc, const std::vector<int>& queries, int k, std::vector<int>& truth)
+{
+	int N = (int)pc.points.size();
+	int Q = (int)queries.size();
+	truth.resize(size_t(Q) * k);
+
+	ParallelUtils::For(Q, ParallelUtils::NumThreads(), [&](int thread_id, int begin, int end) {
+		std::vector<std::pair<float, int>> d(N);
+		for (int q = begin; q < end; q++) {
+			const Eigen::Vector3f& p = pc.points[queries[q]];
+			for (int i = 0; i < N; i++) {
+				d[i] = std::make_pair((pc.points[i] - p).squaredNorm(), i);
+			}
+			std::partial_sort(d.begin(), d.begin() + k, d.end());
+			for (int j = 0; j < k; j++) {
+				truth[size_t(q) * k + j] = d[j].second;
+			}
+		}
+	});
+}
+
+
+/*
+Return the mean fraction of the true k nearest neighbors that were found.
+*/
+double Recall(const KNNResults& results, const std::vector<int>& queries, int k, const std::vector<int>& truth)
+{
+	double sum = 0.0;
+	for (size_t q = 0; q < queries.size(); q++) {
+		int i = queries[q];
+		int found = 0;
+		for (int j = 0; j < k; j++) {
+			int id = truth[q * k + j];
+			for (int r = results.begin(i); r < results.end(i); r++) {
+				if (results.indices[r] == id) {
+					found++;
+					break;
+				}
+			}
+		}
+		sum += double(found) / k;
+	}
+	return sum / queries.size();
+}
+
+
+/*
+Run one configuration and print a table row.
+*/
+void Run(KNN& knn, PointCloud& pc, const std::string& name, const std::string& mode, int k,
+		 const std::vector<int>& queries, const std::vector<int>& truth)
+{
+	KNNResults results;
+
+	// warm up, also allocates the result buffers
+	knn.knn(PointView(pc.points), k, results);
+
+	const int repeat = 3;
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeat; r++) {
+		knn.knn(PointView(pc.points), k, results);
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+	double sec = std::chrono::duration<double>(t1 - t0).count() / repeat;
+
+	double qps = pc.points.size() / sec;
+	double recall = Recall(results, queries, k, truth);
+
+	std::cout << std::left << std::setw(10) << name << std::setw(16) << mode << std::right << std::fixed
+		<< std::setw(12) << std::setprecision(4) << recall
+		<< std::setw(14) << std::setprecision(0) << qps
+		<< std::setw(12) << std::setprecision(2) << sec * 1000.0 << std::endl;
+}
+
+
+int main(int argc, char** argv)
+{
+	int num_points = 200000;
+	int k = 10;
+	int num_queries = 1000;
+
+	if (argc > 1) num_points = std::max(100, atoi(argv[1]));
+	if (argc > 2) k = std::max(1, std::min(KNN_MATCHES_LENGTH, atoi(argv[2])));
+	if (argc > 3) num_queries = std::max(1, std::min(num_points, atoi(argv[3])));
+
+	std::cout << "[INFO] - knn benchmark with " << num_points << " points, k = " << k << ", " << num_queries << " recall queries, "
+		<< ParallelUtils::NumThreads() << " threads." << std::endl;
+
+	std::vector<KdTreeBackend> backends;
+	backends.push_back(KD_CPU);
+	if (ResourceManager::HasCudaDevice()) backends.push_back(KD_CUDA);
+
+	const int budgets[] = { 1, 2, 4, 8, 16, 32 };
+
+	for (int dataset = 0; dataset < 2; dataset++) {
+
+		PointCloud pc;
+		std::string name = (dataset == 0) ? "cube" : "sphere";
+		if (dataset == 0) GenerateCube(pc, num_points);
+		else GenerateSphere(pc, num_points);
+
+		// evenly distributed query points for the recall
+		std::vector<int> queries(num_queries);
+		for (int q = 0; q < num_queries; q++) {
+			queries[q] = (int)((long long)q * num_points / num_queries);
+		}
+
+		std::vector<int> truth;
+		BruteForce(pc, queries, k, truth);
+
+		std::cout << "\n" << std::left << std::setw(10) << "dataset" << std::setw(16) << "mode" << std::right
+			<< std::setw(12) << "recall@" + std::to_string(k) << std::setw(14) << "queries/s" << std::setw(12) << "ms" << std::endl;
+
+		for (KdTreeBackend backend : backends) {
+			KNN knn(backend);
+			knn.populate(pc);
+
+			if (backend == KD_CUDA) {
+				Run(knn, pc, name, "cuda", k, queries, truth);
+				continue;
+			}
+
+			knn.setSearchMode(KNN_EXACT);
+			Run(knn, pc, name, "cpu exact", k, queries, truth);
+
+			for (int b : budgets) {
+				knn.setSearchMode(KNN_APPROXIMATE, b);
+				Run(knn, pc, name, "cpu leaves " + std::to_string(b), k, queries, truth);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -23,6 +23,9 @@ Last edited:
 July 7, 2020, RR
 - Added a function to test the radius search. 
 
+Oct 17, 2026
+- Added a test round for the cpu kd-tree backend. 
+
 */
 
 // STL
@@ -331,6 +334,24 @@ int main(int argc, char** argv)
 
 	delete knn;
 
+	//-------------------------------------------------
+	// Run the tests with the cpu kd-tree
+
+	std::cout << "\n[Info] 5. Testing the cpu kd-tree backend." << endl;
+
+	knn = new KNN(KD_CPU);
+
+	for(int i = 0; i< 5; i++){
+		RunTest( 10000, -1.0, 1.0);
+	}
+
+	for(int i = 0; i< 5; i++){
+		float radius = 0.1 * i + 0.1;
+		RunRadiusTest(10000, 2000, -1.0, 1.0, radius);
+	}
+
+	delete knn;
+
 }
 
 
@@ -0,0 +1,153 @@
+/*
+@file radius_grid_test.cpp
+
+This file tests the radius search of the uniform grid (Cpu_RadiusGrid).
+It compares the neighbors of random search points with a brute-force search on a random point cloud
+with a dense cluster and far outliers. The test covers a search radius equal to the cell size,
+a radius larger than the cell size, a max. number of neighbors, and multiple threads.
+Points with equal distances can appear in any order, so the neighbors are compared by their sorted
+distances, and each neighbor must be a distinct point with the reported distance.
+
+Usage:
+	test_radius_grid
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the radius grid test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+// Eigen
+#include <Eigen/Dense>
+
+// TrackingExpert
+#include "Cpu_RadiusGrid.h"
+
+
+/*
+Brute-force radius search. Returns all points within the radius, sorted by distance.
+*/
+void BruteForce(const std::vector<Eigen::Vector3f>& points, const Eigen::Vector3f& q, float radius, std::vector<std::pair<float, int>>& row)
+{
+	row.clear();
+	float max_dist2 = radius * radius;
+	for (size_t i = 0; i < points.size(); i++) {
+		float dx = points[i].x() - q.x();
+		float dy = points[i].y() - q.y();
+		float dz = points[i].z() - q.z();
+		float d = dx * dx + dy * dy + dz * dz;
+		if (d <= max_dist2) row.push_back(std::make_pair(d, (int)i));
+	}
+	std::sort(row.begin(), row.end());
+}
+
+
+int main(void)
+{
+	std::mt19937 gen(13);
+	std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	std::normal_distribution<float> cluster(0.0f, 0.02f);
+
+	std::vector<Eigen::Vector3f> points;
+	for (int i = 0; i < 20000; i++) {
+		points.push_back(Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)));
+	}
+	for (int i = 0; i < 5000; i++) {
+		points.push_back(Eigen::Vector3f(0.5f + cluster(gen), 0.5f + cluster(gen), 0.5f + cluster(gen)));
+	}
+	for (int i = 0; i < 10; i++) {
+		points.push_back(Eigen::Vector3f(1000.0f * uniform(gen), -1000.0f * uniform(gen), 1000.0f * uniform(gen)));
+	}
+
+	// search points inside the cloud, in the cluster, and on the reference points
+	std::vector<Eigen::Vector3f> search;
+	for (int i = 0; i < 500; i++) {
+		search.push_back(Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)));
+	}
+	for (int i = 0; i < 200; i++) {
+		search.push_back(Eigen::Vector3f(0.5f + cluster(gen), 0.5f + cluster(gen), 0.5f + cluster(gen)));
+	}
+	for (int i = 0; i < 300; i++) {
+		search.push_back(points[(i * 97) % points.size()]);
+	}
+
+	const float cell_size = 0.05f;
+	const float radii[2] = { 0.05f, 0.12f };
+	const int max_neighbors[2] = { -1, 10 };
+	const int threads[2] = { 1, 4 };
+
+	int errors = 0;
+	std::vector<std::pair<float, int>> row, found;
+
+	for (int num_threads : threads) {
+		Cpu_RadiusGrid grid;
+		grid.setNumThreads(num_threads);
+		grid.initialize(PointView(points), cell_size);
+
+		for (float radius : radii) {
+			for (int k : max_neighbors) {
+				KNNResults results;
+				grid.radius_search(PointView(search), results, radius, k);
+
+				int wrong = 0;
+				int truncated = 0;
+				int total = 0;
+
+				if (results.size() != (int)search.size()) wrong = (int)search.size();
+
+				for (int i = 0; i < results.size() && wrong == 0; i++) {
+					BruteForce(points, search[i], radius, row);
+					if (k > 0 && (int)row.size() > k) {
+						truncated++;
+						row.resize(k);
+					}
+					total += (int)row.size();
+
+					if (results.end(i) - results.begin(i) != (int)row.size()) {
+						wrong++;
+						continue;
+					}
+					found.clear();
+					for (int r = results.begin(i); r < results.end(i); r++) {
+						found.push_back(std::make_pair(results.distances[r], results.indices[r]));
+					}
+					std::sort(found.begin(), found.end());
+
+					for (int j = 0; j < (int)row.size(); j++) {
+						int id = found[j].second;
+						bool distinct = j == 0 || found[j] != found[j - 1];
+						bool valid = id >= 0 && id < (int)points.size() && distinct &&
+							std::fabs((points[id] - search[i]).squaredNorm() - found[j].first) <= 1e-6f;
+						if (!valid || std::fabs(found[j].first - row[j].first) > 1e-6f) {
+							wrong++;
+							break;
+						}
+					}
+				}
+				if (results.truncated != truncated) wrong++;
+				if (wrong > 0) errors++;
+
+				std::cout << "[INFO] - " << num_threads << " threads, radius " << radius << ", max. neighbors " << k << ": "
+					<< total << " neighbors, " << truncated << " truncated, " << wrong << " different." << std::endl;
+			}
+		}
+	}
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - Cpu_RadiusGrid: " << errors << " searches differ from the brute-force search." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - Cpu_RadiusGrid: all searches identical to the brute-force search." << std::endl;
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*
+@file loader_benchmark.cpp
+
+This file compares the obj loaders. It writes a random point cloud with ReaderWriterOBJ
+or uses the file given as first argument, loads it with ReaderWriterOBJ, LoaderObj, and 
+FastLoaderOBJ, and reports the load times. The points and normal vectors of FastLoaderOBJ 
+must match the result of ReaderWriterOBJ.
+
+Usage:
+	test_loader [file.obj] [num_points]
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the obj loader benchmark.
+
+*/
+
+// STL
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+
+// TrackingExpert
+#include "ReaderWriterOBJ.h"
+#include "LoaderOBJ.h"
+#include "FastLoaderOBJ.h"
+#include "ParallelUtils.h"
+
+using namespace texpert;
+
+
+/*
+Write a random point cloud with normal vectors to file.
+*/
+void WriteRandomModel(std::string file, int num_points)
+{
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+	std::vector<Eigen::Vector3f> points(num_points);
+	std::vector<Eigen::Vector3f> normals(num_points);
+	for (int i = 0; i < num_points; i++) {
+		points[i] = Eigen::Vector3f(dist(gen), dist(gen), dist(gen));
+		normals[i] = Eigen::Vector3f(dist(gen), dist(gen), dist(gen)).normalized();
+	}
+
+	ReaderWriterOBJ::Write(file, points, normals);
+}
+
+
+/*
+Return the time in ms to run func. 
+*/
+template<typename F>
+double Time(F func)
+{
+	auto t0 = std::chrono::high_resolution_clock::now();
+	func();
+	auto t1 = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+
+/*
+Compare two vectors of points. Returns the number of different entries.
+*/
+int Compare(const std::vector<Eigen::Vector3f>& a, const std::vector<Eigen::Vector3f>& b)
+{
+	if (a.size() != b.size()) return (int)std::max(a.size(), b.size());
+
+	int diff = 0;
+	for (size_t i = 0; i < a.size(); i++) {
+		if ((a[i] - b[i]).norm() > 1e-6f) diff++;
+	}
+	return diff;
+}
+
+
+
+int main(int argc, char** argv)
+{
+	std::string file = "loader_benchmark.obj";
+	int num_points = 1000000;
+
+	if (argc > 1) file = argv[1];
+	if (argc > 2) num_points = std::atoi(argv[2]);
+
+	if (argc <= 1) {
+		std::cout << "[INFO] - Writing " << num_points << " random points to " << file << "." << std::endl;
+		WriteRandomModel(file, num_points);
+	}
+
+	std::vector<Eigen::Vector3f> p0, n0, p1, n1, p2, n2, p3, n3;
+
+	double t0 = Time([&]() { ReaderWriterOBJ::Read(file, p0, n0); });
+	double t1 = Time([&]() { LoaderObj::Read(file, &p1, &n1, false, false); });
+	double t2 = Time([&]() { FastLoaderOBJ::Read(file, p2, n2, false, 1); });
+	double t3 = Time([&]() { FastLoaderOBJ::Read(file, p3, n3, false, ParallelUtils::NumThreads()); });
+
+	std::cout << "\n[INFO] - Loaded " << p0.size() << " points and " << n0.size() << " normal vectors." << std::endl;
+	std::cout << "ReaderWriterOBJ:\t\t" << t0 << " ms" << std::endl;
+	std::cout << "LoaderObj:\t\t\t" << t1 << " ms" << std::endl;
+	std::cout << "FastLoaderOBJ, 1 thread:\t" << t2 << " ms (" << t0 / t2 << "x)" << std::endl;
+	std::cout << "FastLoaderOBJ, " << ParallelUtils::NumThreads() << " threads:\t" << t3 << " ms (" << t0 / t3 << "x)" << std::endl;
+
+	int diff = Compare(p0, p3) + Compare(n0, n3) + Compare(p2, p3) + Compare(n2, n3);
+	if (diff > 0) {
+		std::cout << "[ERROR] - FastLoaderOBJ and ReaderWriterOBJ differ in " << diff << " entries." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - FastLoaderOBJ and ReaderWriterOBJ results match." << std::endl;
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+@file ply_roundtrip_test.cpp
+
+This file tests the ReaderWriterPLY reader and writer. It writes a random point cloud
+as ascii and binary_little_endian file, reads the files back, and compares points and normal vectors.
+Files without normal vectors are written with only x, y, z vertex properties; the reader must
+return the points and zero normal vectors.
+
+Usage:
+	test_ply_roundtrip
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the ply round-trip test.
+
+*/
+
+// STL
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+// TrackingExpert
+#include "ReaderWriterPLY.h"
+
+
+/*
+Write a ply file with x, y, z vertex properties only.
+*/
+bool WritePointsOnly(std::string file, const std::vector<Eigen::Vector3f>& points, const PLYFormat format)
+{
+	std::ofstream of(file, std::ofstream::out | std::ofstream::binary);
+	if (!of.is_open()) return false;
+
+	of << "ply\n";
+	of << (format == PLY_BINARY_LE ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
+	of << "element vertex " << points.size() << "\n";
+	of << "property float x\n";
+	of << "property float y\n";
+	of << "property float z\n";
+	of << "end_header\n";
+
+	for (const Eigen::Vector3f& p : points) {
+		if (format == PLY_BINARY_LE) {
+			// the test hosts are little endian
+			of.write(reinterpret_cast<const char*>(p.data()), 3 * sizeof(float));
+		}
+		else {
+			of << std::fixed << p.x() << " " << p.y() << " " << p.z() << "\n";
+		}
+	}
+	of.close();
+	return true;
+}
+
+
+/*
+Compare the loaded points and normal vectors with the original data.
+@return the number of errors.
+*/
+int Compare(std::string name, const std::vector<Eigen::Vector3f>& points, const std::vector<Eigen::Vector3f>& normals,
+	const std::vector<Eigen::Vector3f>& loaded_points, const std::vector<Eigen::Vector3f>& loaded_normals, const float tolerance)
+{
+	if (loaded_points.size() != points.size() || loaded_normals.size() != points.size()) {
+		std::cout << "[ERROR] - " << name << ": loaded " << loaded_points.size() << " points and " << loaded_normals.size()
+			<< " normals, expected " << points.size() << "." << std::endl;
+		return 1;
+	}
+
+	float max_error = 0.0f;
+	for (size_t i = 0; i < points.size(); i++) {
+		max_error = std::max(max_error, (loaded_points[i] - points[i]).cwiseAbs().maxCoeff());
+		max_error = std::max(max_error, (loaded_normals[i] - normals[i]).cwiseAbs().maxCoeff());
+	}
+
+	if (max_error > tolerance) {
+		std::cout << "[ERROR] - " << name << ": max. error " << max_error << " exceeds " << tolerance << "." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - " << name << ": " << points.size() << " points match, max. error " << max_error << "." << std::endl;
+	return 0;
+}
+
+
+int main(void)
+{
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+	// no point at the origin; Write skips those
+	const int num_points = 5000;
+	std::vector<Eigen::Vector3f> points(num_points), normals(num_points), zero_normals(num_points, Eigen::Vector3f::Zero());
+	for (int i = 0; i < num_points; i++) {
+		points[i] = Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)) + Eigen::Vector3f(2.0f, 0.0f, 0.0f);
+		normals[i] = Eigen::Vector3f(uniform(gen), uniform(gen), uniform(gen)).normalized();
+	}
+
+	// ascii values are written with 6 decimals
+	const float ascii_tolerance = 1e-5f;
+
+	int errors = 0;
+	std::vector<Eigen::Vector3f> loaded_points, loaded_normals;
+
+	// with normals
+	ReaderWriterPLY::Write("ply_roundtrip_ascii.ply", points, normals, 1.0f, PLY_ASCII);
+	ReaderWriterPLY::Read("ply_roundtrip_ascii.ply", loaded_points, loaded_normals);
+	errors += Compare("ascii with normals", points, normals, loaded_points, loaded_normals, ascii_tolerance);
+
+	ReaderWriterPLY::Write("ply_roundtrip_binary.ply", points, normals, 1.0f, PLY_BINARY_LE);
+	ReaderWriterPLY::Read("ply_roundtrip_binary.ply", loaded_points, loaded_normals);
+	errors += Compare("binary_little_endian with normals", points, normals, loaded_points, loaded_normals, 0.0f);
+
+	// without normals
+	WritePointsOnly("ply_roundtrip_ascii_xyz.ply", points, PLY_ASCII);
+	ReaderWriterPLY::Read("ply_roundtrip_ascii_xyz.ply", loaded_points, loaded_normals);
+	errors += Compare("ascii without normals", points, zero_normals, loaded_points, loaded_normals, ascii_tolerance);
+
+	WritePointsOnly("ply_roundtrip_binary_xyz.ply", points, PLY_BINARY_LE);
+	ReaderWriterPLY::Read("ply_roundtrip_binary_xyz.ply", loaded_points, loaded_normals);
+	errors += Compare("binary_little_endian without normals", points, zero_normals, loaded_points, loaded_normals, 0.0f);
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - ReaderWriterPLY: " << errors << " round trips failed." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - ReaderWriterPLY: all round trips passed." << std::endl;
+	return 0;
+}
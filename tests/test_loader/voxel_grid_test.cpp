@@ -0,0 +1,158 @@
+/*
+@file voxel_grid_test.cpp
+
+This file tests the voxel grid filter (VoxelGrid) with a small point cloud.
+It compares the output with a per-voxel averaging that accumulates the points of each voxel in a map:
+the first point, the centroid, and the centroid with the normalized average normal vector.
+The voxels must appear in the order of their first point, for every number of threads.
+
+Usage:
+	test_voxel_grid
+
+MIT License
+-----------------------------------------------------------------------------------------------------------------------------
+Last edited:
+
+Oct 17, 2026
+- Added the voxel grid test.
+
+*/
+
+// STL
+#include <iostream>
+#include <vector>
+#include <random>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// TrackingExpert
+#include "VoxelGrid.h"
+
+using namespace texpert;
+
+
+/*
+Per-voxel averaging of all finite points in the order of the first point of each voxel.
+*/
+void AverageVoxels(const PointCloud& src, const Eigen::Vector3f& grid, VoxelRepresentative representative,
+	std::vector<Eigen::Vector3f>& points, std::vector<Eigen::Vector3f>& normals)
+{
+	typedef std::tuple<long long, long long, long long> Key;
+
+	typedef struct _Voxel {
+		int				first;
+		int				count;
+		Eigen::Vector3f	point_sum;
+		Eigen::Vector3f	normal_sum;
+	}Voxel;
+
+	Eigen::Vector3f min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+	for (const Eigen::Vector3f& p : src.points) {
+		if (p.allFinite()) min = min.cwiseMin(p);
+	}
+	Eigen::Vector3f inv_grid = grid.cwiseInverse();
+
+	std::map<Key, int> voxel_id;
+	std::vector<Voxel> voxels;
+
+	for (size_t i = 0; i < src.points.size(); i++) {
+		const Eigen::Vector3f& p = src.points[i];
+		if (!p.allFinite()) continue;
+
+		Eigen::Vector3f c = (p - min).cwiseProduct(inv_grid);
+		Key key((long long)std::floor(c.x()), (long long)std::floor(c.y()), (long long)std::floor(c.z()));
+
+		auto it = voxel_id.find(key);
+		if (it == voxel_id.end()) {
+			voxel_id[key] = (int)voxels.size();
+			voxels.push_back(Voxel{ (int)i, 1, p, src.normals[i] });
+		}
+		else {
+			Voxel& v = voxels[it->second];
+			v.count++;
+			v.point_sum += p;
+			v.normal_sum += src.normals[i];
+		}
+	}
+
+	points.clear();
+	normals.clear();
+	for (const Voxel& v : voxels) {
+		switch (representative) {
+		case VOXEL_FIRST:
+			points.push_back(src.points[v.first]);
+			normals.push_back(src.normals[v.first]);
+			break;
+		case VOXEL_CENTROID:
+			points.push_back(v.point_sum / (float)v.count);
+			normals.push_back(src.normals[v.first]);
+			break;
+		case VOXEL_NORMAL_AVERAGE:
+			points.push_back(v.point_sum / (float)v.count);
+			normals.push_back(v.normal_sum.normalized());
+			break;
+		}
+	}
+}
+
+
+int main(void)
+{
+	std::mt19937 gen(5);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+	PointCloud cloud;
+	for (int i = 0; i < 3000; i++) {
+		cloud.points.push_back(Eigen::Vector3f(uniform(gen), 0.5f * uniform(gen), 0.2f * uniform(gen)));
+		cloud.normals.push_back(Eigen::Vector3f(uniform(gen), uniform(gen), 1.0f).normalized());
+	}
+	// non-finite points are skipped
+	cloud.points[10] = Eigen::Vector3f(std::numeric_limits<float>::quiet_NaN(), 0.0f, 0.0f);
+	cloud.size();
+
+	const Eigen::Vector3f grid(0.1f, 0.1f, 0.1f);
+	const VoxelRepresentative representatives[3] = { VOXEL_FIRST, VOXEL_CENTROID, VOXEL_NORMAL_AVERAGE };
+	const int threads[3] = { 1, 2, 4 };
+
+	int errors = 0;
+
+	for (VoxelRepresentative representative : representatives) {
+		std::vector<Eigen::Vector3f> ref_points, ref_normals;
+		AverageVoxels(cloud, grid, representative, ref_points, ref_normals);
+
+		for (int num_threads : threads) {
+			VoxelGrid voxel_grid;
+			voxel_grid.setGridSize(grid.x(), grid.y(), grid.z());
+			voxel_grid.setRepresentative(representative);
+			voxel_grid.setNumThreads(num_threads);
+
+			PointCloud out;
+			voxel_grid.filter(cloud, out);
+
+			int wrong = 0;
+			if (out.points.size() != ref_points.size() || out.normals.size() != ref_normals.size()) {
+				wrong = (int)ref_points.size();
+			}
+			else {
+				for (size_t i = 0; i < ref_points.size(); i++) {
+					if ((out.points[i] - ref_points[i]).norm() > 1e-5f || (out.normals[i] - ref_normals[i]).norm() > 1e-5f) wrong++;
+				}
+			}
+			if (wrong > 0) errors++;
+
+			std::cout << "[INFO] - representative " << representative << ", " << num_threads << " threads: " << out.points.size()
+				<< " voxels, reference " << ref_points.size() << " voxels, " << wrong << " different." << std::endl;
+		}
+	}
+
+	if (errors > 0) {
+		std::cout << "[ERROR] - VoxelGrid: " << errors << " runs differ from the per-voxel averaging." << std::endl;
+		return 1;
+	}
+
+	std::cout << "[INFO] - VoxelGrid: all runs identical to the per-voxel averaging." << std::endl;
+	return 0;
+}